@@ -8,6 +8,14 @@
 #include "trasterimage.h"
 #include "trop.h"
 #include "tpixelutils.h"
+#include "tsystem.h"
+#include "tthread.h"
+
+#include <QDateTime>
+
+#include <map>
+#include <list>
+#include <algorithm>
 
 /*
   The entire content of this file is ridden with LEAKS. A bug has been filed,
@@ -34,7 +42,7 @@
 std::string buildErrorString(int error);
 
 void readChannel(FILE *f, TPSDLayerInfo *li, TPSDChannelInfo *chan,
-                 int channels, TPSDHeaderInfo *h);
+                 int channels, TPSDHeaderInfo *h, bool readZipData = true);
 void readLongData(FILE *f, struct dictentry *parent, TPSDLayerInfo *li);
 void readByteData(FILE *f, struct dictentry *parent, TPSDLayerInfo *li);
 void readKey(FILE *f, struct dictentry *parent, TPSDLayerInfo *li);
@@ -51,6 +59,81 @@ static char swapByte(unsigned char src) {
   return out;
 }
 
+//=============================================================================
+// Layer index cache
+//
+// Parsing the header and the layer records of a big psd is expensive, and a
+// reader is built for each level (and each psd parser) referring to the file.
+// The parsed records are kept per file and modification time, and shared by
+// all readers; the channel row tables of each layer are appended lazily the
+// first time the layer is loaded. Only the most recently used files stay in
+// the table - evicted indices live on until their last reader is destroyed.
+// The index owns the records: readers only copy their pointers.
+
+namespace {
+void freeChannels(TPSDChannelInfo *chan, int channels) {
+  for (int ch = 0; ch < channels; ++ch) {
+    free(chan[ch].rowpos);
+    free(chan[ch].unzipdata);
+  }
+}
+}  // namespace
+
+struct TPSDFileIndex {
+  QDateTime m_date;
+  TPSDHeaderInfo m_headerInfo;
+  std::vector<bool> m_indexedLayers;  // layers whose row tables are read
+  std::vector<TPSDChannelInfo> m_mergedChans;
+
+  QMutex m_mutex;  // protects the lazily built channel tables
+
+  TPSDFileIndex() : m_headerInfo() {}
+  ~TPSDFileIndex() {
+    if (!m_mergedChans.empty())
+      freeChannels(&m_mergedChans[0], (int)m_mergedChans.size());
+
+    TPSDLayerInfo *linfo = m_headerInfo.linfo;
+    if (!linfo) return;
+    for (int i = 0; i < m_headerInfo.layersCount; ++i) {
+      TPSDLayerInfo *li = linfo + i;
+      if (li->chan) {
+        freeChannels(li->chan, li->channels);
+        free(li->chan);
+      }
+      if (li->chindex) free(li->chindex - 2);  // see readLayerInfo()
+      free(li->name);
+      free(li->nameno);
+    }
+    free(linfo);
+  }
+
+  TPSDFileIndex(const TPSDFileIndex &) = delete;
+  TPSDFileIndex &operator=(const TPSDFileIndex &) = delete;
+};
+
+namespace {
+const int PsdIndexTableSize = 16;
+
+QMutex psdIndexMutex;
+std::map<TFilePath, std::shared_ptr<TPSDFileIndex>> psdIndexTable;
+std::list<TFilePath> psdIndexUses;  // most recently used first
+
+// Marks the file's index as the most recently used one, and evicts the
+// least recently used indices exceeding the table size. Requires
+// psdIndexMutex to be locked.
+void touchPsdIndex(const TFilePath &path) {
+  psdIndexUses.remove(path);
+  psdIndexUses.push_front(path);
+
+  while ((int)psdIndexUses.size() > PsdIndexTableSize) {
+    psdIndexTable.erase(psdIndexUses.back());
+    psdIndexUses.pop_back();
+  }
+}
+}  // namespace
+
+//=============================================================================
+
 TPSDReader::TPSDReader(const TFilePath &path)
     : m_shrinkX(1), m_shrinkY(1), m_region(TRect()) {
   m_layerId    = 0;
@@ -62,12 +145,40 @@ TPSDReader::TPSDReader(const TFilePath &path)
   m_path = path.getParentDir() + TFilePath(name.toStdString());
   // m_path = path;
   QMutexLocker sl(&m_mutex);
+
+  QDateTime date = TFileStatus(m_path).getLastModificationTime();
+  {
+    QMutexLocker indexLocker(&psdIndexMutex);
+    std::map<TFilePath, std::shared_ptr<TPSDFileIndex>>::iterator it =
+        psdIndexTable.find(m_path);
+    if (it != psdIndexTable.end() && it->second->m_date == date) {
+      m_index = it->second;
+      touchPsdIndex(m_path);
+    }
+  }
+  if (m_index) {
+    m_headerInfo = m_index->m_headerInfo;
+    return;
+  }
+
   openFile();
-  if (!doInfo()) {
-    fclose(m_file);
+  bool ok = doInfo();
+  fclose(m_file);
+
+  // the index takes ownership of the parsed records, even partial ones
+  m_index.reset(new TPSDFileIndex);
+  m_index->m_headerInfo = m_headerInfo;
+  if (!ok) {
+    m_index.reset();
     throw TImageException(m_path, "Do PSD INFO ERROR");
   }
-  fclose(m_file);
+
+  m_index->m_date       = date;
+  m_index->m_indexedLayers.resize(std::max(m_headerInfo.layersCount, 0), false);
+
+  QMutexLocker indexLocker(&psdIndexMutex);
+  psdIndexTable[m_path] = m_index;
+  touchPsdIndex(m_path);
 }
 TPSDReader::~TPSDReader() {
   /*for(int i=0; i<m_headerInfo.layersCount;i++)
@@ -94,6 +205,8 @@ int TPSDReader::openFile() {
   return 0;
 }
 bool TPSDReader::doInfo() {
+  m_headerInfo.layersCount = 0;
+  m_headerInfo.linfo       = NULL;
   // Read Header Block
   if (!doHeaderInfo()) return false;
   // Read Color Mode Data Block
@@ -192,6 +305,7 @@ bool TPSDReader::doLayerAndMaskInfo() {
   psdByte layerlen;
 
   m_headerInfo.layersCount = 0;
+  m_headerInfo.linfo       = NULL;
   m_headerInfo.lmilen      = read4Bytes(m_file);
   m_headerInfo.lmistart    = ftell(m_file);
   if (m_headerInfo.lmilen) {
@@ -220,12 +334,25 @@ bool TPSDReader::doLayersInfo() {
     m_headerInfo.layersCount = -m_headerInfo.layersCount;
   }
   if (!m_headerInfo.linfoBlockEmpty) {
-    m_headerInfo.linfo = (TPSDLayerInfo *)mymalloc(
-        m_headerInfo.layersCount * sizeof(struct TPSDLayerInfo));
+    // zeroed, so that the index can tell what was allocated
+    m_headerInfo.linfo = (TPSDLayerInfo *)calloc(
+        m_headerInfo.layersCount, sizeof(struct TPSDLayerInfo));
+    if (!m_headerInfo.linfo) m_headerInfo.layersCount = 0;
     int i = 0;
     for (i = 0; i < m_headerInfo.layersCount; i++) {
       readLayerInfo(i);
     }
+
+    // channels image data follows the layer records, in the same order
+    psdByte dataPos = ftell(m_file);
+    for (i = 0; i < m_headerInfo.layersCount; i++) {
+      TPSDLayerInfo *li = m_headerInfo.linfo + i;
+      li->startDataPos  = dataPos;
+      li->dataLength    = 0;
+      for (int ch = 0; li->chan && ch < li->channels; ch++)
+        li->dataLength += li->chan[ch].length;
+      dataPos += li->dataLength;
+    }
   }
   return true;
 }
@@ -245,11 +372,12 @@ bool TPSDReader::readLayerInfo(int i) {
       li->channels > 64)  // sanity ck
   {
     // qualcosa è andato storto, skippo il livello
+    li->chan = NULL;
     fseek(m_file, 6 * li->channels + 12, SEEK_CUR);
     skipBlock(m_file);  // skip  "layer info: extra data";
   } else {
-    li->chan = (TPSDChannelInfo *)mymalloc(li->channels *
-                                           sizeof(struct TPSDChannelInfo));
+    li->chan = (TPSDChannelInfo *)calloc(li->channels,
+                                         sizeof(struct TPSDChannelInfo));
     li->chindex = (int *)mymalloc((li->channels + 2) * sizeof(int));
     li->chindex += 2;  //
 
@@ -321,50 +449,17 @@ void TPSDReader::doImage(TRasterP &rasP, int layerId) {
   m_layerId         = layerId;
   int layerIndex    = getLayerInfoIndexById(layerId);
   TPSDLayerInfo *li = getLayerInfo(layerIndex);
-  psdByte imageDataEnd;
-  // retrieve start data pos
-  psdByte startPos = ftell(m_file);
-  if (m_headerInfo.layersCount > 0) {
-    struct TPSDLayerInfo *lilast =
-        &m_headerInfo.linfo[m_headerInfo.layersCount - 1];
-    startPos = lilast->additionalpos + lilast->additionallen;
-  }
-  if (layerIndex > 0) {
-    for (int j = 0; j < layerIndex; j++) {
-      struct TPSDLayerInfo *liprev = &m_headerInfo.linfo[j];
-      for (int ch = 0; ch < liprev->channels; ch++) {
-        startPos += liprev->chan[ch].length;
-      }
-    }
-  }
-  fseek(m_file, startPos, SEEK_SET);
 
   long pixw    = li ? li->right - li->left : m_headerInfo.cols;
   long pixh    = li ? li->bottom - li->top : m_headerInfo.rows;
   int channels = li ? li->channels : m_headerInfo.channels;
 
-  if (li == NULL)
-    fseek(m_file, m_headerInfo.lmistart + m_headerInfo.lmilen, SEEK_SET);
-
   psdPixel rows = pixh;
   psdPixel cols = pixw;
 
-  int ch = 0;
-  psdByte **rowpos;
-
-  rowpos = (psdByte **)mymalloc(channels * sizeof(psdByte *));
-
-  for (ch = 0; ch < channels; ++ch) {
-    psdPixel chrows =
-        li && !m_headerInfo.linfoBlockEmpty && li->chan[ch].id == -2
-            ? li->mask.rows
-            : rows;
-    rowpos[ch] = (psdByte *)mymalloc((chrows + 1) * sizeof(psdByte));
-  }
-
+  int ch          = 0;
   int tnzchannels = 0;
 
-  int depth = m_headerInfo.depth;
   switch (m_headerInfo.mode) {
   // default: // multichannel, cmyk, lab etc
   //	split = 1;
@@ -396,24 +491,55 @@ void TPSDReader::doImage(TRasterP &rasP, int layerId) {
   }
 
   if (!li || m_headerInfo.linfoBlockEmpty) {  // merged channel
-    TPSDChannelInfo *mergedChans =
-        (TPSDChannelInfo *)mymalloc(channels * sizeof(struct TPSDChannelInfo));
-
-    readChannel(m_file, NULL, mergedChans, channels, &m_headerInfo);
-    imageDataEnd = ftell(m_file);
-    readImageData(rasP, NULL, mergedChans, tnzchannels, rows, cols);
-    free(mergedChans);
+    std::vector<TPSDChannelInfo> mergedChans = indexMergedChannels(channels);
+    readImageData(rasP, NULL, &mergedChans[0], tnzchannels, rows, cols);
   } else {
+    indexLayerChannels(layerIndex);
+
+    // ZIP channels are inflated in a private copy of the channels info, and
+    // released as soon as the layer has been read
+    std::vector<TPSDChannelInfo> chans(li->chan, li->chan + channels);
     for (ch = 0; ch < channels; ++ch) {
-      readChannel(m_file, li, li->chan + ch, 1, &m_headerInfo);
+      TPSDChannelInfo &chan = chans[ch];
+      if (chan.comptype != ZIPWITHOUTPREDICTION &&
+          chan.comptype != ZIPWITHPREDICTION)
+        continue;
+      chan.unzipdata = NULL;
+      fseek(m_file, chan.filepos - 2, SEEK_SET);
+      readChannel(m_file, li, &chan, 1, &m_headerInfo);
+    }
+    try {
+      readImageData(rasP, li, &chans[0], tnzchannels, rows, cols);
+    } catch (...) {
+      for (ch = 0; ch < channels; ++ch) free(chans[ch].unzipdata);
+      throw;
     }
-    imageDataEnd = ftell(m_file);
-    readImageData(rasP, li, li->chan, tnzchannels, rows, cols);
+    for (ch = 0; ch < channels; ++ch) free(chans[ch].unzipdata);
+  }
+}
+
+void TPSDReader::indexLayerChannels(int layerIndex) {
+  QMutexLocker sl(&m_index->m_mutex);
+  if (m_index->m_indexedLayers[layerIndex]) return;
+
+  TPSDLayerInfo *li = m_headerInfo.linfo + layerIndex;
+  fseek(m_file, li->startDataPos, SEEK_SET);
+  for (int ch = 0; ch < li->channels; ++ch) {
+    li->chan[ch].unzipdata = NULL;
+    readChannel(m_file, li, li->chan + ch, 1, &m_headerInfo, false);
   }
-  fseek(m_file, imageDataEnd, SEEK_SET);
+  m_index->m_indexedLayers[layerIndex] = true;
+}
 
-  for (ch = 0; ch < channels; ++ch) free(rowpos[ch]);
-  free(rowpos);
+std::vector<TPSDChannelInfo> TPSDReader::indexMergedChannels(int channels) {
+  QMutexLocker sl(&m_index->m_mutex);
+  std::vector<TPSDChannelInfo> &mergedChans = m_index->m_mergedChans;
+  if ((int)mergedChans.size() != channels) {
+    mergedChans.resize(channels);
+    fseek(m_file, m_headerInfo.lmistart + m_headerInfo.lmilen, SEEK_SET);
+    readChannel(m_file, NULL, &mergedChans[0], channels, &m_headerInfo);
+  }
+  return mergedChans;
 }
 
 void TPSDReader::load(TRasterImageP &img, int layerId) {
@@ -514,24 +640,15 @@ TPSDHeaderInfo TPSDReader::getPSDHeaderInfo() { return m_headerInfo; }
 void TPSDReader::readImageData(TRasterP &rasP, TPSDLayerInfo *li,
                                TPSDChannelInfo *chan, int chancount,
                                psdPixel rows, psdPixel cols) {
-  int channels = li ? li->channels : m_headerInfo.channels;
-
   short depth = m_headerInfo.depth;
 
-  psdByte savepos = ftell(m_file);
   if (rows == 0 || cols == 0) return;
-  psdPixel j;
-
-  unsigned char *inrows[4], *rledata;
 
-  int ch, map[4];
+  int ch;
+  std::vector<int> map(chancount);
 
-  rledata = (unsigned char *)mymalloc(chan->rowbytes * 2);
-
-  for (ch = 0; ch < chancount; ++ch) {
-    inrows[ch] = (unsigned char *)mymalloc(chan->rowbytes);
-    map[ch]    = li && chancount > 1 ? li->chindex[ch] : ch;
-  }
+  for (ch = 0; ch < chancount; ++ch)
+    map[ch] = li && chancount > 1 ? li->chindex[ch] : ch;
 
   // find the alpha channel, if needed
   if (li && (chancount == 2 || chancount == 4)) {  // grey+alpha
@@ -551,19 +668,13 @@ void TPSDReader::readImageData(TRasterP &rasP, TPSDLayerInfo *li,
   if (!m_region.isEmpty()) {
     x0 = m_region.getP00().x;
     // se x0 è fuori dalle dimensioni dell'immagine ritorna un'immagine vuota
-    if (x0 >= m_headerInfo.cols) {
-      free(rledata);
-      return;
-    }
+    if (x0 >= m_headerInfo.cols) return;
     x1 = x0 + m_region.getLx() - 1;
     // controllo che x1 rimanga all'interno dell'immagine
     if (x1 >= m_headerInfo.cols) x1 = m_headerInfo.cols - 1;
     y0                              = m_region.getP00().y;
     // se y0 è fuori dalle dimensioni dell'immagine ritorna un'immagine vuota
-    if (y0 >= m_headerInfo.rows) {
-      free(rledata);
-      return;
-    }
+    if (y0 >= m_headerInfo.rows) return;
     y1 = y0 + m_region.getLy() - 1;
     // controllo che y1 rimanga all'interno dell'immagine
     if (y1 >= m_headerInfo.rows) y1 = m_headerInfo.rows - 1;
@@ -614,10 +725,7 @@ void TPSDReader::readImageData(TRasterP &rasP, TPSDLayerInfo *li,
   // Se è tutta fuori restutuisco TRasterImageP()
   layerSaveBox *= imageRect;
 
-  if (layerSaveBox == TRect() || layerSaveBox.isEmpty()) {
-    free(rledata);
-    return;
-  }
+  if (layerSaveBox == TRect() || layerSaveBox.isEmpty()) return;
   // Estraggo da rasP solo il rettangolo che si interseca con il livello
   // corrente
   // stando attento a prendere i pixel giusti.
@@ -650,173 +758,182 @@ void TPSDReader::readImageData(TRasterP &rasP, TPSDLayerInfo *li,
   // Trovo l'indice della prima riga del livello che deve essere letta
   // L'indice è riferito al livello.
   // Nota che nel file photoshop le righe sono memorizzate dall'ultima alla
-  // prima.
-  int rowOffset = std::abs(sby1) % m_shrinkY;
-  int rowCount  = rowOffset;
-  // if(m_shrinkY==3) rowCount--;
-  for (j = 0; j < smallRas->getLy(); j++) {
-    for (ch = 0; ch < chancount; ++ch) {
-      /* get row data */
-      if (map[ch] < 0 || map[ch] > chancount) {
-        // warn("bad map[%d]=%d, skipping a channel", i, map[i]);
-        memset(inrows[ch], 0, chan->rowbytes);  // zero out the row
-      } else
-        readrow(m_file, chan + map[ch], rowCount, inrows[ch], rledata);
-    }
-    // se la riga corrente non rientra nell'immagine salto la copia
-    if (sby1 - rowCount < 0 || sby1 - rowCount > m_headerInfo.rows - 1) {
-      rowCount += m_shrinkY;
-      continue;
-    }
-    if (depth == 1 && chancount == 1) {
-      if (!(layerSaveBox.getP00().x - sbx0 >= 0 &&
-            layerSaveBox.getP00().x - sbx0 + smallRas->getLx() / 8 - 1 <
-                chan->rowbytes))
-        throw TImageException(
-            m_path, "Unable to read image with this depth and channels values");
-      smallRas->lock();
-      unsigned char *rawdata =
-          (unsigned char *)smallRas->getRawData(0, smallRas->getLy() - j - 1);
-      TPixelGR8 *pix = (TPixelGR8 *)rawdata;
-      int colCount   = colOffset;
-      for (int k = 0; k < smallRas->getLx(); k += 8) {
-        char value = ~inrows[0][layerSaveBox.getP00().x - sbx0 + colCount];
-        pix[k].setValue(value);
-        pix[k + 1].setValue(value);
-        pix[k + 2].setValue(value);
-        pix[k + 3].setValue(value);
-        pix[k + 4].setValue(value);
-        pix[k + 5].setValue(value);
-        pix[k + 6].setValue(value);
-        pix[k + 7].setValue(value);
-        colCount += m_shrinkX;
-      }
-      smallRas->unlock();
-    } else if (depth == 8 && chancount > 1) {
-      if (!(layerSaveBox.getP00().x - sbx0 >= 0 &&
-            layerSaveBox.getP00().x - sbx0 + smallRas->getLx() - 1 <
-                chan->rowbytes))
-        throw TImageException(
-            m_path, "Unable to read image with this depth and channels values");
-      smallRas->lock();
-      unsigned char *rawdata =
-          (unsigned char *)smallRas->getRawData(0, smallRas->getLy() - j - 1);
-      TPixel32 *pix = (TPixel32 *)rawdata;
-      int colCount  = colOffset;
-      for (int k = 0; k < smallRas->getLx(); k++) {
-        if (chancount >= 3) {
-          pix[k].r = inrows[0][layerSaveBox.getP00().x - sbx0 + colCount];
-          pix[k].g = inrows[1][layerSaveBox.getP00().x - sbx0 + colCount];
-          pix[k].b = inrows[2][layerSaveBox.getP00().x - sbx0 + colCount];
-          if (chancount == 4)  // RGB + alpha
-            pix[k].m = inrows[3][layerSaveBox.getP00().x - sbx0 + colCount];
-          else
-            pix[k].m = 255;
-        } else if (chancount <= 2)  // gray + alpha
-        {
-          pix[k].r = inrows[0][layerSaveBox.getP00().x - sbx0 + colCount];
-          pix[k].g = inrows[0][layerSaveBox.getP00().x - sbx0 + colCount];
-          pix[k].b = inrows[0][layerSaveBox.getP00().x - sbx0 + colCount];
-          if (chancount == 2)
-            pix[k].m = inrows[1][layerSaveBox.getP00().x - sbx0 + colCount];
-          else
-            pix[k].m = 255;
-        }
-        colCount += m_shrinkX;
-      }
+  // prima. La riga in cima a smallRas e' lry1, che puo' essere sotto la prima
+  // riga del livello se la regione lo taglia.
+  int rowOffset = sby1 - lry1 * m_shrinkY;
+  assert(rowOffset >= 0);
+  int rowsCount = smallRas->getLy();
+  int lastRow   = rowOffset + (rowsCount - 1) * m_shrinkY;
+
+  // the first byte of the row data used by smallRas
+  int dataX0 = layerSaveBox.getP00().x - sbx0 + colOffset;
+  int dataLx = (depth == 1 && chancount == 1) ? smallRas->getLx() / 8
+                                               : smallRas->getLx();
+  if (!(layerSaveBox.getP00().x - sbx0 >= 0 &&
+        layerSaveBox.getP00().x - sbx0 + dataLx - 1 < chan->rowbytes) ||
+      !((depth == 1 && chancount == 1) || depth == 8 ||
+        m_headerInfo.depth == 16))
+    throw TImageException(
+        m_path, "Unable to read image with this depth and channels values");
+
+  // Read the compressed data of the needed rows with a single read per
+  // channel; rows are then decoded in parallel without touching the file.
+  std::vector<std::vector<unsigned char>> chanData(chancount);
+  std::vector<psdByte> chanDataPos(chancount, 0);
+  for (ch = 0; ch < chancount; ++ch) {
+    if (map[ch] < 0 || map[ch] > chancount) continue;
+    TPSDChannelInfo *c = chan + map[ch];
+    psdPixel r0        = std::min<psdPixel>(rowOffset, c->rows);
+    psdPixel r1        = std::min<psdPixel>(lastRow + 1, c->rows);
+    if (r0 >= r1) continue;
+
+    psdByte pos0, pos1;
+    if (c->comptype == RAWDATA) {
+      pos0 = c->filepos + c->rowbytes * r0;
+      pos1 = c->filepos + c->rowbytes * r1;
+    } else if (c->comptype == RLECOMP) {
+      pos0 = c->rowpos[r0];
+      pos1 = c->rowpos[r1];
+    } else
+      continue;  // ZIP data is already inflated in memory
 
-      smallRas->unlock();
-    } else if (m_headerInfo.depth == 8 && chancount == 1) {
-      if (!(layerSaveBox.getP00().x - sbx0 >= 0 &&
-            layerSaveBox.getP00().x - sbx0 + smallRas->getLx() - 1 <
-                chan->rowbytes))
-        throw TImageException(
-            m_path, "Unable to read image with this depth and channels values");
-      smallRas->lock();
-      unsigned char *rawdata =
-          (unsigned char *)smallRas->getRawData(0, smallRas->getLy() - j - 1);
+    if (pos1 <= pos0 || fseek(m_file, pos0, SEEK_SET) == -1) continue;
+    chanData[ch].resize(pos1 - pos0);
+    chanData[ch].resize(fread(&chanData[ch][0], 1, pos1 - pos0, m_file));
+    chanDataPos[ch] = pos0;
+  }
 
-      TPixelGR8 *pix = (TPixelGR8 *)rawdata;
-      int colCount   = colOffset;
-      for (int k = 0; k < smallRas->getLx(); k++) {
-        pix[k].setValue(inrows[0][layerSaveBox.getP00().x - sbx0 + colCount]);
-        colCount += m_shrinkX;
+  // Decodes the specified row of a tnz channel into buffer. Missing data is
+  // zeroed out.
+  auto decodeRow = [&](int ch, psdPixel row, unsigned char *buffer) {
+    psdPixel n = 0;
+    if (map[ch] >= 0 && map[ch] <= chancount) {
+      TPSDChannelInfo *c = chan + map[ch];
+      psdByte dataSize   = chanData[ch].size();
+      if (row < c->rows) {
+        switch (c->comptype) {
+        case RAWDATA: {
+          psdByte ofs = c->filepos + c->rowbytes * row - chanDataPos[ch];
+          n = std::max<psdByte>(0, std::min(c->rowbytes, dataSize - ofs));
+          if (n > 0) memcpy(buffer, &chanData[ch][ofs], n);
+          break;
+        }
+        case RLECOMP: {
+          psdByte ofs = c->rowpos[row] - chanDataPos[ch];
+          psdByte len = std::min(c->rowpos[row + 1] - c->rowpos[row],
+                                 dataSize - ofs);
+          if (ofs >= 0 && len > 0)
+            n = unpackrow(buffer, &chanData[ch][ofs], c->rowbytes, len);
+          break;
+        }
+        case ZIPWITHPREDICTION:
+        case ZIPWITHOUTPREDICTION:
+          memcpy(buffer, c->unzipdata + c->rowbytes * row, c->rowbytes);
+          n = c->rowbytes;
+          break;
+        }
       }
-      smallRas->unlock();
-    } else if (m_headerInfo.depth == 16 && chancount == 1 &&
-               m_headerInfo.mergedalpha)  // mergedChannels
-    {
-      if (!(layerSaveBox.getP00().x - sbx0 >= 0 &&
-            layerSaveBox.getP00().x - sbx0 + smallRas->getLx() - 1 <
-                chan->rowbytes))
-        throw TImageException(
-            m_path, "Unable to read image with this depth and channels values");
-      smallRas->lock();
+    }
+    // zero out unwritten part of row
+    if (n < chan->rowbytes) memset(buffer + n, 0, chan->rowbytes - n);
+  };
+
+  smallRas->lock();
+  TThread::parallelFor(0, rowsCount, [&](int j0, int j1) {
+    std::vector<unsigned char> rowsBuffer(chancount * chan->rowbytes);
+    std::vector<unsigned char *> inrows(chancount);
+    for (int ch = 0; ch < chancount; ++ch)
+      inrows[ch] = &rowsBuffer[ch * chan->rowbytes];
+
+    for (int j = j0; j < j1; ++j) {
+      int rowCount = rowOffset + j * m_shrinkY;
+      // se la riga corrente non rientra nell'immagine salto la copia
+      if (sby1 - rowCount < 0 || sby1 - rowCount > m_headerInfo.rows - 1)
+        continue;
+      for (int ch = 0; ch < chancount; ++ch)
+        decodeRow(ch, rowCount, inrows[ch]);
+
       unsigned char *rawdata =
           (unsigned char *)smallRas->getRawData(0, smallRas->getLy() - j - 1);
-      TPixelGR8 *pix = (TPixelGR8 *)rawdata;
-      int colCount   = colOffset;
-      for (int k = 0; k < smallRas->getLx(); k++) {
-        pix[k].setValue(inrows[0][layerSaveBox.getP00().x - sbx0 + colCount]);
-        colCount += m_shrinkX;
-      }
-      smallRas->unlock();
-    } else if (m_headerInfo.depth == 16) {
-      if (!(layerSaveBox.getP00().x - sbx0 >= 0 &&
-            layerSaveBox.getP00().x - sbx0 + smallRas->getLx() - 1 <
-                chan->rowbytes))
-        throw TImageException(
-            m_path, "Unable to read image with this depth and channels values");
-      smallRas->lock();
-      unsigned short *rawdata =
-          (unsigned short *)smallRas->getRawData(0, smallRas->getLy() - j - 1);
-      TPixel64 *pix = (TPixel64 *)rawdata;
-      int colCount  = colOffset;
-      for (int k = 0; k < smallRas->getLx(); k++) {
-        if (chancount >= 3) {
-          pix[k].r = swapShort(
-              ((psdUint16 *)
-                   inrows[0])[layerSaveBox.getP00().x - sbx0 + colCount]);
-          pix[k].g = swapShort(
-              ((psdUint16 *)
-                   inrows[1])[layerSaveBox.getP00().x - sbx0 + colCount]);
-          pix[k].b = swapShort(
-              ((psdUint16 *)
-                   inrows[2])[layerSaveBox.getP00().x - sbx0 + colCount]);
-        } else if (chancount <= 2) {
-          pix[k].r = swapShort(
-              ((psdUint16 *)
-                   inrows[0])[layerSaveBox.getP00().x - sbx0 + colCount]);
-          pix[k].g = swapShort(
-              ((psdUint16 *)
-                   inrows[0])[layerSaveBox.getP00().x - sbx0 + colCount]);
-          pix[k].b = swapShort(
-              ((psdUint16 *)
-                   inrows[0])[layerSaveBox.getP00().x - sbx0 + colCount]);
-          if (chancount == 2)
-            pix[k].m = swapShort(
-                ((psdUint16 *)
-                     inrows[1])[layerSaveBox.getP00().x - sbx0 + colCount]);
+      int colCount = dataX0;
+
+      if (depth == 1 && chancount == 1) {
+        TPixelGR8 *pix = (TPixelGR8 *)rawdata;
+        for (int k = 0; k < smallRas->getLx(); k += 8) {
+          char value = ~inrows[0][colCount];
+          pix[k].setValue(value);
+          pix[k + 1].setValue(value);
+          pix[k + 2].setValue(value);
+          pix[k + 3].setValue(value);
+          pix[k + 4].setValue(value);
+          pix[k + 5].setValue(value);
+          pix[k + 6].setValue(value);
+          pix[k + 7].setValue(value);
+          colCount += m_shrinkX;
+        }
+      } else if (depth == 8 && chancount > 1) {
+        TPixel32 *pix = (TPixel32 *)rawdata;
+        for (int k = 0; k < smallRas->getLx(); k++) {
+          if (chancount >= 3) {
+            pix[k].r = inrows[0][colCount];
+            pix[k].g = inrows[1][colCount];
+            pix[k].b = inrows[2][colCount];
+            if (chancount == 4)  // RGB + alpha
+              pix[k].m = inrows[3][colCount];
+            else
+              pix[k].m = 255;
+          } else if (chancount <= 2)  // gray + alpha
+          {
+            pix[k].r = inrows[0][colCount];
+            pix[k].g = inrows[0][colCount];
+            pix[k].b = inrows[0][colCount];
+            if (chancount == 2)
+              pix[k].m = inrows[1][colCount];
+            else
+              pix[k].m = 255;
+          }
+          colCount += m_shrinkX;
+        }
+      } else if (m_headerInfo.depth == 8 && chancount == 1) {
+        TPixelGR8 *pix = (TPixelGR8 *)rawdata;
+        for (int k = 0; k < smallRas->getLx(); k++) {
+          pix[k].setValue(inrows[0][colCount]);
+          colCount += m_shrinkX;
+        }
+      } else if (m_headerInfo.depth == 16 && chancount == 1 &&
+                 m_headerInfo.mergedalpha)  // mergedChannels
+      {
+        TPixelGR8 *pix = (TPixelGR8 *)rawdata;
+        for (int k = 0; k < smallRas->getLx(); k++) {
+          pix[k].setValue(inrows[0][colCount]);
+          colCount += m_shrinkX;
+        }
+      } else if (m_headerInfo.depth == 16) {
+        TPixel64 *pix          = (TPixel64 *)rawdata;
+        psdUint16 *inrows16[4] = {0, 0, 0, 0};
+        for (int ch = 0; ch < chancount && ch < 4; ++ch)
+          inrows16[ch] = (psdUint16 *)inrows[ch];
+        for (int k = 0; k < smallRas->getLx(); k++) {
+          if (chancount >= 3) {
+            pix[k].r = swapShort(inrows16[0][colCount]);
+            pix[k].g = swapShort(inrows16[1][colCount]);
+            pix[k].b = swapShort(inrows16[2][colCount]);
+          } else if (chancount <= 2) {
+            pix[k].r = swapShort(inrows16[0][colCount]);
+            pix[k].g = swapShort(inrows16[0][colCount]);
+            pix[k].b = swapShort(inrows16[0][colCount]);
+            if (chancount == 2) pix[k].m = swapShort(inrows16[1][colCount]);
+          }
+          if (chancount == 4) {
+            pix[k].m = swapShort(inrows16[3][colCount]);
+          } else
+            pix[k].m = 0xffff;
+          colCount += m_shrinkX;
         }
-        if (chancount == 4) {
-          pix[k].m = swapShort(
-              ((psdUint16 *)
-                   inrows[3])[layerSaveBox.getP00().x - sbx0 + colCount]);
-        } else
-          pix[k].m = 0xffff;
-        colCount += m_shrinkX;
       }
-      smallRas->unlock();
-    } else {
-      throw TImageException(
-          m_path, "Unable to read image with this depth and channels values");
     }
-    rowCount += m_shrinkY;
-  }
-  fseek(m_file, savepos, SEEK_SET);  // restoring filepos
-
-  free(rledata);
-  for (ch = 0; ch < chancount; ++ch) free(inrows[ch]);
+  }, 16);
+  smallRas->unlock();
 }
 
 void TPSDReader::doExtraData(TPSDLayerInfo *li, psdByte length) {
@@ -968,7 +1085,8 @@ std::string buildErrorString(int error) {
 
 void readChannel(FILE *f, TPSDLayerInfo *li,
                  TPSDChannelInfo *chan,  // channel info array
-                 int channels, TPSDHeaderInfo *h) {
+                 int channels, TPSDHeaderInfo *h,
+                 bool readZipData) {  // false to just index ZIP channels
   int comp, ch;
   psdByte pos, chpos, rb;
   unsigned char *zipdata;
@@ -1045,6 +1163,7 @@ void readChannel(FILE *f, TPSDLayerInfo *li,
     case ZIPWITHPREDICTION:
       if (li) {
         pos += chan->length - 2;
+        if (!readZipData) break;
 
         zipdata = (unsigned char *)mymalloc(chan->length);
         count   = fread(zipdata, 1, chan->length - 2, f);
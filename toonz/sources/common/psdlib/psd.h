@@ -6,6 +6,9 @@
 #include "psdutils.h"
 #include "timage_io.h"
 
+#include <memory>
+#include <vector>
+
 #define REF_LAYER_BY_NAME
 
 class TRasterImageP;
@@ -139,6 +142,9 @@ struct dictentry {
   void (*func)(FILE *f, struct dictentry *dict, TPSDLayerInfo *li);
 };
 
+// Parsed header and layer records of a psd file, shared by all its readers
+struct TPSDFileIndex;
+
 // PSD LIB
 // Restituisce eccezioni
 class DVAPI TPSDReader {
@@ -195,6 +201,12 @@ private:
   TThread::Mutex m_mutex;
   int openFile();
 
+  std::shared_ptr<TPSDFileIndex> m_index;
+
+  // build the channel row tables once per file, on first access
+  void indexLayerChannels(int layerIndex);
+  std::vector<TPSDChannelInfo> indexMergedChannels(int channels);
+
   void doExtraData(TPSDLayerInfo *li, psdByte length);
   int sigkeyblock(FILE *f, struct dictentry *dict, TPSDLayerInfo *li);
   struct dictentry *findbykey(FILE *f, struct dictentry *parent, char *key,
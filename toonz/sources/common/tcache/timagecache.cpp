@@ -634,6 +634,8 @@ TImageP UncompressedOnDiskCacheItem::getImage() const {
       ras = (TRasterP)(TRasterGR8P(rii->m_size));
     else if (m_pixelsize == 2)
       ras = (TRasterP)(TRasterGR16P(rii->m_size));
+    else if (m_pixelsize == 16)
+      ras = (TRasterP)(TRasterFP(rii->m_size));
     else
       assert(false);
     ras->lock();
@@ -41,6 +41,11 @@ const TPixelD TPixelD::White(1, 1, 1);
 const TPixelD TPixelD::Black(0, 0, 0);
 const TPixelD TPixelD::Transparent(0, 0, 0, 0);
 //---------------------------------------------------
+const float TPixelF::maxChannelValue = 1.0f;
+
+const TPixelF TPixelF::Black(0, 0, 0);
+const TPixelF TPixelF::Transparent(0, 0, 0, 0);
+//---------------------------------------------------
 const TPixelGR8 TPixelGR8::White(maxChannelValue);
 const TPixelGR8 TPixelGR8::Black(0);
 
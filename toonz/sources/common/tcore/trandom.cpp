@@ -2,6 +2,8 @@
 
 #include "trandom.h"
 
+#include <algorithm>
+
 TRandom::RANDOM_FLOAT_TYPE TRandom::RandomFloatType =
     TRandom::RANDOM_FLOAT_TYPE_NONE;
 
@@ -45,6 +47,24 @@ void TRandom::reset() {
 
 //--------------------------------------------------------------------------
 
+void TRandom::getState(UINT *state) const {
+  state[0] = seed;
+  state[1] = (UINT)idx1;
+  state[2] = (UINT)idx2;
+  std::copy(ran, ran + 56, state + 3);
+}
+
+//--------------------------------------------------------------------------
+
+void TRandom::setState(const UINT *state) {
+  seed = state[0];
+  idx1 = (int)state[1];
+  idx2 = (int)state[2];
+  std::copy(state + 3, state + StateSize, ran);
+}
+
+//--------------------------------------------------------------------------
+
 inline void TRandom::setRandomFloatType() {
   UINT u;
 
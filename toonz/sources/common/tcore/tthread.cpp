@@ -15,6 +15,9 @@
 // STL includes
 #include <set>
 #include <deque>
+#include <memory>
+#include <exception>
+#include <algorithm>
 
 // tcg includes
 #include "tcg/tcg_pool.h"
@@ -26,6 +29,9 @@
 #include <QWaitCondition>
 #include <QMetaType>
 #include <QCoreApplication>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
 
 //==============================================================================
 
@@ -826,11 +832,12 @@ void Executor::addTask(RunnableP task) {
 //! Runnable::canceled signal. Tasks already under execution are not
 //! stopped by this method - although the canceled signal is still emitted.
 //! It has no effect if the task is not currently under the task manager's
-//! control.
+//! control. Returns true if the task was still waiting in the queue, i.e.
+//! if it was actually prevented from running.
 //! \sa \b Runnable::canceled signal and the \b cancelAll method.
-void Executor::removeTask(RunnableP task) {
+bool Executor::removeTask(RunnableP task) {
   // If the task does not belong to this Executor, quit.
-  if (task->m_id != m_id) return;
+  if (task->m_id != m_id) return false;
 
   // Updating tasks list - lock against state transitions
   QMutexLocker transitionLocker(&globalImp->m_transitionMutex);
@@ -839,7 +846,7 @@ void Executor::removeTask(RunnableP task) {
   // send the canceled signal.
   if (globalImp->m_tasks.remove(task->m_schedulingPriority, task)) {
     Q_EMIT task->canceled(task);
-    return;
+    return true;
   }
 
   // Finally, the task may be running - look in workers.
@@ -849,6 +856,7 @@ void Executor::removeTask(RunnableP task) {
     if (task && (*it)->m_task == task) Q_EMIT task->canceled(task);
 
   // No need to refresh - tasks were eventually decremented...
+  return false;
 }
 
 //---------------------------------------------------------------------
@@ -1135,3 +1143,105 @@ inline void Worker::takeTask() {
     }
   }
 }
+
+//==============================================================================
+
+//====================
+//    parallelFor
+//--------------------
+
+namespace {
+
+class ParallelForJob {
+  std::function<void(int, int)> m_body;
+  QAtomicInt m_next;
+  int m_end, m_chunkSize, m_chunksCount, m_chunksDone;
+
+  QMutex m_mutex;
+  QWaitCondition m_done;
+  std::exception_ptr m_exception;
+
+public:
+  ParallelForJob(int begin, int end, const std::function<void(int, int)> &body,
+                 int chunkSize, int chunksCount)
+      : m_body(body)
+      , m_next(begin)
+      , m_end(end)
+      , m_chunkSize(chunkSize)
+      , m_chunksCount(chunksCount)
+      , m_chunksDone(0) {}
+
+  //! Processes chunks until none is left to take.
+  void work() {
+    int chunks = 0;
+    std::exception_ptr exception;
+
+    for (;;) {
+      int i0 = m_next.fetchAndAddOrdered(m_chunkSize);
+      if (i0 >= m_end) break;
+
+      ++chunks;
+      if (exception) continue;  // just drain the remaining chunks
+      try {
+        m_body(i0, std::min(i0 + m_chunkSize, m_end));
+      } catch (...) {
+        exception = std::current_exception();
+      }
+    }
+
+    if (chunks == 0) return;
+
+    QMutexLocker locker(&m_mutex);
+    if (exception && !m_exception) m_exception = exception;
+    m_chunksDone += chunks;
+    if (m_chunksDone == m_chunksCount) m_done.wakeAll();
+  }
+
+  //! Waits for the chunks taken by other threads, then rethrows any failure.
+  void wait() {
+    QMutexLocker locker(&m_mutex);
+    while (m_chunksDone < m_chunksCount) m_done.wait(&m_mutex);
+    if (m_exception) std::rethrow_exception(m_exception);
+  }
+};
+
+//------------------------------------------------------------------------------
+
+class ParallelForTask final : public QRunnable {
+  std::shared_ptr<ParallelForJob> m_job;
+
+public:
+  ParallelForTask(const std::shared_ptr<ParallelForJob> &job) : m_job(job) {}
+  void run() override { m_job->work(); }
+};
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+void TThread::parallelFor(int begin, int end,
+                          const std::function<void(int, int)> &body,
+                          int chunkSize, int threadCount) {
+  if (begin >= end) return;
+
+  chunkSize       = std::max(chunkSize, 1);
+  int chunksCount = (end - begin + chunkSize - 1) / chunkSize;
+
+  QThreadPool *pool = QThreadPool::globalInstance();
+  if (threadCount <= 0) threadCount = pool->maxThreadCount();
+  threadCount = std::min(threadCount, chunksCount);
+
+  if (threadCount <= 1) {
+    for (int i0 = begin; i0 < end; i0 += chunkSize)
+      body(i0, std::min(i0 + chunkSize, end));
+    return;
+  }
+
+  // Helper tasks which start late simply find no chunks left
+  std::shared_ptr<ParallelForJob> job(
+      new ParallelForJob(begin, end, body, chunkSize, chunksCount));
+  for (int t = 1; t < threadCount; ++t) pool->start(new ParallelForTask(job));
+
+  job->work();
+  job->wait();
+}
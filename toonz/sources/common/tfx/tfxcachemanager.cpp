@@ -3,6 +3,7 @@
 #include <string>
 
 #include "trenderer.h"
+#include "trenderprofiler.h"
 #include "tcacheresourcepool.h"
 
 #include "tfxcachemanager.h"
@@ -740,8 +741,12 @@ void ResourceBuilder::build(const TRectD &tileRect) {
                       1);
 #endif
 
-    if (download(m_data.second)) return;
+    if (download(m_data.second)) {
+      TRenderProfiler::addCacheAccess(true);
+      return;
+    }
 
+    TRenderProfiler::addCacheAccess(false);
     compute(tileRect);
 
     // Since there is an associated resource, the calculated content is
@@ -779,6 +784,7 @@ void ResourceBuilder::build(const TRectD &tileRect) {
   }
 
   // If necessary, calculate something
+  bool computed = false;
   if (tiles.size() > 0) {
     // For every tile to build
     std::vector<ResourceDeclaration::TileData *>::iterator it;
@@ -828,6 +834,7 @@ DIAGNOSTICS_THRSTRGET("stackVar"), "$ > " + resName,
 
         // Compute the tile to be calculated
         compute(tileData.m_rect);
+        computed = true;
         if (tileData.m_refCount > 0) tileData.m_calculated = true;
 
         // Upload the tile into the resource - do so even if the tile
@@ -838,6 +845,9 @@ DIAGNOSTICS_THRSTRGET("stackVar"), "$ > " + resName,
     }
   }
 
+  // The tile is a cache hit if nothing had to be calculated
+  TRenderProfiler::addCacheAccess(!computed);
+
   // Finally, download the built resource in the required tile
   bool ret = download(m_data.second);
   assert(ret);
@@ -347,12 +347,16 @@ public:
 struct LockedResourceP {
   TCacheResourceP m_resource;
 
+  // Resource names are hashed - the fx alias is retained to find the
+  // resources depending on a level
+  std::string m_alias;
+
   LockedResourceP(const TCacheResourceP &resource) : m_resource(resource) {
     m_resource->addLock();
   }
 
   LockedResourceP(const LockedResourceP &resource)
-      : m_resource(resource.m_resource) {
+      : m_resource(resource.m_resource), m_alias(resource.m_alias) {
     m_resource->addLock();
   }
 
@@ -362,6 +366,7 @@ struct LockedResourceP {
     src.m_resource->addLock();
     if (m_resource) m_resource->releaseLock();
     m_resource = src.m_resource;
+    m_alias    = src.m_alias;
     return *this;
   }
 
@@ -768,7 +773,7 @@ void TPassiveCacheManager::invalidateLevel(const std::string &levelName) {
     std::set<LockedResourceP> &resources = *it;
     std::set<LockedResourceP>::iterator jt, kt;
     for (jt = resources.begin(); jt != resources.end();) {
-      if ((*jt)->getName().find(levelName) != std::string::npos) {
+      if (jt->m_alias.find(levelName) != std::string::npos) {
         kt = jt++;
         it->erase(kt);
       } else
@@ -885,12 +890,26 @@ void TPassiveCacheManager::getResource(TCacheResourceP &resource,
 #endif
 
   if (flag & IN_MEMORY) {
-    QMutexLocker locker(&m_mutex);
+    LockedResourceP lockedResource(resource);
+    int passiveCacheId;
+    {
+      QMutexLocker locker(&m_mutex);
+
+      passiveCacheId =
+          m_fxDataVector[fx->getAttributes()->passiveCacheDataIdx()]
+              .m_passiveCacheId;
+      std::set<LockedResourceP> &resources =
+          m_resources->getTable().value(contextName, passiveCacheId);
+      if (resources.find(lockedResource) != resources.end()) return;
+    }
 
-    int passiveCacheId =
-        m_fxDataVector[fx->getAttributes()->passiveCacheDataIdx()]
-            .m_passiveCacheId;
-    m_resources->getTable().value(contextName, passiveCacheId).insert(resource);
+    // The alias spans the whole fx subtree - build it outside the lock
+    lockedResource.m_alias = fx->getAlias(frame, rs);
+
+    QMutexLocker locker(&m_mutex);
+    m_resources->getTable()
+        .value(contextName, passiveCacheId)
+        .insert(lockedResource);
   }
 }
 
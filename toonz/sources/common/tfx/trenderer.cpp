@@ -18,6 +18,8 @@
 // TnzBase includes
 #include "trenderresourcemanager.h"
 #include "tpredictivecachemanager.h"
+#include "trenderprofiler.h"
+#include "ttilepool.h"
 
 // Qt includes
 #include <QEventLoop>
@@ -56,6 +58,9 @@ QThreadStorage<TRendererImp **> rendererStorage;
 // Same for render process ids.
 QThreadStorage<unsigned long *> renderIdsStorage;
 
+// Same for the active memory estimators.
+QThreadStorage<TRenderMemoryEstimator **> estimatorsStorage;
+
 //-------------------------------------------------------------------------------
 
 // Interlacing functions for field-based rendering
@@ -88,6 +93,29 @@ inline void interlace(TRasterP f0, const TRasterP &f1, int field) {
   f1->unlock();
   f0->unlock();
 }
+
+//-------------------------------------------------------------------------------
+
+// Returns whether the specified fx tree contains an fx of the specified type
+bool containsFxType(TFx *rootFx, const std::string &fxType) {
+  if (!rootFx) return false;
+
+  std::set<TFx *> visited;
+  std::vector<TFx *> fxs(1, rootFx);
+
+  while (!fxs.empty()) {
+    TFx *fx = fxs.back();
+    fxs.pop_back();
+
+    if (!fx || !visited.insert(fx).second) continue;
+    if (fx->getFxType() == fxType) return true;
+
+    for (int p = 0, pCount = fx->getInputPortCount(); p != pCount; ++p)
+      fxs.push_back(fx->getInputPort(p)->getFx());
+  }
+
+  return false;
+}
 }  // anonymous namespace
 
 //================================================================================
@@ -129,6 +157,8 @@ public:
       raster = TRaster32P(size);
     else if (bpp == 64)
       raster = TRaster64P(size);
+    else if (bpp == 128)
+      raster = TRasterFP(size);
     else
       assert(false);
 
@@ -315,6 +345,13 @@ public:
 
   Executor m_executor;
 
+  //! Render tasks wait here until their estimated memory fits in the budget
+  QMutex m_admissionMutex;
+  std::deque<RunnableP> m_waitingTasks;
+  TINT64 m_memoryBudget, m_memoryInUse;  // In KB
+
+  int m_tasksPriority;
+
   bool m_precomputingEnabled;
   RasterPool m_rasterPool;
 
@@ -332,7 +369,8 @@ public:
   ~TRendererImp();
 
   void startRendering(unsigned long renderId,
-                      const std::vector<TRenderer::RenderData> &renderDatas);
+                      const std::vector<TRenderer::RenderData> &renderDatas,
+                      const TRectD &renderArea);
 
   void notifyRasterStarted(const TRenderPort::RenderData &rd);
   void notifyRasterCompleted(const TRenderPort::RenderData &rd);
@@ -353,6 +391,9 @@ public:
 
   void setThreadsCount(int nThreads) { m_executor.setMaxActiveTasks(nThreads); }
 
+  void admitTasks();
+  void releaseTaskMemory(TINT64 memoryKB);
+
   inline void declareRenderStart(unsigned long renderId);
   inline void declareRenderEnd(unsigned long renderId);
   inline void declareFrameStart(double frame);
@@ -393,6 +434,9 @@ class RenderTask final : public TThread::Runnable {
 
   bool m_fieldRender, m_stereoscopic;
 
+  TINT64 m_memoryEstimate;  //!< Estimated peak memory, in KB
+  int m_priority;
+
   Mutex m_rasterGuard;
   TTile m_tileA;  // in normal and field rendering, Rendered at given frame; in
                   // stereoscopic, rendered left frame
@@ -409,6 +453,9 @@ public:
 
   void addFrame(double frame) { m_frames.push_back(frame); }
 
+  unsigned long renderId() const { return m_renderId; }
+  TINT64 memoryEstimate() const { return m_memoryEstimate; }
+
   void buildTile(TTile &tile);
   void releaseTiles();
 
@@ -420,6 +467,7 @@ public:
   void run() override;
 
   int taskLoad() override { return 100; }
+  int schedulingPriority() override { return m_priority; }
 
   void onFinished(TThread::RunnableP) override;
 };
@@ -428,6 +476,80 @@ public:
 //    Implementations
 //================================================================================
 
+//==============================
+//    TRenderer::RenderData
+//------------------------------
+
+const std::string &TRenderer::RenderData::getContentKey() const {
+  if (!m_contentKey.empty()) return m_contentKey;
+
+  std::string key = m_fxRoot.m_frameA->getAlias(m_frame, m_info);
+  if (m_fxRoot.m_frameB)
+    key += "|" + m_fxRoot.m_frameB->getAlias(m_frame, m_info);
+
+  key += "|" + m_info.toString() + ";" + std::to_string(m_info.m_stereoscopic) +
+         "," + std::to_string(m_info.m_stereoscopicShift);
+
+  m_contentKey = TRasterFxKey::hash(key).toString();
+  return m_contentKey;
+}
+
+//=================================
+//    TRenderMemoryEstimator
+//---------------------------------
+
+TRenderMemoryEstimator::TRenderMemoryEstimator()
+    : m_parent(0), m_current(0), m_peak(0) {
+  if (estimatorsStorage.hasLocalData() && estimatorsStorage.localData())
+    m_parent = *estimatorsStorage.localData();
+
+  estimatorsStorage.setLocalData(new (TRenderMemoryEstimator *)(this));
+}
+
+//---------------------------------------------------------
+
+TRenderMemoryEstimator::~TRenderMemoryEstimator() {
+  estimatorsStorage.setLocalData(
+      m_parent ? new (TRenderMemoryEstimator *)(m_parent) : 0);
+}
+
+//---------------------------------------------------------
+
+TRenderMemoryEstimator::Node::Node(TRasterFx *fx, const TRectD &rect,
+                                   double frame, const TRenderSettings &info)
+    : m_estimator(0), m_saved(0), m_tile(0), m_requirement(0) {
+  if (!(estimatorsStorage.hasLocalData() && estimatorsStorage.localData()))
+    return;
+
+  m_estimator = *estimatorsStorage.localData();
+
+  m_tile = ((TINT64)tceil(rect.getLx()) * tceil(rect.getLy()) *
+            (info.m_bpp >> 3)) >>
+           10;
+
+  // The fx-specific allocations happen once the inputs are computed, and are
+  // released when the node is complete
+  m_requirement =
+      std::max(fx->getMemoryRequirement(rect, frame, info), 0) * (TINT64)1024;
+
+  m_saved = m_estimator->m_current;
+  m_estimator->m_current += m_tile;
+  m_estimator->m_peak = std::max(m_estimator->m_peak, m_estimator->m_current);
+}
+
+//---------------------------------------------------------
+
+TRenderMemoryEstimator::Node::~Node() {
+  if (!m_estimator) return;
+
+  // The fx computes with its input tiles and own allocations all alive. Then
+  // the input tiles are released, while this node's tile survives until its
+  // parent node is complete
+  m_estimator->m_peak = std::max(m_estimator->m_peak,
+                                 m_estimator->m_current + m_requirement);
+  m_estimator->m_current = m_saved + m_tile;
+}
+
 //==================
 //    TRenderer
 //------------------
@@ -613,6 +735,37 @@ void TRenderer::setThreadsCount(int nThreads) {
 
 //---------------------------------------------------------
 
+void TRenderer::setTasksPriority(int priority) {
+  m_imp->m_tasksPriority = priority;
+}
+
+//---------------------------------------------------------
+
+void TRenderer::setMemoryBudget(int mb) {
+  {
+    QMutexLocker locker(&m_imp->m_admissionMutex);
+    m_imp->m_memoryBudget = std::max(mb, 0) * (TINT64)1024;
+  }
+
+  m_imp->admitTasks();
+}
+
+//---------------------------------------------------------
+
+int TRenderer::getMemoryBudget() const {
+  QMutexLocker locker(&m_imp->m_admissionMutex);
+  return m_imp->m_memoryBudget >> 10;
+}
+
+//---------------------------------------------------------
+
+int TRenderer::getMemoryInUse() const {
+  QMutexLocker locker(&m_imp->m_admissionMutex);
+  return m_imp->m_memoryInUse >> 10;
+}
+
+//---------------------------------------------------------
+
 void TRenderer::addPort(TRenderPort *port) { m_imp->addPort(port); }
 
 //---------------------------------------------------------
@@ -622,12 +775,13 @@ void TRenderer::removePort(TRenderPort *port) { m_imp->removePort(port); }
 //---------------------------------------------------------
 // Looks like this only handles a single frame?
 unsigned long TRenderer::startRendering(double f, const TRenderSettings &info,
-                                        const TFxPair &actualRoot) {
+                                        const TFxPair &actualRoot,
+                                        const TRectD &renderArea) {
   assert(f >= 0);
 
   std::vector<RenderData> *rds = new std::vector<RenderData>;
   rds->push_back(RenderData(f, info, actualRoot));
-  return startRendering(rds);
+  return startRendering(rds, renderArea);
 }
 
 //---------------------------------------------------------
@@ -637,7 +791,7 @@ unsigned long TRenderer::startRendering(double f, const TRenderSettings &info,
 //! rendering -
 //! do not delete it later.
 unsigned long TRenderer::startRendering(
-    const std::vector<RenderData> *renderDatas) {
+    const std::vector<RenderData> *renderDatas, const TRectD &renderArea) {
   if (renderDatas->empty()) {
     delete renderDatas;
     return -1;
@@ -649,6 +803,7 @@ unsigned long TRenderer::startRendering(
   TRendererStartInvoker::StartInvokerRenderData srd;
   srd.m_renderId         = renderId;
   srd.m_renderDataVector = renderDatas;
+  srd.m_renderArea       = renderArea;
   TRendererStartInvoker::instance()->emitStartRender(m_imp, srd);
 
   return renderId;
@@ -688,6 +843,9 @@ TRendererImp::TRendererImp(int nThreads)
     : m_executor()
     , m_undoneTasks()
     , m_rendererId(m_rendererIdCounter++)
+    , m_memoryBudget(0)
+    , m_memoryInUse(0)
+    , m_tasksPriority(5)
     , m_precomputingEnabled(true) {
   m_executor.setMaxActiveTasks(nThreads);
 
@@ -722,6 +880,45 @@ TRendererImp::~TRendererImp() {
 
 //---------------------------------------------------------
 
+void TRendererImp::admitTasks() {
+  QMutexLocker locker(&m_admissionMutex);
+
+  // Idle rasters held by the tile pool are not part of any task's estimate
+  TINT64 pooledMemory = (m_memoryBudget > 0 && !m_waitingTasks.empty())
+                            ? TTilePool::instance()->getIdleMemory()
+                            : 0;
+
+  while (!m_waitingTasks.empty()) {
+    RenderTask *task =
+        static_cast<RenderTask *>(m_waitingTasks.front().getPointer());
+    TINT64 memory = task->memoryEstimate();
+
+    // At least a task is always admitted, and aborted tasks are let through
+    // since they quit immediately
+    if (m_memoryBudget > 0 && m_memoryInUse > 0 &&
+        m_memoryInUse + pooledMemory + memory > m_memoryBudget &&
+        !hasToDie(task->renderId()))
+      break;
+
+    m_memoryInUse += memory;
+    m_executor.addTask(m_waitingTasks.front());
+    m_waitingTasks.pop_front();
+  }
+}
+
+//---------------------------------------------------------
+
+void TRendererImp::releaseTaskMemory(TINT64 memoryKB) {
+  {
+    QMutexLocker locker(&m_admissionMutex);
+    m_memoryInUse -= memoryKB;
+  }
+
+  admitTasks();
+}
+
+//---------------------------------------------------------
+
 void TRendererImp::addPort(TRenderPort *port) {
   QWriteLocker sl(&m_portsLock);
 
@@ -927,9 +1124,15 @@ RenderTask::RenderTask(unsigned long renderId, unsigned long taskId,
     , m_framePos(framePos)
     , m_rendererImp(rendererImp)
     , m_fieldRender(ri.m_fieldPrevalence != TRenderSettings::NoField)
-    , m_stereoscopic(ri.m_stereoscopic) {
+    , m_stereoscopic(ri.m_stereoscopic)
+    , m_priority(rendererImp->m_tasksPriority) {
   m_frames.push_back(frame);
 
+  // Without precomputation, only the output tiles are accounted for
+  m_memoryEstimate = ((TINT64)frameSize.lx * frameSize.ly * (ri.m_bpp >> 3)) >>
+                     10;
+  if (m_fieldRender || m_stereoscopic) m_memoryEstimate *= 2;
+
   // Connect the onFinished slot
   connect(this, SIGNAL(finished(TThread::RunnableP)), this,
           SLOT(onFinished(TThread::RunnableP)));
@@ -947,11 +1150,15 @@ RenderTask::RenderTask(unsigned long renderId, unsigned long taskId,
 void RenderTask::preRun() {
   TRectD geom(m_framePos, TDimensionD(m_frameSize.lx, m_frameSize.ly));
 
+  TRenderMemoryEstimator estimator;
+
   if (m_fx.m_frameA) m_fx.m_frameA->dryCompute(geom, m_frames[0], m_info);
 
   if (m_fx.m_frameB)
     m_fx.m_frameB->dryCompute(
         geom, m_fieldRender ? m_frames[0] + 0.5 : m_frames[0], m_info);
+
+  m_memoryEstimate = std::max(m_memoryEstimate, estimator.getPeak());
 }
 
 //---------------------------------------------------------
@@ -985,6 +1192,8 @@ void RenderTask::run() {
 
     TStopWatch::global(8).start();
 
+    TRenderProfiler::Scope profilerScope(t);
+
     if (!m_fieldRender && !m_stereoscopic) {
       // Common case - just build the first tile
       buildTile(m_tileA);
@@ -1108,6 +1317,9 @@ void RenderTask::onFinished(TThread::RunnableP) {
   TRendererImp *rendererImp = m_rendererImp.getPointer();
   --rendererImp->m_undoneTasks;
 
+  // Let waiting tasks use the memory of this one
+  rendererImp->releaseTaskMemory(m_memoryEstimate);
+
   // Tiles release back to the Raster Pool happens in the main thread, after all
   // possible
   // signals emitted in the onFrameCompleted/Failed notifications have been
@@ -1181,7 +1393,8 @@ void TRendererStartInvoker::emitStartRender(TRendererImp *renderer,
 
 void TRendererStartInvoker::doStartRender(TRendererImp *renderer,
                                           StartInvokerRenderData rd) {
-  renderer->startRendering(rd.m_renderId, *rd.m_renderDataVector);
+  renderer->startRendering(rd.m_renderId, *rd.m_renderDataVector,
+                           rd.m_renderArea);
   renderer->release();
   delete rd.m_renderDataVector;
 }
@@ -1249,7 +1462,8 @@ Exit if there is no input port */
 
 void TRendererImp::startRendering(
     unsigned long renderId,
-    const std::vector<TRenderer::RenderData> &renderDatas) {
+    const std::vector<TRenderer::RenderData> &renderDatas,
+    const TRectD &area) {
   rootFx = renderDatas.front().m_fxRoot.m_frameA;
   int T  = renderDatas.size();
   for (int z = 0; z < T; z++) {
@@ -1346,9 +1560,10 @@ void TRendererImp::startRendering(
   //    Preliminary initializations
   //----------------------------------------------------------------------
 
-  // Calculate the overall render area - sum of all render ports' areas
-  TRectD renderArea;
-  {
+  // Calculate the overall render area - sum of all render ports' areas,
+  // unless an explicit area was specified
+  TRectD renderArea(area);
+  if (renderArea.isEmpty()) {
     QReadLocker sl(&m_portsLock);
 
     for (PortContainerIterator it = m_ports.begin(); it != m_ports.end(); ++it)
@@ -1411,28 +1626,26 @@ void TRendererImp::startRendering(
     /*--- Flag when Preview calculation is canceled in the middle ---*/
     rs.m_isCanceled = &renderInfos->m_canceled;
 
-    TRasterFxP fx = renderData.m_fxRoot.m_frameA;
-    assert(fx);
-
-    double frame = renderData.m_frame;
-
-    std::string alias = fx->getAlias(frame, renderData.m_info);
-    if (renderData.m_fxRoot.m_frameB)
-      alias = alias +
-              renderData.m_fxRoot.m_frameB->getAlias(frame, renderData.m_info);
+    assert(renderData.m_fxRoot.m_frameA);
 
     // If the render contains offscreen render, then prepare the
     // QOffscreenSurface
     // in main (GUI) thread. For now it is used only in the plasticDeformerFx.
-    if (alias.find("plasticDeformerFx") != std::string::npos &&
-        QThread::currentThread() == qGuiApp->thread()) {
+    if (QThread::currentThread() == qGuiApp->thread() &&
+        (containsFxType(renderData.m_fxRoot.m_frameA.getPointer(),
+                        "plasticDeformerFx") ||
+         containsFxType(renderData.m_fxRoot.m_frameB.getPointer(),
+                        "plasticDeformerFx"))) {
       rs.m_offScreenSurface.reset(new QOffscreenSurface());
       rs.m_offScreenSurface->setFormat(QSurfaceFormat::defaultFormat());
       rs.m_offScreenSurface->create();
     }
 
-    // Search the alias among stored clusters - and store the frame
-    jt = clusters.find(alias);
+    // Search the frame content among stored clusters - and store the frame.
+    // Frames with the same content are rendered once, and the resulting
+    // rasters are notified for all of them.
+    const std::string &contentKey = renderData.getContentKey();
+    jt                            = clusters.find(contentKey);
 
     if (jt == clusters.end()) {
       RenderTask *newTask =
@@ -1440,7 +1653,7 @@ void TRendererImp::startRendering(
                          renderData.m_fxRoot, pos, frameSize, this);
 
       tasksVector.push_back(newTask);
-      clusters.insert(std::make_pair(alias, newTask));
+      clusters.insert(std::make_pair(contentKey, newTask));
     } else
       jt->second->addFrame(renderData.m_frame);
 
@@ -1525,9 +1738,14 @@ void TRendererImp::startRendering(
 
   instanceDecl.commit();  // Same here
 
-  // Launch the render
-  for (kt = tasksVector.begin(); kt != tasksVector.end(); ++kt)
-    m_executor.addTask(*kt);
+  // Launch the render - tasks start as the memory budget allows
+  {
+    QMutexLocker locker(&m_admissionMutex);
+    for (kt = tasksVector.begin(); kt != tasksVector.end(); ++kt)
+      m_waitingTasks.push_back(*kt);
+  }
+
+  admitTasks();
 
   tasksVector.clear();  // Prevent tasks destruction by TasksCleaner
 }
@@ -32,6 +32,7 @@ public:
   struct StartInvokerRenderData {
     unsigned long m_renderId;
     const RenderDataVector *m_renderDataVector;
+    TRectD m_renderArea;  // Empty to render the ports' areas
   };
 
 public:
@@ -0,0 +1,382 @@
+
+
+#include "trenderprofiler.h"
+
+// TnzBase includes
+#include "tfx.h"
+
+// TnzCore includes
+#include "tconvert.h"
+#include "tfilepath_io.h"
+
+// Qt includes
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThreadStorage>
+
+// STD includes
+#include <atomic>
+#include <map>
+#include <sstream>
+#include <iomanip>
+
+//****************************************************************************************
+//    Local namespace
+//****************************************************************************************
+
+namespace {
+
+struct Event {
+  std::string m_name, m_type;
+  double m_frame;
+  TINT64 m_start, m_duration, m_self, m_allocated;  // Times in microseconds
+  int m_thread;
+  int m_lx, m_ly, m_bpp;
+  int m_cacheHits, m_cacheMisses;
+  bool m_isFrame;
+};
+
+//---------------------------------------------------------
+
+// Per-thread profiling state
+struct ThreadData {
+  TRenderProfiler::Scope *m_scope;  //!< The innermost active scope
+  int m_index;                      //!< Thread index in the trace
+
+  ThreadData() : m_scope(0), m_index(-1) {}
+};
+
+QThreadStorage<ThreadData> threadData;
+
+//---------------------------------------------------------
+
+std::string escape(const std::string &str) {
+  std::string result;
+  result.reserve(str.size());
+
+  std::string::const_iterator it;
+  for (it = str.begin(); it != str.end(); ++it) {
+    if (*it == '"' || *it == '\\')
+      result += '\\';
+    else if ((unsigned char)*it < 0x20)
+      continue;
+
+    result += *it;
+  }
+
+  return result;
+}
+
+}  // namespace
+
+//****************************************************************************************
+//    TRenderProfiler::Imp  definition
+//****************************************************************************************
+
+class TRenderProfiler::Imp {
+public:
+  QElapsedTimer m_timer;
+  std::vector<Event> m_events;
+  int m_threadsCount;
+  std::atomic<bool> m_enabled;  //!< Set by the GUI, read by render threads.
+
+  mutable QMutex m_mutex;
+
+public:
+  Imp() : m_threadsCount(0), m_enabled(false) { m_timer.start(); }
+
+  TINT64 now() const { return m_timer.nsecsElapsed() / 1000; }
+
+  int threadIndex() {
+    ThreadData &data = threadData.localData();
+    if (data.m_index < 0) {
+      QMutexLocker locker(&m_mutex);
+      data.m_index = m_threadsCount++;
+    }
+
+    return data.m_index;
+  }
+};
+
+//****************************************************************************************
+//    TRenderProfiler::Scope  implementation
+//****************************************************************************************
+
+TRenderProfiler::Scope::Scope(const TFx *fx, double frame, int lx, int ly,
+                              int bpp)
+    : m_parent(0)
+    , m_fx(fx)
+    , m_frame(frame)
+    , m_lx(lx)
+    , m_ly(ly)
+    , m_bpp(bpp)
+    , m_start(0)
+    , m_childrenTime(0)
+    , m_allocated(0)
+    , m_cacheHits(0)
+    , m_cacheMisses(0)
+    , m_active(TRenderProfiler::instance()->isEnabled()) {
+  if (m_active) begin();
+}
+
+//---------------------------------------------------------
+
+TRenderProfiler::Scope::Scope(double frame)
+    : m_parent(0)
+    , m_fx(0)
+    , m_frame(frame)
+    , m_lx(0)
+    , m_ly(0)
+    , m_bpp(0)
+    , m_start(0)
+    , m_childrenTime(0)
+    , m_allocated(0)
+    , m_cacheHits(0)
+    , m_cacheMisses(0)
+    , m_active(TRenderProfiler::instance()->isEnabled()) {
+  if (m_active) begin();
+}
+
+//---------------------------------------------------------
+
+void TRenderProfiler::Scope::begin() {
+  ThreadData &data = threadData.localData();
+
+  m_parent     = data.m_scope;
+  data.m_scope = this;
+
+  m_start = TRenderProfiler::instance()->m_imp->now();
+}
+
+//---------------------------------------------------------
+
+TRenderProfiler::Scope::~Scope() {
+  if (!m_active) return;
+
+  TRenderProfiler::Imp *imp = TRenderProfiler::instance()->m_imp.get();
+
+  TINT64 duration = imp->now() - m_start;
+
+  ThreadData &data = threadData.localData();
+  data.m_scope     = m_parent;
+  if (m_parent) m_parent->m_childrenTime += duration;
+
+  Event event;
+  if (m_fx) {
+    event.m_type = m_fx->getFxType();
+    event.m_name = ::to_string(m_fx->getFxId());
+    if (event.m_name.empty()) event.m_name = event.m_type;
+  } else
+    event.m_name = "Frame " + std::to_string((int)m_frame + 1);
+
+  event.m_frame       = m_frame;
+  event.m_start       = m_start;
+  event.m_duration    = duration;
+  event.m_self        = duration - m_childrenTime;
+  event.m_allocated   = m_allocated;
+  event.m_thread      = imp->threadIndex();
+  event.m_lx          = m_lx;
+  event.m_ly          = m_ly;
+  event.m_bpp         = m_bpp;
+  event.m_cacheHits   = m_cacheHits;
+  event.m_cacheMisses = m_cacheMisses;
+  event.m_isFrame     = !m_fx;
+
+  QMutexLocker locker(&imp->m_mutex);
+  imp->m_events.push_back(event);
+}
+
+//****************************************************************************************
+//    TRenderProfiler  implementation
+//****************************************************************************************
+
+TRenderProfiler::TRenderProfiler() : m_imp(new Imp) {}
+
+//---------------------------------------------------------
+
+TRenderProfiler::~TRenderProfiler() {}
+
+//---------------------------------------------------------
+
+TRenderProfiler *TRenderProfiler::instance() {
+  static TRenderProfiler theInstance;
+  return &theInstance;
+}
+
+//---------------------------------------------------------
+
+void TRenderProfiler::enable(bool on) { m_imp->m_enabled = on; }
+
+//---------------------------------------------------------
+
+bool TRenderProfiler::isEnabled() const { return m_imp->m_enabled; }
+
+//---------------------------------------------------------
+
+void TRenderProfiler::clear() {
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->m_events.clear();
+}
+
+//---------------------------------------------------------
+
+bool TRenderProfiler::isEmpty() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_events.empty();
+}
+
+//---------------------------------------------------------
+
+void TRenderProfiler::addCacheAccess(bool hit) {
+  if (!instance()->isEnabled()) return;
+
+  Scope *scope = threadData.localData().m_scope;
+  if (!scope) return;
+
+  if (hit)
+    ++scope->m_cacheHits;
+  else
+    ++scope->m_cacheMisses;
+}
+
+//---------------------------------------------------------
+
+void TRenderProfiler::addAllocation(TINT64 bytes) {
+  if (!instance()->isEnabled()) return;
+
+  Scope *scope = threadData.localData().m_scope;
+  if (scope) scope->m_allocated += bytes;
+}
+
+//---------------------------------------------------------
+
+bool TRenderProfiler::exportTrace(const TFilePath &fp) const {
+  Tofstream os(fp);
+  if (!os.isOpen()) return false;
+
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  os << "{\"traceEvents\":[";
+
+  // Name the render threads
+  const char *separator = "\n";
+  for (int t = 0; t < m_imp->m_threadsCount; ++t, separator = ",\n")
+    os << separator
+       << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+       << ",\"args\":{\"name\":\"Render thread " << t + 1 << "\"}}";
+
+  std::vector<Event>::const_iterator it;
+  for (it = m_imp->m_events.begin(); it != m_imp->m_events.end();
+       ++it, separator = ",\n") {
+    const Event &event = *it;
+
+    os << separator << "{\"name\":\"" << escape(event.m_name) << "\",\"cat\":\""
+       << (event.m_isFrame ? "frame" : "fx")
+       << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.m_thread
+       << ",\"ts\":" << event.m_start << ",\"dur\":" << event.m_duration
+       << ",\"args\":{\"frame\":" << event.m_frame + 1;
+
+    if (!event.m_isFrame)
+      os << ",\"type\":\"" << escape(event.m_type) << "\",\"tile\":\""
+         << event.m_lx << "x" << event.m_ly << "\",\"bpp\":" << event.m_bpp
+         << ",\"self_us\":" << event.m_self
+         << ",\"cache_hits\":" << event.m_cacheHits
+         << ",\"cache_misses\":" << event.m_cacheMisses
+         << ",\"allocated_kb\":" << (event.m_allocated >> 10);
+
+    os << "}}";
+  }
+
+  os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  return !os.fail();
+}
+
+//---------------------------------------------------------
+
+std::string TRenderProfiler::getSummary() const {
+  struct Totals {
+    std::string m_type;
+    int m_calls, m_cacheHits, m_cacheMisses;
+    TINT64 m_time, m_self, m_pixels, m_allocated;
+
+    Totals()
+        : m_calls(0)
+        , m_cacheHits(0)
+        , m_cacheMisses(0)
+        , m_time(0)
+        , m_self(0)
+        , m_pixels(0)
+        , m_allocated(0) {}
+  };
+
+  std::map<std::string, Totals> totalsMap;
+  TINT64 framesTime = 0, selfTime = 0;
+  int framesCount   = 0;
+
+  {
+    QMutexLocker locker(&m_imp->m_mutex);
+
+    std::vector<Event>::const_iterator it;
+    for (it = m_imp->m_events.begin(); it != m_imp->m_events.end(); ++it) {
+      const Event &event = *it;
+
+      if (event.m_isFrame) {
+        framesTime += event.m_duration;
+        ++framesCount;
+        continue;
+      }
+
+      Totals &totals = totalsMap[event.m_name];
+      totals.m_type  = event.m_type;
+      ++totals.m_calls;
+      totals.m_cacheHits += event.m_cacheHits;
+      totals.m_cacheMisses += event.m_cacheMisses;
+      totals.m_time += event.m_duration;
+      totals.m_self += event.m_self;
+      totals.m_pixels += (TINT64)event.m_lx * event.m_ly;
+      totals.m_allocated += event.m_allocated;
+
+      selfTime += event.m_self;
+    }
+  }
+
+  // Sort by decreasing self time
+  std::vector<std::pair<TINT64, std::string>> order;
+  std::map<std::string, Totals>::iterator it;
+  for (it = totalsMap.begin(); it != totalsMap.end(); ++it)
+    order.push_back(std::make_pair(-it->second.m_self, it->first));
+  std::sort(order.begin(), order.end());
+
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(1);
+
+  os << std::left << std::setw(28) << "Fx" << std::right << std::setw(8)
+     << "Calls" << std::setw(12) << "Self (ms)" << std::setw(8) << "Self %"
+     << std::setw(12) << "Total (ms)" << std::setw(10) << "MPixels"
+     << std::setw(8) << "Hits" << std::setw(8) << "Misses" << std::setw(10)
+     << "Alloc MB"
+     << "\n";
+
+  std::vector<std::pair<TINT64, std::string>>::iterator jt;
+  for (jt = order.begin(); jt != order.end(); ++jt) {
+    const Totals &totals = totalsMap[jt->second];
+
+    std::string name = jt->second;
+    if (name != totals.m_type) name += " (" + totals.m_type + ")";
+    if (name.size() > 27) name = name.substr(0, 24) + "...";
+
+    os << std::left << std::setw(28) << name << std::right << std::setw(8)
+       << totals.m_calls << std::setw(12) << totals.m_self / 1000.0
+       << std::setw(8) << (selfTime ? 100.0 * totals.m_self / selfTime : 0.0)
+       << std::setw(12) << totals.m_time / 1000.0 << std::setw(10)
+       << totals.m_pixels / 1.0e6 << std::setw(8) << totals.m_cacheHits
+       << std::setw(8) << totals.m_cacheMisses << std::setw(10)
+       << totals.m_allocated / 1048576.0 << "\n";
+  }
+
+  os << framesCount << " frames rendered in " << framesTime / 1000.0
+     << " ms of render threads time\n";
+
+  return os.str();
+}
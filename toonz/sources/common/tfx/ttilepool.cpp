@@ -0,0 +1,395 @@
+
+
+#include "ttilepool.h"
+
+// TnzBase includes
+#include "trenderresourcemanager.h"
+
+// Qt includes
+#include <QMutex>
+#include <QThreadStorage>
+
+// STD includes
+#include <list>
+#include <set>
+
+//****************************************************************************************
+//    Local namespace
+//****************************************************************************************
+
+namespace {
+
+TRasterP createRaster(const TDimension &size, int bpp) {
+  switch (bpp) {
+  case 8:
+    return TRasterGR8P(size);
+  case 16:
+    return TRasterGR16P(size);
+  case 32:
+    return TRaster32P(size);
+  case 64:
+    return TRaster64P(size);
+  case 128:
+    return TRasterFP(size);
+  }
+
+  assert(false);
+  return TRasterP();
+}
+
+//---------------------------------------------------------
+
+inline TINT64 memoryKb(const TRasterP &ras) {
+  return ((TINT64)ras->getLx() * ras->getLy() * ras->getPixelSize()) >> 10;
+}
+
+}  // namespace
+
+//****************************************************************************************
+//    TTilePool::Imp  definition
+//****************************************************************************************
+
+class TTilePool::Imp {
+public:
+  //! The rasters of a render thread, most recently used first. An arena is
+  //! deleted when its thread exits.
+  struct Arena {
+    Imp *m_imp;
+    std::list<TRasterP> m_rasters;
+    QMutex m_mutex;  //!< Guards m_rasters from other threads' trims
+
+    Arena(Imp *imp);
+    ~Arena();
+  };
+
+  QThreadStorage<Arena *> m_arenas;
+  std::set<Arena *> m_allArenas;
+
+  Statistics m_stats;
+  TINT64 m_idleLimitKb;
+  bool m_enabled;
+
+  // Arenas are always locked after this mutex
+  mutable QMutex m_mutex;
+
+public:
+  Imp() : m_idleLimitKb(256 << 10), m_enabled(true) {}
+  ~Imp();
+
+  Arena *arena();
+
+  //! Records a request served by the specified arena. Allocations may make
+  //! the idle rasters exceed the memory limit, and trim them.
+  void addRequest(Arena *arena, bool recycled, TINT64 allocatedKb);
+
+  //! Releases idle rasters until the idle memory of all arenas fits the
+  //! limit, starting from the least recently used ones of the specified
+  //! arena. Requires m_mutex to be locked.
+  void trim(Arena *first);
+
+  //! Returns the memory held by the idle rasters of the specified arena.
+  static TINT64 idleMemory(Arena *arena);
+
+  //! Releases the least recently used idle rasters of the arena, until at
+  //! least the specified memory has been released. Returns the released
+  //! memory.
+  static TINT64 release(Arena *arena, TINT64 kb);
+};
+
+//---------------------------------------------------------
+
+TTilePool::Imp::Arena::Arena(Imp *imp) : m_imp(imp) {
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->m_allArenas.insert(this);
+}
+
+//---------------------------------------------------------
+
+TTilePool::Imp::Arena::~Arena() {
+  if (!m_imp) return;  // The pool was destroyed first
+
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->m_allArenas.erase(this);
+
+  std::list<TRasterP>::iterator it;
+  for (it = m_rasters.begin(); it != m_rasters.end(); ++it)
+    m_imp->m_stats.m_residentKb -= memoryKb(*it);
+}
+
+//---------------------------------------------------------
+
+TTilePool::Imp::~Imp() {
+  QMutexLocker locker(&m_mutex);
+
+  // Arenas of still running threads must no longer refer to the pool
+  std::set<Arena *>::iterator it;
+  for (it = m_allArenas.begin(); it != m_allArenas.end(); ++it)
+    (*it)->m_imp = 0;
+}
+
+//---------------------------------------------------------
+
+TTilePool::Imp::Arena *TTilePool::Imp::arena() {
+  if (!m_arenas.hasLocalData()) m_arenas.setLocalData(new Arena(this));
+
+  return m_arenas.localData();
+}
+
+//---------------------------------------------------------
+
+void TTilePool::Imp::addRequest(Arena *arena, bool recycled,
+                                TINT64 allocatedKb) {
+  QMutexLocker locker(&m_mutex);
+
+  ++m_stats.m_requests;
+  if (recycled) ++m_stats.m_recycled;
+
+  m_stats.m_residentKb += allocatedKb;
+  if (!recycled) trim(arena);
+
+  if (m_stats.m_residentKb > m_stats.m_peakResidentKb)
+    m_stats.m_peakResidentKb = m_stats.m_residentKb;
+}
+
+//---------------------------------------------------------
+
+void TTilePool::Imp::trim(Arena *first) {
+  TINT64 idleKb = 0;
+
+  std::set<Arena *>::iterator it;
+  for (it = m_allArenas.begin(); it != m_allArenas.end(); ++it) {
+    QMutexLocker locker(&(*it)->m_mutex);
+    idleKb += idleMemory(*it);
+  }
+
+  TINT64 excessKb = idleKb - m_idleLimitKb, releasedKb = 0;
+  if (excessKb <= 0) return;
+
+  // The allocating thread gives up its own stale rasters first
+  {
+    QMutexLocker locker(&first->m_mutex);
+    releasedKb += release(first, excessKb);
+  }
+
+  for (it = m_allArenas.begin();
+       releasedKb < excessKb && it != m_allArenas.end(); ++it) {
+    if (*it == first) continue;
+
+    QMutexLocker locker(&(*it)->m_mutex);
+    releasedKb += release(*it, excessKb - releasedKb);
+  }
+
+  m_stats.m_residentKb -= releasedKb;
+}
+
+//---------------------------------------------------------
+
+TINT64 TTilePool::Imp::idleMemory(Arena *arena) {
+  TINT64 idleKb = 0;
+
+  // Rasters referenced outside the arena are busy
+  std::list<TRasterP>::iterator it;
+  for (it = arena->m_rasters.begin(); it != arena->m_rasters.end(); ++it)
+    if ((*it)->getRefCount() == 1) idleKb += memoryKb(*it);
+
+  return idleKb;
+}
+
+//---------------------------------------------------------
+
+TINT64 TTilePool::Imp::release(Arena *arena, TINT64 kb) {
+  TINT64 releasedKb = 0;
+
+  std::list<TRasterP>::iterator it = arena->m_rasters.end();
+  while (releasedKb < kb && it != arena->m_rasters.begin()) {
+    --it;
+    if ((*it)->getRefCount() > 1) continue;
+
+    releasedKb += memoryKb(*it);
+    it = arena->m_rasters.erase(it);
+  }
+
+  return releasedKb;
+}
+
+//****************************************************************************************
+//    TTilePoolReleaser  definition
+//****************************************************************************************
+
+//! Releases the idle rasters of the pool once no render instance is active,
+//! so that they are not held between renders.
+class TTilePoolReleaser final : public TRenderResourceManager {
+  T_RENDER_RESOURCE_MANAGER
+
+  QMutex m_mutex;
+  int m_activeInstances;
+
+public:
+  TTilePoolReleaser() : m_activeInstances(0) {}
+
+  static TTilePoolReleaser *instance() {
+    static TTilePoolReleaser theInstance;
+    return &theInstance;
+  }
+
+  void onRenderInstanceStart(unsigned long id) override {
+    QMutexLocker locker(&m_mutex);
+    ++m_activeInstances;
+  }
+
+  void onRenderInstanceEnd(unsigned long id) override {
+    {
+      QMutexLocker locker(&m_mutex);
+      if (--m_activeInstances > 0) return;
+    }
+
+    TTilePool::instance()->releaseIdleRasters();
+  }
+
+  bool renderHasOwnership() override { return false; }
+};
+
+//------------------------------------------------------------------------------
+
+class TTilePoolReleaserGenerator final
+    : public TRenderResourceManagerGenerator {
+public:
+  TRenderResourceManager *operator()() override {
+    return TTilePoolReleaser::instance();
+  }
+};
+
+MANAGER_FILESCOPE_DECLARATION(TTilePoolReleaser, TTilePoolReleaserGenerator);
+
+//****************************************************************************************
+//    TTilePool  implementation
+//****************************************************************************************
+
+TTilePool::TTilePool() : m_imp(new Imp) {}
+
+//---------------------------------------------------------
+
+TTilePool::~TTilePool() {}
+
+//---------------------------------------------------------
+
+TTilePool *TTilePool::instance() {
+  static TTilePool theInstance;
+  return &theInstance;
+}
+
+//---------------------------------------------------------
+
+void TTilePool::enable(bool on) {
+  m_imp->m_enabled = on;
+  if (!on) releaseIdleRasters();
+}
+
+//---------------------------------------------------------
+
+bool TTilePool::isEnabled() const { return m_imp->m_enabled; }
+
+//---------------------------------------------------------
+
+void TTilePool::setIdleMemoryLimit(int mb) {
+  m_imp->m_idleLimitKb = (TINT64)mb << 10;
+}
+
+//---------------------------------------------------------
+
+int TTilePool::getIdleMemoryLimit() const {
+  return (int)(m_imp->m_idleLimitKb >> 10);
+}
+
+//---------------------------------------------------------
+
+TRasterP TTilePool::getRaster(const TDimension &size, int bpp) {
+  if (!m_imp->m_enabled) return createRaster(size, bpp);
+
+  Imp::Arena *arena = m_imp->arena();
+  int pixelSize     = bpp >> 3;
+
+  TRasterP ras;
+  bool recycled      = false;
+  TINT64 allocatedKb = 0;
+  {
+    QMutexLocker locker(&arena->m_mutex);
+
+    // Search an idle raster of the same size class
+    std::list<TRasterP>::iterator it;
+    for (it = arena->m_rasters.begin(); it != arena->m_rasters.end(); ++it) {
+      const TRasterP &idleRas = *it;
+      if (idleRas->getRefCount() == 1 && idleRas->getSize() == size &&
+          idleRas->getPixelSize() == pixelSize) {
+        ras = idleRas;
+        arena->m_rasters.splice(arena->m_rasters.begin(), arena->m_rasters,
+                                it);
+        break;
+      }
+    }
+
+    if (ras) {
+      // Recycled rasters must look just like newly allocated ones
+      ras->clear();
+      recycled = true;
+    } else {
+      ras = createRaster(size, bpp);
+      if (!ras) return ras;
+
+      arena->m_rasters.push_front(ras);
+      allocatedKb = memoryKb(ras);
+    }
+  }
+
+  m_imp->addRequest(arena, recycled, allocatedKb);
+
+  return ras;
+}
+
+//---------------------------------------------------------
+
+void TTilePool::releaseIdleRasters() {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  std::set<Imp::Arena *>::iterator it;
+  for (it = m_imp->m_allArenas.begin(); it != m_imp->m_allArenas.end(); ++it) {
+    Imp::Arena *arena = *it;
+
+    QMutexLocker arenaLocker(&arena->m_mutex);
+    m_imp->m_stats.m_residentKb -=
+        Imp::release(arena, Imp::idleMemory(arena));
+  }
+}
+
+//---------------------------------------------------------
+
+TINT64 TTilePool::getIdleMemory() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  TINT64 idleKb = 0;
+
+  std::set<Imp::Arena *>::iterator it;
+  for (it = m_imp->m_allArenas.begin(); it != m_imp->m_allArenas.end(); ++it) {
+    QMutexLocker arenaLocker(&(*it)->m_mutex);
+    idleKb += Imp::idleMemory(*it);
+  }
+
+  return idleKb;
+}
+
+//---------------------------------------------------------
+
+TTilePool::Statistics TTilePool::getStatistics() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_stats;
+}
+
+//---------------------------------------------------------
+
+void TTilePool::resetStatistics() {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  m_imp->m_stats.m_requests       = 0;
+  m_imp->m_stats.m_recycled       = 0;
+  m_imp->m_stats.m_peakResidentKb = m_imp->m_stats.m_residentKb;
+}
@@ -79,7 +79,7 @@ std::string TGeometryFx::getAlias(double frame,
     if (port->isConnected()) {
       TRasterFxP ifx = port->getFx();
       assert(ifx);
-      alias += ifx->getAlias(frame, info);
+      alias += getInputAlias(ifx.getPointer(), frame, info);
     }
     alias += ",";
   }
@@ -161,7 +161,12 @@ void ColumnColorFilterFx::doCompute(TTile &tile, double frame,
   TRasterFxP src = m_port.getFx();
   src->compute(tile, frame, ri);
 
-  TRop::applyColorScale(tile.getRaster(), m_colorFilter);
+  computePixels(tile.getRaster(), frame, ri);
+}
+
+void ColumnColorFilterFx::computePixels(const TRasterP &ras, double frame,
+                                        const TRenderSettings &ri) {
+  TRop::applyColorScale(ras, m_colorFilter);
 }
 
 std::string ColumnColorFilterFx::getAlias(double frame,
@@ -171,7 +176,7 @@ std::string ColumnColorFilterFx::getAlias(double frame,
   if (m_port.isConnected()) {
     TRasterFxP ifx = m_port.getFx();
     assert(ifx);
-    alias += ifx->getAlias(frame, info);
+    alias += getInputAlias(ifx.getPointer(), frame, info);
   }
   alias += ",";
 
@@ -236,10 +241,14 @@ public:
     if (!m_input.isConnected()) return;
 
     m_input->compute(tile, frame, ri);
+    computePixels(tile.getRaster(), frame, ri);
+  }
 
-    TRop::invert(tile.getRaster(), m_redChan->getValue(),
-                 m_greenChan->getValue(), m_blueChan->getValue(),
-                 m_alphaChan->getValue());
+  bool isPointwise() const override { return true; }
+  void computePixels(const TRasterP &ras, double frame,
+                     const TRenderSettings &ri) override {
+    TRop::invert(ras, m_redChan->getValue(), m_greenChan->getValue(),
+                 m_blueChan->getValue(), m_alphaChan->getValue());
   }
 };
 
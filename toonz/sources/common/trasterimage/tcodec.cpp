@@ -30,6 +30,7 @@ class Header {
     Raster32CM,
     RasterGR8,
     RasterGR16,
+    RasterFRGBM,
     RasterUnknown
   };
 
@@ -73,8 +74,13 @@ Header::Header(const TRasterP &ras) {
           if (rasGR16)
             m_rasType = RasterGR16;
           else {
-            assert(!"Unknown RasterType");
-            m_rasType = RasterUnknown;
+            TRasterFP rasF(ras);
+            if (rasF)
+              m_rasType = RasterFRGBM;
+            else {
+              assert(!"Unknown RasterType");
+              m_rasType = RasterUnknown;
+            }
           }
         }
       }
@@ -101,6 +107,9 @@ TRasterP Header::createRaster() const {
   case RasterGR16:
     return TRasterGR16P(m_lx, m_ly);
     break;
+  case RasterFRGBM:
+    return TRasterFP(m_lx, m_ly);
+    break;
   default:
     assert(0);
     return TRasterP();
@@ -125,6 +134,9 @@ int Header::getRasterSize() const {
   case RasterGR8:
     return m_lx * m_ly;
     break;
+  case RasterFRGBM:
+    return 16 * m_lx * m_ly;
+    break;
   default:
     assert(0);
     return 0;
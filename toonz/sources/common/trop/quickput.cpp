@@ -7,6 +7,7 @@
 
 #ifndef TNZCORE_LIGHT
 #include "tpalette.h"
+#include "tpalettecolorlut.h"
 #include "tcolorstyles.h"
 #endif
 
@@ -71,6 +72,22 @@ inline TPixel32 applyColorScaleCMapped(const TPixel32 &color,
 
 //------------------------------------------------------------------------------
 
+#ifndef TNZCORE_LIGHT
+
+//! Fills \b colors with the palette colors of \b lut scaled by \b colorScale,
+//! over the whole cmapped id range.
+inline void getScaledCmappedColors(const TPaletteColorLut &lut,
+                                   const TPixel32 &colorScale,
+                                   std::vector<TPixel32> &colors) {
+  colors.assign(lut.getColors(), lut.getColors() + lut.getColorCount());
+  for (int i = 0; i < lut.getStyleCount(); i++)
+    colors[i] = applyColorScaleCMapped(lut.getAverageColor(i), colorScale);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
 void doQuickPutFilter(const TRaster32P &dn, const TRaster32P &up,
                       const TAffine &aff) {
   //  se aff e' degenere la controimmagine di up e' un segmento (o un punto)
@@ -337,7 +354,8 @@ void doQuickPutFilter(const TRaster32P &dn, const TRaster32P &up,
 void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up,
                         const TAffine &aff, const TPixel32 &colorScale,
                         bool doPremultiply, bool whiteTransp, bool firstColumn,
-                        bool doRasterDarkenBlendedView) {
+                        bool doRasterDarkenBlendedView, int rowBegin,
+                        int rowEnd) {
   //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
   //  di up e' un segmento (o un punto)
   if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
@@ -397,6 +415,11 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up,
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
+  //  restricts the scanlines to the requested rows of dn
+  yMin = std::max(yMin, rowBegin);
+  yMax = std::min(yMax, rowEnd - 1);
+  if (yMin > yMax) return;
+
   dn->lock();
   up->lock();
 
@@ -570,7 +593,7 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up,
 
 void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
                         const TAffine &aff, bool doPremultiply,
-                        bool firstColumn) {
+                        bool firstColumn, int rowBegin, int rowEnd) {
   //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
   //  di up e' un segmento (o un punto)
   if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
@@ -630,6 +653,11 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
+  //  restricts the scanlines to the requested rows of dn
+  yMin = std::max(yMin, rowBegin);
+  yMax = std::min(yMax, rowEnd - 1);
+  if (yMin > yMax) return;
+
   dn->lock();
   up->lock();
 
@@ -794,7 +822,8 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
 //=============================================================================
 
 void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
-                        const TAffine &aff, const TPixel32 &colorScale) {
+                        const TAffine &aff, const TPixel32 &colorScale,
+                        int rowBegin, int rowEnd) {
   if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
   const int PADN = 16;
   assert(std::max(up->getLx(), up->getLy()) <
@@ -832,6 +861,11 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
+  //  restricts the scanlines to the requested rows of dn
+  yMin = std::max(yMin, rowBegin);
+  yMax = std::min(yMax, rowEnd - 1);
+  if (yMin > yMax) return;
+
   dn->lock();
   up->lock();
 
@@ -1221,7 +1255,8 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up, double sx,
                         double sy, double tx, double ty,
                         const TPixel32 &colorScale, bool doPremultiply,
                         bool whiteTransp, bool firstColumn,
-                        bool doRasterDarkenBlendedView) {
+                        bool doRasterDarkenBlendedView, int rowBegin,
+                        int rowEnd) {
   //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
   //  di up e' un segmento (o un punto)
   if ((sx == 0) || (sy == 0)) return;
@@ -1365,6 +1400,9 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up, double sx,
   //  calcola kMinY, kMaxY effettuando anche il clippind su dn
   kMinY = std::max(kMinY, (int)0);
   kMaxY = std::min(kMaxY, yMax - yMin);
+  //  restricts the scanlines to the requested rows of dn
+  kMinY = std::max(kMinY, rowBegin - yMin);
+  kMaxY = std::min(kMaxY, rowEnd - 1 - yMin);
 
   //  calcola kMinX, kMaxX intersecando la (2) con i lati
   //  (x = xMin) e (x = xMax) di up
@@ -1456,7 +1494,7 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up, double sx,
 //=============================================================================
 void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up, double sx,
                         double sy, double tx, double ty,
-                        const TPixel32 &colorScale) {
+                        const TPixel32 &colorScale, int rowBegin, int rowEnd) {
   if ((sx == 0) || (sy == 0)) return;
 
   const int PADN = 16;
@@ -1511,6 +1549,9 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up, double sx,
   }
   kMinY = std::max(kMinY, (int)0);
   kMaxY = std::min(kMaxY, yMax - yMin);
+  //  restricts the scanlines to the requested rows of dn
+  kMinY = std::max(kMinY, rowBegin - yMin);
+  kMaxY = std::min(kMaxY, rowEnd - 1 - yMin);
 
   if (deltaXL > 0)  //  (deltaXL != 0)
   {
@@ -2928,7 +2969,8 @@ void doQuickResampleNoFilter(const TRasterPT<PIX> &dn, const TRasterPT<PIX> &up,
 
 void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
                        const TPaletteP &palette, const TAffine &aff,
-                       const TPixel32 &globalColorScale, bool inksOnly) {
+                       const TPixel32 &globalColorScale, bool inksOnly,
+                       int rowBegin, int rowEnd) {
   //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
   //  di up e' un segmento (o un punto)
   if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
@@ -2989,16 +3031,23 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
 
-  std::vector<TPixel32> colors(palette->getStyleCount());
-  // vector<TPixel32> inks(palette->getStyleCount());
+  // Unscaled colors and tone blends come straight from the palette's cached
+  // color table
+  std::shared_ptr<const TPaletteColorLut> lut = palette->getColorLut();
+  const TPaletteColorLut *toneLut             = lut.get();
+  const TPixel32 *colors                      = lut->getColors();
+
+  std::vector<TPixel32> scaledColors;
+  if (globalColorScale != TPixel::Black) {
+    getScaledCmappedColors(*lut, globalColorScale, scaledColors);
+    colors  = &scaledColors[0];
+    toneLut = 0;
+  }
 
-  if (globalColorScale != TPixel::Black)
-    for (int i  = 0; i < palette->getStyleCount(); i++)
-      colors[i] = applyColorScaleCMapped(
-          palette->getStyle(i)->getAverageColor(), globalColorScale);
-  else
-    for (int i  = 0; i < palette->getStyleCount(); i++)
-      colors[i] = ::premultiply(palette->getStyle(i)->getAverageColor());
+  //  restricts the scanlines to the requested rows of dn
+  yMin = std::max(yMin, rowBegin);
+  yMax = std::min(yMax, rowEnd - 1);
+  if (yMin > yMax) return;
 
   dn->lock();
   up->lock();
@@ -3172,7 +3221,9 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
             colorUp = colors[p];
             break;
           default:
-            colorUp = blend(colors[i], colors[p], t, TPixelCM32::getMaxTone());
+            colorUp = toneLut ? toneLut->getPixel(i, p, t)
+                              : blend(colors[i], colors[p], t,
+                                      TPixelCM32::getMaxTone());
             break;
           }
 
@@ -3199,7 +3250,8 @@ TPixel TransparencyCheckPaint = TPixel(127,127,127);  //paint*/
 
 void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
                        const TPaletteP &palette, const TAffine &aff,
-                       const TRop::CmappedQuickputSettings &s)
+                       const TRop::CmappedQuickputSettings &s, int rowBegin,
+                       int rowEnd)
 /*const TPixel32& globalColorScale,
                  bool inksOnly,
                  bool transparencyCheck,
@@ -3230,27 +3282,33 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
   int lyPred = up->getLy() * (1 << PADN) - 1;
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
-  std::vector<TPixel32> paints(palette->getStyleCount());
-  std::vector<TPixel32> inks(palette->getStyleCount());
+  std::shared_ptr<const TPaletteColorLut> lut = palette->getColorLut();
+  std::vector<TPixel32> paints, inks;
 
   if (s.m_transparencyCheck && !s.m_isOnionSkin) {
-    for (int i = 0; i < palette->getStyleCount(); i++) {
+    paints.resize(lut->getColorCount(), TPixel32::Red);
+    inks.resize(lut->getColorCount(), TPixel32::Red);
+    for (int i = 0; i < lut->getStyleCount(); i++) {
       if (i == s.m_gapCheckIndex) {
-        paints[i] = inks[i] = applyColorScaleCMapped(
-            palette->getStyle(i)->getAverageColor(), s.m_globalColorScale);
+        paints[i] = inks[i] = applyColorScaleCMapped(lut->getAverageColor(i),
+                                                     s.m_globalColorScale);
       } else {
         paints[i] = s.m_transpCheckPaint;
         inks[i]   = s.m_blackBgCheck ? s.m_transpCheckBg : s.m_transpCheckInk;
       }
     }
-  } else if (s.m_globalColorScale == TPixel::Black)
-    for (int i  = 0; i < palette->getStyleCount(); i++)
-      paints[i] = inks[i] =
-          ::premultiply(palette->getStyle(i)->getAverageColor());
-  else
-    for (int i  = 0; i < palette->getStyleCount(); i++)
-      paints[i] = inks[i] = applyColorScaleCMapped(
-          palette->getStyle(i)->getAverageColor(), s.m_globalColorScale);
+  } else {
+    if (s.m_globalColorScale == TPixel::Black)
+      paints.assign(lut->getColors(), lut->getColors() + lut->getColorCount());
+    else
+      getScaledCmappedColors(*lut, s.m_globalColorScale, paints);
+    inks = paints;
+  }
+
+  //  restricts the scanlines to the requested rows of dn
+  yMin = std::max(yMin, rowBegin);
+  yMax = std::min(yMax, rowEnd - 1);
+  if (yMin > yMax) return;
 
   dn->lock();
   up->lock();
@@ -3379,7 +3437,7 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
 void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
                        const TPaletteP &palette, double sx, double sy,
                        double tx, double ty, const TPixel32 &globalColorScale,
-                       bool inksOnly) {
+                       bool inksOnly, int rowBegin, int rowEnd) {
   //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
   //  di up e' un segmento (o un punto)
   if ((sx == 0) || (sy == 0)) return;
@@ -3523,6 +3581,9 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
   //  calcola kMinY, kMaxY effettuando anche il clippind su dn
   kMinY = std::max(kMinY, (int)0);
   kMaxY = std::min(kMaxY, yMax - yMin);
+  //  restricts the scanlines to the requested rows of dn
+  kMinY = std::max(kMinY, rowBegin - yMin);
+  kMaxY = std::min(kMaxY, rowEnd - 1 - yMin);
 
   //  calcola kMinX, kMaxX intersecando la (2) con i lati
   //  (x = xMin) e (x = xMax) di up
@@ -3552,19 +3613,18 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
 
-  int count = std::max({palette->getStyleCount(), TPixelCM32::getMaxInk(),
-                        TPixelCM32::getMaxPaint()});
-
-  std::vector<TPixel32> paints(count, TPixel32::Red);
-  std::vector<TPixel32> inks(count, TPixel32::Red);
-  if (globalColorScale != TPixel::Black)
-    for (int i  = 0; i < palette->getStyleCount(); i++)
-      paints[i] = inks[i] = applyColorScaleCMapped(
-          palette->getStyle(i)->getAverageColor(), globalColorScale);
-  else
-    for (int i  = 0; i < palette->getStyleCount(); i++)
-      paints[i] = inks[i] =
-          ::premultiply(palette->getStyle(i)->getAverageColor());
+  // Unscaled colors and tone blends come straight from the palette's cached
+  // color table
+  std::shared_ptr<const TPaletteColorLut> lut = palette->getColorLut();
+  const TPaletteColorLut *toneLut             = lut.get();
+  const TPixel32 *colors                      = lut->getColors();
+
+  std::vector<TPixel32> scaledColors;
+  if (globalColorScale != TPixel::Black) {
+    getScaledCmappedColors(*lut, globalColorScale, scaledColors);
+    colors  = &scaledColors[0];
+    toneLut = 0;
+  }
 
   dn->lock();
   up->lock();
@@ -3604,35 +3664,37 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
       int t             = upPix->getTone();
       int p             = upPix->getPaint();
       assert(0 <= t && t < 256);
-      assert(0 <= p && p < (int)paints.size());
+      assert(0 <= p && p < lut->getColorCount());
 
       if (t == 0xff && p == 0)
         continue;
       else {
         int i = upPix->getInk();
-        assert(0 <= i && i < (int)inks.size());
+        assert(0 <= i && i < lut->getColorCount());
         TPixel32 colorUp;
         if (inksOnly) switch (t) {
           case 0:
-            colorUp = inks[i];
+            colorUp = colors[i];
             break;
           case 255:
             colorUp = TPixel::Transparent;
             break;
           default:
-            colorUp = antialias(inks[i], 255 - t);
+            colorUp = antialias(colors[i], 255 - t);
             break;
           }
         else
           switch (t) {
           case 0:
-            colorUp = inks[i];
+            colorUp = colors[i];
             break;
           case 255:
-            colorUp = paints[p];
+            colorUp = colors[p];
             break;
           default:
-            colorUp = blend(inks[i], paints[p], t, TPixelCM32::getMaxTone());
+            colorUp = toneLut ? toneLut->getPixel(i, p, t)
+                              : blend(colors[i], colors[p], t,
+                                      TPixelCM32::getMaxTone());
             break;
           }
 
@@ -3657,11 +3719,7 @@ void doQuickResampleColorFilter(const TRaster32P &dn, const TRasterCM32P &up,
   if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
   const int PADN = 16;
 
-  std::vector<TPixel32> paints(plt->getStyleCount());
-  std::vector<TPixel32> inks(plt->getStyleCount());
-
-  for (int i  = 0; i < plt->getStyleCount(); i++)
-    paints[i] = inks[i] = ::premultiply(plt->getStyle(i)->getAverageColor());
+  std::shared_ptr<const TPaletteColorLut> lut = plt->getColorLut();
 
   assert(std::max(up->getLx(), up->getLy()) <
          (1 << (8 * sizeof(int) - PADN - 1)));
@@ -3753,22 +3811,7 @@ void doQuickResampleColorFilter(const TRaster32P &dn, const TRasterCM32P &up,
       assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
              (yI <= up->getLy() - 1));
 
-      TPixelCM32 *upPix = upBasePix + (yI * upWrap + xI);
-      int t             = upPix->getTone();
-      int p             = upPix->getPaint();
-      int i             = upPix->getInk();
-      TPixel32 colorUp;
-      switch (t) {
-      case 0:
-        colorUp = inks[i];
-        break;
-      case 255:
-        colorUp = paints[p];
-        break;
-      default:
-        colorUp = blend(inks[i], paints[p], t, TPixelCM32::getMaxTone());
-        break;
-      }
+      TPixel32 colorUp = lut->getPixel(upBasePix[yI * upWrap + xI]);
 
       if (colorMask == TRop::MChan)
         dnPix->r = dnPix->g = dnPix->b = colorUp.m;
@@ -4191,14 +4234,17 @@ void doQuickResampleFilter_optimized(const TRaster32P &dn, const TRaster32P &up,
 
 void TRop::quickPut(const TRasterP &dn, const TRasterCM32P &upCM32,
                     const TPaletteP &plt, const TAffine &aff,
-                    const TPixel32 &globalColorScale, bool inksOnly) {
+                    const TPixel32 &globalColorScale, bool inksOnly,
+                    int rowBegin, int rowEnd) {
   TRaster32P dn32 = dn;
+  if (rowEnd < 0) rowEnd = dn->getLy();
   if (dn32 && upCM32)
     if (areAlmostEqual(aff.a12, 0) && areAlmostEqual(aff.a21, 0))
       doQuickPutCmapped(dn32, upCM32, plt, aff.a11, aff.a22, aff.a13, aff.a23,
-                        globalColorScale, inksOnly);
+                        globalColorScale, inksOnly, rowBegin, rowEnd);
     else
-      doQuickPutCmapped(dn32, upCM32, plt, aff, globalColorScale, inksOnly);
+      doQuickPutCmapped(dn32, upCM32, plt, aff, globalColorScale, inksOnly,
+                        rowBegin, rowEnd);
   else
     throw TRopException("raster type mismatch");
 }
@@ -4211,7 +4257,8 @@ void TRop::quickPut(const TRasterP &dn, const TRasterCM32P &upCM32,
 
 void TRop::quickPut(const TRasterP &dn, const TRasterCM32P &upCM32,
                     const TPaletteP &plt, const TAffine &aff,
-                    const CmappedQuickputSettings &settings)  // const TPixel32&
+                    const CmappedQuickputSettings &settings, int rowBegin,
+                    int rowEnd)  // const TPixel32&
 // globalColorScale, bool
 // inksOnly, bool
 // transparencyCheck, bool
@@ -4219,11 +4266,12 @@ void TRop::quickPut(const TRasterP &dn, const TRasterCM32P &upCM32,
 // paintIndex)
 {
   TRaster32P dn32 = dn;
+  if (rowEnd < 0) rowEnd = dn->getLy();
   if (dn32 && upCM32)
-    doQuickPutCmapped(dn32, upCM32, plt, aff,
-                      settings);  // globalColorScale, inksOnly,
-                                  // transparencyCheck, blackBgCheck, inkIndex,
-                                  // paintIndex);
+    doQuickPutCmapped(dn32, upCM32, plt, aff, settings, rowBegin,
+                      rowEnd);  // globalColorScale, inksOnly,
+                                // transparencyCheck, blackBgCheck, inkIndex,
+                                // paintIndex);
   else
     throw TRopException("raster type mismatch");
 }
@@ -4259,10 +4307,14 @@ void TRop::quickResampleColorFilter(const TRasterP &dn, const TRasterP &up,
 void quickPut(const TRasterP &dn, const TRasterP &up, const TAffine &aff,
               TRop::ResampleFilterType filterType, const TPixel32 &colorScale,
               bool doPremultiply, bool whiteTransp, bool firstColumn,
-              bool doRasterDarkenBlendedView) {
+              bool doRasterDarkenBlendedView, int rowBegin, int rowEnd) {
   assert(filterType == TRop::Bilinear || filterType == TRop::ClosestPixel);
 
   bool bilinear = filterType == TRop::Bilinear;
+  if (rowEnd < 0) rowEnd = dn->getLy();
+
+  // The bilinear puts can only write the whole of dn
+  assert(!bilinear || (rowBegin == 0 && rowEnd == dn->getLy()));
 
   TRaster32P dn32 = dn;
   TRaster32P up32 = up;
@@ -4274,9 +4326,9 @@ void quickPut(const TRasterP &dn, const TRasterP &up, const TAffine &aff,
     assert(filterType == TRop::ClosestPixel);
     if (areAlmostEqual(aff.a12, 0) && areAlmostEqual(aff.a21, 0))
       doQuickPutNoFilter(dn32, up8, aff.a11, aff.a22, aff.a13, aff.a23,
-                         colorScale);
+                         colorScale, rowBegin, rowEnd);
     else
-      doQuickPutNoFilter(dn32, up8, aff, colorScale);
+      doQuickPutNoFilter(dn32, up8, aff, colorScale, rowBegin, rowEnd);
   } else if (dn32 && up32) {
     if (areAlmostEqual(aff.a12, 0) && areAlmostEqual(aff.a21, 0)) {
       if (bilinear)
@@ -4284,16 +4336,18 @@ void quickPut(const TRasterP &dn, const TRasterP &up, const TAffine &aff,
       else {
         doQuickPutNoFilter(dn32, up32, aff.a11, aff.a22, aff.a13, aff.a23,
                            colorScale, doPremultiply, whiteTransp, firstColumn,
-                           doRasterDarkenBlendedView);
+                           doRasterDarkenBlendedView, rowBegin, rowEnd);
       }
     } else if (bilinear)
       doQuickPutFilter(dn32, up32, aff);
     else {
       doQuickPutNoFilter(dn32, up32, aff, colorScale, doPremultiply,
-                         whiteTransp, firstColumn, doRasterDarkenBlendedView);
+                         whiteTransp, firstColumn, doRasterDarkenBlendedView,
+                         rowBegin, rowEnd);
     }
   } else if (dn32 && up64)
-    doQuickPutNoFilter(dn32, up64, aff, doPremultiply, firstColumn);
+    doQuickPutNoFilter(dn32, up64, aff, doPremultiply, firstColumn, rowBegin,
+                       rowEnd);
   else
     throw TRopException("raster type mismatch");
 }
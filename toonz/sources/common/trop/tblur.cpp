@@ -3,6 +3,11 @@
 #include "traster.h"
 #include "trop.h"
 #include "tpixelgr.h"
+#include "tthread.h"
+
+#include <complex>
+#include <limits>
+#include <vector>
 
 #if defined(_WIN32) && defined(x64)
 #define USE_SSE2
@@ -38,6 +43,54 @@ struct BlurPixel {
 
 //===================================================================
 
+// Rows and columns filtered per task. Columns are written to the
+// destination raster with a stride, so they are grouped to limit the cache
+// lines shared between tasks.
+const int BlurRowsPerTask    = 8;
+const int BlurColumnsPerTask = 32;
+
+// The smallest radius filtered by the recursive Gaussian (sigma = 0.6)
+const double GaussianBlurMinRadius = 1.5;
+
+//-------------------------------------------------------------------
+
+// A scratch line of a blur pass - each task uses its own
+template <class T>
+class BlurLine {
+  T *m_data;
+  bool m_aligned;
+
+public:
+  BlurLine(int count, bool aligned) : m_aligned(false) {
+#ifdef _WIN32
+    if (aligned) {
+      m_data    = (T *)_aligned_malloc(count * sizeof(T), 16);
+      m_aligned = true;
+      if (!m_data) throw std::bad_alloc();
+      return;
+    }
+#endif
+    m_data = new T[count];
+  }
+  ~BlurLine() {
+#ifdef _WIN32
+    if (m_aligned) {
+      _aligned_free(m_data);
+      return;
+    }
+#endif
+    delete[] m_data;
+  }
+
+  T *get() const { return m_data; }
+
+private:
+  BlurLine(const BlurLine &);
+  BlurLine &operator=(const BlurLine &);
+};
+
+//===================================================================
+
 #define LOAD_COL_CODE                                                          \
                                                                                \
   buffer += x;                                                                 \
@@ -522,6 +575,21 @@ void store_colRgb(T *buffer, int wrap, int r_ly, T *col, int ly, int x, int dy,
     assert(false);
 }
 
+//-------------------------------------------------------------------
+
+// Float pixels are never backlit
+template <>
+void store_colRgb<TPixelF>(TPixelF *buffer, int wrap, int r_ly, TPixelF *col,
+                           int ly, int x, int dy, int backlit, double blur) {
+  assert(!backlit);
+
+  buffer += x;
+  for (int i = ((dy >= 0) ? 0 : -dy); i < std::min(ly, r_ly - dy); i++) {
+    *buffer = col[i];
+    buffer += wrap;
+  }
+}
+
 //-------------------------------------------------------------------
 template <class T>
 void store_colGray(T *buffer, int wrap, int r_ly, T *col, int ly, int x, int dy,
@@ -573,7 +641,10 @@ void do_filtering_chan(BlurPixel<P> *row1, T *row2, int length, float coeff,
     BlurPixel<P> sigma1, sigma2, sigma3, desigma;
     BlurPixel<P> *pix1, *pix2, *pix3, *pix4;
 
-    BLUR_CODE((P)0.5, Q)
+    // Float channels are not rounded
+    const P roundFac = std::numeric_limits<Q>::is_integer ? (P)0.5 : (P)0;
+
+    BLUR_CODE(roundFac, Q)
   }
 }
 
@@ -763,7 +834,7 @@ void do_filtering_floatRgb(T *row1, BlurPixel<P> *row2, int length, float coeff,
 template <class T, class Q, class P>
 void doBlurRgb(TRasterPT<T> &dstRas, TRasterPT<T> &srcRas, double blur, int dx,
                int dy, bool useSSE) {
-  int i, lx, ly, llx, lly, brad;
+  int lx, ly, llx, lly, brad;
   float coeff, coeffq, diff;
   int bx1 = 0, by1 = 0, bx2 = 0, by2 = 0;
 
@@ -785,89 +856,75 @@ void doBlurRgb(TRasterPT<T> &dstRas, TRasterPT<T> &srcRas, double blur, int dx,
   llx = lx + bx1 + bx2;
   lly = ly + by1 + by2;
 
-  T *row1, *col2, *buffer;
-  BlurPixel<P> *row2, *col1, *fbuffer;
+  T *buffer;
+  BlurPixel<P> *fbuffer;
   TRasterGR8P r1;
 
 #ifdef _WIN32
-  if (useSSE) {
+  if (useSSE)
     fbuffer =
         (BlurPixel<P> *)_aligned_malloc(llx * ly * sizeof(BlurPixel<P>), 16);
-    row1 = (T *)_aligned_malloc((llx + 2 * brad) * sizeof(T), 16);
-    col1 = (BlurPixel<P> *)_aligned_malloc(
-        (lly + 2 * brad) * sizeof(BlurPixel<P>), 16);
-    col2 = (T *)_aligned_malloc(lly * sizeof(T), 16);
-  } else
+  else
 #endif
   {
     TRasterGR8P raux(llx * sizeof(BlurPixel<P>), ly);
     r1 = raux;
     r1->lock();
     fbuffer = (BlurPixel<P> *)r1->getRawData();  // new CASM_FPIXEL [llx *ly];
-    row1    = new T[llx + 2 * brad];
-    col1    = new BlurPixel<P>[ lly + 2 * brad ];
-    col2    = new T[lly];
   }
 
-  if ((!fbuffer) || (!row1) || (!col1) || (!col2)) {
+  if (!fbuffer) {
     if (!useSSE) r1->unlock();
-#ifdef _WIN32
-    if (useSSE) {
-      _aligned_free(col2);
-      _aligned_free(col1);
-      _aligned_free(row1);
-      _aligned_free(fbuffer);
-    } else
-#endif
-    {
-      delete[] col2;
-      delete[] col1;
-      delete[] row1;
-    }
     return;
   }
 
-  row2 = fbuffer;
-
   try {
-    for (i = 0; i < ly; i++) {
-      load_rowRgb<T>(srcRas, row1 + brad, lx, i, brad, bx1, bx2);
-      do_filtering_floatRgb<T>(row1 + brad, row2, llx, coeff, coeffq, brad,
-                               diff, useSSE);
-      row2 += llx;
-    }
+    // Rows are filtered into fbuffer independently of each other; then
+    // columns are, from fbuffer into the destination
+    TThread::parallelFor(
+        0, ly,
+        [&](int y0, int y1) {
+          BlurLine<T> row1(llx + 2 * brad, useSSE);
+          BlurPixel<P> *row2 = fbuffer + y0 * llx;
+          for (int y = y0; y < y1; y++, row2 += llx) {
+            load_rowRgb<T>(srcRas, row1.get() + brad, lx, y, brad, bx1, bx2);
+            do_filtering_floatRgb<T>(row1.get() + brad, row2, llx, coeff,
+                                     coeffq, brad, diff, useSSE);
+          }
+        },
+        BlurRowsPerTask);
+
     dstRas->lock();
     buffer = (T *)dstRas->getRawData();
 
     if (dy >= 0) buffer += (dstRas->getWrap()) * dy;
 
-    for (i = (dx >= 0) ? 0 : -dx; i < std::min(llx, dstRas->getLx() - dx);
-         i++) {
-      load_colRgb<P>(fbuffer, col1 + brad, llx, ly, i, brad, by1, by2);
-      do_filtering_chan<T, Q, P>(col1 + brad, col2, lly, coeff, coeffq, brad,
-                                 diff, useSSE);
-      store_colRgb<T>(buffer, dstRas->getWrap(), dstRas->getLy(), col2, lly,
-                      i + dx, dy, 0, blur);
-    }
+    TThread::parallelFor(
+        (dx >= 0) ? 0 : -dx, std::min(llx, dstRas->getLx() - dx),
+        [&](int x0, int x1) {
+          BlurLine<BlurPixel<P>> col1(lly + 2 * brad, useSSE);
+          BlurLine<T> col2(lly, useSSE);
+          for (int x = x0; x < x1; x++) {
+            load_colRgb<P>(fbuffer, col1.get() + brad, llx, ly, x, brad, by1,
+                           by2);
+            do_filtering_chan<T, Q, P>(col1.get() + brad, col2.get(), lly,
+                                       coeff, coeffq, brad, diff, useSSE);
+            store_colRgb<T>(buffer, dstRas->getWrap(), dstRas->getLy(),
+                            col2.get(), lly, x + dx, dy, 0, blur);
+          }
+        },
+        BlurColumnsPerTask);
     dstRas->unlock();
   } catch (...) {
     dstRas->clear();
   }
 
 #ifdef _WIN32
-  if (useSSE) {
-    _aligned_free(col2);
-    _aligned_free(col1);
-    _aligned_free(row1);
+  if (useSSE)
     _aligned_free(fbuffer);
-  } else
+  else
 #endif
-  {
-    delete[] col2;
-    delete[] col1;
-    delete[] row1;
     r1->unlock();
-  }
 }
 
 //-------------------------------------------------------------------
@@ -875,7 +932,7 @@ void doBlurRgb(TRasterPT<T> &dstRas, TRasterPT<T> &srcRas, double blur, int dx,
 template <class T>
 void doBlurGray(TRasterPT<T> &dstRas, TRasterPT<T> &srcRas, double blur, int dx,
                 int dy) {
-  int i, lx, ly, llx, lly, brad;
+  int lx, ly, llx, lly, brad;
   float coeff, coeffq, diff;
   int bx1 = 0, by1 = 0, bx2 = 0, by2 = 0;
 
@@ -894,54 +951,311 @@ void doBlurGray(TRasterPT<T> &dstRas, TRasterPT<T> &srcRas, double blur, int dx,
   llx = lx + bx1 + bx2;
   lly = ly + by1 + by2;
 
-  T *row1, *col2, *buffer;
-  float *row2, *col1, *fbuffer;
+  T *buffer;
+  float *fbuffer;
 
   TRasterGR8P r1(llx * sizeof(float), ly);
   r1->lock();
   fbuffer = (float *)r1->getRawData();  // new float[llx *ly];
 
-  row1 = new T[llx + 2 * brad];
-  col1 = new float[lly + 2 * brad];
-  col2 = new T[lly];
+  if (!fbuffer) return;
+
+  // As in doBlurRgb(), rows and then columns are filtered in parallel
+  TThread::parallelFor(
+      0, ly,
+      [&](int y0, int y1) {
+        BlurLine<T> row1(llx + 2 * brad, false);
+        float *row2 = fbuffer + y0 * llx;
+        for (int y = y0; y < y1; y++, row2 += llx) {
+          load_rowGray<T>(srcRas, row1.get() + brad, lx, y, brad, bx1, bx2);
+          do_filtering_channel_float<T>(row1.get() + brad, row2, llx, coeff,
+                                        coeffq, brad, diff);
+        }
+      },
+      BlurRowsPerTask);
 
-  if ((!fbuffer) || (!row1) || (!col1) || (!col2)) {
-    delete[] row1;
-    delete[] col1;
-    delete[] col2;
-    return;
+  dstRas->lock();
+  buffer = (T *)dstRas->getRawData();
+
+  if (dy >= 0) buffer += (dstRas->getWrap()) * dy;
+
+  TThread::parallelFor(
+      (dx >= 0) ? 0 : -dx, std::min(llx, dstRas->getLx() - dx),
+      [&](int x0, int x1) {
+        BlurLine<float> col1(lly + 2 * brad, false);
+        BlurLine<T> col2(lly, false);
+        for (int x = x0; x < x1; x++) {
+          load_channel_col32(fbuffer, col1.get() + brad, llx, ly, x, brad, by1,
+                             by2);
+          do_filtering_channel_gray<T>(col1.get() + brad, col2.get(), lly,
+                                       coeff, coeffq, brad, diff);
+
+          int backlit = 0;
+          store_colGray<T>(buffer, dstRas->getWrap(), dstRas->getLy(),
+                           col2.get(), lly, x + dx, dy, backlit, blur);
+        }
+      },
+      BlurColumnsPerTask);
+  dstRas->unlock();
+  r1->unlock();  // delete[]fbuffer;
+}
+
+//===================================================================
+//    Recursive Gaussian filter
+//-------------------------------------------------------------------
+
+/*
+  Recursive Gaussian filter (van Vliet, Young, Verbeek - "Recursive Gaussian
+  derivative filters", 1998): lines are filtered by a causal and then an
+  anticausal 3rd order IIR filter, whose cost per pixel does not depend on
+  sigma. The poles are scaled so that the filter variance matches sigma^2
+  exactly; the impulse response then stays within 1% of the Gaussian peak
+  at any sigma.
+
+  Lines are extended with their end values, like the triangle filter does.
+  The causal filter starts from the steady state of the extension, and the
+  anticausal filter from the exact state following the line end (Triggs -
+  Sdika, "Boundary conditions for Young - van Vliet recursive filtering",
+  2006) - so no padding is needed at any radius.
+*/
+class GaussianFilter {
+  double m_b, m_a1, m_a2, m_a3;  // w[n] = b*x[n] + a1*w[n-1] + a2*w[n-2] +
+                                 //        a3*w[n-3]
+  double m_edge[3][3];  // Maps the causal state at the line end to the
+                        // anticausal state following it
+
+public:
+  //! The poles approximation holds for sigma >= 0.5.
+  GaussianFilter(double sigma);
+
+  //! Filters in place \b length pixels of \b C interleaved channels.
+  template <int C>
+  void apply(double *line, int length) const;
+
+private:
+  //! Returns the variance of the filter whose poles are scaled by 1/q.
+  static double variance(double q);
+};
+
+//-------------------------------------------------------------------
+
+// The poles for sigma = 2
+const std::complex<double> GaussianPoles[] = {
+    std::complex<double>(1.41650, 1.00829),
+    std::complex<double>(1.41650, -1.00829), std::complex<double>(1.86543, 0)};
+
+
+double GaussianFilter::variance(double q) {
+  double var = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    std::complex<double> d = std::pow(GaussianPoles[i], 1.0 / q);
+    var += (2.0 * d / ((d - 1.0) * (d - 1.0))).real();
   }
 
-  row2 = fbuffer;
+  return var;
+}
+
+//-------------------------------------------------------------------
+
+GaussianFilter::GaussianFilter(double sigma) {
+  assert(sigma >= 0.5);
 
-  for (i = 0; i < ly; i++) {
-    load_rowGray<T>(srcRas, row1 + brad, lx, i, brad, bx1, bx2);
-    do_filtering_channel_float<T>(row1 + brad, row2, llx, coeff, coeffq, brad,
-                                  diff);
-    row2 += llx;
+  // The variance grows with q
+  double q0 = 0.1, q1 = sigma + 10.0, var = sigma * sigma;
+  for (int i = 0; i < 64; ++i) {
+    double q = 0.5 * (q0 + q1);
+    (variance(q) < var ? q0 : q1) = q;
   }
-  dstRas->lock();
-  buffer = (T *)dstRas->getRawData();
 
-  if (dy >= 0) buffer += (dstRas->getWrap()) * dy;
+  double q = 0.5 * (q0 + q1);
+
+  std::complex<double> p[3];
+  for (int i = 0; i < 3; ++i) p[i] = 1.0 / std::pow(GaussianPoles[i], 1.0 / q);
+
+  m_a1 = (p[0] + p[1] + p[2]).real();
+  m_a2 = -(p[0] * p[1] + p[0] * p[2] + p[1] * p[2]).real();
+  m_a3 = (p[0] * p[1] * p[2]).real();
+  m_b  = 1.0 - (m_a1 + m_a2 + m_a3);
+
+  // Past the line end, the causal output deviates from the end value by a
+  // linear function of its state at the end, and so does the anticausal
+  // output. The matrix is built by filtering each basis state until it has
+  // vanished.
+  int n = tceil(40.0 * q) + 16;
+  std::vector<double> e(n + 3), f(n + 4);
+
+  for (int k = 0; k < 3; ++k) {
+    // e[t + 2] is the causal deviation t pixels after the line end
+    std::fill(e.begin(), e.end(), 0.0);
+    e[2 - k] = 1.0;
+    for (int t = 3; t < n + 3; ++t)
+      e[t] = m_a1 * e[t - 1] + m_a2 * e[t - 2] + m_a3 * e[t - 3];
+
+    // f[t] is the anticausal deviation t pixels after the line end
+    std::fill(f.begin(), f.end(), 0.0);
+    for (int t = n; t > 0; --t)
+      f[t] = m_b * e[t + 2] + m_a1 * f[t + 1] + m_a2 * f[t + 2] +
+             m_a3 * f[t + 3];
+
+    for (int j = 0; j < 3; ++j) m_edge[j][k] = f[j + 1];
+  }
+}
+
+//-------------------------------------------------------------------
+
+template <int C>
+void GaussianFilter::apply(double *line, int length) const {
+  double last[C], w1[C], w2[C], w3[C];
+  double *pix = line;
+  int c;
+
+  for (c = 0; c < C; ++c) {
+    last[c] = line[(length - 1) * C + c];
+    w1[c] = w2[c] = w3[c] = line[c];
+  }
+
+  // Causal pass
+  for (int i = 0; i < length; ++i, pix += C)
+    for (c = 0; c < C; ++c) {
+      double w = m_b * pix[c] + m_a1 * w1[c] + m_a2 * w2[c] + m_a3 * w3[c];
+      w3[c] = w2[c], w2[c] = w1[c], w1[c] = pix[c] = w;
+    }
+
+  // The anticausal state following the line end. Short lines' causal state
+  // includes the steady state before the line start, as needed.
+  for (c = 0; c < C; ++c) {
+    double e0 = w1[c] - last[c], e1 = w2[c] - last[c], e2 = w3[c] - last[c];
+
+    w1[c] = last[c] + m_edge[0][0] * e0 + m_edge[0][1] * e1 +
+            m_edge[0][2] * e2;
+    w2[c] = last[c] + m_edge[1][0] * e0 + m_edge[1][1] * e1 +
+            m_edge[1][2] * e2;
+    w3[c] = last[c] + m_edge[2][0] * e0 + m_edge[2][1] * e1 +
+            m_edge[2][2] * e2;
+  }
+
+  // Anticausal pass
+  for (int i = 0; i < length; ++i) {
+    pix -= C;
+    for (c = 0; c < C; ++c) {
+      double y = m_b * pix[c] + m_a1 * w1[c] + m_a2 * w2[c] + m_a3 * w3[c];
+      w3[c] = w2[c], w2[c] = w1[c], w1[c] = pix[c] = y;
+    }
+  }
+}
+
+//-------------------------------------------------------------------
+
+template <class Q>
+inline Q toChannel(double val, double maxValue) {
+  return (Q)((val <= 0.0) ? 0.0 : (val >= maxValue) ? maxValue : val + 0.5);
+}
+
+template <>
+inline float toChannel<float>(double val, double maxValue) {
+  return (float)val;
+}
+
+//-------------------------------------------------------------------
+
+// Channel access of the pixel types filtered by doGaussianBlur()
+template <class T>
+struct RgbmChannels {
+  enum { count = 4 };
+
+  static void load(const T &pix, double *val) {
+    val[0] = pix.r, val[1] = pix.g, val[2] = pix.b, val[3] = pix.m;
+  }
+  static void store(const double *val, T &pix) {
+    typedef typename T::Channel Q;
+    pix.r = toChannel<Q>(val[0], T::maxChannelValue);
+    pix.g = toChannel<Q>(val[1], T::maxChannelValue);
+    pix.b = toChannel<Q>(val[2], T::maxChannelValue);
+    pix.m = toChannel<Q>(val[3], T::maxChannelValue);
+  }
+};
+
+template <class T>
+struct GrayChannels {
+  enum { count = 1 };
+
+  static void load(const T &pix, double *val) { val[0] = pix.value; }
+  static void store(const double *val, T &pix) {
+    pix.value = toChannel<typename T::Channel>(val[0], T::maxChannelValue);
+  }
+};
+
+//-------------------------------------------------------------------
 
-  for (i = (dx >= 0) ? 0 : -dx; i < std::min(llx, dstRas->getLx() - dx); i++) {
-    load_channel_col32(fbuffer, col1 + brad, llx, ly, i, brad, by1, by2);
-    do_filtering_channel_gray<T>(col1 + brad, col2, lly, coeff, coeffq, brad,
-                                 diff);
+template <class T, class Channels>
+void doGaussianBlur(TRasterPT<T> &dstRas, TRasterPT<T> &srcRas, double blur,
+                    int dx, int dy) {
+  const int C = Channels::count;
+
+  int lx = srcRas->getLx(), ly = srcRas->getLy();
+  if ((lx == 0) || (ly == 0)) return;
 
-    int backlit = 0;
-    store_colGray<T>(buffer, dstRas->getWrap(), dstRas->getLy(), col2, lly,
-                     i + dx, dy, backlit, blur);
+  // The Gaussian with the variance of the triangle filter of radius blur
+  GaussianFilter filter(blur / sqrt(6.0));
+
+  TRasterGR8P r1(lx * C * sizeof(float), ly);
+  r1->lock();
+  float *fbuffer = (float *)r1->getRawData();
+
+  if (!fbuffer) {
+    r1->unlock();
+    return;
   }
+
+  // Rows are filtered into fbuffer
+  srcRas->lock();
+  TThread::parallelFor(
+      0, ly,
+      [&](int y0, int y1) {
+        std::vector<double> line(lx * C);
+        for (int y = y0; y < y1; y++) {
+          const T *pix = srcRas->pixels(y);
+          for (int x = 0; x < lx; x++) Channels::load(pix[x], &line[x * C]);
+
+          filter.apply<C>(&line[0], lx);
+          std::copy(line.begin(), line.end(), fbuffer + y * lx * C);
+        }
+      },
+      BlurRowsPerTask);
+  srcRas->unlock();
+
+  // Then columns are, a block at a time, into the destination
+  int x0 = (dx >= 0) ? 0 : -dx, x1 = std::min(lx, dstRas->getLx() - dx);
+  int y0 = (dy >= 0) ? 0 : -dy, y1 = std::min(ly, dstRas->getLy() - dy);
+
+  dstRas->lock();
+  TThread::parallelFor(
+      x0, x1,
+      [&](int xa, int xb) {
+        std::vector<double> block((xb - xa) * ly * C);
+        int x, y, c;
+
+        for (y = 0; y < ly; y++) {
+          const float *pix = fbuffer + (y * lx + xa) * C;
+          for (x = xa; x < xb; x++, pix += C)
+            for (c = 0; c < C; c++) block[((x - xa) * ly + y) * C + c] = pix[c];
+        }
+
+        for (x = xa; x < xb; x++) filter.apply<C>(&block[(x - xa) * ly * C], ly);
+
+        for (y = y0; y < y1; y++) {
+          T *pix = dstRas->pixels(y + dy) + dx;
+          for (x = xa; x < xb; x++)
+            Channels::store(&block[((x - xa) * ly + y) * C], pix[x]);
+        }
+      },
+      BlurColumnsPerTask);
   dstRas->unlock();
-  delete[] col2;
-  delete[] col1;
-  delete[] row1;
-  r1->unlock();  // delete[]fbuffer;
+
+  r1->unlock();
 }
 
-};  // namespace
+}  // namespace
 
 //====================================================================
 
@@ -955,33 +1269,72 @@ int TRop::getBlurBorder(double blur) {
 //--------------------------------------------------------------------
 
 void TRop::blur(const TRasterP &dstRas, const TRasterP &srcRas, double blur,
-                int dx, int dy, bool useSSE) {
+                int dx, int dy, bool useSSE, BlurFilterType filter) {
+  // The recursive Gaussian does not approximate smaller sigmas well - and
+  // their triangle filter is cheap anyway
+  bool gaussian = (filter == GaussianBlur) && blur >= GaussianBlurMinRadius;
+
   TRaster32P dstRas32 = dstRas;
   TRaster32P srcRas32 = srcRas;
 
-  if (dstRas32 && srcRas32)
-    doBlurRgb<TPixel32, UCHAR, float>(dstRas32, srcRas32, blur, dx, dy, useSSE);
-  else {
-    TRaster64P dstRas64 = dstRas;
-    TRaster64P srcRas64 = srcRas;
-    if (dstRas64 && srcRas64)
+  if (dstRas32 && srcRas32) {
+    if (gaussian)
+      doGaussianBlur<TPixel32, RgbmChannels<TPixel32>>(dstRas32, srcRas32,
+                                                       blur, dx, dy);
+    else
+      doBlurRgb<TPixel32, UCHAR, float>(dstRas32, srcRas32, blur, dx, dy,
+                                        useSSE);
+    return;
+  }
+
+  TRaster64P dstRas64 = dstRas;
+  TRaster64P srcRas64 = srcRas;
+
+  if (dstRas64 && srcRas64) {
+    if (gaussian)
+      doGaussianBlur<TPixel64, RgbmChannels<TPixel64>>(dstRas64, srcRas64,
+                                                       blur, dx, dy);
+    else
       doBlurRgb<TPixel64, USHORT, double>(dstRas64, srcRas64, blur, dx, dy,
                                           useSSE);
-    else {
-      TRasterGR8P dstRasGR8 = dstRas;
-      TRasterGR8P srcRasGR8 = srcRas;
-
-      if (dstRasGR8 && srcRasGR8)
-        doBlurGray<TPixelGR8>(dstRasGR8, srcRasGR8, blur, dx, dy);
-      else {
-        TRasterGR16P dstRasGR16 = dstRas;
-        TRasterGR16P srcRasGR16 = srcRas;
-
-        if (dstRasGR16 && srcRasGR16)
-          doBlurGray<TPixelGR16>(dstRasGR16, srcRasGR16, blur, dx, dy);
-        else
-          throw TException("TRop::blur unsupported pixel type");
-      }
-    }
+    return;
   }
+
+  TRasterFP dstRasF = dstRas;
+  TRasterFP srcRasF = srcRas;
+
+  if (dstRasF && srcRasF) {
+    if (gaussian)
+      doGaussianBlur<TPixelF, RgbmChannels<TPixelF>>(dstRasF, srcRasF, blur,
+                                                     dx, dy);
+    else  // The SSE2 code handles integer channels only
+      doBlurRgb<TPixelF, float, float>(dstRasF, srcRasF, blur, dx, dy, false);
+    return;
+  }
+
+  TRasterGR8P dstRasGR8 = dstRas;
+  TRasterGR8P srcRasGR8 = srcRas;
+
+  if (dstRasGR8 && srcRasGR8) {
+    if (gaussian)
+      doGaussianBlur<TPixelGR8, GrayChannels<TPixelGR8>>(dstRasGR8, srcRasGR8,
+                                                         blur, dx, dy);
+    else
+      doBlurGray<TPixelGR8>(dstRasGR8, srcRasGR8, blur, dx, dy);
+    return;
+  }
+
+  TRasterGR16P dstRasGR16 = dstRas;
+  TRasterGR16P srcRasGR16 = srcRas;
+
+  if (dstRasGR16 && srcRasGR16) {
+    if (gaussian)
+      doGaussianBlur<TPixelGR16, GrayChannels<TPixelGR16>>(
+          dstRasGR16, srcRasGR16, blur, dx, dy);
+    else
+      doBlurGray<TPixelGR16>(dstRasGR16, srcRasGR16, blur, dx, dy);
+    return;
+  }
+
+  throw TException("TRop::blur unsupported pixel type");
 }
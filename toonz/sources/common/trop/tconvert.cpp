@@ -99,6 +99,60 @@ static void do_convert(const TRaster32P &dst, const TRasterGR8P &src) {
 
 //-----------------------------------------------------------------------------
 
+template <typename PIXEL>
+void do_convertToFloat(const TRasterFP &dst, const TRasterPT<PIXEL> &src) {
+  assert(dst->getSize() == src->getSize());
+
+  const float k = 1.0f / PIXEL::maxChannelValue;
+
+  int lx = src->getLx();
+  for (int y = 0; y < src->getLy(); ++y) {
+    TPixelF *outPix = dst->pixels(y);
+    PIXEL *inPix = src->pixels(y), *inEndPix = inPix + lx;
+
+    for (; inPix < inEndPix; ++outPix, ++inPix) {
+      outPix->r = k * inPix->r;
+      outPix->g = k * inPix->g;
+      outPix->b = k * inPix->b;
+      outPix->m = k * inPix->m;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename CHANNEL>
+inline CHANNEL quantizeFloat(float val, float maxValue) {
+  val = val * maxValue + 0.5f;
+  return (CHANNEL)((val < 0.0f) ? 0.0f : (val > maxValue) ? maxValue : val);
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename PIXEL>
+void do_convertFromFloat(const TRasterPT<PIXEL> &dst, const TRasterFP &src) {
+  typedef typename PIXEL::Channel Channel;
+
+  assert(dst->getSize() == src->getSize());
+
+  const float maxValue = PIXEL::maxChannelValue;
+
+  int lx = src->getLx();
+  for (int y = 0; y < src->getLy(); ++y) {
+    PIXEL *outPix  = dst->pixels(y);
+    TPixelF *inPix = src->pixels(y), *inEndPix = inPix + lx;
+
+    for (; inPix < inEndPix; ++outPix, ++inPix) {
+      outPix->r = quantizeFloat<Channel>(inPix->r, maxValue);
+      outPix->g = quantizeFloat<Channel>(inPix->g, maxValue);
+      outPix->b = quantizeFloat<Channel>(inPix->b, maxValue);
+      outPix->m = quantizeFloat<Channel>(inPix->m, maxValue);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
 #define USHORT2BYTE_MAGICFAC (256U * 255U + 1U)
 
 inline UCHAR ditherUcharFromUshort(USHORT in, UINT rndNum) {
@@ -342,12 +396,14 @@ void TRop::convert(TRasterP dst, const TRasterP &src) {
   TRasterGR16P dst16 = dst;
   TRaster64P dst64   = dst;
   TRasterCM32P dstCm = dst;
+  TRasterFP dstF     = dst;
 
   TRaster32P src32      = src;
   TRasterGR8P src8      = src;
   TRaster64P src64      = src;
   TRasterYUV422P srcYUV = src;
   TRasterYUV422P dstYUV = dst;
+  TRasterFP srcF        = src;
 
   src->lock();
   dst->lock();
@@ -372,6 +428,14 @@ void TRop::convert(TRasterP dst, const TRasterP &src) {
     do_convert(dstCm, src32);  //
   else if (dstCm && src8)
     do_convert(dstCm, src8);  //
+  else if (dstF && src32)
+    do_convertToFloat(dstF, src32);
+  else if (dstF && src64)
+    do_convertToFloat(dstF, src64);
+  else if (dst32 && srcF)
+    do_convertFromFloat(dst32, srcF);
+  else if (dst64 && srcF)
+    do_convertFromFloat(dst64, srcF);
   else {
     dst->unlock();
     src->unlock();
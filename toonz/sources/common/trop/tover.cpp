@@ -160,6 +160,30 @@ void do_overT2(TRasterPT<T> rout, const TRasterPT<T> &rup) {
 
 //-----------------------------------------------------------------------------
 
+void do_over(TRasterFP rout, const TRasterFP &rup) {
+  assert(rout->getSize() == rup->getSize());
+  for (int y = 0; y < rout->getLy(); y++) {
+    TPixelF *out_pix       = rout->pixels(y);
+    TPixelF *const out_end = out_pix + rout->getLx();
+    const TPixelF *up_pix  = rup->pixels(y);
+
+    for (; out_pix < out_end; ++out_pix, ++up_pix) {
+      if (up_pix->m >= 1.0f)
+        *out_pix = *up_pix;
+      else if (up_pix->m > 0.0f) {
+        float resm = 1.0f - up_pix->m;
+
+        out_pix->r = up_pix->r + out_pix->r * resm;
+        out_pix->g = up_pix->g + out_pix->g * resm;
+        out_pix->b = up_pix->b + out_pix->b * resm;
+        out_pix->m = up_pix->m + out_pix->m * resm;
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
 #ifdef USE_SSE2
 
 void do_over_SSE2(TRaster32P rout, const TRaster32P &rup) {
@@ -330,6 +354,8 @@ void TRop::over(const TRasterP &rout, const TRasterP &rup, const TPoint &pos) {
 
   TRasterCM32P routCM32 = cRout, rupCM32 = cRup;
 
+  TRasterFP routF = cRout, rupF = cRup;
+
   rout->lock();
   rup->lock();
 
@@ -348,6 +374,13 @@ void TRop::over(const TRasterP &rout, const TRasterP &rup, const TPoint &pos) {
       rup64 = raux;
     }
     do_overT2<TPixel64, USHORT>(rout64, rup64);
+  } else if (routF) {
+    if (!rupF) {
+      TRasterFP raux(cRup->getSize());
+      TRop::convert(raux, cRup);
+      rupF = raux;
+    }
+    do_over(routF, rupF);
   } else if (rout32 && rup8)
     do_over(rout32, rup8);
   else if (rout8 && rup32)
@@ -465,9 +498,9 @@ void TRop::over(TRasterP rout, const TRasterCM32P &rup, TPalette *palette,
 void TRop::quickPut(const TRasterP &out, const TRasterP &up, const TAffine &aff,
                     const TPixel32 &colorScale, bool doPremultiply,
                     bool whiteTransp, bool firstColumn,
-                    bool doRasterDarkenBlendedView) {
+                    bool doRasterDarkenBlendedView, int rowBegin, int rowEnd) {
   ::quickPut(out, up, aff, ClosestPixel, colorScale, doPremultiply, whiteTransp,
-             firstColumn, doRasterDarkenBlendedView);
+             firstColumn, doRasterDarkenBlendedView, rowBegin, rowEnd);
 }
 
 //===================================================================
@@ -10,6 +10,7 @@
 #include "tpixelutils.h"
 #include "ttile.h"
 #include "tpalette.h"
+#include "tpalettecolorlut.h"
 #include "timage_io.h"
 #include "trasterimage.h"
 #include "tsimplecolorstyles.h"
@@ -62,12 +63,7 @@ const TPixel32 c_transparencyCheckInk   = TPixel32::Black;
 
 void TRop::convert(const TRaster32P &rasOut, const TRasterCM32P &rasIn,
                    const TPaletteP palette, bool transparencyCheck) {
-  int count = palette->getStyleCount();
-  int count2 =
-      std::max({count, TPixelCM32::getMaxInk(), TPixelCM32::getMaxPaint()});
-
-  // per poter utilizzare lo switch (piu' efficiente) si utilizza 255
-  // anziche' TPixelCM32::getMaxTone()
+  // the palette color table is built for 8-bit tones
   assert(TPixelCM32::getMaxTone() == 255);
 
   int rasLx = rasOut->getLx();
@@ -75,116 +71,19 @@ void TRop::convert(const TRaster32P &rasOut, const TRasterCM32P &rasIn,
 
   rasOut->lock();
   rasIn->lock();
-#ifdef USE_SSE2
-  if (TSystem::getCPUExtensions() & TSystem::CpuSupportsSse2) {
-    __m128i zeros = _mm_setzero_si128();
-    TPixelFloat *paints =
-        (TPixelFloat *)_aligned_malloc(count2 * sizeof(TPixelFloat), 16);
-    TPixelFloat *inks =
-        (TPixelFloat *)_aligned_malloc(count2 * sizeof(TPixelFloat), 16);
-
-    std::vector<TPixel32> paints2(count2);
-    std::vector<TPixel32> inks2(count2);
-    if (transparencyCheck) {
-      for (int i = 0; i < palette->getStyleCount(); i++) {
-        paints2[i] = c_transparencyCheckPaint;
-        inks2[i]   = c_transparencyCheckInk;
-        paints[i]  = TPixelFloat(paints2[i]);
-        inks[i]    = TPixelFloat(inks2[i]);
-      }
-      paints2[0] = TPixel32::Transparent;
-      paints[0]  = TPixelFloat(TPixel32::Transparent);
-    }
-    /*
-else if (true)
-{
-            for(int i=0;i<palette->getStyleCount();i++)
-{
-paints2[i] = c_transparencyCheckPaint;
-                    inks2[i]   = c_transparencyCheckInk;
-paints[i]  = TPixelFloat(paints2[i]);
-                    inks[i]    = TPixelFloat(inks2[i]);
-            paints2[i] = TPixel32::Transparent;
-            paints[i] = TPixelFloat(TPixel32::Transparent);
-}
-            paints2[0] = TPixel32::Transparent;
-            paints[0] = TPixelFloat(TPixel32::Transparent);
-}
-*/
-    else
-      for (int i = 0; i < palette->getStyleCount(); i++) {
-        TPixel32 color = ::premultiply(palette->getStyle(i)->getAverageColor());
-        paints[i] = inks[i] = TPixelFloat(color);
-        paints2[i] = inks2[i] = color;
-      }
-
-    float maxTone     = (float)TPixelCM32::getMaxTone();
-    __m128 den_packed = _mm_load1_ps(&maxTone);
-
-    for (int y = 0; y < rasLy; ++y) {
-      TPixel32 *pix32   = rasOut->pixels(y);
-      TPixelCM32 *pixIn = rasIn->pixels(y);
-
-      TPixelCM32 *endPixIn = pixIn + rasLx;
-
-      while (pixIn < endPixIn) {
-        int tt = pixIn->getTone();
-        int p  = pixIn->getPaint();
-        int i  = pixIn->getInk();
-        switch (tt) {
-        case 255:
-          *pix32++ = paints2[p];
-          break;
-        case 0:
-          *pix32++ = inks2[i];
-          break;
-        default: {
-          float t         = (float)tt;
-          __m128 a_packed = _mm_load_ps((float *)&(inks[i]));
-          __m128 b_packed = _mm_load_ps((float *)&(paints[p]));
-
-          __m128 num_packed  = _mm_load1_ps(&t);
-          __m128 diff_packed = _mm_sub_ps(den_packed, num_packed);
-
-          // calcola in modo vettoriale out = ((den-num)*a + num*b)/den
-          __m128 outPix_packed = _mm_mul_ps(diff_packed, a_packed);
-          __m128 tmpPix_packed = _mm_mul_ps(num_packed, b_packed);
-
-          outPix_packed = _mm_add_ps(outPix_packed, tmpPix_packed);
-          outPix_packed = _mm_div_ps(outPix_packed, den_packed);
-
-          // converte i canali da float a char
-          __m128i outPix_packed_i = _mm_cvtps_epi32(outPix_packed);
-          outPix_packed_i         = _mm_packs_epi32(outPix_packed_i, zeros);
-          outPix_packed_i         = _mm_packus_epi16(outPix_packed_i, zeros);
-
-          *(DWORD *)(pix32) = _mm_cvtsi128_si32(outPix_packed_i);
-          ++pix32;
-        }
-        }
-        ++pixIn;
-      }
-    }
-
-    _aligned_free(paints);
-    _aligned_free(inks);
 
-  } else  // SSE2 not supported
-#endif    // _WIN32
-  {
+  if (transparencyCheck) {
+    int count  = palette->getStyleCount();
+    int count2 = std::max(
+        {count, TPixelCM32::getMaxInk() + 1, TPixelCM32::getMaxPaint() + 1});
 
     std::vector<TPixel32> paints(count2, TPixel32(255, 0, 0));
     std::vector<TPixel32> inks(count2, TPixel32(255, 0, 0));
-    if (transparencyCheck) {
-      for (int i = 0; i < palette->getStyleCount(); i++) {
-        paints[i] = c_transparencyCheckPaint;
-        inks[i]   = c_transparencyCheckInk;
-      }
-      paints[0] = TPixel32::Transparent;
-    } else
-      for (int i = 0; i < palette->getStyleCount(); i++)
-        paints[i] = inks[i] =
-            ::premultiply(palette->getStyle(i)->getAverageColor());
+    for (int i = 0; i < count; i++) {
+      paints[i] = c_transparencyCheckPaint;
+      inks[i]   = c_transparencyCheckInk;
+    }
+    paints[0] = TPixel32::Transparent;
 
     for (int y = 0; y < rasLy; ++y) {
       TPixel32 *pix32      = rasOut->pixels(y);
@@ -206,7 +105,83 @@ paints[i]  = TPixelFloat(paints2[i]);
         ++pixIn;
       }
     }
+  } else {
+    // The palette's color table is cached across calls
+    std::shared_ptr<const TPaletteColorLut> lut = palette->getColorLut();
+
+#ifdef USE_SSE2
+    if (TSystem::getCPUExtensions() & TSystem::CpuSupportsSse2) {
+      int count2             = lut->getColorCount();
+      const TPixel32 *colors = lut->getColors();
+
+      __m128i zeros = _mm_setzero_si128();
+      TPixelFloat *floatColors =
+          (TPixelFloat *)_aligned_malloc(count2 * sizeof(TPixelFloat), 16);
+      for (int i = 0; i < count2; i++) floatColors[i] = TPixelFloat(colors[i]);
+
+      float maxTone     = (float)TPixelCM32::getMaxTone();
+      __m128 den_packed = _mm_load1_ps(&maxTone);
+
+      for (int y = 0; y < rasLy; ++y) {
+        TPixel32 *pix32   = rasOut->pixels(y);
+        TPixelCM32 *pixIn = rasIn->pixels(y);
+
+        TPixelCM32 *endPixIn = pixIn + rasLx;
+
+        while (pixIn < endPixIn) {
+          int tt = pixIn->getTone();
+          int p  = pixIn->getPaint();
+          int i  = pixIn->getInk();
+          switch (tt) {
+          case 255:
+            *pix32++ = colors[p];
+            break;
+          case 0:
+            *pix32++ = colors[i];
+            break;
+          default: {
+            float t         = (float)tt;
+            __m128 a_packed = _mm_load_ps((float *)&(floatColors[i]));
+            __m128 b_packed = _mm_load_ps((float *)&(floatColors[p]));
+
+            __m128 num_packed  = _mm_load1_ps(&t);
+            __m128 diff_packed = _mm_sub_ps(den_packed, num_packed);
+
+            // calcola in modo vettoriale out = ((den-num)*a + num*b)/den
+            __m128 outPix_packed = _mm_mul_ps(diff_packed, a_packed);
+            __m128 tmpPix_packed = _mm_mul_ps(num_packed, b_packed);
+
+            outPix_packed = _mm_add_ps(outPix_packed, tmpPix_packed);
+            outPix_packed = _mm_div_ps(outPix_packed, den_packed);
+
+            // converte i canali da float a char
+            __m128i outPix_packed_i = _mm_cvtps_epi32(outPix_packed);
+            outPix_packed_i         = _mm_packs_epi32(outPix_packed_i, zeros);
+            outPix_packed_i         = _mm_packus_epi16(outPix_packed_i, zeros);
+
+            *(DWORD *)(pix32) = _mm_cvtsi128_si32(outPix_packed_i);
+            ++pix32;
+          }
+          }
+          ++pixIn;
+        }
+      }
+
+      _aligned_free(floatColors);
+    } else  // SSE2 not supported
+#endif      // USE_SSE2
+    {
+      for (int y = 0; y < rasLy; ++y) {
+        TPixel32 *pix32      = rasOut->pixels(y);
+        TPixelCM32 *pixIn    = rasIn->pixels(y);
+        TPixelCM32 *endPixIn = pixIn + rasLx;
+
+        for (; pixIn < endPixIn; ++pixIn, ++pix32)
+          *pix32 = lut->getPixel(*pixIn);
+      }
+    }
   }
+
   rasOut->unlock();
   rasIn->unlock();
 }
@@ -15,6 +15,7 @@
 #include <QMutexLocker>
 
 #include "tpalette.h"
+#include "tpalettecolorlut.h"
 
 #include <memory>
 #include <sstream>
@@ -296,6 +297,24 @@ TColorStyle *TPalette::getStyle(int index) const {
 
 //-------------------------------------------------------------------
 
+std::shared_ptr<const TPaletteColorLut> TPalette::getColorLut() const {
+  QMutexLocker muLock(&m_colorLutMutex);
+
+  if (!m_colorLut || m_colorLut->getStyleCount() != getStyleCount())
+    m_colorLut = std::make_shared<TPaletteColorLut>(this);
+
+  return m_colorLut;
+}
+
+//-------------------------------------------------------------------
+
+void TPalette::invalidateColorLut() {
+  QMutexLocker muLock(&m_colorLutMutex);
+  m_colorLut.reset();
+}
+
+//-------------------------------------------------------------------
+
 int TPalette::getStyleInPagesCount() const {
   int styleInPagesCount = 0;
   for (int i = 0; i < getStyleCount(); i++)
@@ -327,6 +346,7 @@ int TPalette::addStyle(TColorStyle *style) {
       if (getStyle(i) == style) break;
     if (i == styleId) {
       m_styles.push_back(std::make_pair((Page *)0, style));
+      invalidateColorLut();
       return styleId;
     }
   }
@@ -358,6 +378,7 @@ void TPalette::setStyle(int styleId, TColorStyle *style) {
       m_styleAnimationTable.erase(styleId);
 
     m_styles[styleId].second = styleOwner.release();
+    invalidateColorLut();
   }
 }
 
@@ -1095,6 +1116,8 @@ void TPalette::setFrame(int frame) {
       }
     }
   }
+
+  if (isAnimated()) invalidateColorLut();
 }
 
 //-------------------------------------------------------------------
@@ -0,0 +1,24 @@
+
+
+#include "tpalettecolorlut.h"
+#include "tpalette.h"
+#include "tcolorstyles.h"
+
+#include <algorithm>
+
+//*****************************************************************************************
+//    TPaletteColorLut  implementation
+//*****************************************************************************************
+
+TPaletteColorLut::TPaletteColorLut(const TPalette *palette) {
+  int styleCount = palette->getStyleCount();
+  int idCount    = std::max({styleCount, TPixelCM32::getMaxInk() + 1,
+                          TPixelCM32::getMaxPaint() + 1});
+
+  m_averageColors.resize(styleCount);
+  m_colors.resize(idCount, TPixel32::Red);
+  for (int i = 0; i < styleCount; ++i) {
+    m_averageColors[i] = palette->getStyle(i)->getAverageColor();
+    m_colors[i]        = ::premultiply(m_averageColors[i]);
+  }
+}
@@ -13,6 +13,43 @@
 
 //#include "tstroke.h"
 
+#include <climits>
+#include <algorithm>
+
+//=============================================================================
+
+namespace {
+
+/*!
+  Removes the pairs of outline points that are closer than \b tolerance to
+  the last pair kept. Outlines are drawn as strips of quads, which remain
+  valid strips.
+*/
+void simplifyOutline(std::vector<TOutlinePoint> &v, double tolerance) {
+  if (v.size() % 2 != 0 || v.size() <= 4) return;
+
+  double tolerance2 = tolerance * tolerance;
+  int pairCount = (int)v.size() / 2, keptCount = 1;
+  for (int i = 1; i < pairCount; ++i) {
+    const TOutlinePoint &p0 = v[2 * i], &p1 = v[2 * i + 1];
+    const TOutlinePoint &last0 = v[2 * keptCount - 2],
+                        &last1 = v[2 * keptCount - 1];
+
+    // the last pair closes the stroke
+    if (i < pairCount - 1 &&
+        tdistance2(convert(p0), convert(last0)) < tolerance2 &&
+        tdistance2(convert(p1), convert(last1)) < tolerance2)
+      continue;
+
+    v[2 * keptCount]     = p0;
+    v[2 * keptCount + 1] = p1;
+    ++keptCount;
+  }
+  v.erase(v.begin() + 2 * keptCount, v.end());
+}
+
+}  // namespace
+
 //=============================================================================
 
 TSimpleStrokeProp::TSimpleStrokeProp(const TStroke *stroke,
@@ -183,20 +220,16 @@ void TVectorImagePatternStrokeProp::draw(
 
 OutlineStrokeProp::OutlineStrokeProp(const TStroke *stroke,
                                      const TOutlineStyleP style)
-    : TStrokeProp(stroke)
-    , m_colorStyle(style)
-    , m_outline()
-    , m_outlinePixelSize(0) {
+    : TStrokeProp(stroke), m_colorStyle(style) {
   m_styleVersionNumber = m_colorStyle->getVersionNumber();
 }
 
 //-----------------------------------------------------------------------------
 
 TStrokeProp *OutlineStrokeProp::clone(const TStroke *stroke) const {
-  OutlineStrokeProp *prop  = new OutlineStrokeProp(stroke, m_colorStyle);
-  prop->m_strokeChanged    = m_strokeChanged;
-  prop->m_outline          = m_outline;
-  prop->m_outlinePixelSize = m_outlinePixelSize;
+  OutlineStrokeProp *prop = new OutlineStrokeProp(stroke, m_colorStyle);
+  prop->m_strokeChanged   = m_strokeChanged;
+  prop->m_lods            = m_lods;
   return prop;
 }
 
@@ -228,29 +261,54 @@ void OutlineStrokeProp::draw(const TVectorRenderData &rd) {
         new TCenterLineStrokeStyle(m_colorStyle->getAverageColor(), 0, 0);
     appStyle->drawStroke(rd.m_cf, m_stroke);
     delete appStyle;
-  } else {
-    if (!isAlmostZero(pixelSize - m_outlinePixelSize, 1e-5) ||
-        m_strokeChanged ||
-        m_styleVersionNumber != m_colorStyle->getVersionNumber()) {
-      m_strokeChanged    = false;
-      m_outlinePixelSize = pixelSize;
-      TOutlineUtil::OutlineParameter param;
-
-      m_outline.getArray().clear();
-      m_colorStyle->computeOutline(m_stroke, m_outline, param);
-
-      // TOutlineStyle::StrokeOutlineModifier *modifier =
-      // m_colorStyle->getStrokeOutlineModifier();
-      // if(modifier)
-      //  modifier->modify(m_outline);
-
-      m_styleVersionNumber = m_colorStyle->getVersionNumber();
-    }
+  } else
+    m_colorStyle->drawStroke(rd.m_cf,
+                             &getOutline(pixelSize, !rd.m_isOfflineRender),
+                             m_stroke);
+
+  glPopMatrix();
+}
 
-    m_colorStyle->drawStroke(rd.m_cf, &m_outline, m_stroke);
+//-----------------------------------------------------------------------------
+
+TStrokeOutline &OutlineStrokeProp::getOutline(double pixelSize,
+                                              bool onScreen) {
+  if (m_strokeChanged ||
+      m_styleVersionNumber != m_colorStyle->getVersionNumber()) {
+    m_strokeChanged      = false;
+    m_styleVersionNumber = m_colorStyle->getVersionNumber();
+    m_lods.clear();
   }
 
-  glPopMatrix();
+  // the level's pixel size is never larger than the screen's one
+  int level = pixelSize > 0 ? (int)floor(2.0 * log2(pixelSize)) : INT_MIN;
+
+  // other outline styles may rely on every point, e.g. for texturing
+  bool simplified =
+      onScreen && level >= SimplifiedLevel &&
+      dynamic_cast<TSolidColorStyle *>(m_colorStyle.getPointer()) != 0;
+
+  for (int i = 0; i < (int)m_lods.size(); ++i)
+    if (m_lods[i].m_level == level && m_lods[i].m_simplified == simplified) {
+      std::rotate(m_lods.begin(), m_lods.begin() + i, m_lods.begin() + i + 1);
+      return m_lods[0].m_outline;
+    }
+
+  Lod lod;
+  lod.m_level      = level;
+  lod.m_simplified = simplified;
+
+  double lodPixelSize = pixelSize > 0 ? pow(2.0, 0.5 * level) : 0.0;
+  TOutlineUtil::OutlineParameter param(0, lodPixelSize);
+  m_colorStyle->computeOutline(m_stroke, lod.m_outline, param);
+
+  if (simplified)
+    simplifyOutline(lod.m_outline.getArray(), 0.5 * lodPixelSize);
+
+  m_lods.insert(m_lods.begin(), lod);
+  if ((int)m_lods.size() > MaxLodCount) m_lods.pop_back();
+
+  return m_lods[0].m_outline;
 }
 
 //=============================================================================
@@ -62,6 +62,10 @@ public:
 
   void doCompute(TTile &tile, double frame, const TRenderSettings &ri) override;
 
+  bool isPointwise() const override { return true; }
+  void computePixels(const TRasterP &ras, double frame,
+                     const TRenderSettings &ri) override;
+
   void setColorFilter(TPixel32 color) { m_colorFilter = color; }
 
   std::string getAlias(double frame,
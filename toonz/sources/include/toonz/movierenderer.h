@@ -72,6 +72,20 @@ public:
 
   void addFrame(double frame, const TFxPair &fx);
 
+  //! Sets a folder where the content keys of the saved frames are recorded
+  //! (see TRenderer::RenderData::getContentKey()). Frames whose content was
+  //! already saved by any render sharing the folder - like other chunks of a
+  //! farm render - are copied from the recorded file instead of being
+  //! rendered again. Only image sequences support frames reuse.
+  //! Recorded keys also stamp the modification time and size of the scene
+  //! and level files, so that frames are not reused once a source file
+  //! changes. Levels with unsaved changes disable frames reuse.
+  void setFrameKeysFolder(const TFilePath &folder);
+
+  //! Returns the number of frames which were not rendered since their content
+  //! was identical to that of another frame.
+  int getDuplicateFramesCount() const;
+
   void start();
 
 public slots:
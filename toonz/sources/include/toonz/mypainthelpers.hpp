@@ -50,8 +50,15 @@ namespace mypaint {
       void *controller;
       bool antialiasing;
 
+      // pixels outside the clip rect are never read nor written
+      int clipX0;
+      int clipY0;
+      int clipX1;
+      int clipY1;
+
       SurfaceCustom():
-        pointer(), width(), height(), pixelSize(), rowSize(), controller(), antialiasing(true)
+        pointer(), width(), height(), pixelSize(), rowSize(), controller(), antialiasing(true),
+        clipX0(0), clipY0(0), clipX1(-1), clipY1(-1)
         { }
 
       SurfaceCustom(void *pointer, int width, int height, int pixelSize, int rowSize = 0, void *controller = 0, bool antialiasing = true):
@@ -61,9 +68,42 @@ namespace mypaint {
         pixelSize(pixelSize),
         rowSize(rowSize ? rowSize : width*pixelSize),
         controller(controller),
-        antialiasing(antialiasing)
+        antialiasing(antialiasing),
+        clipX0(0),
+        clipY0(0),
+        clipX1(width-1),
+        clipY1(height-1)
         { }
 
+      void setClip(int x0, int y0, int x1, int y1) {
+        clipX0 = std::max(0, x0);
+        clipY0 = std::max(0, y0);
+        clipX1 = std::min(width-1, x1);
+        clipY1 = std::min(height-1, y1);
+      }
+
+      void resetClip()
+        { setClip(0, 0, width-1, height-1); }
+
+      // bounding rect of the pixels touched by dab, inside the surface
+      bool getDabSurfaceBounds(const Dab &dab, int &x0, int &y0, int &x1, int &y1) const {
+        x0 = std::max(0, (int)floor(dab.x - dab.radius - 1.f + precision));
+        x1 = std::min(width-1, (int)ceil(dab.x + dab.radius + 1.f - precision));
+        y0 = std::max(0, (int)floor(dab.y - dab.radius - 1.f + precision));
+        y1 = std::min(height-1, (int)ceil(dab.y + dab.radius + 1.f - precision));
+        return x0 <= x1 && y0 <= y1;
+      }
+
+      // bounding rect of the pixels touched by dab, inside the clip rect
+      bool getDabBounds(const Dab &dab, int &x0, int &y0, int &x1, int &y1) const {
+        getDabSurfaceBounds(dab, x0, y0, x1, y1);
+        x0 = std::max(clipX0, x0);
+        x1 = std::min(clipX1, x1);
+        y0 = std::max(clipY0, y0);
+        y1 = std::min(clipY1, y1);
+        return x0 <= x1 && y0 <= y1;
+      }
+
     private:
       template< bool enableAspect,         // 2 variants
                 bool enableAntialiasing,   // 1 variants (true)
@@ -98,11 +138,8 @@ namespace mypaint {
         }
 
         // bounding rect
-        int x0 = std::max(0, (int)floor(dab.x - dab.radius - 1.f + precision));
-        int x1 = std::min(width-1, (int)ceil(dab.x + dab.radius + 1.f - precision));
-        int y0 = std::max(0, (int)floor(dab.y - dab.radius - 1.f + precision));
-        int y1 = std::min(height-1, (int)ceil(dab.y + dab.radius + 1.f - precision));
-        if (x0 > x1 || y0 > y1)
+        int x0, y0, x1, y1;
+        if (!getDabBounds(dab, x0, y0, x1, y1))
           return false;
 
         if (controller && !askRead(controller, pointer, x0, y0, x1, y1))
@@ -120,12 +157,17 @@ namespace mypaint {
         int pixelNextCol = pixelSize;
         int pixelNextRow = rowSize - w*pixelSize;
 
-        // prepare geometry iterators
+        // the geometry of a pixel is computed from its offset in the unclipped
+        // rect, so that it gets the same values whatever the clip rect is
+        int gx0, gy0, gx1, gy1;
+        getDabSurfaceBounds(dab, gx0, gy0, gx1, gy1);
+
+        // prepare geometry
         float radiusInv = 1.f/dab.radius;
-        float dx = (float)x0 - dab.x + 0.5f;
-        float dy = (float)y0 - dab.y + 0.5f;
-        float ddx, ddxNextCol, ddxNextRow;
-        float ddy, ddyNextCol, ddyNextRow;
+        float dx = (float)gx0 - dab.x + 0.5f;
+        float dy = (float)gy0 - dab.y + 0.5f;
+        float ddx0, ddxNextCol, ddxNextRow;
+        float ddy0, ddyNextCol, ddyNextRow;
         if (enableAspect) {
           float angle = dab.angle*((float)M_PI/180.f);
           float s = sinf(angle);
@@ -133,19 +175,19 @@ namespace mypaint {
 
           float radiusYInv = radiusInv*dab.aspectRatio;
 
-          ddx        = (dx*c + dy*s)*radiusInv;
+          ddx0       = (dx*c + dy*s)*radiusInv;
           ddxNextCol = c*radiusInv;
-          ddxNextRow = (s - c*(float)w)*radiusInv;
+          ddxNextRow = s*radiusInv;
 
-          ddy        = (dy*c - dx*s)*radiusYInv;
+          ddy0       = (dy*c - dx*s)*radiusYInv;
           ddyNextCol = -s*radiusYInv;
-          ddyNextRow = (c + s*(float)w)*radiusYInv;
+          ddyNextRow = c*radiusYInv;
         } else {
-          ddx        = dx*radiusInv;
+          ddx0       = dx*radiusInv;
           ddxNextCol = radiusInv;
-          ddxNextRow = -radiusInv*(float)w;
+          ddxNextRow = 0.f;
 
-          ddy        = dy*radiusInv;
+          ddy0       = dy*radiusInv;
           ddyNextCol = 0.f;
           ddyNextRow = radiusInv;
         }
@@ -215,8 +257,15 @@ namespace mypaint {
         }
 
         // process
-        for(int iy = h; iy; --iy, ddx += ddxNextRow, ddy += ddyNextRow, pixel += pixelNextRow)
-        for(int ix = w; ix; --ix, ddx += ddxNextCol, ddy += ddyNextCol, pixel += pixelNextCol) {
+        float fx0 = (float)(x0 - gx0);
+        float fy = (float)(y0 - gy0);
+        for(int iy = h; iy; --iy, fy += 1.f, pixel += pixelNextRow) {
+        float ddxRow = ddx0 + fy*ddxNextRow;
+        float ddyRow = ddy0 + fy*ddyNextRow;
+        float fx = fx0;
+        for(int ix = w; ix; --ix, fx += 1.f, pixel += pixelNextCol) {
+          float ddx = ddxRow + fx*ddxNextCol;
+          float ddy = ddyRow + fx*ddyNextCol;
           float o;
           if (enableAntialiasing) {
             float dd, dr;
@@ -363,6 +412,7 @@ namespace mypaint {
 
           write(pixel, destR, destG, destB, destA);
         }
+        }
 
         if (enableSummary) {
           double k = colorSumA > precision ? 1.0/colorSumA : 0.0;
@@ -538,18 +588,22 @@ namespace mypaint {
         return done;
       }
 
-      bool drawDab(const Dab &dab) {
+      // Fits dab into the limits of the rasterizer. Returns false if there is
+      // nothing to draw, with the value drawDab() returns in result.
+      bool fitDab(const Dab &dab, Dab &fitted, bool &result) const {
         const float minRadiusX = 0.66f; // equals to drawDabCustom::antialiasing
         const float minRadiusY = 3.f*minRadiusX;
         const float maxAspect = 10.f;
         const float minOpaque = 1.f/256.f;
 
         // check limits
-        Dab d = dab.getClamped();
+        Dab &d = fitted;
+        d = dab.getClamped();
+        result = true;
         if (d.radius <= precision)
-          return true;
+          return false;
         if (d.hardness <= precision)
-          return true;
+          return false;
 
         // fix aspect
         if (d.aspectRatio > maxAspect) {
@@ -589,10 +643,18 @@ namespace mypaint {
         }
 
         // check opaque
-        if (d.opaque < minOpaque)
-          return false;
+        result = false;
+        return d.opaque >= minOpaque;
+      }
 
-        return drawDabCheckAspect(d, antialiasing);
+      // draws a dab returned by fitDab()
+      bool drawFittedDab(const Dab &dab)
+        { return drawDabCheckAspect(dab, antialiasing); }
+
+      bool drawDab(const Dab &dab) {
+        Dab d;
+        bool result;
+        return fitDab(dab, d, result) ? drawFittedDab(d) : result;
       }
     }; // SurfaceCustom
   } // helpers
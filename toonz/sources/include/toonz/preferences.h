@@ -180,6 +180,9 @@ public:
   bool isWatchFileSystemEnabled() {
     return getBoolValue(watchFileSystemEnabled);
   }
+  bool isThumbnailStoreEnabled() const {
+    return getBoolValue(thumbnailStoreEnabled);
+  }
   int getProjectRoot() { return getIntValue(projectRoot); }
   QString getCustomProjectRoot() { return getStringValue(customProjectRoot); }
   PathAliasPriority getPathAliasPriority() const {
@@ -423,6 +426,18 @@ public:
   bool isGeneratedMovieViewEnabled() const {
     return getBoolValue(generatedMovieViewEnabled);
   }
+  int getSpeculativePreviewFrameCount() const {
+    return getIntValue(speculativePreviewFrameCount);
+  }
+  int getSpeculativePreviewCpuShare() const {
+    return getIntValue(speculativePreviewCpuShare);
+  }
+  bool isRegionOfInterestPreviewEnabled() const {
+    return getBoolValue(regionOfInterestPreview);
+  }
+  bool isProgressivePreviewEnabled() const {
+    return getBoolValue(progressivePreview);
+  }
 
   // Onion Skin  tab
   bool isOnionSkinEnabled() const { return getBoolValue(onionSkinEnabled); }
@@ -17,6 +17,7 @@ enum PreferencesItemId {
   backupKeepCount,
   sceneNumberingEnabled,
   watchFileSystemEnabled,
+  thumbnailStoreEnabled,
   projectRoot,
   customProjectRoot,
   pathAliasPriority,
@@ -145,6 +146,10 @@ enum PreferencesItemId {
   fitToFlipbook,
   generatedMovieViewEnabled,
   shortPlayFrameCount,
+  speculativePreviewFrameCount,
+  speculativePreviewCpuShare,
+  regionOfInterestPreview,
+  progressivePreview,
 
   //----------
   // Onion Skin
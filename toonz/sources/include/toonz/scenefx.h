@@ -75,6 +75,24 @@ DVAPI TFxP buildSceneFx(ToonzScene *scene, double frame, TXsheet *xsh = 0,
                         bool isPreview = false, int whichLevels = -1,
                         int shrink = 1);
 
+/*!
+  \brief    Optimizes a render-tree for rendering at the specified frame.
+
+  \details  Consecutive affines are merged, fxs returning their input unchanged
+            are bypassed and chains of pointwise fxs are fused into single
+            passes. The fxs of the passed tree are not modified - so trees
+            meant to be edited, like swatch ones, should not be replaced.
+
+            Returns the passed tree when optimization is disabled.
+*/
+
+DVAPI TFxP optimizeSceneFx(const TFxP &fx, double frame);
+
+//! Enables render-tree optimization (the default). Disabling it allows
+//! comparing outputs and timings with the unoptimized trees.
+DVAPI void enableSceneFxOptimization(bool enable);
+DVAPI bool isSceneFxOptimizationEnabled();
+
 // temo non debba andare qui
 // in ogni caso gestisce anche lo zdepth
 // (utilizzando la camera corrente, il che forse non e' una buona idea)
@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef SOUNDMIXER_H
+#define SOUNDMIXER_H
+
+// TnzCore includes
+#include "tsound.h"
+
+// STD includes
+#include <memory>
+#include <vector>
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TOONZLIB_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=============================================================================
+// forward declarations
+class TXshSoundColumn;
+
+//***************************************************************************************
+//    SoundMixer declaration
+//***************************************************************************************
+
+//! Plays the mix of a set of sound columns, mixing it on demand.
+/*!
+    Unlike TXshSoundColumn::mixingTogether(), which renders the whole mix
+    before anything can be heard, SoundMixer mixes BlockSize samples at a
+    time on its own thread, only slightly ahead of the audio device: at most
+    MaxQueuedBlocks blocks are queued, which bounds the playback latency.
+    Each level is resampled and converted to the mixer's format block by
+    block, and scaled by its column's volume.
+    \n\n
+    The mixer reads a snapshot of the columns taken by setColumns(), so the
+    xsheet can be edited during playback. Samples are counted from frame 0
+    of the xsheet, at the mixer's sample rate - see getSamplePerFrame().
+*/
+class DVAPI SoundMixer {
+public:
+  enum { BlockSize = 1024, MaxQueuedBlocks = 4 };
+
+  struct Statistics {
+    int m_underrunCount;         //!< Device reads that drained the queue
+                                 //!< during playback.
+    TINT64 m_silentSampleCount;  //!< Silence samples played on underruns.
+    TINT64 m_mixedSampleCount;   //!< Samples mixed since the last reset.
+    int m_queuedSampleCount;     //!< Samples currently waiting for the device.
+  };
+
+private:
+  class Imp;
+  std::unique_ptr<Imp> m_imp;
+
+public:
+  SoundMixer();
+  ~SoundMixer();
+
+  //! Replaces the mixed columns with those in \b columns, whose frames last
+  //! 1 / \b fps seconds. Playback is not interrupted.
+  void setColumns(const std::vector<TXshSoundColumn *> &columns, double fps);
+
+  //! Returns true if there is nothing to mix.
+  bool isEmpty() const;
+
+  //! Returns the format of the mix.
+  TSoundTrackFormat getFormat() const;
+  double getSamplePerFrame() const;
+
+  //! Mixes the samples [s0, s0 + dst->getSampleCount()) into \b dst, which
+  //! must be in the mixer's format.
+  void mix(TINT32 s0, const TSoundTrackP &dst) const;
+
+  /*! Plays the samples [s0, s1) of the mix. A range starting where the
+      current one ends continues it seamlessly, so that frame-sized ranges
+      can be queued during playback; any other range restarts the playback.
+  */
+  void play(TINT32 s0, TINT32 s1, bool loop = false);
+  void stop();
+  bool isPlaying() const;
+
+  Statistics getStatistics() const;
+  void resetStatistics();
+
+private:
+  // not implemented
+  SoundMixer(const SoundMixer &);
+  SoundMixer &operator=(const SoundMixer &);
+};
+
+#endif  // SOUNDMIXER_H
@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef SOUNDPEAKS_H
+#define SOUNDPEAKS_H
+
+// TnzCore includes
+#include "tsound.h"
+#include "tfilepath.h"
+
+// STD includes
+#include <vector>
+
+// Qt includes
+#include <QString>
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TOONZLIB_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//***************************************************************************************
+//    SoundPeaks declaration
+//***************************************************************************************
+
+//! A multi-resolution summary of a sound track's mono pressure, used to draw
+//! its waveform at any zoom level without scanning the whole track.
+/*!
+    SoundPeaks stores the min and max of the pressure of each block of
+    BlockSize samples, then of every power-of-two run of blocks. A
+    sample range is answered from O(log) blocks, plus the samples of the
+    partial blocks at its ends - which are read from the track, so results
+    match TSoundTrack::getMinMaxPressure() exactly.
+    \n\n
+    Peaks of sound files are kept in the cache folder, keyed by the file's
+    path, size and modification time: each file is scanned only once.
+*/
+class DVAPI SoundPeaks {
+public:
+  enum { BlockLevel = 8, BlockSize = 1 << BlockLevel };
+
+  struct Block {
+    double m_min, m_max;
+  };
+
+private:
+  std::vector<std::vector<Block>> m_levels;  //!< Level k has blocks of
+                                             //! BlockSize << k samples.
+  TINT32 m_sampleCount;
+  double m_leftMin, m_leftMax;  //!< Extremes of the whole left channel.
+
+public:
+  SoundPeaks();
+
+  //! Scans \b st.
+  void build(const TSoundTrackP &st);
+  //! Reads the stored peaks of the sound file \b path, otherwise scans \b st
+  //! (loaded from \b path) and stores them.
+  void build(const TSoundTrackP &st, const TFilePath &path);
+
+  void clear();
+  bool isEmpty() const { return m_sampleCount <= 0; }
+
+  //! Same as st->getMinMaxPressure(TSound::LEFT, min, max), for the track
+  //! the peaks were built from.
+  void getLeftMinMaxPressure(double &min, double &max) const {
+    min = m_leftMin, max = m_leftMax;
+  }
+
+  //! Same as st->getMinMaxPressure(s0, s1, TSound::MONO, min, max), for the
+  //! track the peaks were built from.
+  void getMinMaxPressure(const TSoundTrackP &st, TINT32 s0, TINT32 s1,
+                         double &min, double &max) const;
+
+private:
+  void buildLevels();
+
+  bool load(const QString &filePath, const TSoundTrackP &st);
+  void save(const QString &filePath, const TSoundTrackP &st) const;
+};
+
+#endif  // SOUNDPEAKS_H
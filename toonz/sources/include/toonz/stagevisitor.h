@@ -262,6 +262,8 @@ private:
   // darken blended view mode for viewing the non-cleanuped and stacked drawings
   bool m_doRasterDarkenBlendedView;
 
+  int m_threadCount;  //!< Threads compositing the raster images on flush
+
   std::vector<TStroke *> m_guidedStrokes;
 
 public:
@@ -292,6 +294,13 @@ public:
 
   void setRasterDarkenBlendedView(bool on) { m_doRasterDarkenBlendedView = on; }
 
+  //! Sets the number of threads used to composite the stacked raster images
+  //! in flushRasterImages(); 0 uses all available cores. Default is 1.
+  //! Fetching the column images while visiting the stage stays serial, as it
+  //! goes through the shared level image caches.
+  void setThreadCount(int count) { m_threadCount = count; }
+  int getThreadCount() const { return m_threadCount; }
+
   std::vector<TStroke *> &getGuidedStrokes() { return m_guidedStrokes; }
 };
 
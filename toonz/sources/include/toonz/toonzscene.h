@@ -148,9 +148,11 @@ none was
 specified), on its currently selected camera, and returns the result on top of
 the specified
 32-bit raster.
+The raster columns are composited by \b threadCount threads (0 uses all cores),
+with the same result for any count.
 */
   void renderFrame(const TRaster32P &ras, int row, const TXsheet *xsh = 0,
-                   bool checkFlags = true) const;
+                   bool checkFlags = true, int threadCount = 1) const;
 
   /*!
 Performs a camera-stand render of the specified xsheet in the specified
@@ -160,8 +162,8 @@ specified
 32-bit raster.
 */
   void renderFrame(const TRaster32P &ras, int row, const TXsheet *xsh,
-                   const TRectD &placedRect,
-                   const TAffine &worldToPlacedAff) const;
+                   const TRectD &placedRect, const TAffine &worldToPlacedAff,
+                   int threadCount = 1) const;
 
   /*!
 Return scene frame count.
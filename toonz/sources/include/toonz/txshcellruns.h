@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef TXSHCELLRUNS_INCLUDED
+#define TXSHCELLRUNS_INCLUDED
+
+#include "toonz/txshcell.h"
+
+#include <vector>
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TOONZLIB_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=============================================================================
+//! The TXshCellRuns class stores a sequence of xsheet cells as runs of
+//! identical cells.
+/*!TXshCellRuns is the cell container used by \b TXshCellColumn. Held cells
+   (the same level and frame repeated on consecutive rows) collapse to a single
+   \b Run, so long holds and very long columns take memory proportional to the
+   number of cell changes rather than to the number of rows.
+
+   Each run stores its cell and the (exclusive) end index of the rows it
+   covers. Random access locates the run by binary search, in O(log R) for R
+   runs. Editing operations split runs at the edit boundaries, work on whole
+   runs and merge equal neighbours back: since runs are kept in a vector with
+   absolute end indices, they cost O(R) - independent of the row count, but
+   not logarithmic. Overwriting a single cell without changing the run
+   layout is O(log R). Loops editing many rows should gather them in a
+   single set() call rather than setting them one by one.
+
+   All empty cells are stored as TXshCell(), so consecutive empty rows always
+   form a single run.
+
+   Indices are local to the container, i.e. 0 is the first stored cell.
+   References returned by operator[](), front() and back() are invalidated by
+   any editing operation.
+*/
+//=============================================================================
+
+class DVAPI TXshCellRuns {
+public:
+  struct Run {
+    TXshCell m_cell;
+    int m_end;  //!< One past the last index covered by the run.
+
+    Run(const TXshCell &cell, int end) : m_cell(cell), m_end(end) {}
+  };
+
+private:
+  std::vector<Run> m_runs;
+
+public:
+  TXshCellRuns() {}
+
+  //! Returns the number of stored cells.
+  int size() const { return m_runs.empty() ? 0 : m_runs.back().m_end; }
+  bool empty() const { return m_runs.empty(); }
+  void clear() { m_runs.clear(); }
+
+  int getRunCount() const { return (int)m_runs.size(); }
+  const Run &getRun(int r) const { return m_runs[r]; }
+  int getRunStart(int r) const { return r > 0 ? m_runs[r - 1].m_end : 0; }
+
+  //! Returns the index of the run containing the cell at \b index.
+  int findRun(int index) const;
+
+  const TXshCell &operator[](int index) const {
+    return m_runs[findRun(index)].m_cell;
+  }
+  const TXshCell &front() const { return m_runs.front().m_cell; }
+  const TXshCell &back() const { return m_runs.back().m_cell; }
+
+  //! Copies \b count cells starting at \b index into \b cells[].
+  void get(int index, int count, TXshCell cells[]) const;
+
+  //! Overwrites \b count cells starting at \b index; the range must be stored.
+  void set(int index, int count, const TXshCell cells[]);
+  void set(int index, const TXshCell &cell) { set(index, 1, &cell); }
+
+  //! Inserts \b count copies of \b cell before \b index, shifting down.
+  void insert(int index, int count, const TXshCell &cell = TXshCell());
+  //! Removes \b count cells starting at \b index, shifting up.
+  void erase(int index, int count);
+
+  void push_back(const TXshCell &cell) { insert(size(), 1, cell); }
+  //! Truncates, or pads with empty cells, to \b newSize cells.
+  void resize(int newSize);
+
+  //! Removes leading empty cells, returning how many were removed.
+  int trimFront();
+  //! Removes trailing empty cells.
+  void trimBack();
+
+  //! Returns the approximate heap footprint of the container, in bytes.
+  size_t getMemorySize() const {
+    return sizeof(*this) + m_runs.capacity() * sizeof(Run);
+  }
+
+private:
+  //! Returns \b cell, or TXshCell() if it is empty.
+  static TXshCell normalized(const TXshCell &cell) {
+    return cell.isEmpty() ? TXshCell() : cell;
+  }
+  //! Ensures a run starts at \b index, returning that run's index.
+  int split(int index);
+  //! Merges each run in [r0, r1] into its predecessor when their cells match.
+  void merge(int r0, int r1);
+};
+
+#endif  // TXSHCELLRUNS_INCLUDED
@@ -6,6 +6,7 @@
 #include "tcolumnset.h"
 #include "tpersist.h"
 #include "traster.h"
+#include "toonz/txshcellruns.h"
 
 #include <QPair>
 #include <QString>
@@ -283,8 +284,8 @@ typedef TSmartPointerT<TXshColumn> TXshColumnP;
 
    The class defines column by cells getCellColumn(). TXshCellColumn is an
 object
-   composed of a \b TXshCell vector and of an integer to memorize first not
-empty cell.
+   composed of a run-length encoded \b TXshCellRuns sequence of cells and of
+an integer to memorize first not empty cell.
 
    Class allows to manage cells in a column.
    It's possible to know if cell is empty isCellEmpty(), if column is empty
@@ -301,7 +302,7 @@ removeCells(),
 
 class DVAPI TXshCellColumn : public TXshColumn {
 protected:
-  std::vector<TXshCell> m_cells;
+  TXshCellRuns m_cells;
   int m_first;
 
 public:
@@ -48,6 +48,7 @@ class TOfflineGL;
 class ColumnFan;
 class ToonzScene;
 class TXshSoundColumn;
+class SoundMixer;
 class TXshNoteSet;
 class TFrameId;
 class Orientation;
@@ -518,8 +519,16 @@ in TXsheetImp.
   /*! Utility Function */
   TSoundTrack *makeSound(int fromFrame, int toFrame, int frameRate = -1);
 #endif
+  /*! Plays the sound of \b frame, mixing the sound columns on demand.
+      Consecutive frames are played seamlessly.
+  */
   void scrub(int frame, bool isPreview = false);
   void stopScrub();
+  //! Returns true if some sound column is audible - see scrub().
+  bool hasSound(bool isPreview = false);
+  //! Returns the mixer streaming the scrubbed frames, or 0 if nothing was
+  //! scrubbed yet.
+  SoundMixer *getSoundMixer() const;
   void play(TSoundTrackP soundtrack, int s0, int s1, bool loop);
 
   /*! Returns a pointer to object \b FxDag contained in \b TXsheetImp, this
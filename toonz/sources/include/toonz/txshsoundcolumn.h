@@ -109,6 +109,8 @@ class DVAPI TXshSoundColumn final : public QObject, public TXshCellColumn {
   double m_volume;
   bool m_isOldVersion;
 
+  friend class SoundMixer;  // Reads the column levels
+
   QTimer m_timer;
 
 public:
@@ -4,6 +4,7 @@
 #define TXSHSOUNDLEVEL_INCLUDED
 
 #include "toonz/txshlevel.h"
+#include "toonz/soundpeaks.h"
 #include "tsound.h"
 
 #include <QList>
@@ -25,6 +26,7 @@ class DVAPI TXshSoundLevel final : public TXshLevel {
   PERSIST_DECLARATION(TXshSoundLevel)
 
   TSoundTrackP m_soundTrack;
+  SoundPeaks m_peaks;  //!< Waveform summary of m_soundTrack.
 
   double m_duration;  // overall soundtrack duration in seconds
   double m_samplePerFrame;
@@ -75,10 +77,7 @@ public:
   void setPath(const TFilePath &path) { m_path = path; }
   TFilePath getPath() const override { return m_path; }
 
-  void setSoundTrack(TSoundTrackP st) {
-    m_soundTrack = st;
-    computeValues();
-  }
+  void setSoundTrack(TSoundTrackP st);
   TSoundTrackP getSoundTrack() { return m_soundTrack; }
 
   //! Pay Attention this is the sound frame !!
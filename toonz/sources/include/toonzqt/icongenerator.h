@@ -61,6 +61,16 @@ class TOfflineGL;
             informed of the icon generation status, an iconGenerated() signal is
   emitted
             once an icon has been generated.
+
+            Pending requests are served most-recent first, so that the icons
+            being painted are generated before those that scrolled away. Views
+            can bracket their paint events with getRequestMark() and
+            cancelRequestsBefore() to drop requests for icons that are no
+            longer visible.
+
+            Icons decoded from saved files are also kept in a thumbnail store
+            on disk, keyed by file path, frame, modification time and icon
+            size, so that they are not decoded again in later sessions.
 */
 
 class DVAPI IconGenerator final : public QObject {
@@ -83,6 +93,36 @@ public:
         , m_paintIndex(-1) {}
   };
 
+  //! Kinds of icon requests, used to cancel the requests of a single view.
+  enum RequestGroup {
+    FilmstripIcons,  //!< Level icons shown in the filmstrip.
+    CellIcons,       //!< Small level icons, shown in xsheet and cast.
+    FileIcons,       //!< Icons of files, shown in the file browser.
+    OtherIcons
+  };
+
+  //! Counters describing how icon requests were served.
+  struct Statistics {
+    int m_memoryHits;     //!< Icons served by the icons cache, once each.
+    int m_storeHits;      //!< Icons loaded from the thumbnail store.
+    int m_renders;        //!< Icons generated from their source images.
+    int m_canceled;       //!< Requests canceled before being processed.
+    double m_renderTime;  //!< Total time spent generating icons, in ms.
+
+    Statistics()
+        : m_memoryHits(0)
+        , m_storeHits(0)
+        , m_renders(0)
+        , m_canceled(0)
+        , m_renderTime(0.0) {}
+
+    //! Returns the fraction of icons that did not need to be generated.
+    double getHitRate() const {
+      int total = m_memoryHits + m_storeHits + m_renders;
+      return total ? double(m_memoryHits + m_storeHits) / total : 0.0;
+    }
+  };
+
 public:
   IconGenerator();
   ~IconGenerator();
@@ -126,6 +166,18 @@ public:
   void clearRequests();
   void clearSceneIcons();
 
+  //! Returns a mark identifying the requests submitted (or renewed) so far.
+  int getRequestMark() const { return m_requestCount; }
+  //! Cancels the pending requests of \b group that were not submitted or
+  //! renewed after \b mark - typically, icons that left the view.
+  void cancelRequestsBefore(int mark, RequestGroup group);
+
+  Statistics getStatistics() const;
+  void resetStatistics();
+
+  //! Enables or disables the disk thumbnail store (enabled by default).
+  static void enableThumbnailStore(bool enabled);
+
   static TRaster32P generateVectorFileIcon(const TFilePath &path,
                                            const TDimension &iconSize,
                                            const TFrameId &fid);
@@ -156,6 +208,13 @@ public slots:
   void onException(TThread::RunnableP iconRenderer);
   void onTerminated(TThread::RunnableP iconRenderer);
 
+private:
+  struct Request {
+    TThread::RunnableP m_renderer;
+    RequestGroup m_group;
+    int m_mark;  //!< Value of m_requestCount at the last request.
+  };
+
 private:
   TThread::Executor m_executor;
   QThreadStorage<TOfflineGL *> m_contexts;
@@ -166,8 +225,18 @@ private:
 
   Settings m_settings;
 
+  std::map<std::string, Request> m_requests;  //!< Pending requests, by id.
+  std::map<int, std::string> m_queue;  //!< Requests not yet submitted to the
+                                       //! executor, by mark.
+  TThread::RunnableP m_waitingTask;    //!< Submitted task not started yet.
+  int m_requestCount;
+
 private:
-  void addTask(const std::string &id, TThread::RunnableP iconRenderer);
+  void addTask(const std::string &id, TThread::RunnableP iconRenderer,
+               RequestGroup group = OtherIcons);
+  void renewRequest(const std::string &id);
+  void submitNext();
+  void releaseRequest(TThread::RunnableP iconRenderer);
 };
 
 //**********************************************************************************
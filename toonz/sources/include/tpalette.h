@@ -13,6 +13,9 @@
 // Qt includes
 #include <QMutex>
 
+// STD includes
+#include <memory>
+
 #undef DVAPI
 #undef DVVAR
 #ifdef TVRENDER_EXPORTS
@@ -33,6 +36,7 @@
 //    Forward declarations
 
 class TPixelRGBM32;
+class TPaletteColorLut;
 
 typedef TSmartPointerT<TPalette> TPaletteP;
 
@@ -220,6 +224,10 @@ private:
 
   bool m_areRefLevelFidsSpecified = false;
 
+  mutable std::shared_ptr<const TPaletteColorLut>
+      m_colorLut;                  //!< Cached color table, see getColorLut().
+  mutable QMutex m_colorLutMutex;  //!< Guards m_colorLut.
+
 public:
   TPalette();
   ~TPalette();
@@ -433,6 +441,16 @@ between RGBA color components.
 
   QMutex *mutex() { return &m_mutex; }  //!< Returns the palette's mutex
 
+  std::shared_ptr<const TPaletteColorLut> getColorLut()
+      const;  //!< Returns the flat color table of the palette, used to
+              //!  convert cmapped pixels. The table is rebuilt only after
+              //!  invalidateColorLut() or a change of the style count.
+  void invalidateColorLut();  //!< Declares the style colors changed. Styles
+                              //!  added, replaced, loaded, assigned, merged
+                              //!  or animated through the palette call this;
+                              //!  styles edited in place must be followed by
+                              //!  a call.
+
   bool isLocked() const {
     return m_isLocked;
   }                            //!< Returns whether the palette is locked.
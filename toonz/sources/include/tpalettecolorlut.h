@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef TPALETTECOLORLUT_H
+#define TPALETTECOLORLUT_H
+
+// TnzCore includes
+#include "tpixel.h"
+#include "tpixelcm.h"
+#include "tpixelutils.h"
+
+// STD includes
+#include <vector>
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TVRENDER_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=========================================================
+
+//    Forward declarations
+
+class TPalette;
+
+//*****************************************************************************************
+//    TPaletteColorLut  declaration
+//*****************************************************************************************
+
+/*!
+  \brief    A flat, premultiplied snapshot of the colors of a palette, used to
+            convert TPixelCM32 pixels to TPixel32 without going through the
+            palette's style objects.
+
+  \details  The table covers the whole ink/paint range of TPixelCM32; ids that
+            are not in the palette map to red, as TPalette::getStyle() does.
+
+            Instances are immutable once built and are obtained through
+            TPalette::getColorLut(), which rebuilds the table only after the
+            palette's colors have been declared changed.
+*/
+
+class DVAPI TPaletteColorLut {
+  std::vector<TPixel32> m_averageColors;  //!< Raw palette colors.
+  std::vector<TPixel32> m_colors;  //!< Premultiplied colors, whole id range.
+
+public:
+  TPaletteColorLut(const TPalette *palette);
+
+  int getStyleCount() const { return (int)m_averageColors.size(); }
+
+  //! Returns the palette's (non-premultiplied) average color for \b styleId.
+  const TPixel32 &getAverageColor(int styleId) const {
+    return m_averageColors[styleId];
+  }
+
+  //! Returns the flat premultiplied color table, indexed by ink or paint id.
+  const TPixel32 *getColors() const { return &m_colors[0]; }
+  int getColorCount() const { return (int)m_colors.size(); }
+
+  //! Returns the premultiplied color of \b pix.
+  TPixel32 getPixel(const TPixelCM32 &pix) const {
+    return getPixel(pix.getInk(), pix.getPaint(), pix.getTone());
+  }
+
+  TPixel32 getPixel(int ink, int paint, int tone) const {
+    if (tone == 255) return m_colors[paint];
+    if (tone == 0) return m_colors[ink];
+    return blend(m_colors[ink], m_colors[paint], tone, 255);
+  }
+};
+
+#endif  // TPALETTECOLORLUT_H
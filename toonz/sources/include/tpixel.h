@@ -28,6 +28,7 @@ class TPixelRGB555;
 class TPixelRGB565;
 //! Double r,g,b,m ; 16 byte/pixel
 class TPixelD;
+class TPixelF;
 
 //! Gray Scale 1 byte/pixel
 class TPixelGR8;
@@ -320,6 +321,32 @@ static inline TPixelD from(const TPixelD &pix) {return pix;};
 
 //-----------------------------------------------------------------------------
 
+/*! The TPixelF class stores premultiplied rgbm channels as floats in the
+  [0, 1] range (channel values out of range are allowed during fx
+  computations). It is the pixel type of the 128 bits-per-pixel rasters used by
+  the float render pipeline - see TRasterFx::canComputeInFloat(). */
+class DVAPI TPixelF {
+public:
+  static const float maxChannelValue;
+  typedef float Channel;
+
+  Channel r, g, b, m;
+
+  TPixelF() : r(0), g(0), b(0), m(1){};
+  TPixelF(float rr, float gg, float bb, float mm = 1)
+      : r(rr), g(gg), b(bb), m(mm){};
+
+  inline bool operator==(const TPixelF &p) const {
+    return r == p.r && g == p.g && b == p.b && m == p.m;
+  };
+  inline bool operator!=(const TPixelF &p) const { return !operator==(p); };
+
+  static const TPixelF Black;
+  static const TPixelF Transparent;
+};
+
+//-----------------------------------------------------------------------------
+
 class DVAPI TPixelCY {
 public:
   UCHAR c, y;
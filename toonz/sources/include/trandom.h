@@ -49,6 +49,14 @@ public:
   /*! returns a double number in the range [0, 1[ */
   double getDouble();
 
+  /*! number of UINTs in the engine state, see getState() */
+  static const int StateSize = 59;
+
+  /*! copies the engine state into state[StateSize]; passing it to setState()
+      resumes the sequence from the same point */
+  void getState(UINT *state) const;
+  void setState(const UINT *state);
+
 private:
   UINT seed;
   int idx1, idx2;
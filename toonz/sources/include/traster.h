@@ -441,6 +441,9 @@ template class DVAPI TRasterPT<TPixelGRD>;
 template class DVAPI TSmartPointerT<TRasterT<TPixelCY>>;
 template class DVAPI TRasterPT<TPixelCY>;
 
+template class DVAPI TSmartPointerT<TRasterT<TPixelF>>;
+template class DVAPI TRasterPT<TPixelF>;
+
 #endif
 
 typedef TRasterPT<TPixel32> TRaster32P;
@@ -449,6 +452,7 @@ typedef TRasterPT<TPixelGR8> TRasterGR8P;
 typedef TRasterPT<TPixelGR16> TRasterGR16P;
 typedef TRasterPT<TPixelGRD> TRasterGRDP;
 typedef TRasterPT<TPixelCY> TRasterYUV422P;
+typedef TRasterPT<TPixelF> TRasterFP;
 
 //=========================================================
 
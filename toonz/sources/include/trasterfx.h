@@ -113,10 +113,13 @@ public:
                                //! inches. \sa m_stereoscopic. \note Should be
   //! moved to TOutputProperties.
 
-  int m_bpp;  //!< Bits-per-pixel required in the output frame. \remark This
-              //! data
+  int m_bpp;  //!< Bits-per-pixel required in the output frame: 32, 64 or
+              //! 128 (float). \remark This data
   //!  must be accompanied by a tile of the suitable type. \sa
-  //!  TRasterFx::compute().
+  //!  TRasterFx::compute(), TRasterFx::canComputeInFloat().
+  int m_nonFloatBpp;  //!< Bits-per-pixel, 32 or 64, of the tiles computed by
+                      //! fxs that cannot work in float, while m_bpp is 128.
+  //!  It is the m_bpp requested where the float region of the fx tree began.
   int m_maxTileSize;  //!< Maximum size (in MegaBytes) of a tile cachable during
                       //! a render process.
   //!  Used by the predictive cache manager to subdivide an fx calculation into
@@ -169,6 +172,38 @@ public:
   std::string toString() const;
 };
 
+//******************************************************************************
+//    TRasterFxKey  declaration
+//******************************************************************************
+
+//! TRasterFxKey is a 128-bit hash identifying the result of an fx subtree at
+//! some frame. It is the compact counterpart of the fx alias, and is used to
+//! name cache resources during render processes.
+/*!
+  \sa TRasterFx::getAliasKey()
+*/
+class DVAPI TRasterFxKey {
+public:
+  TUINT64 m_hi, m_lo;
+
+public:
+  TRasterFxKey() : m_hi(0), m_lo(0) {}
+
+  //! Returns the hash of the specified string.
+  static TRasterFxKey hash(const std::string &str);
+
+  bool operator==(const TRasterFxKey &key) const {
+    return m_lo == key.m_lo && m_hi == key.m_hi;
+  }
+  bool operator!=(const TRasterFxKey &key) const { return !operator==(key); }
+  bool operator<(const TRasterFxKey &key) const {
+    return m_hi < key.m_hi || (m_hi == key.m_hi && m_lo < key.m_lo);
+  }
+
+  //! Returns the key as a 32 characters hexadecimal string.
+  std::string toString() const;
+};
+
 //******************************************************************************
 //    TRasterFx  declaration
 //******************************************************************************
@@ -273,6 +308,16 @@ public:
   std::string getAlias(double frame,
                        const TRenderSettings &info) const override;
 
+  //! Returns a 128-bit hash of the fx alias, built incrementally from the
+  //! keys of the input fxs. Keys are memoized for the duration of the render
+  //! instance, and are used in place of the aliases to name cache resources.
+  TRasterFxKey getAliasKey(double frame, const TRenderSettings &info) const;
+
+  //! Returns the alias of an input fx, as getAlias() reimplementations must
+  //! include it. While a key is being built, that is the input's own key.
+  static std::string getInputAlias(const TRasterFx *fx, double frame,
+                                   const TRenderSettings &info);
+
   virtual void dryCompute(TRectD &rect, double frame,
                           const TRenderSettings &info);
 
@@ -288,6 +333,32 @@ public:
 
   virtual bool isPlugin() const { return false; };
 
+  //! Returns true if the fx returns its (single) input unchanged - bit for
+  //! bit - at the specified frame. Render-tree optimizations use it to bypass
+  //! the fx.
+  virtual bool isIdentity(double frame) const { return false; }
+
+  //! Returns true if each output pixel of the fx depends only on the input
+  //! pixel at the same position. Such fxs have a single input port, handle
+  //! any affine, and implement computePixels() - which allows chains of them
+  //! to be applied in a single pass over the tile.
+  virtual bool isPointwise() const { return false; }
+
+  //! Returns true if the fx is able to compute float (128 bpp, TRasterFP)
+  //! tiles. Float tiles requested to other fxs are computed at
+  //! TRenderSettings::m_nonFloatBpp - the depth requested where the float
+  //! region of the tree began - and converted by TRasterFx::compute(), so
+  //! that float data flows unquantized only through chains of fxs declaring
+  //! support.
+  virtual bool canComputeInFloat() const { return false; }
+
+  //! Applies the transform of a pointwise fx to \b ras, in place. The
+  //! raster may be any part of the tile being computed.
+  virtual void computePixels(const TRasterP &ras, double frame,
+                             const TRenderSettings &info) {
+    assert(false);
+  }
+
 private:
   friend class FxResourceBuilder;
 };
@@ -189,6 +189,19 @@ public:
 
     RenderData(double frame, const TRenderSettings &info, const TFxPair &fxRoot)
         : m_frame(frame), m_info(info), m_fxRoot(fxRoot) {}
+
+    //! Returns a key identifying the whole content of the rendered frame -
+    //! that is, the aliases of the rendered fx trees together with the render
+    //! settings. Frames with the same content key render to identical
+    //! rasters, and are computed only once by startRendering().
+    //! \note Aliases do not track the content of level files: keys are only
+    //! comparable among frames rendered from the same scene state.
+    //! \note The key is built on the first call, and kept by copies of the
+    //! RenderData.
+    const std::string &getContentKey() const;
+
+  private:
+    mutable std::string m_contentKey;
   };
 
 public:
@@ -204,10 +217,16 @@ public:
   void addPort(TRenderPort *port);
   void removePort(TRenderPort *port);
 
+  //! Starts rendering the specified frames. The rendered area is the union
+  //! of the ports' render areas when the render actually starts - unless a
+  //! non-empty \b renderArea is specified, which is fixed at the time of the
+  //! call instead.
   unsigned long startRendering(
-      const std::vector<TRenderer::RenderData> *renderDatas);
+      const std::vector<TRenderer::RenderData> *renderDatas,
+      const TRectD &renderArea = TRectD());
   unsigned long startRendering(double f, const TRenderSettings &info,
-                               const TFxPair &actualRoot);
+                               const TFxPair &actualRoot,
+                               const TRectD &renderArea = TRectD());
 
   void abortRendering(unsigned long renderId);
   void stopRendering(bool waitForCompleteStop = false);
@@ -217,6 +236,24 @@ public:
 
   void setThreadsCount(int nThreads);
 
+  //! Sets the scheduling priority of the render tasks started from now on
+  //! (see TThread::Runnable::schedulingPriority()). Lower priorities let the
+  //! tasks of other renderers start first. The default is 5.
+  void setTasksPriority(int priority);
+
+  //! Sets the memory budget, in MB, of the frames rendered concurrently. A
+  //! frame starts rendering only when its estimated peak memory fits in the
+  //! budget beside that of the frames currently rendering - but at least one
+  //! frame is always rendering. Estimates are measured on the precomputation
+  //! dry run (see TRenderMemoryEstimator). Idle rasters held by the tile pool
+  //! (see TTilePool) count against the budget too. 0 means no budget (the
+  //! default).
+  void setMemoryBudget(int mb);
+  int getMemoryBudget() const;
+
+  //! Returns the estimated memory, in MB, of the frames currently rendering.
+  int getMemoryInUse() const;
+
   static TRenderer instance();
 
   unsigned long rendererId();
@@ -257,6 +294,53 @@ public:
   static void initialize();
 };
 
+//===============================================================
+
+//========================================
+//    TRenderMemoryEstimator  class
+//----------------------------------------
+
+//! TRenderMemoryEstimator estimates the peak memory of an fx tree computation
+//! through a dry run. While an estimator is alive, each node simulated by
+//! TRasterFx::dryCompute() on the same thread declares the tile it would
+//! allocate, plus its own getMemoryRequirement(). The input tiles of a node
+//! are assumed alive until the node is complete.
+class DVAPI TRenderMemoryEstimator {
+  TRenderMemoryEstimator *m_parent;
+  TINT64 m_current, m_peak;  // In KB
+
+public:
+  //! Declares the simulated computation of the specified tile by an fx to the
+  //! estimator active on the calling thread, if any. The node is complete
+  //! when destroyed.
+  class DVAPI Node {
+    TRenderMemoryEstimator *m_estimator;
+    TINT64 m_saved, m_tile, m_requirement;
+
+  public:
+    Node(TRasterFx *fx, const TRectD &rect, double frame,
+         const TRenderSettings &info);
+    ~Node();
+
+  private:
+    // Not copyable
+    Node(const Node &);
+    Node &operator=(const Node &);
+  };
+
+public:
+  TRenderMemoryEstimator();
+  ~TRenderMemoryEstimator();
+
+  //! Returns the estimated peak memory, in KB.
+  TINT64 getPeak() const { return m_peak; }
+
+private:
+  // Not copyable
+  TRenderMemoryEstimator(const TRenderMemoryEstimator &);
+  TRenderMemoryEstimator &operator=(const TRenderMemoryEstimator &);
+};
+
 //-------------------------------------------------------------------------------
 
 typedef std::vector<TRenderer::RenderData> RenderDataVector;
@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef TRENDERPROFILER_H
+#define TRENDERPROFILER_H
+
+#include <memory>
+
+#include "tcommon.h"
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TFX_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=========================================================
+
+//  Forward declarations
+
+class TFx;
+class TFilePath;
+
+//=========================================================
+
+//==============================
+//    TRenderProfiler class
+//------------------------------
+
+/*!
+The TRenderProfiler class records how the time of render processes is spent
+among the fx nodes of the rendered trees.
+
+While enabled, each fx node computation (see TRasterFx::compute()) and each
+rendered frame is recorded as a timed interval, together with the computed tile
+size, the cache hits and misses of the node and the memory it allocated for
+the tiles of its inputs. Intervals nest naturally on each render thread, so
+the \a self time of a node excludes the time spent computing its inputs.
+\n \n
+Recorded data can be exported as a Chrome trace (JSON, viewable in Perfetto or
+chrome://tracing) through exportTrace(), or resumed per fx in a table sorted by
+self time through getSummary().
+\n \n
+The profiler is disabled by default, and costs a single flag check per
+recorded interval when disabled.
+*/
+
+class DVAPI TRenderProfiler {
+  class Imp;
+  std::unique_ptr<Imp> m_imp;
+
+public:
+  //! Records the interval between its construction and destruction, if the
+  //! profiler is enabled when the scope is constructed.
+  class DVAPI Scope {
+    Scope *m_parent;
+
+    const TFx *m_fx;
+    double m_frame;
+    int m_lx, m_ly, m_bpp;
+
+    TINT64 m_start, m_childrenTime, m_allocated;
+    int m_cacheHits, m_cacheMisses;
+
+    bool m_active;
+
+    friend class TRenderProfiler;
+
+  public:
+    //! Records the computation of a tile by the specified fx.
+    Scope(const TFx *fx, double frame, int lx, int ly, int bpp);
+    //! Records the computation of a whole frame.
+    explicit Scope(double frame);
+    ~Scope();
+
+  private:
+    void begin();
+
+    // Not copyable
+    Scope(const Scope &);
+    Scope &operator=(const Scope &);
+  };
+
+public:
+  TRenderProfiler();
+  ~TRenderProfiler();
+
+  static TRenderProfiler *instance();
+
+  void enable(bool on);
+  bool isEnabled() const;
+
+  //! Discards all recorded data.
+  void clear();
+  bool isEmpty() const;
+
+  //! Attributes a cache access to the innermost scope of the calling thread.
+  static void addCacheAccess(bool hit);
+
+  //! Attributes a tile allocation to the innermost scope of the calling
+  //! thread - that is, to the fx which is allocating its input tiles.
+  static void addAllocation(TINT64 bytes);
+
+  //! Writes the recorded intervals to the specified path, in the Chrome trace
+  //! event format. Returns false if the file could not be written.
+  bool exportTrace(const TFilePath &fp) const;
+
+  //! Returns a text table with the recorded totals of each fx, sorted by
+  //! decreasing self time.
+  std::string getSummary() const;
+
+private:
+  // Not copyable
+  TRenderProfiler(const TRenderProfiler &);
+  TRenderProfiler &operator=(const TRenderProfiler &);
+};
+
+#endif  // TRENDERPROFILER_H
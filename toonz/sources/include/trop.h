@@ -153,21 +153,28 @@ DVAPI void resample(const TRasterP &out, const TRasterP &in, const TAffine &aff,
                     ResampleFilterType filterType = Triangle, double blur = 1.);
 
 //! Like the over function, but only uses closest_pixel filter
+/*! Only the rows of \b out in [rowBegin, rowEnd) are written, where a
+    negative rowEnd stands for the raster height. Those rows come out exactly
+    as in a put of the whole raster, so that disjoint row ranges of \b out can
+    be put concurrently.
+  */
 DVAPI void quickPut(const TRasterP &out, const TRasterP &up, const TAffine &aff,
                     const TPixel32 &colorScale = TPixel::Black,
                     bool doPremultiply = false, bool whiteTransp = false,
                     bool firstColumn               = false,
-                    bool doRasterDarkenBlendedView = false);
+                    bool doRasterDarkenBlendedView = false, int rowBegin = 0,
+                    int rowEnd = -1);
 
 //! Like the over function but up image must be cmapped.
 /*! Only uses closest_pixel filter.
-    GlobalMatte is the opacity, used for onionskinning
+    GlobalMatte is the opacity, used for onionskinning. The rows of \b out
+    in [rowBegin, rowEnd) are written just like in the above overload.
   */
 
 DVAPI void quickPut(const TRasterP &out, const TRasterCM32P &up,
                     const TPaletteP &plt, const TAffine &aff,
                     const TPixel32 &globalColorScale = TPixel::Black,
-                    bool inksOnly                    = false);
+                    bool inksOnly = false, int rowBegin = 0, int rowEnd = -1);
 
 // for trasparency check, ink check and paint check
 
@@ -194,7 +201,8 @@ public:
 
 DVAPI void quickPut(const TRasterP &dn, const TRasterCM32P &upCM32,
                     const TPaletteP &plt, const TAffine &aff,
-                    const CmappedQuickputSettings &settings);
+                    const CmappedQuickputSettings &settings, int rowBegin = 0,
+                    int rowEnd = -1);
 
 DVAPI void quickResampleColorFilter(const TRasterP &dn, const TRasterP &up,
                                     const TAffine &aff, const TPaletteP &plt,
@@ -333,9 +341,22 @@ DVAPI void antialias(const TRasterP &src, const TRasterP &dst, int threshold,
 //! border.
 DVAPI void majorityDespeckle(const TRasterP &ras, int sizeThreshold);
 
+//! Kernels of blur()
+enum BlurFilterType {
+  //! triangle filter of the specified radius
+  TriangleBlur,
+  //! recursive Gaussian filter with the variance of the triangle filter;
+  //! within 2.6 8-bit levels of the exact Gaussian at radii 5-500 (0.4 on
+  //! average). Radii below 1.5 use the triangle filter.
+  GaussianBlur
+};
+
 //! Make blur effect on \b srcRas raster and put the result in \b dstRas.
+//! The filter kernel can be chosen per call; both cost O(1) per pixel at any
+//! radius. Supports 32, 64 and float RGBM rasters, and GR8/GR16 ones.
 DVAPI void blur(const TRasterP &dstRas, const TRasterP &srcRas, double blur,
-                int dx, int dy, bool useSSE = false);
+                int dx, int dy, bool useSSE = false,
+                BlurFilterType filter = TriangleBlur);
 
 struct RaylitParams {
   TPixel m_color;
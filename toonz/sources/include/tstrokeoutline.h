@@ -196,7 +196,10 @@ class DVAPI OutlineParameter {
 public:
   double m_lengthStep;  //  max lengthStep (sulla centerline) per la
                         //  linearizzazione dell'outline
-  OutlineParameter(double lengthStep = 0) : m_lengthStep(lengthStep) {}
+  double m_pixelSize;   //  size of the pixels the outline is linearized for;
+                        //  0 takes it from the current OpenGL matrices
+  OutlineParameter(double lengthStep = 0, double pixelSize = 0)
+      : m_lengthStep(lengthStep), m_pixelSize(pixelSize) {}
 };
 
 // per adesso implementata in tellipticbrush.cpp (per motivi storici)
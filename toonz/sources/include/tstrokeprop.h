@@ -82,11 +82,32 @@ public:
 
 //=============================================================================
 
+//! Draws strokes of TOutlineStyle styles, caching their outlines by level of
+//! detail.
+/*!
+  Outlines are linearized for the size of the screen pixels, quantized to
+  half-octave levels: the outlines of the last MaxLodCount levels are kept, so
+  zooming back and forth doesn't rebuild them. Editing the stroke or its style
+  drops the cache.
+
+  On screen, from level SimplifiedLevel on, solid color outlines are also
+  decimated to half a pixel, which keeps dense freehand strokes cheap to draw
+  when zoomed out. Pixels of 2 units are below 1:1 for any camera of more
+  than 27 dpi; offline renders are never decimated.
+*/
 class DVAPI OutlineStrokeProp final : public TStrokeProp {
+public:
+  enum { MaxLodCount = 3, SimplifiedLevel = 2 };
+
 protected:
+  struct Lod {
+    int m_level;  //!< Pixel size of the outline is 2^(m_level / 2).
+    bool m_simplified;
+    TStrokeOutline m_outline;
+  };
+
   TOutlineStyleP m_colorStyle;
-  TStrokeOutline m_outline;
-  double m_outlinePixelSize;
+  std::vector<Lod> m_lods;  //!< Most recently drawn first.
 
 public:
   OutlineStrokeProp(const TStroke *stroke, TOutlineStyleP style);
@@ -95,6 +116,9 @@ public:
 
   TStrokeProp *clone(const TStroke *stroke) const override;
   void draw(const TVectorRenderData &rd) override;
+
+private:
+  TStrokeOutline &getOutline(double pixelSize, bool onScreen);
 };
 
 //=============================================================================
@@ -7,6 +7,8 @@
 
 #include <QThread>
 
+#include <functional>
+
 #undef DVAPI
 #undef DVVAR
 #ifdef TNZCORE_EXPORTS
@@ -221,7 +223,7 @@ public:
   static void shutdown();
 
   void addTask(RunnableP task);
-  void removeTask(RunnableP task);
+  bool removeTask(RunnableP task);
   void cancelAll();
 
   void setMaxActiveTasks(int count);
@@ -238,6 +240,26 @@ private:
   Executor(const Executor &);
 };
 
+//------------------------------------------------------------------------------
+
+/*!
+  Splits the index range [begin, end) into chunks of \b chunkSize indices and
+  calls \b body(chunkBegin, chunkEnd) once per chunk, using up to \b
+  threadCount threads taken from Qt's global thread pool (the calling thread
+  included).
+
+  The function returns once every chunk has been processed. Since the calling
+  thread takes part in the loop, nested or concurrent calls cannot deadlock
+  when the pool is saturated. A \b threadCount of 0 uses the pool's maximum
+  thread count; 1 runs the whole loop in the calling thread.
+
+  Exceptions thrown by \b body are rethrown in the calling thread (only the
+  first one is kept).
+*/
+void DVAPI parallelFor(int begin, int end,
+                       const std::function<void(int, int)> &body,
+                       int chunkSize = 1, int threadCount = 0);
+
 }  // namespace TThread
 
 #endif  // TTHREAD_H
@@ -0,0 +1,93 @@
+#pragma once
+
+#ifndef TTILEPOOL_H
+#define TTILEPOOL_H
+
+#include <memory>
+
+#include "traster.h"
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TFX_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=========================================================
+
+//==============================
+//    TTilePool class
+//------------------------------
+
+/*!
+The TTilePool class recycles the rasters of the intermediate tiles allocated
+during fx computations (see TRasterFx::allocateAndCompute()), in place of
+passing them through the general heap at each allocation.
+\n \n
+Each render thread owns an arena of rasters, grouped in size classes by exact
+size and pixel type - fxs generally assume that their tiles' wrap matches the
+width, so larger rasters cannot be served. A raster is available again as soon
+as no one but its arena refers to it, and is returned cleared - just like a
+newly allocated one. Between tiles, nodes and frames, idle rasters are kept up
+to a memory limit shared by all arenas, least recently used ones of the
+allocating thread being released first. Idle rasters are released altogether
+when no render instance is active anymore.
+\n \n
+The pool is enabled by default. Disabling it (e.g. to debug buffer ownership
+issues) makes getRaster() allocate a new raster at each call.
+*/
+
+class DVAPI TTilePool {
+  class Imp;
+  std::unique_ptr<Imp> m_imp;
+
+public:
+  struct Statistics {
+    TINT64 m_requests;        //!< Rasters requested to the pool
+    TINT64 m_recycled;        //!< Requests served without allocation
+    TINT64 m_residentKb;      //!< Memory currently held by the arenas
+    TINT64 m_peakResidentKb;  //!< Peak of m_residentKb
+
+    Statistics()
+        : m_requests(0), m_recycled(0), m_residentKb(0), m_peakResidentKb(0) {}
+  };
+
+public:
+  TTilePool();
+  ~TTilePool();
+
+  static TTilePool *instance();
+
+  void enable(bool on);
+  bool isEnabled() const;
+
+  //! Sets the memory, in MB, that the idle rasters of all arenas may hold.
+  //! The default is 256.
+  void setIdleMemoryLimit(int mb);
+  int getIdleMemoryLimit() const;
+
+  //! Returns a cleared raster of the specified size, for the specified bits
+  //! per pixel: 8 and 16 for grayscale rasters, 32 and 64 for RGBM rasters,
+  //! 128 for float ones.
+  TRasterP getRaster(const TDimension &size, int bpp);
+
+  //! Releases the idle rasters of all arenas.
+  void releaseIdleRasters();
+
+  //! Returns the memory, in KB, currently held by idle rasters.
+  TINT64 getIdleMemory() const;
+
+  Statistics getStatistics() const;
+  void resetStatistics();
+
+private:
+  // Not copyable
+  TTilePool(const TTilePool &);
+  TTilePool &operator=(const TTilePool &);
+};
+
+#endif  // TTILEPOOL_H
@@ -56,6 +56,10 @@ public:
     if (m_value->getValue(frame) == 0) return true;
     return (isAlmostIsotropic(info.m_affine));
   }
+
+  bool isIdentity(double frame) const override {
+    return m_value->getValue(frame) == 0;
+  }
 };
 
 FX_PLUGIN_IDENTIFIER(BlurFx, "blurFx")
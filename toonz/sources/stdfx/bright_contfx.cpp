@@ -36,6 +36,10 @@ public:
   };
 
   void doCompute(TTile &tile, double frame, const TRenderSettings &) override;
+
+  bool isPointwise() const override { return true; }
+  void computePixels(const TRasterP &ras, double frame,
+                     const TRenderSettings &info) override;
 };
 
 //===================================================================
@@ -118,16 +122,22 @@ void Bright_ContFx::doCompute(TTile &tile, double frame,
   if (!m_input.isConnected()) return;
 
   m_input->compute(tile, frame, ri);
+  computePixels(tile.getRaster(), frame, ri);
+}
+
+//-------------------------------------------------------------------
 
+void Bright_ContFx::computePixels(const TRasterP &ras, double frame,
+                                  const TRenderSettings &) {
   double brightness           = m_bright->getValue(frame) / 127.0;
   double contrast             = m_contrast->getValue(frame) / 127.0;
   if (contrast > 1) contrast  = 1;
   if (contrast < -1) contrast = -1;
-  TRaster32P raster32         = tile.getRaster();
+  TRaster32P raster32         = ras;
   if (raster32)
     doBrightnessContrast<TPixel32, UCHAR>(raster32, contrast, brightness);
   else {
-    TRaster64P raster64 = tile.getRaster();
+    TRaster64P raster64 = ras;
     if (raster64)
       doBrightnessContrast<TPixel64, USHORT>(raster64, contrast, brightness);
     else
@@ -98,6 +98,10 @@ public:
   bool canHandle(const TRenderSettings &info, double frame) override {
     return true;
   }
+
+  bool isPointwise() const override { return true; }
+  void computePixels(const TRasterP &ras, double frame,
+                     const TRenderSettings &ri) override;
 };
 
 namespace {
@@ -152,7 +156,13 @@ void ChannelMixerFx::doCompute(TTile &tile, double frame,
   if (!m_input.isConnected()) return;
 
   m_input->compute(tile, frame, ri);
+  computePixels(tile.getRaster(), frame, ri);
+}
+
+//------------------------------------------------------------------------------
 
+void ChannelMixerFx::computePixels(const TRasterP &ras, double frame,
+                                   const TRenderSettings &ri) {
   double r_r = m_r_r->getValue(frame);
   double r_g = m_r_g->getValue(frame);
   double r_b = m_r_b->getValue(frame);
@@ -170,13 +180,13 @@ void ChannelMixerFx::doCompute(TTile &tile, double frame,
   double m_b = m_m_b->getValue(frame);
   double m_m = m_m_m->getValue(frame);
 
-  TRaster32P raster32 = tile.getRaster();
+  TRaster32P raster32 = ras;
   if (raster32)
     doChannelMixer<TPixel32, UCHAR>(raster32, r_r, r_g, r_b, r_m, g_r, g_g, g_b,
                                     g_m, b_r, b_g, b_b, b_m, m_r, m_g, m_b,
                                     m_m);
   else {
-    TRaster64P raster64 = tile.getRaster();
+    TRaster64P raster64 = ras;
     if (raster64)
       doChannelMixer<TPixel64, USHORT>(raster64, r_r, r_g, r_b, r_m, g_r, g_g,
                                        g_b, g_m, b_r, b_g, b_b, b_m, m_r, m_g,
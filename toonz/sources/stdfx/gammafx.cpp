@@ -35,6 +35,14 @@ public:
   bool canHandle(const TRenderSettings &info, double frame) override {
     return true;
   }
+
+  bool isIdentity(double frame) const override {
+    return m_gamma->getValue(frame) == 1.0;
+  }
+
+  bool isPointwise() const override { return true; }
+  void computePixels(const TRasterP &ras, double frame,
+                     const TRenderSettings &ri) override;
 };
 
 //-------------------------------------------------------------------
@@ -43,11 +51,17 @@ void GammaFx::doCompute(TTile &tile, double frame, const TRenderSettings &ri) {
   if (!m_input.isConnected()) return;
 
   m_input->compute(tile, frame, ri);
+  computePixels(tile.getRaster(), frame, ri);
+}
+
+//-------------------------------------------------------------------
 
+void GammaFx::computePixels(const TRasterP &ras, double frame,
+                            const TRenderSettings &ri) {
   double gamma = m_gamma->getValue(frame);
 
   if (gamma == 0.0) gamma = 0.01;
-  TRop::gammaCorrect(tile.getRaster(), gamma);
+  TRop::gammaCorrect(ras, gamma);
 }
 
 //------------------------------------------------------------------
@@ -6,6 +6,7 @@
 #include "tbasefx.h"
 #include "tfxparam.h"
 #include "trop.h"
+#include "ttilepool.h"
 
 #include "tparamset.h"
 
@@ -250,8 +251,10 @@ public:
         {
           TRasterP light(lightTile.getRaster());
 
-          blurOut = light->create(tround(blurOutRect.getLx()),
-                                  tround(blurOutRect.getLy()));
+          blurOut = TTilePool::instance()->getRaster(
+              TDimension(tround(blurOutRect.getLx()),
+                         tround(blurOutRect.getLy())),
+              light->getPixelSize() * 8);
 
           // Apply the blur. Please note that SSE2 should not be used for now -
           // I've seen it
@@ -102,13 +102,10 @@ void fx_(const TRasterP in_ras  // with margin
          ,
          const TRasterP refer_ras, const int refer_mode, const int int_radius,
          const double real_radius) {
-  TRasterGR8P out_buffer(out_ras->getLy(),
-                         out_ras->getLx() * ino::channels() *
-                             ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                                 : sizeof(unsigned char)));
+  TRasterGR8P out_buffer(ino::get_arr_buffer(out_ras));
   const int buffer_bytes = igs::gaussian_blur_hv::buffer_bytes(
       in_ras->getLy(), in_ras->getLx(), int_radius);
-  TRasterGR8P cvt_buffer(buffer_bytes, 1);
+  TRasterGR8P cvt_buffer(ino::get_buffer(buffer_bytes, 1));
   out_buffer->lock();
   cvt_buffer->lock();
   igs::gaussian_blur_hv::convert(
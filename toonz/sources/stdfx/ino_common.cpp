@@ -1,6 +1,8 @@
 #include "tenv.h"
 #include "tsystem.h"
 
+#include "ttilepool.h"
+
 #include "ino_common.h"
 
 /* copy and paste from
@@ -103,6 +105,16 @@ void ino::vec_to_ras(std::vector<unsigned char> &in_vec, const int channels,
   in_vec.clear();
 }
 //--------------------
+TRasterGR8P ino::get_buffer(const int lx, const int ly) {
+  return TRasterGR8P(TTilePool::instance()->getRaster(TDimension(lx, ly), 8));
+}
+TRasterGR8P ino::get_arr_buffer(const TRasterP ras) {
+  return ino::get_buffer(
+      ras->getLy(),
+      ras->getLx() * ino::channels() *
+          (((TRaster64P)ras) ? sizeof(unsigned short) : sizeof(unsigned char)));
+}
+//--------------------
 #if 0   //---
 void ino::Lx_to_wrap( TRasterP ras ) {
 	/*
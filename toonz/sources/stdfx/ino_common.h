@@ -19,6 +19,11 @@ void vec_to_ras(std::vector<unsigned char> &vec, const int channels,
                 TRasterP ras, const int margin = 0);
 // void Lx_to_wrap( TRasterP ras );
 
+/* 一時バッファの確保(render threadごとにTTilePoolで再利用される) */
+TRasterGR8P get_buffer(const int lx, const int ly);
+/* rasの全画素をras_to_arr()で変換できる大きさの一時バッファ */
+TRasterGR8P get_arr_buffer(const TRasterP ras);
+
 /* logのserverアクセスON/OFF,install時設定をするための機能 */
 /* TEnv::getConfigDir() + "fx_ino_no_log.setup"
         が存在するとtrueを返す */
@@ -54,10 +54,7 @@ FX_PLUGIN_IDENTIFIER(ino_density, "inoDensityFx");
 namespace {
 void fx_(TRasterP in_ras, TRasterP refer_ras, const int refer_mode,
          const double density) {
-  TRasterGR8P in_gr8(in_ras->getLy(),
-                     in_ras->getLx() * ino::channels() *
-                         ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                             : sizeof(unsigned char)));
+  TRasterGR8P in_gr8(ino::get_arr_buffer(in_ras));
   in_gr8->lock();
   ino::ras_to_arr(in_ras, ino::channels(), in_gr8->getRawData());
 
@@ -99,13 +99,11 @@ void fx_(const TRasterP in_ras  // with margin
          const int nthread, const double radius, const double curve,
          const double power, const double threshold_min,
          const double threshold_max, const bool alp_rend_sw) {
-  TRasterGR8P out_gr8(in_ras->getLy(),
-                      in_ras->getLx() * ino::channels() *
-                          ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                              : sizeof(unsigned char)));
+  TRasterGR8P out_gr8(ino::get_arr_buffer(in_ras));
   out_gr8->lock();
 
-  TRasterGR8P ref_gr8(in_ras->getLy(), in_ras->getLx() * sizeof(double));
+  TRasterGR8P ref_gr8(
+      ino::get_buffer(in_ras->getLy(), in_ras->getLx() * sizeof(double)));
   ref_gr8->lock();
 
   igs::fog::convert(
@@ -114,10 +114,7 @@ void fx_(TRasterP in_ras, const TRasterP refer_ras, const int refer_mode,
          unsigned long random_seed, double near_blur, double effective,
          double center, int type, const int camera_x, const int camera_y,
          const int camera_w, const int camera_h, const bool anti_alias_sw) {
-  TRasterGR8P in_gr8(in_ras->getLy(),
-                     in_ras->getLx() * ino::channels() *
-                         ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                             : sizeof(unsigned char)));
+  TRasterGR8P in_gr8(ino::get_arr_buffer(in_ras));
   in_gr8->lock();
   ino::ras_to_arr(in_ras, ino::channels(), in_gr8->getRawData());
 
@@ -98,17 +98,11 @@ void fx_(TRasterP in_ras, const TRasterP noise_ras, const TRasterP refer_ras,
   std::vector<unsigned char> refer_vec;
   ino::ras_to_vec( noise_ras, ino::channels(), refer_vec );***/
 
-  TRasterGR8P in_gr8(in_ras->getLy(),
-                     in_ras->getLx() * ino::channels() *
-                         ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                             : sizeof(unsigned char)));
+  TRasterGR8P in_gr8(ino::get_arr_buffer(in_ras));
   in_gr8->lock();
   ino::ras_to_arr(in_ras, ino::channels(), in_gr8->getRawData());
 
-  TRasterGR8P noise_gr8(noise_ras->getLy(),
-                        noise_ras->getLx() * ino::channels() *
-                            ((TRaster64P)noise_ras ? sizeof(unsigned short)
-                                                   : sizeof(unsigned char)));
+  TRasterGR8P noise_gr8(ino::get_arr_buffer(noise_ras));
   noise_gr8->lock();
   ino::ras_to_arr(noise_ras, ino::channels(), noise_gr8->getRawData());
 
@@ -62,10 +62,7 @@ void fx_(TRasterP in_ras, bool *act_sw, double *in_min_shift,
          double *in_max_shift, double *out_min, double *out_max, double *gamma,
          const int camera_x, const int camera_y, const int camera_w,
          const int camera_h) {
-  TRasterGR8P in_gr8(in_ras->getLy(),
-                     in_ras->getLx() * ino::channels() *
-                         ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                             : sizeof(unsigned char)));
+  TRasterGR8P in_gr8(ino::get_arr_buffer(in_ras));
   in_gr8->lock();
   ino::ras_to_arr(in_ras, ino::channels(), in_gr8->getRawData());
 
@@ -227,10 +227,7 @@ void ino_level_rgba::doCompute(TTile &tile, double frame,
   try {
     TRasterP in_ras = tile.getRaster();
 
-    TRasterGR8P in_gr8(in_ras->getLy(),
-                       in_ras->getLx() * ino::channels() *
-                           ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                               : sizeof(unsigned char)));
+    TRasterGR8P in_gr8(ino::get_arr_buffer(in_ras));
 
     in_ras->lock();
     if (refer_tile.getRaster() != nullptr) {
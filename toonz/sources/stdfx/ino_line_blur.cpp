@@ -79,11 +79,15 @@ IGS_LINE_BLUR_EXPORT void convert(
 
 #include <iostream>
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
+#include "tthread.h"
+
 namespace {
 
 #ifndef _pri_h_
@@ -758,6 +762,7 @@ public:
                               double d_y2);
   void to_pixel_from_subpixel(double d_x1, double d_y1, double d_x2,
                               double d_y2);
+  void clear_pixel_image(void);
 
   /* メモリ開放 */
   void mem_free(void);
@@ -831,6 +836,20 @@ int brush_smudge_circle::mem_alloc(void) {
   return OK;
 }
 
+/* Pixels outside the image are never read into the pixel image: clearing it
+   keeps them from carrying values over from another line. Serial smudging
+   used to carry them over from the previous line, which is undefined once
+   lines run in parallel, so strokes crossing the image edge come out
+   slightly different from that */
+void brush_smudge_circle::clear_pixel_image(void) {
+  int32_t ii, i32_size;
+
+  i32_size = (this->_i32_size_by_pixel + 1) * (this->_i32_size_by_pixel + 1);
+  for (ii = 0; ii < i32_size * 5; ++ii) {
+    this->_dp_pixel_image[ii] = 0.0;
+  }
+}
+
 /********************************************************************/
 
 /* 画像上に置いたブラシの範囲
@@ -1334,12 +1353,15 @@ void pixel_point_node::print_xy_around(void) {
 
 #include "igs_line_blur.h"  // "list_root.h" "pixel_point_node.h"
 
+#define POINT_BLOCK_SIZE (4096)
+
 class pixel_point_root final : public list_root {
 public:
   pixel_point_root(void) {
-    this->_i_mv_sw = false;
-    this->_i_cv_sw = false;
-    this->_i_pv_sw = false;
+    this->_i_mv_sw        = false;
+    this->_i_cv_sw        = false;
+    this->_i_pv_sw        = false;
+    this->_i32_block_used = 0;
   }
   ~pixel_point_root(void) { this->mem_free(); }
 
@@ -1362,6 +1384,11 @@ public:
 private:
   bool _i_mv_sw, _i_cv_sw, _i_pv_sw;
 
+  /* Nodes are taken from blocks, one per thinned pixel, and released all
+     together by mem_free() */
+  std::vector<pixel_point_node *> _clpa_blocks;
+  int32_t _i32_block_used;
+
   /* リストの削除 */
   void _remove(pixel_point_node *clp_target);
 };
@@ -1374,11 +1401,17 @@ private:
 pixel_point_node *pixel_point_root::append(pixel_point_node *clp_previous) {
   pixel_point_node *clp_new;
 
-  clp_new = new pixel_point_node;
-  if (NULL == clp_new) {
-    pri_funct_err_bttvr("Error : 'new pixel_point_node' returns NULL.");
-    return NULL;
+  if (this->_clpa_blocks.empty() ||
+      (POINT_BLOCK_SIZE <= this->_i32_block_used)) {
+    clp_new = new pixel_point_node[POINT_BLOCK_SIZE];
+    if (NULL == clp_new) {
+      pri_funct_err_bttvr("Error : 'new pixel_point_node[]' returns NULL.");
+      return NULL;
+    }
+    this->_clpa_blocks.push_back(clp_new);
+    this->_i32_block_used = 0;
   }
+  clp_new = this->_clpa_blocks.back() + this->_i32_block_used++;
   clp_new = (pixel_point_node *)this->push(clp_previous, clp_new);
 
   return clp_new;
@@ -1387,7 +1420,6 @@ pixel_point_node *pixel_point_root::append(pixel_point_node *clp_previous) {
 void pixel_point_root::_remove(pixel_point_node *clp_old) {
   assert(NULL != clp_old); /* あってはならないプログラムバグのチェック */
   this->pop(clp_old);
-  delete clp_old;
 }
 
 void pixel_point_root::mem_free(void) {
@@ -1407,6 +1439,11 @@ void pixel_point_root::mem_free(void) {
       pri_funct_msg_ttvr("free point node %d", ii);
     }
   }
+  for (size_t jj = 0; jj < this->_clpa_blocks.size(); ++jj) {
+    delete[] this->_clpa_blocks[jj];
+  }
+  this->_clpa_blocks.clear();
+  this->_i32_block_used = 0;
 }
 
 int pixel_point_root::alloc_mem_and_list_node(int32_t i32_xs, int32_t i32_ys,
@@ -1596,6 +1633,11 @@ private:
   pixel_point_node *_clpa_link[5];
   calculator_geometry _cl_cal_geom;
 
+  /* The final points, stored contiguously by set_bbox() for
+     get_near_point() */
+  std::vector<pixel_point_node *> _clpa_points;
+  std::vector<double> _da_points_xy;
+
   int _expand_line_from_one(pixel_point_root *clp_pp_root,
                             int32_t i32_body_point_count,
                             pixel_point_node *clp_one,
@@ -1816,29 +1858,34 @@ void pixel_line_node::get_near_point(double d_xp, double d_yp,
                                      int32_t *i32p_pos,
                                      pixel_point_node **clpp_point,
                                      double *dp_length) {
-  pixel_point_node *clp_loop;
-  int32_t ii;
-  double d_length;
+  const double *dp_xy;
+  int32_t ii, i32_count;
+  double d_length, d_square, d_square_near;
 
   assert(NULL != this->get_clp_link_one_expand());
-
-  /* 各ポイントを探索 */
-  *dp_length = 1000.0;
-  clp_loop   = this->get_clp_link_one_expand();
-  for (ii = 0; NULL != clp_loop;
-       ++ii, clp_loop = clp_loop->get_clp_next_point()) {
-    /* 偽の場合、たぶん無限ループ */
-    assert(ii < this->_i32_point_count);
-
+  assert(!this->_clpa_points.empty());
+
+  /* 各ポイントを探索
+     A point farther than the nearest one by the squared distance cannot be
+     nearer by sqrt() either, and is skipped */
+  *dp_length    = 1000.0;
+  d_square_near = HUGE_VAL;
+  i32_count     = (int32_t)this->_clpa_points.size();
+  dp_xy         = &this->_da_points_xy[0];
+  for (ii = 0; ii < i32_count; ++ii, dp_xy += 2) {
     /* 距離 */
-    d_length = sqrt(
-        (clp_loop->get_d_xp_tgt() - d_xp) * (clp_loop->get_d_xp_tgt() - d_xp) +
-        (clp_loop->get_d_yp_tgt() - d_yp) * (clp_loop->get_d_yp_tgt() - d_yp));
+    d_square = (dp_xy[0] - d_xp) * (dp_xy[0] - d_xp) +
+               (dp_xy[1] - d_yp) * (dp_xy[1] - d_yp);
+    if (d_square_near <= d_square) {
+      continue;
+    }
+    d_length = sqrt(d_square);
     /* 近いものならセットする */
     if (d_length < (*dp_length)) {
-      *i32p_pos   = ii;
-      *clpp_point = clp_loop;
-      *dp_length  = d_length;
+      *i32p_pos     = ii;
+      *clpp_point   = this->_clpa_points[ii];
+      *dp_length    = d_length;
+      d_square_near = d_square;
     }
   }
 }
@@ -2279,11 +2326,17 @@ void pixel_line_node::set_bbox(void) {
   if (NULL == clp_point) {
     clp_point = this->get_clp_link_one();
   }
+  this->_clpa_points.clear();
+  this->_da_points_xy.clear();
   for (ii        = 0; NULL != clp_point;
        clp_point = clp_point->get_clp_next_point(), ++ii) {
     /* 偽の場合、たぶん無限ループ */
     assert(ii < this->_i32_point_count);
 
+    this->_clpa_points.push_back(clp_point);
+    this->_da_points_xy.push_back(clp_point->get_d_xp_tgt());
+    this->_da_points_xy.push_back(clp_point->get_d_yp_tgt());
+
     if (0 == ii) {
       this->_d_bbox_x_min = clp_point->get_d_xp_tgt();
       this->_d_bbox_x_max = clp_point->get_d_xp_tgt();
@@ -4009,6 +4062,8 @@ public:
 
     this->_i32_count_max = 4;
     this->_d_length_max  = 160;
+
+    this->_clp_spare = NULL;
   }
   ~pixel_select_curve_blur_root(void) { this->mem_free(); }
   void set_i_mv_sw(bool sw) { this->_i_mv_sw = sw; }
@@ -4040,9 +4095,14 @@ private:
 
   calculator_geometry _cl_cal_geom;
 
+  /* Nodes released by exec(), kept for the next one and linked by
+     get_clp_next() */
+  pixel_select_curve_blur_node *_clp_spare;
+
   pixel_select_curve_blur_node *_append(
       pixel_select_curve_blur_node *clp_previous);
   void _remove(pixel_select_curve_blur_node *clp_old);
+  void _recycle_all(void);
   int _sort_append(pixel_select_curve_blur_node *clp_src);
 
   pixel_point_node *_get_next_points(pixel_point_node *clp_point,
@@ -4070,6 +4130,12 @@ pixel_select_curve_blur_node *pixel_select_curve_blur_root::_append(
     pixel_select_curve_blur_node *clp_previous) {
   pixel_select_curve_blur_node *clp_new;
 
+  if (NULL != this->_clp_spare) {
+    clp_new          = this->_clp_spare;
+    this->_clp_spare = (pixel_select_curve_blur_node *)clp_new->get_clp_next();
+    return (pixel_select_curve_blur_node *)this->push(clp_previous, clp_new);
+  }
+
   clp_new = new pixel_select_curve_blur_node;
   if (NULL == clp_new) {
     pri_funct_err_bttvr(
@@ -4105,6 +4171,24 @@ void pixel_select_curve_blur_root::mem_free(void) {
       pri_funct_msg_ttvr("free select curve blur node %d", ii);
     }
   }
+  while (NULL != this->_clp_spare) {
+    pixel_select_curve_blur_node *clp_next =
+        (pixel_select_curve_blur_node *)this->_clp_spare->get_clp_next();
+    delete this->_clp_spare;
+    this->_clp_spare = clp_next;
+  }
+}
+
+/* exec() runs once per subpixel: its nodes are recycled rather than
+   deleted and allocated again */
+void pixel_select_curve_blur_root::_recycle_all(void) {
+  list_node *clp_old;
+
+  while (NULL != (clp_old = this->get_clp_last())) {
+    this->pop(clp_old);
+    clp_old->set_clp_next(this->_clp_spare);
+    this->_clp_spare = (pixel_select_curve_blur_node *)clp_old;
+  }
 }
 
 /********************************************************************/
@@ -4160,7 +4244,7 @@ void pixel_select_curve_blur_root::exec(double d_xp, double d_yp,
   pixel_select_curve_blur_node cl_select;
 
   /* 選択リストをクリア */
-  this->mem_free();
+  this->_recycle_all();
 
   /* 全体の bbox を見る */
   if ((d_xp <
@@ -5643,6 +5727,8 @@ void igs_line_blur_brush_curve_line_get_image_(
 
 #include "igs_line_blur.h"  // "pri.h" "brush_curve_blur.h" "pixel_select_curve_blur.h" "pixel_line_root.h" "igs_line_blur.h"
 
+#define CURVE_BLUR_ROWS_PER_TASK (4)
+
 int igs_line_blur_brush_curve_blur_subpixel_(
     brush_curve_blur &cl_brush_curve_blur,
     pixel_select_curve_blur_root &cl_pixel_select_curve_blur_root,
@@ -5736,27 +5822,52 @@ int igs_line_blur_brush_curve_blur_all_(
     pri_funct_cv_start(height);
   }
 
-  for (int yy = 0; yy < height; ++yy) {
-    /* カウントダウン表示中 */
-    if (cv_sw) {
-      pri_funct_cv_run(yy);
-    }
-
-    for (int xx = 0; xx < width; ++xx) {
-      if (OK == igs_line_blur_brush_curve_blur_subpixel_(
-                    cl_brush_curve_blur, cl_pixel_select_curve_blur_root,
-                    cl_pixel_line_root, in, height, width, channels, bits, xx,
-                    yy)) {
-        /* ピクセル値を計算 */
-        cl_brush_curve_blur.set_pixel_value();
+  /* Each pixel only reads the lines and the input image: rows are blurred
+     in parallel, each task with its own brush and selection list. The
+     countdown display needs the rows in order. */
+  TThread::parallelFor(
+      0, height,
+      [&](int y_begin, int y_end) {
+        brush_curve_blur cl_brush;
+        cl_brush.set_i32_count(cl_brush_curve_blur.get_i32_count());
+        cl_brush.set_i32_subpixel_divide(
+            cl_brush_curve_blur.get_i32_subpixel_divide());
+        cl_brush.set_d_effect_area_radius(
+            cl_brush_curve_blur.get_d_effect_area_radius());
+        cl_brush.set_d_power(cl_brush_curve_blur.get_d_power());
+        if (OK != cl_brush.mem_alloc()) {
+          throw std::domain_error("Error : cl_brush.mem_alloc() returns NG");
+        }
+        cl_brush.init_ratio_array();
+
+        pixel_select_curve_blur_root cl_select;
+        cl_select.set_i32_count_max(
+            cl_pixel_select_curve_blur_root.get_i32_count_max());
+        cl_select.set_d_length_max(
+            cl_pixel_select_curve_blur_root.get_d_length_max());
+
+        for (int yy = y_begin; yy < y_end; ++yy) {
+          /* カウントダウン表示中 */
+          if (cv_sw) {
+            pri_funct_cv_run(yy);
+          }
 
-        /* 結果をピクセルへ置く
-(取ったものと別の画像におくこと) */
-        igs_line_blur_brush_curve_point_put_image_(
-            cl_brush_curve_blur, xx, yy, height, width, channels, bits, out);
-      }
-    }
-  }
+          for (int xx = 0; xx < width; ++xx) {
+            if (OK == igs_line_blur_brush_curve_blur_subpixel_(
+                          cl_brush, cl_select, cl_pixel_line_root, in, height,
+                          width, channels, bits, xx, yy)) {
+              /* ピクセル値を計算 */
+              cl_brush.set_pixel_value();
+
+              /* 結果をピクセルへ置く
+      (取ったものと別の画像におくこと) */
+              igs_line_blur_brush_curve_point_put_image_(
+                  cl_brush, xx, yy, height, width, channels, bits, out);
+            }
+          }
+        }
+      },
+      CURVE_BLUR_ROWS_PER_TASK, cv_sw ? 1 : 0);
 
   /* カウントダウン表示終了 */
   if (cv_sw) {
@@ -5905,6 +6016,7 @@ void igs_line_blur_brush_smudge_line_(
 
   /* ブラシマスクを円形にセット */
   cl_brush_smudge_circle.set_brush_circle();
+  cl_brush_smudge_circle.clear_pixel_image();
 
   /* 指先(にじみ)の始点 */
   clp_crnt = clp_line->get_clp_link_middle();
@@ -6007,9 +6119,61 @@ void igs_line_blur_brush_smudge_line_(
 
 #include <iostream>
 #include <string.h> /* memcpy() */
+#include <math.h>   /* floor() */
 
 #include "igs_line_blur.h"  // "pri.h"
 
+#define SMUDGE_GRID_CELL_SIZE (64)
+
+/* Pixels the brush may touch while smudging a line */
+struct igs_line_blur_smudge_area_ {
+  int x1, y1, x2, y2;
+
+  bool overlaps(const igs_line_blur_smudge_area_ &area) const {
+    return (x1 <= area.x2) && (area.x1 <= x2) && (y1 <= area.y2) &&
+           (area.y1 <= y2);
+  }
+};
+
+/* Grid cell holding pixel coordinate xy, clamped to the image cells */
+int igs_line_blur_smudge_cell_(const int xy, const int cell_count) {
+  return std::min(std::max(xy, 0) / SMUDGE_GRID_CELL_SIZE, cell_count - 1);
+}
+
+igs_line_blur_smudge_area_ igs_line_blur_brush_smudge_area_(
+    brush_smudge_circle &cl_brush_smudge_circle, pixel_line_node *clp_line) {
+  pixel_point_node *clp_crnt = clp_line->get_clp_link_middle();
+  double d_x1, d_y1, d_x2, d_y2;
+  int32_t ii;
+
+  cl_brush_smudge_circle.get_dp_area(clp_crnt->get_d_xp_tgt(),
+                                     clp_crnt->get_d_yp_tgt(), &d_x1, &d_y1,
+                                     &d_x2, &d_y2);
+  igs_line_blur_smudge_area_ area = {(int)floor(d_x1), (int)floor(d_y1),
+                                     (int)floor(d_x2), (int)floor(d_y2)};
+
+  /* 中点から線の後ろへ、そして前へ */
+  for (int dir = 0; dir < 2; ++dir) {
+    clp_crnt = clp_line->get_clp_link_middle();
+    for (ii = 0; (NULL != clp_crnt) && (ii <= clp_line->get_i32_point_count());
+         ++ii) {
+      clp_crnt = (0 == dir) ? clp_crnt->get_clp_next_point()
+                            : clp_crnt->get_clp_previous_point();
+      if (NULL == clp_crnt) break;
+
+      cl_brush_smudge_circle.get_dp_area(clp_crnt->get_d_xp_tgt(),
+                                         clp_crnt->get_d_yp_tgt(), &d_x1,
+                                         &d_y1, &d_x2, &d_y2);
+      area.x1 = std::min(area.x1, (int)floor(d_x1));
+      area.y1 = std::min(area.y1, (int)floor(d_y1));
+      area.x2 = std::max(area.x2, (int)floor(d_x2));
+      area.y2 = std::max(area.y2, (int)floor(d_y2));
+    }
+  }
+
+  return area;
+}
+
 void igs_line_blur_brush_smudge_all_(
     bool mv_sw, bool pv_sw, bool cv_sw,
     brush_smudge_circle &cl_brush_smudge_circle,
@@ -6049,7 +6213,24 @@ void igs_line_blur_brush_smudge_all_(
     pri_funct_cv_start(cl_pixel_line_root.get_i32_count());
   }
 
-  /* 汚れ線描画 */
+  /* Smudging blends into out, so lines touching the same pixels must keep
+     their order. Lines are split into waves: a line goes in the wave after
+     the latest one holding an earlier line it overlaps. Waves are smudged
+     in order, and the lines of a wave in parallel.
+     Earlier lines are looked up in a grid of image cells, each listing the
+     lines whose area touches it. */
+  std::vector<pixel_line_node *> lines;
+  std::vector<igs_line_blur_smudge_area_> areas;
+  std::vector<int> line_waves;
+  int wave_count = 0;
+
+  const int grid_w =
+      (width + SMUDGE_GRID_CELL_SIZE - 1) / SMUDGE_GRID_CELL_SIZE;
+  const int grid_h =
+      (height + SMUDGE_GRID_CELL_SIZE - 1) / SMUDGE_GRID_CELL_SIZE;
+  std::vector<std::vector<int>> grid(grid_w * grid_h);
+  std::vector<int> line_visits; /* Last line that checked each line */
+
   pixel_line_node *clp_line =
       (pixel_line_node *)cl_pixel_line_root.get_clp_first();
   for (int ii   = 0; NULL != clp_line;
@@ -6059,13 +6240,74 @@ void igs_line_blur_brush_smudge_all_(
           "Error : over cl_pixel_line_root.get_i32_count()");
     }
 
-    /* カウントダウン表示中 */
-    if (cv_sw) {
-      pri_funct_cv_run(ii);
+    igs_line_blur_smudge_area_ area =
+        igs_line_blur_brush_smudge_area_(cl_brush_smudge_circle, clp_line);
+
+    const int cx1 = igs_line_blur_smudge_cell_(area.x1, grid_w);
+    const int cy1 = igs_line_blur_smudge_cell_(area.y1, grid_h);
+    const int cx2 = igs_line_blur_smudge_cell_(area.x2, grid_w);
+    const int cy2 = igs_line_blur_smudge_cell_(area.y2, grid_h);
+
+    int wave = 0;
+    line_visits.push_back(ii);
+    for (int cy = cy1; cy <= cy2; ++cy) {
+      for (int cx = cx1; cx <= cx2; ++cx) {
+        std::vector<int> &cell = grid[cy * grid_w + cx];
+        for (size_t kk = 0; kk < cell.size(); ++kk) {
+          const int jj = cell[kk];
+          if (line_visits[jj] == ii) {
+            continue;
+          }
+          line_visits[jj] = ii;
+          if (wave <= line_waves[jj] && area.overlaps(areas[jj])) {
+            wave = line_waves[jj] + 1;
+          }
+        }
+        cell.push_back(ii);
+      }
     }
 
-    igs_line_blur_brush_smudge_line_(cl_brush_smudge_circle, in, height, width,
-                                     channels, bits, out, clp_line);
+    lines.push_back(clp_line);
+    areas.push_back(area);
+    line_waves.push_back(wave);
+    wave_count = std::max(wave_count, wave + 1);
+  }
+
+  std::vector<std::vector<pixel_line_node *>> waves(wave_count);
+  for (size_t ii = 0; ii < lines.size(); ++ii) {
+    waves[line_waves[ii]].push_back(lines[ii]);
+  }
+
+  /* 汚れ線描画 */
+  int done_count = 0;
+  for (int ww = 0; ww < wave_count; ++ww) {
+    const std::vector<pixel_line_node *> &wave_lines = waves[ww];
+
+    TThread::parallelFor(
+        0, (int)wave_lines.size(),
+        [&](int i_begin, int i_end) {
+          brush_smudge_circle cl_brush;
+          cl_brush.set_i32_size_by_pixel(
+              cl_brush_smudge_circle.get_i32_size_by_pixel());
+          cl_brush.set_i32_subpixel_divide(
+              cl_brush_smudge_circle.get_i32_subpixel_divide());
+          cl_brush.set_d_ratio(cl_brush_smudge_circle.get_d_ratio());
+          if (OK != cl_brush.mem_alloc()) {
+            throw std::domain_error("Error : cl_brush.mem_alloc() returns NG");
+          }
+
+          for (int ii = i_begin; ii < i_end; ++ii) {
+            /* カウントダウン表示中 */
+            if (cv_sw) {
+              pri_funct_cv_run(done_count++);
+            }
+
+            igs_line_blur_brush_smudge_line_(cl_brush, in, height, width,
+                                             channels, bits, out,
+                                             wave_lines[ii]);
+          }
+        },
+        1, cv_sw ? 1 : 0);
   }
   /* カウントダウン表示終了 */
   if (cv_sw) {
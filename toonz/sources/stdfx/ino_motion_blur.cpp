@@ -197,10 +197,7 @@ void fx_(const TRasterP in_ras  // with margin
    throw TRopException("Can not get TRasterGR8P->getRawData()");
   }***/
 
-  TRasterGR8P out_gr8(in_ras->getLy(),
-                      in_ras->getLx() * ino::channels() *
-                          ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                              : sizeof(unsigned char)));
+  TRasterGR8P out_gr8(ino::get_arr_buffer(in_ras));
   out_gr8->lock();
 
   igs::motion_blur::convert(
@@ -197,18 +197,12 @@ void fx_(const TRasterP in_ras  // with margin
   std::vector<unsigned char> refer_vec;
   ino::ras_to_vec( refer_ras, ino::channels(), refer_vec );***/
 
-  TRasterGR8P in_gr8(in_ras->getLy(),
-                     in_ras->getLx() * ino::channels() *
-                         ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                             : sizeof(unsigned char)));
+  TRasterGR8P in_gr8(ino::get_arr_buffer(in_ras));
   in_gr8->lock();
   ino::ras_to_arr(in_ras, ino::channels(), in_gr8->getRawData());
 
   if (refer_ras != nullptr) {
-    TRasterGR8P refer_gr8(refer_ras->getLy(),
-                          refer_ras->getLx() * ino::channels() *
-                              ((TRaster64P)refer_ras ? sizeof(unsigned short)
-                                                     : sizeof(unsigned char)));
+    TRasterGR8P refer_gr8(ino::get_arr_buffer(refer_ras));
     refer_gr8->lock();
     ino::ras_to_arr(refer_ras, ino::channels(), refer_gr8->getRawData());
 
@@ -176,10 +176,7 @@ void fx_(const TRasterP in_ras  // with margin
          const double xp, const double yp, const double twist,
          const double twist_radius, const double blur, const double radius,
          const bool alpha_rendering_sw, const bool anti_alias_sw) {
-  TRasterGR8P in_gr8(in_ras->getLy(),
-                     in_ras->getLx() * ino::channels() *
-                         ((TRaster64P)in_ras ? sizeof(unsigned short)
-                                             : sizeof(unsigned char)));
+  TRasterGR8P in_gr8(ino::get_arr_buffer(in_ras));
   in_gr8->lock();
 
   igs::radial_blur::convert(
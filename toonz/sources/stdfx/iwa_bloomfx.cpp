@@ -146,6 +146,42 @@ void Iwa_BloomFx::setMatToOutput(const RASTER ras, const RASTER srcRas,
   }
 }
 
+//------------------------------------------------
+// float tiles store the channel values without quantization
+
+template <>
+void Iwa_BloomFx::setMatToOutput<TRasterFP, TPixelF>(
+    const TRasterFP ras, const TRasterFP srcRas, cv::Mat &imgMat,
+    const double gamma, const double gain, const bool withAlpha,
+    const int margin) {
+  for (int j = 0; j < ras->getLy(); j++) {
+    cv::Vec3f const *mat_p = imgMat.ptr<cv::Vec3f>(j);
+    TPixelF *pix           = ras->pixels(j);
+    TPixelF *srcPix        = srcRas->pixels(j + margin) + margin;
+
+    for (int i = 0; i < ras->getLx(); i++, pix++, srcPix++, mat_p++) {
+      double nonlinear_b =
+          to_nonlinear_color_space((double)(*mat_p)[0] * gain, 1.0, gamma);
+      double nonlinear_g =
+          to_nonlinear_color_space((double)(*mat_p)[1] * gain, 1.0, gamma);
+      double nonlinear_r =
+          to_nonlinear_color_space((double)(*mat_p)[2] * gain, 1.0, gamma);
+
+      // float tiles keep the values exceeding 1, only the alpha is bounded
+      pix->r = (float)nonlinear_r;
+      pix->g = (float)nonlinear_g;
+      pix->b = (float)nonlinear_b;
+      if (withAlpha) {
+        double chan_a = clamp(
+            std::max(std::max(nonlinear_b, nonlinear_g), nonlinear_r), 0.0,
+            1.0);
+        pix->m = std::max((float)chan_a, srcPix->m);
+      } else
+        pix->m = 1.0f;
+    }
+  }
+}
+
 //------------------------------------------------
 
 void Iwa_BloomFx::doCompute(TTile &tile, double frame,
@@ -177,12 +213,16 @@ void Iwa_BloomFx::doCompute(TTile &tile, double frame,
   cv::Mat imgMat(cv::Size(dimSrc.lx, dimSrc.ly), CV_32FC3);
   TRaster32P ras32 = tile.getRaster();
   TRaster64P ras64 = tile.getRaster();
+  TRasterFP rasF   = tile.getRaster();
   if (ras32)
     setSourceTileToMat<TRaster32P, TPixel32>(sourceTile.getRaster(), imgMat,
                                              gamma);
   else if (ras64)
     setSourceTileToMat<TRaster64P, TPixel64>(sourceTile.getRaster(), imgMat,
                                              gamma);
+  else if (rasF)
+    setSourceTileToMat<TRasterFP, TPixelF>(sourceTile.getRaster(), imgMat,
+                                           gamma);
 
   // compute size and intensity ratios of resampled layers
   // resample size is reduced from the specified size, taking into account
@@ -263,6 +303,9 @@ void Iwa_BloomFx::doCompute(TTile &tile, double frame,
     setMatToOutput<TRaster64P, TPixel64>(tile.getRaster(),
                                          sourceTile.getRaster(), imgMat, gamma,
                                          gain, withAlpha, margin);
+  else if (rasF)
+    setMatToOutput<TRasterFP, TPixelF>(tile.getRaster(), sourceTile.getRaster(),
+                                       imgMat, gamma, gain, withAlpha, margin);
 }
 //------------------------------------------------
 
@@ -43,6 +43,7 @@ public:
   bool doGetBBox(double frame, TRectD &bBox,
                  const TRenderSettings &info) override;
   bool canHandle(const TRenderSettings &info, double frame) override;
+  bool canComputeInFloat() const override { return true; }
   void getParamUIs(TParamUIConcept *&concepts, int &length) override;
 };
 
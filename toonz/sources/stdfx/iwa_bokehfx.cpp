@@ -4,6 +4,7 @@
 #include "tdoubleparam.h"
 #include "trasterfx.h"
 #include "trasterimage.h"
+#include "ttilepool.h"
 
 #include "kiss_fft.h"
 
@@ -501,8 +502,8 @@ void Iwa_BokehFx::doCompute(TTile& tile, double frame,
 
   kiss_fft_cpx* kissfft_comp_iris;
   // create the iris data for FFT (in the same size as the source tile)
-  TRasterGR8P kissfft_comp_iris_ras(dimOut.lx * sizeof(kiss_fft_cpx),
-                                    dimOut.ly);
+  TRasterGR8P kissfft_comp_iris_ras(TTilePool::instance()->getRaster(
+      TDimension(dimOut.lx * sizeof(kiss_fft_cpx), dimOut.ly), 8));
   kissfft_comp_iris_ras->lock();
   kissfft_comp_iris = (kiss_fft_cpx*)kissfft_comp_iris_ras->getRawData();
 
@@ -554,8 +555,8 @@ void Iwa_BokehFx::doCompute(TTile& tile, double frame,
     {
       // Create the Iris image for FFT
       kiss_fft_cpx* kissfft_comp_iris_before;
-      TRasterGR8P kissfft_comp_iris_before_ras(dimOut.lx * sizeof(kiss_fft_cpx),
-                                               dimOut.ly);
+      TRasterGR8P kissfft_comp_iris_before_ras(TTilePool::instance()->getRaster(
+          TDimension(dimOut.lx * sizeof(kiss_fft_cpx), dimOut.ly), 8));
       kissfft_comp_iris_before_ras->lock();
       kissfft_comp_iris_before =
           (kiss_fft_cpx*)kissfft_comp_iris_before_ras->getRawData();
@@ -606,9 +607,9 @@ void Iwa_BokehFx::doCompute(TTile& tile, double frame,
       TRaster32P ras32(tile.getRaster());
       TRaster64P ras64(tile.getRaster());
       if (ras32)
-        tmpAlphaRas = TRasterGR8P(dimOut);
+        tmpAlphaRas = TTilePool::instance()->getRaster(dimOut, 8);
       else if (ras64)
-        tmpAlphaRas = TRasterGR16P(dimOut);
+        tmpAlphaRas = TTilePool::instance()->getRaster(dimOut, 16);
     }
     tmpAlphaRas->lock();
 
@@ -4,6 +4,9 @@
 //------------------------------------*/
 
 #include "iwa_directionalblurfx.h"
+#include "iwa_sparsefilter.h"
+
+#include "tthread.h"
 
 #include "tparamuiconcept.h"
 
@@ -258,49 +261,34 @@ void Iwa_DirectionalBlurFx::doCompute_CPU(
                                 marginRight, marginTop, marginBottom,
                                 filterDim);
 
+  SparseFloat4Filter sparseFilter(filter, filterDim, marginLeft, marginBottom,
+                                  enlargedDimIn.lx);
+
   if (reference_host) /*- 参照画像がある場合 -*/
   {
-    float4 *out_p = out + marginTop * enlargedDimIn.lx;
-    float *ref_p  = reference_host + marginTop * enlargedDimIn.lx;
     /*- フィルタリング -*/
-    for (int y = marginTop; y < dimOut.ly + marginTop; y++) {
-      out_p += marginRight;
-      ref_p += marginRight;
-      for (int x = marginRight; x < dimOut.lx + marginRight;
-           x++, out_p++, ref_p++) {
-        /*- 参照画像が黒ならソースをそのまま返す -*/
-        if ((*ref_p) == 0.0f) {
-          (*out_p) = in[y * enlargedDimIn.lx + x];
-          continue;
-        }
-
-        /*- 値を積算する入れ物を用意 -*/
-        float4 value = {0.0f, 0.0f, 0.0f, 0.0f};
+    auto filterRows = [&](int y0, int y1) {
+      for (int y = y0; y < y1; y++) {
+        int index = y * enlargedDimIn.lx + marginRight;
+        for (int x = marginRight; x < dimOut.lx + marginRight; x++, index++) {
+          float4 *out_p = out + index;
+          float ref     = reference_host[index];
+
+          /*- 参照画像が黒ならソースをそのまま返す -*/
+          if (ref == 0.0f) {
+            (*out_p) = in[index];
+            continue;
+          }
 
-        float *filter_p = filter;
+          if (ref == 1.0f) {
+            sparseFilter.applyAt((float *)in, index, (float *)out_p);
+            continue;
+          }
 
-        if ((*ref_p) == 1.0f) {
-          /*- フィルタのサイズでループ
-             ただし、フィルタはサンプル点の画像を収集するように
-                  用いるため、上下左右反転してサンプルする -*/
-          for (int fily = -marginBottom; fily < filterDim.ly - marginBottom;
-               fily++) {
-            /*- サンプル座標 と インデックス の このスキャンラインのうしろ -*/
-            int2 samplePos  = {x + marginLeft, y - fily};
-            int sampleIndex = samplePos.y * enlargedDimIn.lx + samplePos.x;
+          /*- 値を積算する入れ物を用意 -*/
+          float4 value = {0.0f, 0.0f, 0.0f, 0.0f};
 
-            for (int filx = -marginLeft; filx < filterDim.lx - marginLeft;
-                 filx++, filter_p++, sampleIndex--) {
-              /*- フィルター値が０またはサンプルピクセルが透明ならcontinue -*/
-              if ((*filter_p) == 0.0f || in[sampleIndex].w == 0.0f) continue;
-              /*- サンプル点の値にフィルタ値を掛けて積算する -*/
-              value.x += in[sampleIndex].x * (*filter_p);
-              value.y += in[sampleIndex].y * (*filter_p);
-              value.z += in[sampleIndex].z * (*filter_p);
-              value.w += in[sampleIndex].w * (*filter_p);
-            }
-          }
-        } else {
+          float *filter_p = filter;
           for (int fily = -marginBottom; fily < filterDim.ly - marginBottom;
                fily++) {
             for (int filx = -marginLeft; filx < filterDim.lx - marginLeft;
@@ -308,8 +296,8 @@ void Iwa_DirectionalBlurFx::doCompute_CPU(
               /*- フィルター値が０ならcontinue -*/
               if ((*filter_p) == 0.0f) continue;
               /*- サンプル座標 -*/
-              int2 samplePos = {tround((float)x - (float)filx * (*ref_p)),
-                                tround((float)y - (float)fily * (*ref_p))};
+              int2 samplePos = {tround((float)x - (float)filx * ref),
+                                tround((float)y - (float)fily * ref)};
               int sampleIndex = samplePos.y * enlargedDimIn.lx + samplePos.x;
 
               /*- サンプルピクセルが透明ならcontinue -*/
@@ -322,52 +310,20 @@ void Iwa_DirectionalBlurFx::doCompute_CPU(
               value.w += in[sampleIndex].w * (*filter_p);
             }
           }
-        }
 
-        /*- 値を格納 -*/
-        (*out_p) = value;
+          /*- 値を格納 -*/
+          (*out_p) = value;
+        }
       }
-      out_p += marginLeft;
-      ref_p += marginLeft;
-    }
+    };
+    // Output rows are filtered in parallel
+    TThread::parallelFor(marginTop, dimOut.ly + marginTop, filterRows);
 
   } else /*- 参照画像が無い場合 -*/
   {
-    float4 *out_p = out + marginTop * enlargedDimIn.lx;
     /*- フィルタリング -*/
-    for (int y = marginTop; y < dimOut.ly + marginTop; y++) {
-      out_p += marginRight;
-      for (int x = marginRight; x < dimOut.lx + marginRight; x++, out_p++) {
-        /*- 値を積算する入れ物を用意 -*/
-        float4 value = {0.0f, 0.0f, 0.0f, 0.0f};
-        /*- フィルタのサイズでループ
-           ただし、フィルタはサンプル点の画像を収集するように
-                用いるため、上下左右反転してサンプルする -*/
-        int filterIndex = 0;
-        for (int fily = -marginBottom; fily < filterDim.ly - marginBottom;
-             fily++) {
-          /*- サンプル座標 と インデックス の このスキャンラインのうしろ -*/
-          int2 samplePos  = {x + marginLeft, y - fily};
-          int sampleIndex = samplePos.y * enlargedDimIn.lx + samplePos.x;
-
-          for (int filx = -marginLeft; filx < filterDim.lx - marginLeft;
-               filx++, filterIndex++, sampleIndex--) {
-            /*- フィルター値が０またはサンプルピクセルが透明ならcontinue -*/
-            if (filter[filterIndex] == 0.0f || in[sampleIndex].w == 0.0f)
-              continue;
-            /*- サンプル点の値にフィルタ値を掛けて積算する -*/
-            value.x += in[sampleIndex].x * filter[filterIndex];
-            value.y += in[sampleIndex].y * filter[filterIndex];
-            value.z += in[sampleIndex].z * filter[filterIndex];
-            value.w += in[sampleIndex].w * filter[filterIndex];
-          }
-        }
-
-        /*- 値を格納 -*/
-        (*out_p) = value;
-      }
-      out_p += marginLeft;
-    }
+    sparseFilter.apply((float *)in, (float *)out, marginRight, marginTop,
+                       dimOut);
   }
 
   in_ras->unlock();
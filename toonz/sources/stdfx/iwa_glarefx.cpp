@@ -34,6 +34,19 @@ inline int getCoord(int i, int j, int lx, int ly) {
   return cy * lx + cx;
 }
 
+// Integer channels clamp the glare to [0, 1]; float ones keep its full range
+template <typename PIXEL>
+inline double clampChannel(double chan) {
+  if (chan < 0.0) return 0.0;
+  if (chan > 1.0) return 1.0;
+  return chan;
+}
+
+template <>
+inline double clampChannel<TPixelF>(double chan) {
+  return chan;
+}
+
 };  // namespace
 
 //--------------------------------------------
@@ -292,12 +305,15 @@ void Iwa_GlareFx::doCompute(TTile& tile, double frame,
   double size = getSizePixelAmount(m_size->getValue(frame), settings.m_affine);
   if (irisMode == Iris_InputImage) {
     m_iris->getBBox(frame, irisBBox, settings);
-    // Compute the iris tile.
+    // Compute the iris tile. It is resampled with TRop, so it is computed in
+    // 64 bits rather than float.
+    TRenderSettings irisSettings(settings);
+    irisSettings.m_bpp = 64;
     m_iris->allocateAndCompute(
         irisTile, irisBBox.getP00(),
         TDimension(static_cast<int>(irisBBox.getLx() + 0.5),
                    static_cast<int>(irisBBox.getLy() + 0.5)),
-        tile.getRaster(), frame, settings);
+        0, frame, irisSettings);
     irisRas = irisTile.getRaster();
   } else {
     // obtain iris bbox based on the glare pattern size
@@ -312,7 +328,15 @@ void Iwa_GlareFx::doCompute(TTile& tile, double frame,
     TTranslation aff(
         (double)(tile.getRaster()->getLx() - irisRas->getLx()) * 0.5,
         (double)(tile.getRaster()->getLy() - irisRas->getLy()) * 0.5);
-    TRop::quickPut(tile.getRaster(), irisRas, aff);
+    // quickPut does not support float rasters
+    TRasterFP rasF = tile.getRaster();
+    if (rasF) {
+      TRaster64P irisOutRas(rasF->getSize());
+      irisOutRas->clear();
+      TRop::quickPut(irisOutRas, irisRas, aff);
+      TRop::convert(rasF, irisOutRas);
+    } else
+      TRop::quickPut(tile.getRaster(), irisRas, aff);
     return;
   }
 
@@ -370,10 +394,13 @@ void Iwa_GlareFx::doCompute(TTile& tile, double frame,
   tile.getRaster()->clear();
   TRaster32P ras32 = tile.getRaster();
   TRaster64P ras64 = tile.getRaster();
+  TRasterFP rasF   = tile.getRaster();
   if (ras32)
     ras32->fill(TPixel32::Transparent);
   else if (ras64)
     ras64->fill(TPixel64::Transparent);
+  else if (rasF)
+    rasF->fill(TPixelF::Transparent);
 
   // filter preview mode
   if (renderMode == RendeMode_FilterPreview) {
@@ -386,6 +413,9 @@ void Iwa_GlareFx::doCompute(TTile& tile, double frame,
     else if (ras64)
       setFilterPreviewToResult<TRaster64P, TPixel64>(ras64, glare_pattern,
                                                      dimIris, margin);
+    else if (rasF)
+      setFilterPreviewToResult<TRasterFP, TPixelF>(rasF, glare_pattern,
+                                                   dimIris, margin);
 
     return;
   }
@@ -451,6 +481,9 @@ void Iwa_GlareFx::doCompute(TTile& tile, double frame,
     else if (ras64)
       setSourceTileToBuffer<TRaster64P, TPixel64>(sourceTile.getRaster(),
                                                   kissfft_comp_tmp);
+    else if (rasF)
+      setSourceTileToBuffer<TRasterFP, TPixelF>(sourceTile.getRaster(),
+                                                kissfft_comp_tmp);
   }
   // FFT the source
   kiss_fftnd(plan_fwd, kissfft_comp_tmp, kissfft_comp_source);
@@ -480,6 +513,9 @@ void Iwa_GlareFx::doCompute(TTile& tile, double frame,
     else if (ras64)
       setChannelToResult<TRaster64P, TPixel64>(ras64, kissfft_comp_tmp, ch,
                                                dimOut);
+    else if (rasF)
+      setChannelToResult<TRasterFP, TPixelF>(rasF, kissfft_comp_tmp, ch,
+                                             dimOut);
   }
 
   kiss_fft_free(plan_fwd);
@@ -708,11 +744,6 @@ void Iwa_GlareFx::distortGlarePattern(const double frame, const TAffine affine,
 template <typename RASTER, typename PIXEL>
 void Iwa_GlareFx::setFilterPreviewToResult(const RASTER ras, double3* glare,
                                            int dimIris, int2 margin) {
-  auto clamp01 = [](double chan) {
-    if (chan < 0.0) return 0.0;
-    if (chan > 1.0) return 1.0;
-    return chan;
-  };
   int j = margin.y;
   for (int out_j = 0; out_j < ras->getLy(); j++, out_j++) {
     if (j < 0)
@@ -727,11 +758,11 @@ void Iwa_GlareFx::setFilterPreviewToResult(const RASTER ras, double3* glare,
       else if (i >= dimIris)
         break;
       double3 gl_p = glare[j * dimIris + i];
-      pix->r       = (typename PIXEL::Channel)(clamp01(gl_p.x) *
+      pix->r       = (typename PIXEL::Channel)(clampChannel<PIXEL>(gl_p.x) *
                                          double(PIXEL::maxChannelValue));
-      pix->g       = (typename PIXEL::Channel)(clamp01(gl_p.y) *
+      pix->g       = (typename PIXEL::Channel)(clampChannel<PIXEL>(gl_p.y) *
                                          double(PIXEL::maxChannelValue));
-      pix->b       = (typename PIXEL::Channel)(clamp01(gl_p.z) *
+      pix->b       = (typename PIXEL::Channel)(clampChannel<PIXEL>(gl_p.z) *
                                          double(PIXEL::maxChannelValue));
       pix->m       = PIXEL::maxChannelValue;
     }
@@ -792,12 +823,6 @@ void Iwa_GlareFx::multiplyFilter(kiss_fft_cpx* glare,
 template <typename RASTER, typename PIXEL>
 void Iwa_GlareFx::setChannelToResult(const RASTER ras, kiss_fft_cpx* buf,
                                      int channel, const TDimensionI& dimOut) {
-  auto clamp01 = [](double chan) {
-    if (chan < 0.0) return 0.0;
-    if (chan > 1.0) return 1.0;
-    return chan;
-  };
-
   int margin_x = (dimOut.lx - ras->getSize().lx) / 2;
   int margin_y = (dimOut.ly - ras->getSize().ly) / 2;
 
@@ -809,13 +834,13 @@ void Iwa_GlareFx::setChannelToResult(const RASTER ras, kiss_fft_cpx* buf,
           buf[getCoord(i + margin_x, j + margin_y, dimOut.lx, dimOut.ly)];
       double val = fft_val.r / (dimOut.lx * dimOut.ly);
       if (channel == 0)
-        pix->r = (typename PIXEL::Channel)(clamp01(val) *
+        pix->r = (typename PIXEL::Channel)(clampChannel<PIXEL>(val) *
                                            double(PIXEL::maxChannelValue));
       else if (channel == 1)
-        pix->g = (typename PIXEL::Channel)(clamp01(val) *
+        pix->g = (typename PIXEL::Channel)(clampChannel<PIXEL>(val) *
                                            double(PIXEL::maxChannelValue));
       else if (channel == 2) {
-        pix->b = (typename PIXEL::Channel)(clamp01(val) *
+        pix->b = (typename PIXEL::Channel)(clampChannel<PIXEL>(val) *
                                            double(PIXEL::maxChannelValue));
         pix->m = PIXEL::maxChannelValue;
       }
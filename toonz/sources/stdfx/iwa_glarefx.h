@@ -121,6 +121,8 @@ public:
 
   bool canHandle(const TRenderSettings &info, double frame) override;
 
+  bool canComputeInFloat() const override { return true; }
+
   void getParamUIs(TParamUIConcept *&concepts, int &length) override;
 };
 
@@ -5,6 +5,7 @@ Available to composite exposure value with background.
 //------------------------------------*/
 
 #include "iwa_motionblurfx.h"
+#include "iwa_sparsefilter.h"
 #include "tfxattributes.h"
 
 #include "toonz/tstageobject.h"
@@ -93,6 +94,26 @@ void Iwa_MotionBlurCompFx::setOutputRaster(float4 *srcMem, const RASTER dstRas,
   }
 }
 
+/*------------------------------------------------------------
+ Float tiles store the result without quantization
+------------------------------------------------------------*/
+template <>
+void Iwa_MotionBlurCompFx::setOutputRaster<TRasterFP, TPixelF>(
+    float4 *srcMem, const TRasterFP dstRas, TDimensionI dim, int2 margin) {
+  int out_j = 0;
+  for (int j = margin.y; j < dstRas->getLy() + margin.y; j++, out_j++) {
+    TPixelF *pix   = dstRas->pixels(out_j);
+    float4 *chan_p = srcMem;
+    chan_p += j * dim.lx + margin.x;
+    for (int i = 0; i < dstRas->getLx(); i++, pix++, chan_p++) {
+      pix->r = (*chan_p).x;
+      pix->g = (*chan_p).y;
+      pix->b = (*chan_p).z;
+      pix->m = (*chan_p).w;
+    }
+  }
+}
+
 /*------------------------------------------------------------
  Create and normalize filters
 ------------------------------------------------------------*/
@@ -418,44 +439,12 @@ void Iwa_MotionBlurCompFx::applyBlurFilter_CPU(
     float4 *in_tile_p, float4 *out_tile_p, TDimensionI &enlargedDim,
     float *filter_p, TDimensionI &filterDim, int marginLeft, int marginBottom,
     int marginRight, int marginTop, TDimensionI &outDim) {
-  for (int i = 0; i < outDim.lx * outDim.ly; i++) {
-    /* in_tile_dev and out_tile_dev contain data with dimensions lx * ly.
-     * So, convert i to coordinates for output. */
-    int2 outPos  = {i % outDim.lx + marginRight, i / outDim.lx + marginTop};
-    int outIndex = outPos.y * enlargedDim.lx + outPos.x;
-    /* put the result in out_tile_dev [outIndex] */
-
-    /* Prepare a container to accumulate values ​​- */
-    float4 value = {0.0f, 0.0f, 0.0f, 0.0f};
-
-    /* Loop by filter size.
-     * Note that the filter is used to 'collect' pixels at sample points
-     * so flip the filter vertically and horizontally and sample it */
-    int filterIndex = 0;
-    for (int fily = -marginBottom; fily < filterDim.ly - marginBottom; fily++) {
-      /* Sample coordinates and index of the end of this scan line */
-      int2 samplePos  = {outPos.x + marginLeft, outPos.y - fily};
-      int sampleIndex = samplePos.y * enlargedDim.lx + samplePos.x;
-
-      for (int filx = -marginLeft; filx < filterDim.lx - marginLeft;
-           filx++, filterIndex++, sampleIndex--) {
-        /* If the filter value is 0 or the sample pixel is transparent, continue
-         */
-        if (filter_p[filterIndex] == 0.0f || in_tile_p[sampleIndex].w == 0.0f)
-          continue;
-        /* multiply the sample point value by the filter value and integrate */
-        value.x += in_tile_p[sampleIndex].x * filter_p[filterIndex];
-        value.y += in_tile_p[sampleIndex].y * filter_p[filterIndex];
-        value.z += in_tile_p[sampleIndex].z * filter_p[filterIndex];
-        value.w += in_tile_p[sampleIndex].w * filter_p[filterIndex];
-      }
-    }
-
-    out_tile_p[outIndex].x = value.x;
-    out_tile_p[outIndex].y = value.y;
-    out_tile_p[outIndex].z = value.z;
-    out_tile_p[outIndex].w = value.w;
-  }
+  /* Only the non-zero runs of the filter are visited, and the output rows are
+   * filtered in parallel */
+  SparseFloat4Filter filter(filter_p, filterDim, marginLeft, marginBottom,
+                            enlargedDim.lx);
+  filter.apply((float *)in_tile_p, (float *)out_tile_p, marginRight, marginTop,
+               outDim);
 }
 
 /*------------------------------------------------------------
@@ -540,12 +529,16 @@ void Iwa_MotionBlurCompFx::composeBackgroundExposure_CPU(
    */
   TRaster32P backRas32 = (TRaster32P)back_tile.getRaster();
   TRaster64P backRas64 = (TRaster64P)back_tile.getRaster();
+  TRasterFP backRasF   = (TRasterFP)back_tile.getRaster();
   if (backRas32)
     bgIsPremultiplied = setSourceRaster<TRaster32P, TPixel32>(
         backRas32, background_host, dimOut);
   else if (backRas64)
     bgIsPremultiplied = setSourceRaster<TRaster64P, TPixel64>(
         backRas64, background_host, dimOut);
+  else if (backRasF)
+    bgIsPremultiplied = setSourceRaster<TRasterFP, TPixelF>(
+        backRasF, background_host, dimOut);
 
   float4 *bg_p = background_host;
   float4 *out_p;
@@ -794,6 +787,7 @@ void Iwa_MotionBlurCompFx::doCompute_CPU(
   /* normalize the source image to 0 - 1 and read it into memory */
   TRaster32P ras32 = (TRaster32P)enlarge_tile.getRaster();
   TRaster64P ras64 = (TRaster64P)enlarge_tile.getRaster();
+  TRasterFP rasF   = (TRasterFP)enlarge_tile.getRaster();
   if (ras32)
     sourceIsPremultiplied = setSourceRaster<TRaster32P, TPixel32>(
         ras32, in_tile_p, enlargedDimIn,
@@ -802,6 +796,10 @@ void Iwa_MotionBlurCompFx::doCompute_CPU(
     sourceIsPremultiplied = setSourceRaster<TRaster64P, TPixel64>(
         ras64, in_tile_p, enlargedDimIn,
         (PremultiTypes)m_premultiType->getValue());
+  else if (rasF)
+    sourceIsPremultiplied = setSourceRaster<TRasterFP, TPixelF>(
+        rasF, in_tile_p, enlargedDimIn,
+        (PremultiTypes)m_premultiType->getValue());
 
   /* When afterimage mode is off */
   if (!m_zanzoMode->getValue()) {
@@ -849,6 +847,7 @@ void Iwa_MotionBlurCompFx::doCompute_CPU(
   tile.getRaster()->clear();
   TRaster32P outRas32 = (TRaster32P)tile.getRaster();
   TRaster64P outRas64 = (TRaster64P)tile.getRaster();
+  TRasterFP outRasF   = (TRasterFP)tile.getRaster();
   int2 margin         = {marginRight, marginTop};
   if (outRas32)
     setOutputRaster<TRaster32P, TPixel32>(out_tile_p, outRas32, enlargedDimIn,
@@ -856,6 +855,9 @@ void Iwa_MotionBlurCompFx::doCompute_CPU(
   else if (outRas64)
     setOutputRaster<TRaster64P, TPixel64>(out_tile_p, outRas64, enlargedDimIn,
                                           margin);
+  else if (outRasF)
+    setOutputRaster<TRasterFP, TPixelF>(out_tile_p, outRasF, enlargedDimIn,
+                                        margin);
 
   /* Memory release */
   out_tile_ras->unlock();
@@ -936,7 +938,7 @@ std::string Iwa_MotionBlurCompFx::getAlias(double frame,
     if (port->isConnected()) {
       TRasterFxP ifx = port->getFx();
       assert(ifx);
-      alias += ifx->getAlias(frame, info);
+      alias += getInputAlias(ifx.getPointer(), frame, info);
     }
     alias += ",";
   }
@@ -129,6 +129,9 @@ public:
                  const TRenderSettings &info) override;
 
   bool canHandle(const TRenderSettings &info, double frame) override;
+
+  bool canComputeInFloat() const override { return true; }
+
   /*- 参考にしているオブジェクトが動いている可能性があるので、
           エイリアスは毎フレーム変える -*/
   std::string getAlias(double frame,
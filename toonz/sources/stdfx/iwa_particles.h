@@ -210,6 +210,49 @@ public:
                bool isUpward, /*-  初期向き -*/
                int initSourceFrame);
   // Constructor
+  Iwa_Particle()
+      : x(0)
+      , y(0)
+      , oldx(0)
+      , oldy(0)
+      , vx(0)
+      , vy(0)
+      , mass(0)
+      , scale(0)
+      , angle(0)
+      , smswingx(0)
+      , smswingy(0)
+      , smswinga(0)
+      , smperiodx(0)
+      , smperiody(0)
+      , smperioda(0)
+      , lifetime(0)
+      , genlifetime(0)
+      , level(0)
+      , frame(0)
+      , signx(0)
+      , trail(0)
+      , gencol()
+      , fincol()
+      , foutcol()
+      , changesignx(0)
+      , signy(0)
+      , changesigny(0)
+      , signa(0)
+      , changesigna(0)
+      , animswing(false)
+      , random()
+      , seed(0)
+      , initial_x(0)
+      , initial_y(0)
+      , initial_angle(0)
+      , initial_scale(0)
+      , curlx(0)
+      , curly(0)
+      , curlz(0)
+      , flap_theta(0)
+      , flap_phi(0) {}
+  // Zeroed, for snapshots to be read into
   ~Iwa_Particle() {}
   // Destructor
   void create_Animation(const particles_values &values, int first, int last);
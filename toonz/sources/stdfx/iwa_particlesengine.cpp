@@ -18,6 +18,7 @@
 #include "toonz/tcolumnfx.h"
 
 #include "iwa_particlesmanager.h"
+#include "particlescheckpoints.h"
 
 #include "iwa_particlesengine.h"
 
@@ -26,6 +27,7 @@
 #include <QMutex>
 #include <QMutexLocker>
 
+#include <memory>
 #include <sstream>
 
 namespace {
@@ -38,6 +40,89 @@ void printTime(TStopWatch &sw, std::string name) {
   ss << '\n' << '\0';
   TSystem::outputDebug(ss.str());
 }
+
+//-----------------------------------------------------------------
+
+template <class Stream>
+void ioParticle(Stream &s, Iwa_Particle &p) {
+  ioParticleFields(s, p);
+  s(p.initial_x);
+  s(p.initial_y);
+  s(p.initial_angle);
+  s(p.initial_scale);
+  s(p.curlx);
+  s(p.curly);
+  s(p.curlz);
+  s(p.flap_theta);
+  s(p.flap_phi);
+}
+
+template <class Stream>
+void ioParticleOrigin(Stream &s, ParticleOrigin &o) {
+  s(o.pos[0]);
+  s(o.pos[1]);
+  s(o.potential);
+  s(o.isUpward);
+  s(o.level);
+  s(o.initSourceFrame);
+  s(o.pixPos[0]);
+  s(o.pixPos[1]);
+}
+
+// The state stored in simulation snapshots
+struct SimulationState {
+  std::list<Iwa_Particle> m_particles;
+  QList<ParticleOrigin> m_particleOrigins;
+  TRandom m_random;
+  int m_totalParticles;
+  float m_fractpart;
+};
+
+QByteArray saveSimulationState(SimulationState &st) {
+  QByteArray state;
+  QDataStream out(&state, QIODevice::WriteOnly);
+  ParticlesStateWriter writer(out);
+
+  int count        = (int)st.m_particles.size();
+  int originsCount = st.m_particleOrigins.size();
+  writer(count);
+  writer(originsCount);
+  writer(st.m_random);
+  writer(st.m_totalParticles);
+  writer(st.m_fractpart);
+
+  std::list<Iwa_Particle>::iterator it;
+  for (it = st.m_particles.begin(); it != st.m_particles.end(); ++it)
+    ioParticle(writer, *it);
+  for (int i = 0; i < originsCount; ++i)
+    ioParticleOrigin(writer, st.m_particleOrigins[i]);
+
+  return state;
+}
+
+bool loadSimulationState(const QByteArray &state, SimulationState &st) {
+  QDataStream in(state);
+  ParticlesStateReader reader(in);
+
+  int count = 0, originsCount = 0;
+  reader(count);
+  reader(originsCount);
+  reader(st.m_random);
+  reader(st.m_totalParticles);
+  reader(st.m_fractpart);
+  if (!reader.isOk() || count < 0 || originsCount < 0) return false;
+
+  for (int i = 0; i < count && reader.isOk(); ++i) {
+    st.m_particles.push_back(Iwa_Particle());
+    ioParticle(reader, st.m_particles.back());
+  }
+  for (int i = 0; i < originsCount && reader.isOk(); ++i) {
+    st.m_particleOrigins.append(ParticleOrigin(0, 0, 0, false, 0, 0, 0, 0));
+    ioParticleOrigin(reader, st.m_particleOrigins.last());
+  }
+
+  return reader.isOk();
+}
 };  // namespace
 //----
 
@@ -623,6 +708,51 @@ void Iwa_Particles_Engine::render_particles(
     initialOriginsSize = particleOrigins.size();
   }
 
+  // Far from the last rolled frame, look for a snapshot on disk. Control
+  // images are computed on the resource tile, so it is part of the key.
+  std::unique_ptr<ParticlesCheckpoints> checkpoints;
+  if (ParticlesCheckpoints::isEnabled() &&
+      curr_frame - std::max(pcFrame, startframe - 1) >
+          ParticlesCheckpoints::Interval) {
+    const TAffine &aff = ri.m_affine;
+
+    std::ostringstream seed;
+    seed.precision(12);
+    seed << m_parent->getFxType() << ";" << startframe << ";"
+         << values.step_val << ";" << shrink << ";" << level_n << ";";
+    for (int i = 0; i < (int)last_frame.size(); ++i)
+      seed << last_frame[i] << ",";
+    seed << ";" << resourceTileBBox.x0 << "," << resourceTileBBox.y0 << ","
+         << resourceTileBBox.x1 << "," << resourceTileBBox.y1 << ";"
+         << aff.a11 << "," << aff.a12 << "," << aff.a13 << "," << aff.a21
+         << "," << aff.a22 << "," << aff.a23;
+
+    checkpoints.reset(new ParticlesCheckpoints(seed.str(), startframe - 1));
+
+    TRenderSettings riAux(ri);
+    riAux.m_bpp = 64;
+
+    for (frame = startframe - 1; frame <= curr_frame; ++frame)
+      checkpoints->addFrame(
+          frame, ParticlesCheckpoints::getFrameAlias(
+                     m_parent, frame < 0 ? 0 : frame * values.step_val,
+                     ctrl_ports, std::max(frame, 0), riAux));
+
+    QByteArray data;
+    SimulationState st;
+    int cpFrame = checkpoints->load(std::max(pcFrame, startframe - 1),
+                                    curr_frame, data);
+    if (cpFrame > pcFrame && loadSimulationState(data, st)) {
+      myParticles.swap(st.m_particles);
+      particleOrigins.swap(st.m_particleOrigins);
+      myRandom           = st.m_random;
+      totalparticles     = st.m_totalParticles;
+      fractpart          = st.m_fractpart;
+      initialOriginsSize = -1;
+      pcFrame            = cpFrame;
+    }
+  }
+
   /*- スタートからカレントフレームまでループ -*/
   for (frame = startframe - 1; frame <= curr_frame; ++frame) {
     /*-  参照画像はキャッシュされてるフレームでは必要ないのでは？ -*/
@@ -751,6 +881,17 @@ void Iwa_Particles_Engine::render_particles(
       particlesData->m_particleOrigins = particleOrigins;
     }
 
+    // Only the current frame is drawn, so trails never reach the snapshot
+    if (checkpoints && checkpoints->needsSave(frame, curr_frame)) {
+      SimulationState st;
+      st.m_particles       = myParticles;
+      st.m_particleOrigins = particleOrigins;
+      st.m_random          = myRandom;
+      st.m_totalParticles  = totalparticles;
+      st.m_fractpart       = fractpart;
+      checkpoints->save(frame, curr_frame, 0, saveSimulationState(st));
+    }
+
     // Render the particles if the distance from current frame is a trail
     // multiple
     /*- さしあたり、trailは無視する -*/
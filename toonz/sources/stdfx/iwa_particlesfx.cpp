@@ -374,7 +374,7 @@ std::string Iwa_TiledParticlesFx::getAlias(double frame,
     if (port->isConnected()) {
       TRasterFxP ifx = port->getFx();
       assert(ifx);
-      alias += ifx->getAlias(frame, info);
+      alias += getInputAlias(ifx.getPointer(), frame, info);
     }
     alias += ",";
   }
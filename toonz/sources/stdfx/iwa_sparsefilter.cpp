@@ -0,0 +1,101 @@
+/*------------------------------------
+ SparseFloat4Filter
+ The convolution core shared by Iwa_MotionBlurCompFx and
+ Iwa_DirectionalBlurFx.
+//------------------------------------*/
+
+#include "iwa_sparsefilter.h"
+
+#include "tthread.h"
+
+#if (defined(_WIN32) && defined(x64)) || defined(__SSE2__)
+#define USE_SSE2
+#endif
+
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
+SparseFloat4Filter::SparseFloat4Filter(const float *filter,
+                                       const TDimensionI &filterDim,
+                                       int marginLeft, int marginBottom,
+                                       int bufferLx)
+    : m_bufferLx(bufferLx) {
+  const float *filter_p = filter;
+  for (int fily = -marginBottom; fily < filterDim.ly - marginBottom; fily++) {
+    bool inRun = false;
+    for (int filx = -marginLeft; filx < filterDim.lx - marginLeft;
+         filx++, filter_p++) {
+      if ((*filter_p) == 0.0f) {
+        inRun = false;
+        continue;
+      }
+
+      /* Along a run the sample index decreases by one per weight */
+      if (!inRun) {
+        Run run = {-fily * bufferLx - filx, 0, (int)m_weights.size()};
+        m_runs.push_back(run);
+        inRun = true;
+      }
+      m_weights.push_back(*filter_p);
+      m_runs.back().m_length++;
+    }
+  }
+}
+
+//------------------------------------
+
+void SparseFloat4Filter::applyAt(const float *in, int index,
+                                 float *out) const {
+#ifdef USE_SSE2
+  const __m128 zero = _mm_setzero_ps();
+  __m128 value      = zero;
+
+  for (const Run &run : m_runs) {
+    const float *sample_p = in + 4 * (index + run.m_offset);
+    const float *weight_p = &m_weights[run.m_weight];
+
+    for (int k = 0; k < run.m_length; k++, sample_p -= 4) {
+      __m128 sample = _mm_loadu_ps(sample_p);
+      /* Transparent samples add nothing, as in the scalar loop */
+      __m128 opaque = _mm_cmpneq_ps(
+          _mm_shuffle_ps(sample, sample, _MM_SHUFFLE(3, 3, 3, 3)), zero);
+      __m128 term = _mm_mul_ps(sample, _mm_set1_ps(weight_p[k]));
+      value       = _mm_add_ps(value, _mm_and_ps(term, opaque));
+    }
+  }
+
+  _mm_storeu_ps(out, value);
+#else
+  float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+  for (const Run &run : m_runs) {
+    const float *sample_p = in + 4 * (index + run.m_offset);
+    const float *weight_p = &m_weights[run.m_weight];
+
+    for (int k = 0; k < run.m_length; k++, sample_p -= 4) {
+      /* If the sample pixel is transparent, continue */
+      if (sample_p[3] == 0.0f) continue;
+      value[0] += sample_p[0] * weight_p[k];
+      value[1] += sample_p[1] * weight_p[k];
+      value[2] += sample_p[2] * weight_p[k];
+      value[3] += sample_p[3] * weight_p[k];
+    }
+  }
+
+  for (int c = 0; c < 4; c++) out[c] = value[c];
+#endif
+}
+
+//------------------------------------
+
+void SparseFloat4Filter::apply(const float *in, float *out, int x0, int y0,
+                               const TDimensionI &outDim) const {
+  TThread::parallelFor(y0, y0 + outDim.ly, [&](int yBegin, int yEnd) {
+    for (int y = yBegin; y < yEnd; y++) {
+      int index = y * m_bufferLx + x0;
+      for (int x = 0; x < outDim.lx; x++, index++)
+        applyAt(in, index, out + 4 * index);
+    }
+  });
+}
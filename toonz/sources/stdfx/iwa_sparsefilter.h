@@ -0,0 +1,55 @@
+#pragma once
+
+/*------------------------------------
+ SparseFloat4Filter
+ The convolution core shared by Iwa_MotionBlurCompFx and
+ Iwa_DirectionalBlurFx: a filter stored as runs of non-zero weights, applied
+ to RGBA float buffers.
+//------------------------------------*/
+
+#ifndef IWA_SPARSE_FILTER_H
+#define IWA_SPARSE_FILTER_H
+
+#include "tgeometry.h"
+
+#include <vector>
+
+/*
+  Buffers are arrays of 4 floats per pixel (the fxs' float4), bufferLx pixels
+  wide. The filter is used to 'collect' the pixels at sample points, i.e. the
+  value at (x, y) accumulates
+
+    in(x - filx, y - fily) * filter(filx, fily)
+
+  for filx in [-marginLeft, filterDim.lx - marginLeft) and fily in
+  [-marginBottom, filterDim.ly - marginBottom), skipping transparent samples.
+  Long streaks leave most of the filter at zero: only the runs of non-zero
+  weights are stored, in the order the weights are accumulated, so that the
+  result matches the plain loop over the whole filter.
+*/
+
+class SparseFloat4Filter {
+  struct Run {
+    int m_offset;  //!< Sample offset of the run's first weight, in pixels.
+    int m_length;
+    int m_weight;  //!< Index of the run's first weight.
+  };
+
+  std::vector<Run> m_runs;
+  std::vector<float> m_weights;
+  int m_bufferLx;
+
+public:
+  SparseFloat4Filter(const float *filter, const TDimensionI &filterDim,
+                     int marginLeft, int marginBottom, int bufferLx);
+
+  //! Filters the pixel at \b index of \b in, storing it in \b out[0..3].
+  void applyAt(const float *in, int index, float *out) const;
+
+  //! Filters the \b outDim pixels from (x0, y0) of \b in into \b out,
+  //! processing rows in parallel.
+  void apply(const float *in, float *out, int x0, int y0,
+             const TDimensionI &outDim) const;
+};
+
+#endif
@@ -457,7 +457,7 @@ public:
       if (port->isConnected()) {
         TRasterFxP ifx = port->getFx();
         assert(ifx);
-        alias += ifx->getAlias(frame, info);
+        alias += getInputAlias(ifx.getPointer(), frame, info);
       }
       alias += ",";
     }
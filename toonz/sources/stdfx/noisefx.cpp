@@ -179,7 +179,7 @@ std::string NoiseFx::getAlias(double frame, const TRenderSettings &info) const {
     if (port->isConnected()) {
       TRasterFxP ifx = port->getFx();
       assert(ifx);
-      alias += ifx->getAlias(frame, info);
+      alias += getInputAlias(ifx.getPointer(), frame, info);
     }
     alias += ",";
   }
@@ -648,7 +648,7 @@ void Particle::spread_color(TPixel32 &color, double range) {
 }
 /*-----------------------------------------------------------------*/
 
-void Particle::move(std::map<int, TTile *> porttiles,
+void Particle::move(const std::map<int, TTile *> &porttiles,
                     const particles_values &values,
                     const particles_ranges &ranges, float windx, float windy,
                     float xgravity, float ygravity, float dpicorr,
@@ -666,7 +666,7 @@ void Particle::move(std::map<int, TTile *> porttiles,
   double randomxreference   = 1;
   double randomyreference   = 1;
 
-  for (std::map<int, TTile *>::iterator it = porttiles.begin();
+  for (std::map<int, TTile *>::const_iterator it = porttiles.begin();
        it != porttiles.end(); ++it) {
     if ((values.friction_ctrl_val == it->first ||
          values.scale_ctrl_val == it->first ||
@@ -700,10 +700,10 @@ void Particle::move(std::map<int, TTile *> porttiles,
   oldy = y;
   // time=genlifetime-lifetime-1;
   // if(time<0) time=0;
-  if (values.gravity_ctrl_val &&
-      (porttiles.find(values.gravity_ctrl_val) != porttiles.end())) {
-    get_image_gravity(porttiles[values.gravity_ctrl_val], values, xgravity,
-                      ygravity);
+  std::map<int, TTile *>::const_iterator gravityIt =
+      porttiles.find(values.gravity_ctrl_val);
+  if (values.gravity_ctrl_val && gravityIt != porttiles.end()) {
+    get_image_gravity(gravityIt->second, values, xgravity, ygravity);
     xgravity *= values.gravity_val;
     ygravity *= values.gravity_val;
   }
@@ -758,7 +758,7 @@ void Particle::move(std::map<int, TTile *> porttiles,
 }
 
 /*-----------------------------------------------------------------*/
-double Particle::set_Opacity(std::map<int, TTile *> porttiles,
+double Particle::set_Opacity(const std::map<int, TTile *> &porttiles,
                              const particles_values &values,
                              float opacity_range, double dist_frame) {
   double opacity = 1.0, trailcorr;
@@ -775,11 +775,12 @@ double Particle::set_Opacity(std::map<int, TTile *> porttiles,
             (1 - (dist_frame) / trail);
     opacity *= trailcorr;
   }
-  if (values.opacity_ctrl_val &&
-      (porttiles.find(values.opacity_ctrl_val) != porttiles.end())) {
+  std::map<int, TTile *>::const_iterator opacityIt =
+      porttiles.find(values.opacity_ctrl_val);
+  if (values.opacity_ctrl_val && opacityIt != porttiles.end()) {
     double opacityreference = 0.0;
-    get_image_reference(porttiles[values.opacity_ctrl_val], values,
-                        opacityreference, ParticlesFx::GRAY_REF);
+    get_image_reference(opacityIt->second, values, opacityreference,
+                        ParticlesFx::GRAY_REF);
     opacity =
         values.opacity_val.first + (opacity_range)*opacityreference * opacity;
   } else
@@ -169,6 +169,40 @@ public:
            int level, int last, std::vector<std::vector<int>> &myHistogram,
            std::vector<float> &myWeight);
   // Constructor
+  Particle()
+      : x(0)
+      , y(0)
+      , oldx(0)
+      , oldy(0)
+      , vx(0)
+      , vy(0)
+      , mass(0)
+      , scale(0)
+      , angle(0)
+      , smswingx(0)
+      , smswingy(0)
+      , smswinga(0)
+      , smperiodx(0)
+      , smperiody(0)
+      , smperioda(0)
+      , lifetime(0)
+      , genlifetime(0)
+      , level(0)
+      , frame(0)
+      , signx(0)
+      , trail(0)
+      , gencol()
+      , fincol()
+      , foutcol()
+      , changesignx(0)
+      , signy(0)
+      , changesigny(0)
+      , signa(0)
+      , changesigna(0)
+      , animswing(false)
+      , random()
+      , seed(0) {}
+  // Zeroed, for snapshots to be read into
   ~Particle() {}
   // Destructor
   void create_Animation(const particles_values &values, int first, int last);
@@ -182,7 +216,7 @@ public:
                      const particles_ranges &ranges,
                      std::map<int, TTile *> porttiles);
 
-  void move(const std::map<int, TTile *> porttiles,
+  void move(const std::map<int, TTile *> &porttiles,
             const particles_values &values, const particles_ranges &ranges,
             float windx, float windy, float xgravity, float ygravity, float dpi,
             int lastframe);
@@ -197,7 +231,7 @@ public:
                     const particles_ranges &ranges, double scalereference,
                     double scalestepreference);
 
-  double set_Opacity(std::map<int, TTile *> porttiles,
+  double set_Opacity(const std::map<int, TTile *> &porttiles,
                      const particles_values &values, float opacity_range,
                      double dist_frame);
 
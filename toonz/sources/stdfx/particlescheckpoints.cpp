@@ -0,0 +1,218 @@
+
+
+#include "particlescheckpoints.h"
+
+#include "trasterfx.h"
+#include "tparamcontainer.h"
+
+#include "toonz/toonzfolders.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QMutex>
+#include <QMutexLocker>
+
+/*
+  Snapshot files are named after their key, and hold:
+
+    magic, version, frame, target frame, max trail  (qint32 each)
+    simulation state                                (qCompress'd QByteArray)
+
+  The state is written and read by the particles engines themselves.
+*/
+
+//************************************************************************************************
+//    Local namespace
+//************************************************************************************************
+
+namespace {
+
+const qint32 checkpointMagic   = 0x50434b50;  // 'PCKP'
+const qint32 checkpointVersion = 1;
+
+// The oldest snapshots are removed beyond this size, once per session
+const qint64 maxCacheSize = qint64(2) << 30;
+
+//-------------------------------------------------------------------------
+
+QString initCheckpointsFolder() {
+  TFilePath cacheRoot = ToonzFolder::getCacheRootFolder();
+  if (cacheRoot.isEmpty()) return QString();
+
+  QString folder = (cacheRoot + "particles").getQString();
+  return QDir(folder).mkpath(".") ? folder : QString();
+}
+
+const QString &checkpointsFolder() {
+  static const QString folder = initCheckpointsFolder();
+  return folder;
+}
+
+//-------------------------------------------------------------------------
+
+void pruneCheckpoints() {
+  static QMutex mutex;
+  static bool pruned = false;
+
+  QMutexLocker locker(&mutex);
+  if (pruned) return;
+  pruned = true;
+
+  QFileInfoList files =
+      QDir(checkpointsFolder())
+          .entryInfoList(QStringList("*.ptc"), QDir::Files, QDir::Time);
+
+  qint64 size = 0;
+  for (int i = 0; i < files.size(); ++i) {
+    size += files[i].size();
+    if (size > maxCacheSize) QFile::remove(files[i].filePath());
+  }
+}
+
+//-------------------------------------------------------------------------
+
+struct CheckpointHeader {
+  qint32 m_frame, m_targetFrame, m_maxTrail;
+};
+
+// Reads the header of a snapshot file, leaving the stream on the state
+bool readHeader(QDataStream &in, CheckpointHeader &header) {
+  qint32 magic, version;
+  in >> magic >> version >> header.m_frame >> header.m_targetFrame >>
+      header.m_maxTrail;
+  return in.status() == QDataStream::Ok && magic == checkpointMagic &&
+         version == checkpointVersion;
+}
+
+}  // namespace
+
+//************************************************************************************************
+//    ParticlesCheckpoints implementation
+//************************************************************************************************
+
+ParticlesCheckpoints::ParticlesCheckpoints(const std::string &seed,
+                                           int startFrame)
+    : m_hash(QCryptographicHash::Sha1), m_startFrame(startFrame) {
+  m_hash.addData(seed.c_str(), (int)seed.size());
+}
+
+//-------------------------------------------------------------------------
+
+bool ParticlesCheckpoints::isEnabled() {
+  return !checkpointsFolder().isEmpty();
+}
+
+//-------------------------------------------------------------------------
+
+std::string ParticlesCheckpoints::getFrameAlias(
+    TFx *fx, double paramFrame,
+    const std::map<int, TRasterFxPort *> &ctrlPorts, double frame,
+    const TRenderSettings &ri) {
+  std::string alias;
+
+  TParamContainer *params = fx->getParams();
+  for (int i = 0; i < params->getParamCount(); ++i) {
+    TParam *param = params->getParam(i);
+    alias += param->getName() + "=" + param->getValueAlias(paramFrame, 3) + ",";
+  }
+
+  std::map<int, TRasterFxPort *>::const_iterator it;
+  for (it = ctrlPorts.begin(); it != ctrlPorts.end(); ++it)
+    if (it->second->isConnected())
+      alias += std::to_string(it->first) + "=" +
+               (*it->second)->getAlias(frame, ri) + ",";
+
+  return alias;
+}
+
+//-------------------------------------------------------------------------
+
+void ParticlesCheckpoints::addFrame(int frame, const std::string &frameAlias) {
+  std::string data = std::to_string(frame) + ":" + frameAlias + ";";
+  m_hash.addData(data.c_str(), (int)data.size());
+
+  // result() leaves the hash open to further data
+  if (isCheckpointFrame(frame)) m_keys[frame] = m_hash.result().toHex();
+}
+
+//-------------------------------------------------------------------------
+
+QString ParticlesCheckpoints::getFilePath(int frame) const {
+  std::map<int, QByteArray>::const_iterator it = m_keys.find(frame);
+  if (it == m_keys.end() || !isEnabled()) return QString();
+
+  return checkpointsFolder() + "/" + QString::fromLatin1(it->second) + ".ptc";
+}
+
+//-------------------------------------------------------------------------
+
+int ParticlesCheckpoints::load(int minFrame, int targetFrame,
+                               QByteArray &state) const {
+  std::map<int, QByteArray>::const_reverse_iterator it;
+  for (it = m_keys.rbegin(); it != m_keys.rend(); ++it) {
+    int frame = it->first;
+    if (frame <= minFrame) break;
+    if (frame > targetFrame) continue;
+
+    QFile file(getFilePath(frame));
+    if (!file.open(QIODevice::ReadOnly)) continue;
+
+    QDataStream in(&file);
+    CheckpointHeader header;
+    if (!readHeader(in, header) || header.m_frame != frame ||
+        header.m_targetFrame > targetFrame ||
+        frame + header.m_maxTrail >= targetFrame)
+      continue;
+
+    QByteArray data;
+    in >> data;
+    if (in.status() != QDataStream::Ok) continue;
+
+    state = qUncompress(data);
+    if (!state.isEmpty()) return frame;
+  }
+
+  return minFrame;
+}
+
+//-------------------------------------------------------------------------
+
+bool ParticlesCheckpoints::needsSave(int frame, int targetFrame) const {
+  if (!isCheckpointFrame(frame)) return false;
+
+  QString filePath = getFilePath(frame);
+  if (filePath.isEmpty()) return false;
+
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) return true;
+
+  QDataStream in(&file);
+  CheckpointHeader header;
+  return !readHeader(in, header) || header.m_targetFrame > targetFrame;
+}
+
+//-------------------------------------------------------------------------
+
+void ParticlesCheckpoints::save(int frame, int targetFrame, int maxTrail,
+                                const QByteArray &state) const {
+  QString filePath = getFilePath(frame);
+  if (filePath.isEmpty()) return;
+
+  pruneCheckpoints();
+
+  // Concurrent renders may save the same snapshot - QSaveFile makes each
+  // write atomic.
+  QSaveFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly)) return;
+
+  QDataStream out(&file);
+  out << checkpointMagic << checkpointVersion << qint32(frame)
+      << qint32(targetFrame) << qint32(maxTrail) << qCompress(state, 1);
+
+  if (out.status() == QDataStream::Ok)
+    file.commit();
+  else
+    file.cancelWriting();
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#ifndef PARTICLES_CHECKPOINTS_H
+#define PARTICLES_CHECKPOINTS_H
+
+#include "trandom.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+#include <map>
+#include <string>
+
+//-----------------------------------------------------------------------
+
+//  Forward declarations
+class TFx;
+class TRasterFxPort;
+class TRenderSettings;
+
+//-----------------------------------------------------------------------
+
+/*
+  ParticlesCheckpoints stores snapshots of a particles simulation on disk, so
+  that a render starting far from the simulation start (e.g. a farm chunk, or
+  a preview after a scene reload) can resume from the latest snapshot instead
+  of rolling every frame again.
+
+  Snapshots are taken every Interval frames. Each one is keyed by a hash of
+  everything the simulation read up to its frame: the caller feeds the key
+  with a seed string (the fx type and its frame-independent inputs) and then
+  with an alias for every rolled frame (parameter values and control images).
+  Changing any input at frame f therefore invalidates the snapshots from f on,
+  while earlier ones stay valid.
+
+  The engines skip the particles that die before the frame being rendered,
+  so a snapshot taken while rendering frame t holds the state required by
+  frames >= t only; its target frame is stored along with it. This is the
+  same reuse rule the in-memory ParticlesManager data follows.
+*/
+
+class ParticlesCheckpoints {
+public:
+  //! Frames between two consecutive snapshots.
+  static const int Interval = 25;
+
+private:
+  QCryptographicHash m_hash;
+  int m_startFrame;
+  std::map<int, QByteArray> m_keys;  //!< Snapshot keys, by frame.
+
+public:
+  ParticlesCheckpoints(const std::string &seed, int startFrame);
+
+  //! Returns false if no snapshot can be stored or read.
+  static bool isEnabled();
+
+  //! Returns the alias of the inputs read by a simulation step: the
+  //! parameters of \b fx at \b paramFrame, and the control images at
+  //! \b frame.
+  static std::string getFrameAlias(
+      TFx *fx, double paramFrame,
+      const std::map<int, TRasterFxPort *> &ctrlPorts, double frame,
+      const TRenderSettings &ri);
+
+  //! Adds the inputs of the next frame (in increasing order) to the key.
+  void addFrame(int frame, const std::string &frameAlias);
+
+  bool isCheckpointFrame(int frame) const {
+    return frame > m_startFrame && (frame - m_startFrame) % Interval == 0;
+  }
+
+  /*!
+    Looks for the latest snapshot after \b minFrame usable to render \b
+    targetFrame, and returns its frame and data - or a frame <= minFrame if
+    none was found. Snapshots whose particles have trails reaching back to
+    their own frame are not usable, since the frames before the snapshot are
+    not rolled.
+  */
+  int load(int minFrame, int targetFrame, QByteArray &state) const;
+
+  //! Returns whether the snapshot at \b frame is missing, or not usable to
+  //! render \b targetFrame.
+  bool needsSave(int frame, int targetFrame) const;
+  //! Saves a snapshot; \b maxTrail is the longest trail of its particles.
+  void save(int frame, int targetFrame, int maxTrail,
+            const QByteArray &state) const;
+
+private:
+  QString getFilePath(int frame) const;
+};
+
+//-----------------------------------------------------------------------
+
+//! Writes the fields of a simulation state, one call per field.
+class ParticlesStateWriter {
+  QDataStream &m_out;
+
+public:
+  ParticlesStateWriter(QDataStream &out) : m_out(out) {}
+
+  void operator()(bool &v) { m_out << v; }
+  void operator()(unsigned char &v) { m_out << v; }
+  void operator()(short &v) { m_out << qint16(v); }
+  void operator()(int &v) { m_out << qint32(v); }
+  void operator()(float &v) { m_out << v; }
+  void operator()(double &v) { m_out << v; }
+  void operator()(TRandom &r) {
+    UINT state[TRandom::StateSize];
+    r.getState(state);
+    for (int i = 0; i < TRandom::StateSize; ++i) m_out << quint32(state[i]);
+  }
+};
+
+//-----------------------------------------------------------------------
+
+//! Reads back the fields written by ParticlesStateWriter.
+class ParticlesStateReader {
+  QDataStream &m_in;
+
+public:
+  ParticlesStateReader(QDataStream &in) : m_in(in) {}
+
+  bool isOk() const { return m_in.status() == QDataStream::Ok; }
+
+  void operator()(bool &v) { m_in >> v; }
+  void operator()(unsigned char &v) { m_in >> v; }
+  void operator()(short &v) {
+    qint16 i;
+    m_in >> i;
+    v = i;
+  }
+  void operator()(int &v) {
+    qint32 i;
+    m_in >> i;
+    v = i;
+  }
+  void operator()(float &v) { m_in >> v; }
+  void operator()(double &v) { m_in >> v; }
+  void operator()(TRandom &r) {
+    UINT state[TRandom::StateSize];
+    for (int i = 0; i < TRandom::StateSize; ++i) {
+      quint32 u;
+      m_in >> u;
+      state[i] = u;
+    }
+    r.setState(state);
+  }
+};
+
+//-----------------------------------------------------------------------
+
+//! Reads or writes a particle color, with a ParticlesStateWriter or
+//! ParticlesStateReader.
+template <class Stream, class ColData>
+void ioColData(Stream &s, ColData &c) {
+  s(c.col.r);
+  s(c.col.g);
+  s(c.col.b);
+  s(c.col.m);
+  s(c.rangecol);
+  s(c.fadecol);
+}
+
+//! Reads or writes the fields shared by the particles of both engines.
+template <class Stream, class ParticleT>
+void ioParticleFields(Stream &s, ParticleT &p) {
+  s(p.x);
+  s(p.y);
+  s(p.oldx);
+  s(p.oldy);
+  s(p.vx);
+  s(p.vy);
+  s(p.mass);
+  s(p.scale);
+  s(p.angle);
+  s(p.smswingx);
+  s(p.smswingy);
+  s(p.smswinga);
+  s(p.smperiodx);
+  s(p.smperiody);
+  s(p.smperioda);
+  s(p.lifetime);
+  s(p.genlifetime);
+  s(p.level);
+  s(p.frame);
+  s(p.signx);
+  s(p.trail);
+  ioColData(s, p.gencol);
+  ioColData(s, p.fincol);
+  ioColData(s, p.foutcol);
+  s(p.changesignx);
+  s(p.signy);
+  s(p.changesigny);
+  s(p.signa);
+  s(p.changesigna);
+  s(p.animswing);
+  s(p.random);
+  s(p.seed);
+}
+
+#endif
@@ -20,15 +20,131 @@
 #include "toonz/tcolumnfx.h"
 
 #include "particlesmanager.h"
+#include "particlescheckpoints.h"
 
 #include "particlesengine.h"
 
 #include "trenderer.h"
+#include "tthread.h"
 
+#include <algorithm>
+#include <memory>
 #include <sstream>
 
 /*-----------------------------------------------------------------*/
 
+namespace {
+
+QByteArray saveParticlesState(std::list<Particle> &particles, TRandom &random,
+                              int totalParticles) {
+  QByteArray state;
+  QDataStream out(&state, QIODevice::WriteOnly);
+  ParticlesStateWriter writer(out);
+
+  int count = (int)particles.size();
+  writer(count);
+  writer(random);
+  writer(totalParticles);
+
+  std::list<Particle>::iterator it;
+  for (it = particles.begin(); it != particles.end(); ++it)
+    ioParticleFields(writer, *it);
+
+  return state;
+}
+
+bool loadParticlesState(const QByteArray &state,
+                        std::list<Particle> &particles, TRandom &random,
+                        int &totalParticles) {
+  QDataStream in(state);
+  ParticlesStateReader reader(in);
+
+  int count = 0, total = 0;
+  TRandom rnd;
+  reader(count);
+  reader(rnd);
+  reader(total);
+  if (!reader.isOk() || count < 0) return false;
+
+  std::list<Particle> loaded;
+  for (int i = 0; i < count && reader.isOk(); ++i) {
+    loaded.push_back(Particle());
+    ioParticleFields(reader, loaded.back());
+  }
+  if (!reader.isOk()) return false;
+
+  particles.swap(loaded);
+  random         = rnd;
+  totalParticles = total;
+  return true;
+}
+
+// Particles moved per task, see Particles_Engine::roll_particles()
+const int MoveChunkSize = 256;
+// Particles drawn per batch, see Particles_Engine::splat_particles()
+const int SplatBatchSize = 1024;
+// Rows of the output tile drawn per task
+const int SplatBandHeight = 32;
+
+// Applies the particle's current colors and opacity to its texture, and
+// transforms it to the output reference as TRop::over() would
+void prepareSplat(ParticleSplat &splat,
+                  const std::map<int, TTile *> &porttiles,
+                  const particles_values &values, double opacity_range,
+                  int dist_frame, const TRect &tileBounds) {
+  Particle *part = splat.m_part;
+
+  // Deal with particle colors/opacity
+  TRaster32P rfinalpart;
+  double curr_opacity =
+      part->set_Opacity(porttiles, values, opacity_range, dist_frame);
+  bool modifyColors = curr_opacity != 1.0 || part->gencol.fadecol ||
+                      part->fincol.fadecol || part->foutcol.fadecol;
+  if (modifyColors) {
+    /*- 毎フレーム現在位置のピクセル色を参照 -*/
+    std::map<int, TTile *>::const_iterator it =
+        porttiles.find(values.gencol_ctrl_val);
+    if (values.pick_color_for_every_frame_val && values.gencol_ctrl_val &&
+        it != porttiles.end())
+      part->get_image_reference(it->second, values, part->gencol.col);
+  }
+
+  TRect rasterBounds = splat.m_texture->getBounds();
+  TRectD dbounds(rasterBounds.x0, rasterBounds.y0, rasterBounds.x1 + 1,
+                 rasterBounds.y1 + 1);
+  dbounds = splat.m_aff * dbounds;
+  TRect bounds(tfloor(dbounds.x0), tfloor(dbounds.y0), tceil(dbounds.x1) - 1,
+               tceil(dbounds.y1) - 1);
+  if (!bounds.overlaps(tileBounds)) return;
+
+  if (modifyColors) {
+    rfinalpart = splat.m_texture->clone();
+    part->modify_colors_and_opacity(values, curr_opacity, dist_frame,
+                                    rfinalpart);
+  } else
+    rfinalpart = splat.m_texture;
+
+  // For now, we'll just use 32 bit particles
+  if (!rfinalpart) return;
+
+  splat.m_raster = rfinalpart->create(bounds.getLx(), bounds.getLy());
+  TRop::resample(splat.m_raster, rfinalpart,
+                 TTranslation(-bounds.x0, -bounds.y0) * splat.m_aff);
+  splat.m_pos = bounds.getP00();
+}
+
+int getMaxTrail(const std::list<Particle> &particles) {
+  int maxTrail = 0;
+  std::list<Particle>::const_iterator it;
+  for (it = particles.begin(); it != particles.end(); ++it)
+    maxTrail = std::max(maxTrail, it->trail);
+  return maxTrail;
+}
+
+}  // namespace
+
+/*-----------------------------------------------------------------*/
+
 Particles_Engine::Particles_Engine(ParticlesFx *parent, double frame)
     : m_parent(parent), m_frame(frame) {}
 
@@ -273,6 +389,9 @@ void Particles_Engine::roll_particles(
       totalparticles++;
     }
   } else {
+    std::vector<Particle *> movingParticles;
+    movingParticles.reserve(myParticles.size());
+
     std::list<Particle>::iterator it;
     for (it = myParticles.begin(); it != myParticles.end();) {
       std::list<Particle>::iterator current = it;
@@ -283,10 +402,22 @@ void Particles_Engine::roll_particles(
                                      // "lifetime>curr_frame-frame"
         myParticles.erase(current);  // insertion counterpart
       else
-        part.move(porttiles, values, ranges, windx, windy, xgravity, ygravity,
-                  dpi, lastframe[part.level]);
+        movingParticles.push_back(&part);
     }
 
+    // Each particle draws from its own random generator, so particles move
+    // independently of each other
+    TThread::parallelFor(
+        0, (int)movingParticles.size(),
+        [&](int i0, int i1) {
+          for (int i = i0; i < i1; ++i) {
+            Particle &part = *movingParticles[i];
+            part.move(porttiles, values, ranges, windx, windy, xgravity,
+                      ygravity, dpi, lastframe[part.level]);
+          }
+        },
+        MoveChunkSize);
+
     int oldparticles = myParticles.size();
     switch (values.toplayer_val) {
     case ParticlesFx::TOP_YOUNGER:
@@ -465,6 +596,54 @@ void Particles_Engine::render_particles(
     myRandom       = particlesData->m_random;
     totalparticles = particlesData->m_totalParticles;
   }
+
+  // Far from the last rolled frame, look for a snapshot on disk. Control
+  // images are computed in the output tile's reference when their bbox is
+  // infinite, so the tile is part of the key when they are connected.
+  std::unique_ptr<ParticlesCheckpoints> checkpoints;
+  if (ParticlesCheckpoints::isEnabled() &&
+      curr_frame - std::max(pcFrame, startframe - 1) >
+          ParticlesCheckpoints::Interval) {
+    std::ostringstream seed;
+    seed.precision(12);
+    seed << m_parent->getFxType() << ";" << startframe << ";"
+         << values.step_val << ";" << shrink << ";" << level_n << ";";
+    for (int i = 0; i < (int)last_frame.size(); ++i)
+      seed << last_frame[i] << ",";
+
+    bool ctrlConnected = false;
+    std::map<int, TRasterFxPort *>::iterator it;
+    for (it = ctrl_ports.begin(); it != ctrl_ports.end(); ++it)
+      if (it->second->isConnected()) ctrlConnected = true;
+
+    if (ctrlConnected) {
+      const TAffine &aff = ri.m_affine;
+      seed << ";" << tile->m_pos.x << "," << tile->m_pos.y << ","
+           << tile->getRaster()->getLx() << "," << tile->getRaster()->getLy()
+           << ";" << aff.a11 << "," << aff.a12 << "," << aff.a13 << ","
+           << aff.a21 << "," << aff.a22 << "," << aff.a23;
+    }
+
+    checkpoints.reset(new ParticlesCheckpoints(seed.str(), startframe - 1));
+
+    TRenderSettings riAux(ri);
+    riAux.m_affine = TAffine();
+    riAux.m_bpp    = 32;
+
+    for (frame = startframe - 1; frame <= curr_frame; ++frame)
+      checkpoints->addFrame(
+          frame, ParticlesCheckpoints::getFrameAlias(
+                     m_parent, frame < 0 ? 0 : frame * values.step_val,
+                     ctrl_ports, std::max(frame, 0), riAux));
+
+    QByteArray state;
+    int cpFrame = checkpoints->load(std::max(pcFrame, startframe - 1),
+                                    curr_frame, state);
+    if (cpFrame > pcFrame &&
+        loadParticlesState(state, myParticles, myRandom, totalparticles))
+      pcFrame = cpFrame;
+  }
+
   /*- スタートからカレントフレームまでループ -*/
   for (frame = startframe - 1; frame <= curr_frame; ++frame) {
     int dist_frame = curr_frame - frame;
@@ -585,6 +764,11 @@ void Particles_Engine::render_particles(
         particlesData->m_calculated     = true;
         particlesData->m_totalParticles = totalparticles;
       }
+
+      if (checkpoints && checkpoints->needsSave(frame, curr_frame))
+        checkpoints->save(
+            frame, curr_frame, getMaxTrail(myParticles),
+            saveParticlesState(myParticles, myRandom, totalparticles));
     }
 
     // Render the particles if the distance from current frame is a trail
@@ -612,6 +796,9 @@ void Particles_Engine::render_particles(
           values.toplayer_val == ParticlesFx::TOP_BIGGER)
         myParticles.sort(ComparebySize());
 
+      std::map<std::pair<int, int>, ParticleTexture> textures;
+      std::vector<ParticleSplat> splats;
+
       if (values.toplayer_val == ParticlesFx::TOP_SMALLER) {
         std::list<Particle>::iterator pt;
         for (pt = myParticles.begin(); pt != myParticles.end(); ++pt) {
@@ -620,9 +807,8 @@ void Particles_Engine::render_particles(
               part.lifetime <=
                   part.genlifetime)  // This last... shouldn't always be?
           {
-            do_render(&part, tile, part_ports, porttiles, ri, p_size, p_offset,
-                      last_frame[part.level], partLevel, values, opacity_range,
-                      dist_frame, partScales);
+            do_render(&part, tile, part_ports, ri, last_frame[part.level],
+                      partLevel, values, partScales, textures, splats);
           }
         }
       } else {
@@ -632,12 +818,14 @@ void Particles_Engine::render_particles(
           if (dist_frame <= part.trail && part.scale && part.lifetime > 0 &&
               part.lifetime <= part.genlifetime)  // Same here..?
           {
-            do_render(&part, tile, part_ports, porttiles, ri, p_size, p_offset,
-                      last_frame[part.level], partLevel, values, opacity_range,
-                      dist_frame, partScales);
+            do_render(&part, tile, part_ports, ri, last_frame[part.level],
+                      partLevel, values, partScales, textures, splats);
           }
         }
       }
+
+      splat_particles(tile, splats, porttiles, values, opacity_range,
+                      dist_frame);
     }
 
     std::map<int, TTile *>::iterator it;
@@ -646,50 +834,24 @@ void Particles_Engine::render_particles(
 }
 
 //-----------------------------------------------------------------
-/*- render_particles から呼ばれる。粒子の数だけ繰り返し -*/
-void Particles_Engine::do_render(
-    Particle *part, TTile *tile, std::vector<TRasterFxPort *> part_ports,
-    std::map<int, TTile *> porttiles, const TRenderSettings &ri,
-    TDimension &p_size, TPointD &p_offset, int lastframe,
-    std::vector<TLevelP> partLevel, struct particles_values &values,
-    double opacity_range, int dist_frame,
-    std::map<std::pair<int, int>, double> &partScales) {
-  // Retrieve the particle frame - that is, the *column frame* from which we are
-  // picking
-  // the particle to be rendered.
-  int ndx = part->frame % lastframe;
-
-  TRasterP tileRas(tile->getRaster());
-
-  std::string levelid;
-  double aim_angle = 0;
-  if (values.pathaim_val) {
-    double arctan = atan2(part->vy, part->vx);
-    aim_angle     = arctan * M_180_PI;
-  }
 
-  // Calculate the rotational and scale components we have to apply on the
-  // particle
-  TRotation rotM(part->angle + aim_angle);
-  TScale scaleM(part->scale);
-  TAffine M(rotM * scaleM);
+ParticleTexture Particles_Engine::build_texture(
+    int level, int ndx, TTile *tile,
+    const std::vector<TRasterFxPort *> &part_ports, const TRenderSettings &ri,
+    const std::vector<TLevelP> &partLevel, double partScale) {
+  ParticleTexture texture;
 
-  // Particles deal with dpi affines on their own
-  TAffine scaleAff(m_parent->handledAffine(ri, m_frame));
-  double partScale =
-      scaleAff.a11 * partScales[std::pair<int, int>(part->level, ndx)];
   TDimensionD partResolution(0, 0);
   TRenderSettings riNew(ri);
 
   // Retrieve the bounding box in the standard reference
   TRectD bbox(-5.0, -5.0, 5.0, 5.0), standardRefBBox;
-  if (part->level <
-          (int)part_ports.size() &&  // Not the default levelless cases
-      part_ports[part->level]->isConnected()) {
+  if (level < (int)part_ports.size() &&  // Not the default levelless cases
+      part_ports[level]->isConnected()) {
     TRenderSettings riIdentity(ri);
     riIdentity.m_affine = TAffine();
 
-    (*part_ports[part->level])->getBBox(ndx, bbox, riIdentity);
+    (*part_ports[level])->getBBox(ndx, bbox, riIdentity);
 
     // A particle's bbox MUST be finite. Gradients and such which have an
     // infinite bbox
@@ -699,7 +861,7 @@ void Particles_Engine::do_render(
     // either
     // (std::numeric_limits<double>::max)() or its opposite, then the rect IS
     // THE infiniteRectD)
-    if (bbox.isEmpty() || bbox == TConsts::infiniteRectD) return;
+    if (bbox.isEmpty() || bbox == TConsts::infiniteRectD) return texture;
   }
 
   // Now, these are the particle rendering specifications
@@ -714,11 +876,11 @@ void Particles_Engine::do_render(
 
   std::string alias;
   TRasterImageP rimg;
-  rimg = partLevel[part->level]->frame(ndx);
+  rimg = partLevel[level]->frame(ndx);
   if (rimg) {
     ras = rimg->getRaster();
   } else {
-    alias = "PART: " + (*part_ports[part->level])->getAlias(ndx, riNew);
+    alias = "PART: " + (*part_ports[level])->getAlias(ndx, riNew);
     rimg  = TImageCache::instance()->get(alias, false);
     if (rimg) {
       ras = rimg->getRaster();
@@ -744,7 +906,7 @@ void Particles_Engine::do_render(
   // calculate it
   if (!ras) {
     TTile auxTile;
-    (*part_ports[part->level])
+    (*part_ports[level])
         ->allocateAndCompute(auxTile, bbox.getP00(),
                              TDimension(partResolution.lx, partResolution.ly),
                              tile->getRaster(), ndx, riNew);
@@ -763,25 +925,57 @@ void Particles_Engine::do_render(
     addRenderCache(alias, TRasterImageP(ras));
   }
 
-  if (!ras) return;  // At this point, it should never happen anyway...
+  texture.m_raster = ras;
+  texture.m_scale  = partScale;
+  texture.m_offset = bbox.getP00();
+  return texture;
+}
 
-  // Deal with particle colors/opacity
-  TRaster32P rfinalpart;
-  double curr_opacity =
-      part->set_Opacity(porttiles, values, opacity_range, dist_frame);
-  if (curr_opacity != 1.0 || part->gencol.fadecol || part->fincol.fadecol ||
-      part->foutcol.fadecol) {
-    /*- 毎フレーム現在位置のピクセル色を参照 -*/
-    if (values.pick_color_for_every_frame_val && values.gencol_ctrl_val &&
-        (porttiles.find(values.gencol_ctrl_val) != porttiles.end()))
-      part->get_image_reference(porttiles[values.gencol_ctrl_val], values,
-                                part->gencol.col);
+//-----------------------------------------------------------------
+/*- render_particles から呼ばれる。粒子の数だけ繰り返し -*/
+void Particles_Engine::do_render(
+    Particle *part, TTile *tile, const std::vector<TRasterFxPort *> &part_ports,
+    const TRenderSettings &ri, int lastframe,
+    const std::vector<TLevelP> &partLevel, struct particles_values &values,
+    std::map<std::pair<int, int>, double> &partScales,
+    std::map<std::pair<int, int>, ParticleTexture> &textures,
+    std::vector<ParticleSplat> &splats) {
+  // Retrieve the particle frame - that is, the *column frame* from which we are
+  // picking
+  // the particle to be rendered.
+  int ndx = part->frame % lastframe;
 
-    rfinalpart = ras->clone();
-    part->modify_colors_and_opacity(values, curr_opacity, dist_frame,
-                                    rfinalpart);
-  } else
-    rfinalpart = ras;
+  // The texture only depends on the level frame, so it is built once for all
+  // the particles sharing it
+  std::pair<int, int> ndxPair(part->level, ndx);
+  std::map<std::pair<int, int>, ParticleTexture>::iterator tt =
+      textures.find(ndxPair);
+  if (tt == textures.end()) {
+    // Particles deal with dpi affines on their own
+    TAffine scaleAff(m_parent->handledAffine(ri, m_frame));
+    double partScale = scaleAff.a11 * partScales[ndxPair];
+
+    tt = textures
+             .insert(std::make_pair(
+                 ndxPair, build_texture(part->level, ndx, tile, part_ports, ri,
+                                        partLevel, partScale)))
+             .first;
+  }
+
+  const ParticleTexture &texture = tt->second;
+  if (!texture.m_raster) return;
+
+  double aim_angle = 0;
+  if (values.pathaim_val) {
+    double arctan = atan2(part->vy, part->vx);
+    aim_angle     = arctan * M_180_PI;
+  }
+
+  // Calculate the rotational and scale components we have to apply on the
+  // particle
+  TRotation rotM(part->angle + aim_angle);
+  TScale scaleM(part->scale);
+  TAffine M(rotM * scaleM);
 
   // Now, let's build the particle transform before it is overed on the output
   // tile
@@ -789,7 +983,7 @@ void Particles_Engine::do_render(
   // First, complete the transform by adding the rotational and scale
   // components from
   // Particles parameters
-  M = ri.m_affine * M * TScale(1.0 / partScale);
+  M = ri.m_affine * M * TScale(1.0 / texture.m_scale);
 
   // Then, retrieve the particle position in current reference.
   TPointD pos(part->x, part->y);
@@ -798,14 +992,56 @@ void Particles_Engine::do_render(
   // Finally, add the translational component to the particle
   // NOTE: p_offset is added to account for the particle relative position
   // inside its level's bbox
-  M = TTranslation(pos - tile->m_pos) * M * TTranslation(bbox.getP00());
+  M = TTranslation(pos - tile->m_pos) * M * TTranslation(texture.m_offset);
 
-  if (TRaster32P myras32 = tile->getRaster())
-    TRop::over(tileRas, rfinalpart, M);
-  else if (TRaster64P myras64 = tile->getRaster())
-    TRop::over(tileRas, rfinalpart, M);
-  else
+  ParticleSplat splat;
+  splat.m_part    = part;
+  splat.m_texture = texture.m_raster;
+  splat.m_aff     = M;
+  splats.push_back(splat);
+}
+
+//-----------------------------------------------------------------
+
+void Particles_Engine::splat_particles(TTile *tile,
+                                       std::vector<ParticleSplat> &splats,
+                                       const std::map<int, TTile *> &porttiles,
+                                       const struct particles_values &values,
+                                       double opacity_range, int dist_frame) {
+  TRasterP tileRas(tile->getRaster());
+  if (!TRaster32P(tileRas) && !TRaster64P(tileRas))
     throw TException("ParticlesFx: unsupported Pixel Type");
+
+  TRect tileBounds(tileRas->getBounds());
+  int splatCount = (int)splats.size();
+
+  // Batches bound the memory taken by the transformed particles
+  for (int b0 = 0; b0 < splatCount; b0 += SplatBatchSize) {
+    int b1 = std::min(b0 + SplatBatchSize, splatCount);
+
+    // Particles are colored and transformed independently of each other
+    TThread::parallelFor(b0, b1, [&](int i0, int i1) {
+      for (int i = i0; i < i1; ++i)
+        prepareSplat(splats[i], porttiles, values, opacity_range, dist_frame,
+                     tileBounds);
+    });
+
+    // A tile pixel depends only on the particles drawn over it, so bands of
+    // the tile are drawn concurrently, each band drawing the whole batch in
+    // order
+    TThread::parallelFor(
+        0, tileRas->getLy(),
+        [&](int y0, int y1) {
+          TRasterP band = tileRas->extract(0, y0, tileRas->getLx() - 1, y1 - 1);
+          for (int i = b0; i < b1; ++i)
+            if (splats[i].m_raster)
+              TRop::over(band, splats[i].m_raster,
+                         splats[i].m_pos - TPoint(0, y0));
+        },
+        SplatBandHeight);
+
+    for (int i = b0; i < b1; ++i) splats[i].m_raster = TRasterP();
+  }
 }
 
 /*-----------------------------------------------------------------*/
@@ -9,6 +9,23 @@
 
 class Particle;
 
+//! The drawing specifications of a particle texture, shared by all the
+//! particles showing the same level frame in a render pass.
+struct ParticleTexture {
+  TRasterP m_raster;  //!< Null if the frame cannot be drawn.
+  double m_scale;     //!< Scale of m_raster relative to the level frame.
+  TPointD m_offset;   //!< Bottom-left corner of m_raster, at m_scale.
+};
+
+//! A particle queued for drawing on the output tile.
+struct ParticleSplat {
+  Particle *m_part;
+  TRasterP m_texture;
+  TAffine m_aff;      //!< Texture to output tile transform.
+  TRasterP m_raster;  //!< The colored, transformed particle.
+  TPoint m_pos;       //!< Position of m_raster on the output tile.
+};
+
 class Particles_Engine {
 public:
   ParticlesFx *m_parent;
@@ -42,14 +59,26 @@ public:
                         double starty, double endx, double endy,
                         std::vector<int> lastframe, unsigned long fxId);
 
+  ParticleTexture build_texture(int level, int ndx, TTile *tile,
+                                const std::vector<TRasterFxPort *> &part_ports,
+                                const TRenderSettings &ri,
+                                const std::vector<TLevelP> &partLevel,
+                                double partScale);
+
+  //! Queues a particle for drawing - splat_particles() draws the queue.
   void do_render(Particle *part, TTile *tile,
-                 std::vector<TRasterFxPort *> part_ports,
-                 std::map<int, TTile *> porttiles, const TRenderSettings &ri,
-                 TDimension &p_size, TPointD &p_offset, int lastframe,
-                 std::vector<TLevelP> partLevel,
-                 struct particles_values &values, double opacity_range,
-                 int curr_frame,
-                 std::map<std::pair<int, int>, double> &partScales);
+                 const std::vector<TRasterFxPort *> &part_ports,
+                 const TRenderSettings &ri, int lastframe,
+                 const std::vector<TLevelP> &partLevel,
+                 struct particles_values &values,
+                 std::map<std::pair<int, int>, double> &partScales,
+                 std::map<std::pair<int, int>, ParticleTexture> &textures,
+                 std::vector<ParticleSplat> &splats);
+
+  void splat_particles(TTile *tile, std::vector<ParticleSplat> &splats,
+                       const std::map<int, TTile *> &porttiles,
+                       const struct particles_values &values,
+                       double opacity_range, int dist_frame);
 
   bool port_is_used(int i, struct particles_values &values);
 
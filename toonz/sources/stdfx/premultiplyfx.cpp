@@ -27,6 +27,12 @@ public:
   bool canHandle(const TRenderSettings &info, double frame) override {
     return true;
   }
+
+  bool isPointwise() const override { return true; }
+  void computePixels(const TRasterP &ras, double frame,
+                     const TRenderSettings &ri) override {
+    TRop::premultiply(ras);
+  }
 };
 
 //------------------------------------------------------------------------------
@@ -36,8 +42,7 @@ void PremultiplyFx::doCompute(TTile &tile, double frame,
   if (!m_input.isConnected()) return;
 
   m_input->compute(tile, frame, ri);
-
-  TRop::premultiply(tile.getRaster());
+  computePixels(tile.getRaster(), frame, ri);
 }
 
 FX_PLUGIN_IDENTIFIER(PremultiplyFx, "premultiplyFx");
@@ -43,6 +43,10 @@ public:
   bool canHandle(const TRenderSettings &info, double frame) override {
     return true;
   }
+
+  bool isPointwise() const override { return true; }
+  void computePixels(const TRasterP &ras, double frame,
+                     const TRenderSettings &ri) override;
 };
 
 //------------------------------------------------------------------------------
@@ -52,6 +56,13 @@ void RGBMScaleFx::doCompute(TTile &tile, double frame,
   if (!m_input.isConnected()) return;
   m_input->compute(tile, frame, ri);
 
+  computePixels(tile.getRaster(), frame, ri);
+}
+
+//------------------------------------------------------------------------------
+
+void RGBMScaleFx::computePixels(const TRasterP &ras, double frame,
+                                const TRenderSettings &ri) {
   double red   = m_red->getValue(frame) / 100;
   double green = m_green->getValue(frame) / 100;
   double blue  = m_blue->getValue(frame) / 100;
@@ -60,7 +71,7 @@ void RGBMScaleFx::doCompute(TTile &tile, double frame,
   // TRaster32P raster32 = tile.getRaster();
   // assert(raster32); // per ora gestisco solo i Raster32
 
-  TRop::rgbmScale(tile.getRaster(), tile.getRaster(), red, green, blue, matte);
+  TRop::rgbmScale(ras, ras, red, green, blue, matte);
 }
 
 FX_PLUGIN_IDENTIFIER(RGBMScaleFx, "rgbmScaleFx");
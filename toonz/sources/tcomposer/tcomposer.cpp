@@ -50,6 +50,9 @@
 #include "tunit.h"
 #include "tenv.h"
 #include "tpassivecachemanager.h"
+#include "trenderprofiler.h"
+#include "trenderer.h"
+#include "ttilepool.h"
 //#include "tcacheresourcepool.h"
 
 // TnzCore includes
@@ -271,7 +274,8 @@ public:
       , m_frameCompletedCount(0)
       , m_frameFailedCount(0)
       , m_renderCompleted(renderCompleted)
-      , m_stereo(stereo) {}
+      , m_stereo(stereo)
+      , m_renderer(0) {}
 
   bool onFrameCompleted(int frame) override;
   bool onFrameFailed(int frame, TException &e) override;
@@ -283,6 +287,7 @@ public:
   int m_frameFailedCount;
   QWaitCondition &m_renderCompleted;
   bool m_stereo;
+  TRenderer *m_renderer;  //!< Reports memory usage, when budgeted
 };
 
 //==================================================================================
@@ -295,6 +300,14 @@ bool MyMovieRenderListener::onFrameCompleted(int frame) {
           ::to_string(fp.withName(fp.getName() + "_r")) + " computed";
   else
     msg = ::to_string(fp) + " computed";
+
+  if (m_renderer && m_renderer->getMemoryBudget() > 0)
+    msg += " (memory in use: " + std::to_string(m_renderer->getMemoryInUse()) +
+           " of " + std::to_string(m_renderer->getMemoryBudget()) +
+           " MB budget, " +
+           std::to_string(TSystem::getFreeMemorySize(true) >> 10) +
+           " MB free)";
+
   cout << msg << endl;
   m_userLog->info(msg);
   DVGui::info(QString::fromStdString(msg));
@@ -431,7 +444,9 @@ bool MyMultimediaRenderListener::onFrameFailed(int frame, int column,
 
 static std::pair<int, int> generateMovie(ToonzScene *scene, const TFilePath &fp,
                                          int r0, int r1, int step, int shrink,
-                                         int threadCount, int maxTileSize) {
+                                         int threadCount, int maxTileSize,
+                                         int memoryBudget,
+                                         const TFilePath &frameKeysFolder) {
   QWaitCondition renderCompleted;
 
   // riporto gli indici a base zero
@@ -538,11 +553,14 @@ static std::pair<int, int> generateMovie(ToonzScene *scene, const TFilePath &fp,
     movieRenderer.setDpi(cameraXDpi, cameraYDpi);
 
     movieRenderer.enablePrecomputing(true);
+    movieRenderer.setFrameKeysFolder(frameKeysFolder);
+    movieRenderer.getTRenderer()->setMemoryBudget(memoryBudget);
 
     MyMovieRenderListener *listener =
         new MyMovieRenderListener(fp, tceil((numFrames) / (float)step),
                                   renderCompleted, rs.m_stereoscopic);
 
+    listener->m_renderer = movieRenderer.getTRenderer();
     movieRenderer.addListener(listener);
 
     for (int i = 0; i < numFrames; i += step, r += stepd) {
@@ -574,6 +592,14 @@ static std::pair<int, int> generateMovie(ToonzScene *scene, const TFilePath &fp,
 
     //----------------- tcomposer's main thread loops here ----------------
 
+    int duplicateFrames = movieRenderer.getDuplicateFramesCount();
+    if (duplicateFrames > 0) {
+      msg = std::to_string(duplicateFrames) +
+            " duplicate frames reused instead of rendered";
+      cout << msg << endl;
+      m_userLog->info(msg);
+    }
+
     // int frameCompleted = listener->m_frameCompletedCount;
     std::pair<int, int> framePair =
         std::make_pair(listener->m_frameCompletedCount, listener->m_frameCount);
@@ -612,9 +638,24 @@ int main(int argc, char *argv[]) {
   StringQualifier nthreads("-nthreads n", "Number of rendering threads");
   StringQualifier tileSize("-maxtilesize n",
                            "Enable tile rendering of max n MB per tile");
+  SimpleQualifier noFxOpt("-nofxopt",
+                          "Render the fx trees without optimizing them");
+  SimpleQualifier noTilePoolOpt(
+      "-notilepool", "Allocate the fx tiles without recycling them (debug)");
+  FilePathQualifier profileOpt(
+      "-profile traceFile",
+      "Write a per-fx render profile to traceFile (Chrome trace format)");
+  IntQualifier memoryBudgetOpt(
+      "-memorybudget n",
+      "Render only as many frames concurrently as fit in n MB");
+  FilePathQualifier frameKeysOpt(
+      "-framekeys folder",
+      "Reuse frames already rendered with the same content, among the renders "
+      "sharing folder");
   StringQualifier tmsg("-tmsg val", "only internal use");
   usageLine = srcName + dstName + range + stepOpt + shrinkOpt + multimedia +
-              farmData + idq + nthreads + tileSize + tmsg;
+              farmData + idq + nthreads + tileSize + memoryBudgetOpt + noFxOpt +
+              noTilePoolOpt + profileOpt + frameKeysOpt + tmsg;
 
   // system path qualifiers
   std::map<QString, std::unique_ptr<TCli::QualifierT<TFilePath>>>
@@ -972,6 +1013,31 @@ int main(int argc, char *argv[]) {
       maxTileSize          = maxTileSizes[maxTileSizeIndex];
     }
 
+    // Retrieve the memory budget of concurrently rendered frames
+    int memoryBudget = 0;
+    if (memoryBudgetOpt.isSelected()) {
+      memoryBudget = memoryBudgetOpt.getValue();
+
+      if (memoryBudget <= 0) {
+        cout << "Qualifier 'memorybudget': bad input" << endl;
+        exit(1);
+      }
+    }
+
+    // Unoptimized fx trees allow comparing the outputs and timings
+    if (noFxOpt.isSelected()) {
+      enableSceneFxOptimization(false);
+      m_userLog->info("Fx trees optimization disabled");
+    }
+
+    // Recycled tiles make buffer ownership issues harder to track down
+    if (noTilePoolOpt.isSelected()) {
+      TTilePool::instance()->enable(false);
+      m_userLog->info("Fx tiles pool disabled");
+    }
+
+    if (profileOpt.isSelected()) TRenderProfiler::instance()->enable(true);
+
     m_userLog->info("Threads count: " + std::to_string(threadCount));
     if (maxTileSize != (std::numeric_limits<int>::max)())
       m_userLog->info("Render tile: " + std::to_string(maxTileSize));
@@ -1000,8 +1066,10 @@ int main(int argc, char *argv[]) {
 #endif
 #endif
 
-    framePair = generateMovie(scene, theDstFilePath, r0, r1, step, shrink,
-                              threadCount, maxTileSize);
+    framePair = generateMovie(
+        scene, theDstFilePath, r0, r1, step, shrink, threadCount, maxTileSize,
+        memoryBudget,
+        frameKeysOpt.isSelected() ? frameKeysOpt.getValue() : TFilePath());
 
     Sw1.stop();
 
@@ -1014,6 +1082,15 @@ int main(int argc, char *argv[]) {
         std::to_string(TBigMemoryManager::instance()->getAllocationMean()) +
         " KB");
 
+    if (TTilePool::instance()->isEnabled()) {
+      TTilePool::Statistics poolStats = TTilePool::instance()->getStatistics();
+      m_userLog->info("Fx Tiles Recycled: " +
+                      std::to_string(poolStats.m_recycled) + " of " +
+                      std::to_string(poolStats.m_requests));
+      m_userLog->info("Fx Tiles Pool Peak: " +
+                      std::to_string(poolStats.m_peakResidentKb) + " KB");
+    }
+
     msg = "Compositing completed in " +
           ::to_string(Sw1.getTotalTime() / 1000.0, 2) + " seconds";
     string msg2 =
@@ -1025,6 +1102,22 @@ int main(int argc, char *argv[]) {
         " seconds spent on rendering" + "\n";
     cout << msg + msg2;
     m_userLog->info(msg + msg2);
+
+    if (profileOpt.isSelected()) {
+      TRenderProfiler *profiler = TRenderProfiler::instance();
+      profiler->enable(false);
+
+      TFilePath traceFp = profileOpt.getValue();
+      if (profiler->exportTrace(traceFp))
+        m_userLog->info("Render profile saved to " + ::to_string(traceFp));
+      else
+        m_userLog->error("Can't write the render profile " +
+                         ::to_string(traceFp));
+
+      std::string summary = profiler->getSummary();
+      cout << summary;
+      m_userLog->info(summary);
+    }
     DVGui::info(QString::fromStdString(msg));
     TImageCache::instance()->clear(true);
   } catch (TException &e) {
@@ -0,0 +1,88 @@
+
+
+// TnzCore includes
+#include "tpalette.h"
+#include "tpalettecolorlut.h"
+#include "tcolorstyles.h"
+
+// STD includes
+#include <iostream>
+
+using namespace std;
+
+//==================================================================================
+
+/*
+  tpalettecolorluttest checks that the color table cached by a palette
+  follows the changes of its styles - in particular the ones that keep the
+  style count, which the table can't detect by itself.
+
+  Returns the number of failed checks.
+*/
+
+namespace {
+
+int failures = 0;
+
+//------------------------------------------------------------------------
+
+//! Checks that the palette's color table holds the colors of \b expected.
+void checkLut(const TPalette *palette, const TPalette *expected,
+              const char *name) {
+  std::shared_ptr<const TPaletteColorLut> lut = palette->getColorLut();
+  if (lut->getStyleCount() != expected->getStyleCount()) {
+    cerr << name << ": " << lut->getStyleCount() << " styles, expected "
+         << expected->getStyleCount() << endl;
+    ++failures;
+    return;
+  }
+
+  for (int i = 0; i < expected->getStyleCount(); ++i) {
+    TPixel32 color = expected->getStyle(i)->getAverageColor();
+    if (lut->getAverageColor(i) != color) {
+      cerr << name << ": stale color for style " << i << endl;
+      ++failures;
+      return;
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+//! Returns a palette whose styles, after the two reserved ones, are \b count
+//! shades of \b color.
+TPaletteP makePalette(const TPixel32 &color, int count) {
+  TPaletteP palette = new TPalette();
+  for (int i = 0; i < count; ++i)
+    palette->getPage(0)->addStyle(
+        TPixel32(color.r * i / count, color.g * i / count,
+                 color.b * i / count));
+  return palette;
+}
+
+}  // namespace
+
+//==================================================================================
+
+int main(int argc, char *argv[]) {
+  TPaletteP palette = makePalette(TPixel32::Red, 8);
+  checkLut(palette.getPointer(), palette.getPointer(), "initial");
+
+  // same style count, different colors
+  TPaletteP blue = makePalette(TPixel32::Blue, 8);
+  palette->assign(blue.getPointer());
+  checkLut(palette.getPointer(), blue.getPointer(), "assign");
+
+  TPaletteP green = makePalette(TPixel32::Green, 8);
+  palette->assign(green.getPointer(), true);
+  checkLut(palette.getPointer(), green.getPointer(), "studio palette assign");
+
+  palette->setStyle(2, TPixel32::Yellow);
+  checkLut(palette.getPointer(), palette.getPointer(), "setStyle");
+
+  palette->merge(blue.getPointer());
+  checkLut(palette.getPointer(), palette.getPointer(), "merge");
+
+  if (failures == 0) cout << "ok" << endl;
+  return failures;
+}
@@ -0,0 +1,185 @@
+
+
+// TnzCore includes
+#include "tgeometry.h"
+
+// Stdfx includes
+#include "iwa_sparsefilter.h"
+
+// STD includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//==================================================================================
+
+/*
+  tsparsefilterbench times SparseFloat4Filter against the per-pixel loop it
+  replaced in Iwa_MotionBlurCompFx::applyBlurFilter_CPU, on motion blur
+  streaks of a few lengths and directions, and checks that both produce the
+  same pixels.
+
+  Prints a line per streak; returns the number of streaks whose results
+  differ.
+*/
+
+namespace {
+
+struct float4 {
+  float x, y, z, w;
+};
+
+struct int2 {
+  int x, y;
+};
+
+//------------------------------------------------------------------------
+
+//! The per-pixel loop of Iwa_MotionBlurCompFx::applyBlurFilter_CPU, before
+//! SparseFloat4Filter.
+void applyBlurFilter(float4 *in_tile_p, float4 *out_tile_p,
+                     TDimensionI &enlargedDim, float *filter_p,
+                     TDimensionI &filterDim, int marginLeft, int marginBottom,
+                     int marginRight, int marginTop, TDimensionI &outDim) {
+  for (int i = 0; i < outDim.lx * outDim.ly; i++) {
+    int2 outPos  = {i % outDim.lx + marginRight, i / outDim.lx + marginTop};
+    int outIndex = outPos.y * enlargedDim.lx + outPos.x;
+    float4 value = {0.0f, 0.0f, 0.0f, 0.0f};
+    int filterIndex = 0;
+    for (int fily = -marginBottom; fily < filterDim.ly - marginBottom; fily++) {
+      int2 samplePos  = {outPos.x + marginLeft, outPos.y - fily};
+      int sampleIndex = samplePos.y * enlargedDim.lx + samplePos.x;
+      for (int filx = -marginLeft; filx < filterDim.lx - marginLeft;
+           filx++, filterIndex++, sampleIndex--) {
+        if (filter_p[filterIndex] == 0.0f || in_tile_p[sampleIndex].w == 0.0f)
+          continue;
+        value.x += in_tile_p[sampleIndex].x * filter_p[filterIndex];
+        value.y += in_tile_p[sampleIndex].y * filter_p[filterIndex];
+        value.z += in_tile_p[sampleIndex].z * filter_p[filterIndex];
+        value.w += in_tile_p[sampleIndex].w * filter_p[filterIndex];
+      }
+    }
+    out_tile_p[outIndex] = value;
+  }
+}
+
+//------------------------------------------------------------------------
+
+//! Builds a fading streak from the origin to (dx, dy), as the motion blur
+//! filter of a straight trajectory.
+void makeStreak(std::vector<float> &filter, TDimensionI &filterDim,
+                int &marginLeft, int &marginBottom, int dx, int dy) {
+  marginLeft   = dx < 0 ? -dx : 0;
+  marginBottom = dy < 0 ? -dy : 0;
+  filterDim    = TDimensionI(std::abs(dx) + 1, std::abs(dy) + 1);
+  filter.assign(filterDim.lx * filterDim.ly, 0.0f);
+
+  int sampleCount = std::max(std::abs(dx), std::abs(dy)) * 4 + 1;
+  float sum       = 0.0f;
+  for (int k = 0; k < sampleCount; k++) {
+    double t = (double)k / (sampleCount - 1);
+    int x    = (int)std::lround(t * dx) + marginLeft;
+    int y    = (int)std::lround(t * dy) + marginBottom;
+    float &w = filter[y * filterDim.lx + x];
+    if (w == 0.0f) {
+      w = (float)(1.0 - 0.5 * t);
+      sum += w;
+    }
+  }
+  for (float &w : filter) w /= sum;
+}
+
+//------------------------------------------------------------------------
+
+double elapsedMs(const std::chrono::steady_clock::time_point &start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+//==================================================================================
+
+int main() {
+  const int outLength = 512, repeatCount = 3;
+
+  struct Streak {
+    const char *m_name;
+    int m_dx, m_dy;
+  } streaks[] = {{"horizontal 16px", 16, 0},
+                 {"horizontal 64px", 64, 0},
+                 {"diagonal 16px", 11, 11},
+                 {"diagonal 64px", 45, 45},
+                 {"steep 64px", 20, 61}};
+
+  int failures = 0;
+  srand(1);
+
+  printf("%-16s %-8s %14s %10s %10s\n", "streak", "filter", "non-zero",
+         "loop ms", "sparse ms");
+
+  for (const Streak &streak : streaks) {
+    std::vector<float> filter;
+    TDimensionI filterDim;
+    int marginLeft, marginBottom;
+    makeStreak(filter, filterDim, marginLeft, marginBottom, streak.m_dx,
+               streak.m_dy);
+    int marginRight = filterDim.lx - 1 - marginLeft;
+    int marginTop   = filterDim.ly - 1 - marginBottom;
+
+    TDimensionI outDim(outLength, outLength);
+    TDimensionI enlargedDim(outLength + filterDim.lx - 1,
+                            outLength + filterDim.ly - 1);
+
+    // Premultiplied pixels, 30% of them transparent
+    std::vector<float4> in(enlargedDim.lx * enlargedDim.ly);
+    for (float4 &pix : in) {
+      if (rand() % 10 < 3) {
+        pix = {0.0f, 0.0f, 0.0f, 0.0f};
+        continue;
+      }
+      pix.w = (rand() % 255 + 1) / 255.0f;
+      pix.x = pix.w * (rand() % 256) / 255.0f;
+      pix.y = pix.w * (rand() % 256) / 255.0f;
+      pix.z = pix.w * (rand() % 256) / 255.0f;
+    }
+    std::vector<float4> loopOut(in.size()), sparseOut(in.size());
+
+    double loopMs = 1e9, sparseMs = 1e9;
+    for (int r = 0; r < repeatCount; r++) {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      applyBlurFilter(in.data(), loopOut.data(), enlargedDim, filter.data(),
+                      filterDim, marginLeft, marginBottom, marginRight,
+                      marginTop, outDim);
+      loopMs = std::min(loopMs, elapsedMs(start));
+
+      // The filter's construction is part of the cost
+      start = std::chrono::steady_clock::now();
+      SparseFloat4Filter sparseFilter(filter.data(), filterDim, marginLeft,
+                                      marginBottom, enlargedDim.lx);
+      sparseFilter.apply((float *)in.data(), (float *)sparseOut.data(),
+                         marginRight, marginTop, outDim);
+      sparseMs = std::min(sparseMs, elapsedMs(start));
+    }
+
+    int nonZeroCount =
+        (int)std::count_if(filter.begin(), filter.end(),
+                           [](float w) { return w != 0.0f; });
+    bool same = memcmp(loopOut.data(), sparseOut.data(),
+                       loopOut.size() * sizeof(float4)) == 0;
+    if (!same) ++failures;
+
+    printf("%-16s %3dx%-4d %6d/%-7d %10.1f %10.1f  %5.2fx%s\n", streak.m_name,
+           filterDim.lx, filterDim.ly, nonZeroCount,
+           filterDim.lx * filterDim.ly, loopMs, sparseMs, loopMs / sparseMs,
+           same ? "" : "  DIFFERENT RESULTS");
+  }
+
+  return failures;
+}
@@ -20,6 +20,17 @@
 #include "trenderresourcemanager.h"
 #include "tfxcachemanager.h"
 #include "trenderer.h"
+#include "trenderprofiler.h"
+#include "ttilepool.h"
+
+// Qt includes
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QThreadStorage>
+
+// STD includes
+#include <set>
+#include <tuple>
 
 // Diagnostics
 //#define DIAGNOSTICS
@@ -245,7 +256,7 @@ public:
     // currently handled by inserting the
     // rendering affine AFTER a getAlias call. Ever.
     std::string alias = getFxType();
-    return alias + "[" + m_fx->getAlias(frame, info) + "]";
+    return alias + "[" + getInputAlias(m_fx, frame, info) + "]";
   }
 
   //-----------------------------------------------------------
@@ -350,6 +361,264 @@ private:
 
 FX_IDENTIFIER_IS_HIDDEN(TrFx, "trFx")
 
+//==============================================================================
+//
+// TRasterFxKey
+//
+//------------------------------------------------------------------------------
+
+TRasterFxKey TRasterFxKey::hash(const std::string &str) {
+  QByteArray digest = QCryptographicHash::hash(
+      QByteArray::fromRawData(str.c_str(), (int)str.size()),
+      QCryptographicHash::Md5);
+  assert(digest.size() == 16);
+
+  TRasterFxKey key;
+  for (int i = 0; i < 8; ++i) {
+    key.m_hi = (key.m_hi << 8) | (unsigned char)digest[i];
+    key.m_lo = (key.m_lo << 8) | (unsigned char)digest[i + 8];
+  }
+
+  return key;
+}
+
+//------------------------------------------------------------------------------
+
+std::string TRasterFxKey::toString() const {
+  static const char digits[] = "0123456789abcdef";
+
+  std::string str(32, '0');
+  for (int i = 0; i < 16; ++i) {
+    str[15 - i] = digits[(m_hi >> (i << 2)) & 0xf];
+    str[31 - i] = digits[(m_lo >> (i << 2)) & 0xf];
+  }
+
+  return str;
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+// Number of alias keys being built on the current thread. While positive,
+// TRasterFx::getAlias() represents input fxs with their key rather than with
+// their whole alias - so that each node only hashes its own description.
+QThreadStorage<int> aliasKeyDepth;
+
+class AliasKeyScope {
+public:
+  AliasKeyScope() { ++aliasKeyDepth.localData(); }
+  ~AliasKeyScope() { --aliasKeyDepth.localData(); }
+
+  static bool isActive() {
+    return aliasKeyDepth.hasLocalData() && aliasKeyDepth.localData() > 0;
+  }
+};
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+//! The alias keys memoized by a thread during a render instance. Each thread
+//! has its own table, so that the lookups made by every compute() don't
+//! contend with other threads.
+class AliasKeyTable {
+public:
+  // Fx, frame and render data description
+  typedef std::tuple<const TFx *, double, std::string> Id;
+
+private:
+  struct Entry {
+    TFxP m_fx;  //!< Keeps the fx alive, so its address is never reused
+    TRasterFxKey m_key;
+  };
+
+  unsigned long m_renderId;  //!< The instance whose keys are stored
+  std::map<Id, Entry> m_keys;
+
+#ifndef NDEBUG
+  std::map<TRasterFxKey, std::string> m_aliases;
+#endif
+
+  QMutex m_mutex;  //!< Contended only by releaseKeys()
+
+public:
+  AliasKeyTable();
+  ~AliasKeyTable();
+
+  //! Returns the table of the current thread.
+  static AliasKeyTable *instance();
+
+  //! Clears the tables storing the keys of the specified render instance.
+  static void releaseKeys(unsigned long renderId);
+
+  bool find(unsigned long renderId, const Id &id, TRasterFxKey &key);
+  void insert(unsigned long renderId, const Id &id, const TFxP &fx,
+              const TRasterFxKey &key, const std::string &alias);
+
+private:
+  void clear();
+};
+
+//------------------------------------------------------------------------------
+
+// The tables of all threads. It is never destroyed, since tables are deleted
+// when their thread exits.
+struct AliasKeyTables {
+  QMutex m_mutex;  //!< Tables are always locked after this mutex
+  std::set<AliasKeyTable *> m_tables;
+  QThreadStorage<AliasKeyTable *> m_localTables;
+};
+
+AliasKeyTables &aliasKeyTables() {
+  static AliasKeyTables *tables = new AliasKeyTables;
+  return *tables;
+}
+
+//------------------------------------------------------------------------------
+
+AliasKeyTable::AliasKeyTable() : m_renderId(-1) {
+  AliasKeyTables &tables = aliasKeyTables();
+
+  QMutexLocker locker(&tables.m_mutex);
+  tables.m_tables.insert(this);
+}
+
+//------------------------------------------------------------------------------
+
+AliasKeyTable::~AliasKeyTable() {
+  AliasKeyTables &tables = aliasKeyTables();
+
+  QMutexLocker locker(&tables.m_mutex);
+  tables.m_tables.erase(this);
+}
+
+//------------------------------------------------------------------------------
+
+AliasKeyTable *AliasKeyTable::instance() {
+  QThreadStorage<AliasKeyTable *> &localTables = aliasKeyTables().m_localTables;
+  if (!localTables.hasLocalData()) localTables.setLocalData(new AliasKeyTable);
+
+  return localTables.localData();
+}
+
+//------------------------------------------------------------------------------
+
+void AliasKeyTable::releaseKeys(unsigned long renderId) {
+  AliasKeyTables &tables = aliasKeyTables();
+
+  QMutexLocker locker(&tables.m_mutex);
+
+  std::set<AliasKeyTable *>::iterator it;
+  for (it = tables.m_tables.begin(); it != tables.m_tables.end(); ++it) {
+    QMutexLocker tableLocker(&(*it)->m_mutex);
+    if ((*it)->m_renderId == renderId) (*it)->clear();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool AliasKeyTable::find(unsigned long renderId, const Id &id,
+                         TRasterFxKey &key) {
+  QMutexLocker locker(&m_mutex);
+  if (m_renderId != renderId) return false;
+
+  std::map<Id, Entry>::iterator it = m_keys.find(id);
+  if (it == m_keys.end()) return false;
+
+  key = it->second.m_key;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void AliasKeyTable::insert(unsigned long renderId, const Id &id,
+                           const TFxP &fx, const TRasterFxKey &key,
+                           const std::string &alias) {
+  QMutexLocker locker(&m_mutex);
+
+  // The keys of another instance are left by a thread serving several renders
+  if (m_renderId != renderId) {
+    clear();
+    m_renderId = renderId;
+  }
+
+  Entry &entry = m_keys[id];
+  entry.m_fx   = fx;
+  entry.m_key  = key;
+
+#ifndef NDEBUG
+  // Different aliases hashing to the same key would make the cache return
+  // wrong results
+  std::pair<std::map<TRasterFxKey, std::string>::iterator, bool> ins =
+      m_aliases.insert(std::make_pair(key, alias));
+  if (!ins.second && ins.first->second != alias) {
+    TSystem::outputDebug("TRasterFxKey collision: " + key.toString() + "\n");
+    assert(!"TRasterFxKey collision");
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void AliasKeyTable::clear() {
+  m_renderId = -1;
+  m_keys.clear();
+
+#ifndef NDEBUG
+  m_aliases.clear();
+#endif
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+//! Releases the alias keys of render instances as they end.
+class AliasKeyReleaser final : public TRenderResourceManager {
+  T_RENDER_RESOURCE_MANAGER
+
+public:
+  static AliasKeyReleaser *instance() {
+    static AliasKeyReleaser theInstance;
+    return &theInstance;
+  }
+
+  void onRenderInstanceEnd(unsigned long id) override {
+    AliasKeyTable::releaseKeys(id);
+  }
+
+  bool renderHasOwnership() override { return false; }
+};
+
+//------------------------------------------------------------------------------
+
+class AliasKeyReleaserGenerator final : public TRenderResourceManagerGenerator {
+public:
+  TRenderResourceManager *operator()() override {
+    return AliasKeyReleaser::instance();
+  }
+};
+
+MANAGER_FILESCOPE_DECLARATION(AliasKeyReleaser, AliasKeyReleaserGenerator);
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+// Returns the name of the cache resource storing the passed fx's result
+inline std::string getResourceName(const TRasterFx *fx, double frame,
+                                   const TRenderSettings &info) {
+  return TRasterFxKey::hash(fx->getAliasKey(frame, info).toString() + "[" +
+                            ::traduce(info.m_affine) + "][" +
+                            std::to_string(info.m_bpp) + "]")
+      .toString();
+}
+
+}  // namespace
+
 //==============================================================================
 //
 // FxResourceBuilder
@@ -607,7 +876,7 @@ std::string TRasterFx::getAlias(double frame,
     if (port->isConnected()) {
       TRasterFxP ifx = port->getFx();
       assert(ifx);
-      alias += ifx->getAlias(frame, info);
+      alias += getInputAlias(ifx.getPointer(), frame, info);
     }
     alias += ",";
   }
@@ -624,6 +893,50 @@ std::string TRasterFx::getAlias(double frame,
 
 //--------------------------------------------------
 
+std::string TRasterFx::getInputAlias(const TRasterFx *fx, double frame,
+                                     const TRenderSettings &info) {
+  // When building alias keys, inputs are identified by their own key
+  return AliasKeyScope::isActive() ? fx->getAliasKey(frame, info).toString()
+                                   : fx->getAlias(frame, info);
+}
+
+//--------------------------------------------------
+
+TRasterFxKey TRasterFx::getAliasKey(double frame,
+                                    const TRenderSettings &info) const {
+  // Upstream render data may change the alias of the subtree
+  std::string data;
+  std::vector<TRasterFxRenderDataP>::const_iterator it;
+  for (it = info.m_data.begin(); it != info.m_data.end(); ++it)
+    if (*it) data += (*it)->toString();
+
+  AliasKeyTable::Id id(this, frame, data);
+
+  // Keys are memoized only inside render instances
+  unsigned long renderId = TRenderer::renderId();
+  AliasKeyTable *table =
+      (renderId != (unsigned long)-1) ? AliasKeyTable::instance() : 0;
+
+  TRasterFxKey key;
+  if (table && table->find(renderId, id, key)) return key;
+
+  std::string alias;
+  {
+    AliasKeyScope scope;
+    alias = getAlias(frame, info);
+  }
+
+  key = TRasterFxKey::hash(alias);
+
+  if (table)
+    table->insert(renderId, id, TFxP(const_cast<TRasterFx *>(this)), key,
+                  alias);
+
+  return key;
+}
+
+//--------------------------------------------------
+
 void TRasterFx::dryCompute(TRectD &rect, double frame,
                            const TRenderSettings &info) {
   if (checkActiveTimeRegion() && !getActiveTimeRegion().contains(frame)) return;
@@ -639,6 +952,21 @@ void TRasterFx::dryCompute(TRectD &rect, double frame,
     return;
   }
 
+  // Mirrors the float boundaries in compute()
+  bool isFloatTile = (info.m_bpp == 128);
+  if (isFloatTile != canComputeInFloat()) {
+    TRenderSettings convInfo(info);
+    if (isFloatTile)
+      convInfo.m_bpp = info.m_nonFloatBpp;
+    else {
+      convInfo.m_bpp         = 128;
+      convInfo.m_nonFloatBpp = info.m_bpp;
+    }
+
+    dryCompute(rect, frame, convInfo);
+    return;
+  }
+
   // If the input tile has a fractionary position, it is passed to the
   // rendersettings' accumulated affine.
   TPoint intTilePos(tfloor(rect.x0), tfloor(rect.y0));
@@ -676,8 +1004,7 @@ void TRasterFx::dryCompute(TRectD &rect, double frame,
     return;
   }
 
-  std::string alias = getAlias(frame, info) + "[" + ::traduce(info.m_affine) +
-                      "][" + std::to_string(info.m_bpp) + "]";
+  std::string alias = ::getResourceName(this, frame, info);
 
   int renderStatus =
       TRenderer::instance().getRenderStatus(TRenderer::renderId());
@@ -694,6 +1021,8 @@ void TRasterFx::dryCompute(TRectD &rect, double frame,
     TRectD interestingRect(rect * bbox);
     if (myIsEmpty(interestingRect)) return;
 
+    TRenderMemoryEstimator::Node memoryNode(this, interestingRect, frame, info);
+
     // Declare the tile to the tiles manager
     ResourceBuilder::declareResource(alias, this, interestingRect, frame, info);
 
@@ -706,6 +1035,8 @@ void TRasterFx::dryCompute(TRectD &rect, double frame,
     TRectD interestingRect(rect * bbox);
     if (myIsEmpty(interestingRect)) return;
 
+    TRenderMemoryEstimator::Node memoryNode(this, interestingRect, frame, info);
+
     // Invoke the fx-specific simulation process
     FxResourceBuilder rBuilder(alias, this, info, frame);
     rBuilder.simBuild(interestingRect);
@@ -763,30 +1094,28 @@ void TRasterFx::allocateAndCompute(TTile &tile, const TPointD &pos,
   if (templateRas) {
     TRaster32P ras32(templateRas);
     TRaster64P ras64(templateRas);
+    TRasterFP rasF(templateRas);
     templateRas = 0;  // Release the reference to templateRas before allocation
 
-    TRasterP tileRas;
-    if (ras32)
-      tileRas = TRaster32P(size.lx, size.ly);
-    else if (ras64)
-      tileRas = TRaster64P(size.lx, size.ly);
-    else {
+    // Input tiles are recycled between computations through the tile pool
+    int bpp = ras32 ? 32 : ras64 ? 64 : rasF ? 128 : 0;
+    if (!bpp) {
       assert(false);
       return;
     }
 
-    tile.setRaster(tileRas);
+    tile.setRaster(TTilePool::instance()->getRaster(size, bpp));
   } else {
-    if (info.m_bpp == 32) {
-      TRaster32P tileRas(size.lx, size.ly);
-      tile.setRaster(tileRas);
-    } else if (info.m_bpp == 64) {
-      TRaster64P tileRas(size.lx, size.ly);
-      tile.setRaster(tileRas);
-    } else
+    if (info.m_bpp == 32 || info.m_bpp == 64 || info.m_bpp == 128)
+      tile.setRaster(TTilePool::instance()->getRaster(size, info.m_bpp));
+    else
       assert(false);
   }
 
+  if (tile.getRaster())
+    TRenderProfiler::addAllocation((TINT64)size.lx * size.ly *
+                                   tile.getRaster()->getPixelSize());
+
   tile.m_pos = pos;
   compute(tile, frame, info);
 }
@@ -819,6 +1148,36 @@ void TRasterFx::compute(TTile &tile, double frame,
     return;
   }
 
+  // Float tiles flow only through fxs declaring support. At the boundaries of
+  // such regions of the fx tree, the fx computes a tile in its own format -
+  // float, or the depth requested where the float region began - which is
+  // then converted to the requested one.
+  TRasterP ras(tile.getRaster());
+  bool isFloatTile = (bool)TRasterFP(ras);
+  if (isFloatTile != canComputeInFloat()) {
+    TRenderSettings convInfo(info);
+
+    TRasterP convRas;
+    if (isFloatTile) {
+      convInfo.m_bpp = info.m_nonFloatBpp;
+      if (convInfo.m_bpp == 32)
+        convRas = TRaster32P(ras->getSize());
+      else
+        convRas = TRaster64P(ras->getSize());
+    } else {
+      convInfo.m_bpp         = 128;
+      convInfo.m_nonFloatBpp = info.m_bpp;
+      convRas                = TRasterFP(ras->getSize());
+    }
+    convRas->clear();
+
+    TTile convTile(convRas, tile.m_pos);
+    compute(convTile, frame, convInfo);
+
+    TRop::convert(ras, convRas);
+    return;
+  }
+
   // If the input tile has a fractionary position, it is passed to the
   // rendersettings' accumulated affine. At the same time, the integer part of
   // such affine is transferred to the tile.
@@ -860,9 +1219,7 @@ void TRasterFx::compute(TTile &tile, double frame,
   TRectD tilePlacement = myConvert(tile.getRaster()->getBounds()) + tile.m_pos;
 
   // Build the fx result alias (in other words, its name)
-  std::string alias = getAlias(frame, info) + "[" + ::traduce(info.m_affine) +
-                      "][" + std::to_string(info.m_bpp) +
-                      "]";  // To be moved below
+  std::string alias = ::getResourceName(this, frame, info);  // To be moved below
 
   TRectD bbox;
   getBBox(frame, bbox, info);
@@ -891,6 +1248,9 @@ void TRasterFx::compute(TTile &tile, double frame,
 #endif
 
   // Invoke the fx-specific computation process
+  TRenderProfiler::Scope profilerScope(this, frame, interestingRectI.getLx(),
+                                       interestingRectI.getLy(), info.m_bpp);
+
   FxResourceBuilder rBuilder(alias, this, info, frame);
   rBuilder.build(interestingTile);
 
@@ -1064,6 +1424,7 @@ TRenderSettings::TRenderSettings()
     , m_timeStretchTo(25)
     , m_stereoscopicShift(0.05)
     , m_bpp(32)
+    , m_nonFloatBpp(64)
     , m_maxTileSize((std::numeric_limits<int>::max)())
     , m_shrinkX(1)
     , m_shrinkY(1)
@@ -1083,7 +1444,8 @@ TRenderSettings::~TRenderSettings() {}
 
 std::string TRenderSettings::toString() const {
   std::string ss =
-      std::to_string(m_bpp) + ";" + std::to_string(m_quality) + ";" +
+      std::to_string(m_bpp) + "," + std::to_string(m_nonFloatBpp) + ";" +
+      std::to_string(m_quality) + ";" +
       std::to_string(m_gamma) + ";" + std::to_string(m_timeStretchFrom) + ";" +
       std::to_string(m_timeStretchTo) + ";" +
       std::to_string(m_fieldPrevalence) + ";" + std::to_string(m_shrinkX) +
@@ -1105,7 +1467,8 @@ std::string TRenderSettings::toString() const {
 //------------------------------------------------------------------------------
 
 bool TRenderSettings::operator==(const TRenderSettings &rhs) const {
-  if (m_bpp != rhs.m_bpp || m_quality != rhs.m_quality ||
+  if (m_bpp != rhs.m_bpp || m_nonFloatBpp != rhs.m_nonFloatBpp ||
+      m_quality != rhs.m_quality ||
       m_fieldPrevalence != rhs.m_fieldPrevalence ||
       m_stereoscopic != rhs.m_stereoscopic ||
       m_stereoscopicShift != rhs.m_stereoscopicShift ||
@@ -595,9 +595,13 @@ void FullColorBrushTool::leftButtonDrag(const TPointD &pos,
 
   m_strokeSegmentRect.empty();
   m_toonz_brush->strokeTo(point, pressure, restartBrushTimer());
-  TRect updateRect = m_strokeSegmentRect * ras->getBounds();
-  if (!updateRect.isEmpty())
-    ras->extract(updateRect)->copy(m_workRaster->extract(updateRect));
+  // only the tiles touched by the dabs need to be copied, not their bbox
+  const std::vector<TRect> &dirtyTiles = m_toonz_brush->getDirtyTiles();
+  for (int i = 0; i < (int)dirtyTiles.size(); ++i) {
+    TRect updateRect = dirtyTiles[i] * ras->getBounds();
+    if (!updateRect.isEmpty())
+      ras->extract(updateRect)->copy(m_workRaster->extract(updateRect));
+  }
 
   TPointD thickOffset(m_maxCursorThick * 0.5, m_maxCursorThick * 0.5);
   invalidateRect = convert(m_strokeSegmentRect) - rasCenter;
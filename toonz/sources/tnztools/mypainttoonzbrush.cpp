@@ -4,6 +4,7 @@
 #include "mypainttoonzbrush.h"
 #include "tropcm.h"
 #include "tpixelutils.h"
+#include "tthread.h"
 #include <toonz/mypainthelpers.hpp>
 
 #include <QColor>
@@ -56,10 +57,25 @@ class Raster32PMyPaintSurface::Internal
                                              askWrite> {
 public:
   typedef SurfaceCustom Parent;
+
+  struct QueuedDab {
+    mypaint::Dab m_dab;  //!< Already fitted, see SurfaceCustom::fitDab().
+    TRect m_bounds;
+  };
+
+  std::vector<QueuedDab> m_dabs;
+  TRect m_dabsRect;
+  std::vector<TRect> m_dirtyTiles;
+
+  //! Set once the brush reads colors: dabs are then drawn immediately, and
+  //! m_dabsRect collects what they touched.
+  bool m_smudging;
+
   Internal(Raster32PMyPaintSurface &owner)
       : SurfaceCustom(owner.m_ras->pixels(), owner.m_ras->getLx(),
                       owner.m_ras->getLy(), owner.m_ras->getPixelSize(),
-                      owner.m_ras->getRowSize(), &owner) {}
+                      owner.m_ras->getRowSize(), &owner)
+      , m_smudging(false) {}
 };
 
 //=======================================================
@@ -86,11 +102,106 @@ Raster32PMyPaintSurface::~Raster32PMyPaintSurface() { delete internal; }
 bool Raster32PMyPaintSurface::getColor(float x, float y, float radius,
                                        float &colorR, float &colorG,
                                        float &colorB, float &colorA) {
+  // smudging brushes read what the stroke has drawn so far, which would
+  // flush the queue at every dab - draw their dabs directly instead
+  if (!internal->m_smudging) {
+    flushDabs();
+    internal->m_smudging = true;
+  }
   return internal->getColor(x, y, radius, colorR, colorG, colorB, colorA);
 }
 
 bool Raster32PMyPaintSurface::drawDab(const mypaint::Dab &dab) {
-  return internal->drawDab(dab);
+  Internal::QueuedDab queued;
+  bool result;
+  if (!internal->fitDab(dab, queued.m_dab, result)) return result;
+
+  TRect &b = queued.m_bounds;
+  if (!internal->getDabBounds(queued.m_dab, b.x0, b.y0, b.x1, b.y1))
+    return false;
+
+  if (internal->m_smudging) {
+    if (!internal->drawFittedDab(queued.m_dab)) return false;
+    internal->m_dabsRect += b;
+    return true;
+  }
+
+  internal->m_dabs.push_back(queued);
+  internal->m_dabsRect += b;
+  return true;
+}
+
+void Raster32PMyPaintSurface::flushDabs() {
+  std::vector<Internal::QueuedDab> &dabs = internal->m_dabs;
+  std::vector<TRect> &dirtyTiles         = internal->m_dirtyTiles;
+
+  if (internal->m_smudging) {
+    // the dabs were drawn as they came
+    if (!internal->m_dabsRect.isEmpty())
+      dirtyTiles.push_back(internal->m_dabsRect);
+    internal->m_dabsRect.empty();
+    return;
+  }
+
+  if (dabs.empty()) return;
+
+  // bin the dabs into the tiles they touch, keeping their order
+  const TRect &rect = internal->m_dabsRect;
+  int tx0 = rect.x0 / TileSize, ty0 = rect.y0 / TileSize;
+  int tileCountX = rect.x1 / TileSize - tx0 + 1;
+  int tileCountY = rect.y1 / TileSize - ty0 + 1;
+
+  std::vector<std::vector<int>> tileDabs(tileCountX * tileCountY);
+  std::vector<TRect> tileRects(tileDabs.size());
+  for (int i = 0; i < (int)dabs.size(); ++i) {
+    const TRect &b = dabs[i].m_bounds;
+    for (int ty = b.y0 / TileSize; ty <= b.y1 / TileSize; ++ty)
+      for (int tx = b.x0 / TileSize; tx <= b.x1 / TileSize; ++tx) {
+        int t = (ty - ty0) * tileCountX + tx - tx0;
+        tileDabs[t].push_back(i);
+        tileRects[t] += b * TRect(tx * TileSize, ty * TileSize,
+                                  (tx + 1) * TileSize - 1,
+                                  (ty + 1) * TileSize - 1);
+      }
+  }
+
+  // the controller prepares the tiles before any of them is drawn
+  std::vector<int> tiles;
+  for (int t = 0; t < (int)tileDabs.size(); ++t) {
+    if (tileDabs[t].empty()) continue;
+    const TRect &tileRect = tileRects[t];
+    if (controller && (!controller->askRead(tileRect) ||
+                       !controller->askWrite(tileRect)))
+      continue;
+    tiles.push_back(t);
+    dirtyTiles.push_back(tileRect);
+  }
+
+  // tiles don't overlap, so they can be drawn concurrently - each by a
+  // controller-less surface clipped to it
+  const Internal &in = *internal;
+  TThread::parallelFor(0, (int)tiles.size(), [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      const std::vector<int> &indices = tileDabs[tiles[i]];
+      const TRect &tileRect           = tileRects[tiles[i]];
+
+      Internal::Parent surface(in.pointer, in.width, in.height, in.pixelSize,
+                               in.rowSize, 0, in.antialiasing);
+      surface.setClip(tileRect.x0, tileRect.y0, tileRect.x1, tileRect.y1);
+      for (int d : indices) surface.drawFittedDab(dabs[d].m_dab);
+    }
+  });
+
+  dabs.clear();
+  internal->m_dabsRect.empty();
+}
+
+const std::vector<TRect> &Raster32PMyPaintSurface::getDirtyTiles() const {
+  return internal->m_dirtyTiles;
+}
+
+void Raster32PMyPaintSurface::clearDirtyTiles() {
+  internal->m_dirtyTiles.clear();
 }
 
 bool Raster32PMyPaintSurface::getAntialiasing() const {
@@ -141,6 +252,7 @@ void MyPaintToonzBrush::endStroke() {
 void MyPaintToonzBrush::strokeTo(const TPointD &point, double pressure,
                                  double dtime) {
   Params next(point.x, point.y, pressure, 0.0);
+  m_mypaintSurface.clearDirtyTiles();
 
   if (reset) {
     current  = next;
@@ -190,6 +302,8 @@ void MyPaintToonzBrush::strokeTo(const TPointD &point, double pressure,
     }
   }
 
+  m_mypaintSurface.flushDabs();
+
   // keep parameters for future interpolation
   previous = current;
   current  = next;
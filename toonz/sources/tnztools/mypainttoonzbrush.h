@@ -10,6 +10,8 @@
 #include <QPainter>
 #include <QImage>
 
+#include <vector>
+
 class RasterController {
 public:
   virtual ~RasterController() {}
@@ -23,7 +25,22 @@ public:
 //
 //=======================================================
 
+//! A MyPaint surface over a 32-bit raster.
+/*!
+  Dabs are not drawn as soon as the brush emits them: they are queued until
+  flushDabs(), which bins them into TileSize x TileSize tiles and rasterizes
+  the tiles in parallel - each tile receiving its dabs in emission order. A
+  dab clipped to a tile computes its pixels just as an unclipped one, so the
+  result does not depend on the tiling. The controller is asked for access
+  once per dirty tile rather than once per dab.
+
+  Smudging brushes read the raster between dabs. Once the brush asks for a
+  color, the surface stops queueing and draws each dab as it comes.
+*/
 class Raster32PMyPaintSurface : public mypaint::Surface {
+public:
+  enum { TileSize = 64 };
+
 private:
   class Internal;
 
@@ -78,6 +95,12 @@ public:
 
   bool drawDab(const mypaint::Dab &dab) override;
 
+  //! Draws the queued dabs.
+  void flushDabs();
+  //! Returns the rects of the tiles drawn since the last clearDirtyTiles().
+  const std::vector<TRect> &getDirtyTiles() const;
+  void clearDirtyTiles();
+
   bool getAntialiasing() const;
   void setAntialiasing(bool value);
 };
@@ -128,6 +151,12 @@ public:
   void endStroke();
   void strokeTo(const TPointD &p, double pressure, double dtime);
 
+  //! Returns the rects of the raster drawn by the last strokeTo(); their
+  //! union is the rect passed to the controller's askWrite().
+  const std::vector<TRect> &getDirtyTiles() const {
+    return m_mypaintSurface.getDirtyTiles();
+  }
+
   // colormapped
   void updateDrawing(const TRasterCM32P rasCM, const TRasterCM32P rasBackupCM,
                      const TRect &bbox, int styleId, bool lockAlpha) const;
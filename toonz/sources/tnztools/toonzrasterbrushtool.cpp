@@ -1718,12 +1718,11 @@ void ToonzRasterBrushTool::leftButtonDrag(const TPointD &pos,
 
     m_strokeSegmentRect.empty();
     m_toonz_brush->strokeTo(point, pressure, restartBrushTimer());
-    TRect updateRect = m_strokeSegmentRect * ras->getBounds();
-    if (!updateRect.isEmpty()) {
-      // ras->extract(updateRect)->copy(m_workRaster->extract(updateRect));
-      m_toonz_brush->updateDrawing(ras, m_backupRas, m_strokeSegmentRect,
-                                   m_styleId, m_modifierLockAlpha.getValue());
-    }
+    // only the tiles touched by the dabs need to be merged, not their bbox
+    const std::vector<TRect> &dirtyTiles = m_toonz_brush->getDirtyTiles();
+    for (int i = 0; i < (int)dirtyTiles.size(); ++i)
+      m_toonz_brush->updateDrawing(ras, m_backupRas, dirtyTiles[i], m_styleId,
+                                   m_modifierLockAlpha.getValue());
     m_lastRect = m_strokeRect;
 
     TPointD thickOffset(m_maxCursorThick * 0.5, m_maxCursorThick * 0.5);
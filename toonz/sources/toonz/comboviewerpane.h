@@ -65,9 +65,7 @@ class ComboViewerPanel final : public QFrame,
   bool m_playing         = false;
   double m_fps;
   int m_viewerFps;
-  double m_samplesPerFrame;
-  bool m_first         = true;
-  TSoundTrack *m_sound = NULL;
+  bool m_first = true;
 
   TPanelTitleBarButton *m_previewButton;
   TPanelTitleBarButton *m_subcameraPreviewButton;
@@ -965,10 +965,17 @@ void DvItemViewerPanel::paintEvent(QPaintEvent *) {
   case TableView:
     for (i = 0; i < n; i++) paintTableItem(p, i);
     break;
-  case ThumbnailView:
+  case ThumbnailView: {
+    // icon requests not renewed by this paint are for items out of view
+    IconGenerator *iconGenerator = IconGenerator::instance();
+    int iconRequestMark          = iconGenerator->getRequestMark();
     for (i = 0; i < n; i++) paintThumbnailItem(p, i);
+    if (m_viewer->m_windowType == DvItemViewer::Browser)
+      iconGenerator->cancelRequestsBefore(iconRequestMark,
+                                          IconGenerator::FileIcons);
     break;
   }
+  }
 
   /*
 
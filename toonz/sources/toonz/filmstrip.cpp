@@ -635,6 +635,10 @@ void FilmstripFrames::paintEvent(QPaintEvent *evt) {
 
   int frameCount = (int)fids.size();
 
+  // icon requests not renewed by this paint are for frames out of view
+  IconGenerator *iconGenerator = IconGenerator::instance();
+  int iconRequestMark          = iconGenerator->getRequestMark();
+
   bool isReadOnly = false;
   if (sl) isReadOnly = sl->isReadOnly();
 
@@ -758,6 +762,11 @@ void FilmstripFrames::paintEvent(QPaintEvent *evt) {
   // frame corrente
   if (TApp::instance()->getCurrentFrame()->isEditingLevel())
     m_frameHeadGadget->draw(p, QColor(Qt::white), QColor(Qt::black));
+
+  // partial repaints do not request all the visible icons
+  if (clipRect.contains(visibleRegion().boundingRect()))
+    iconGenerator->cancelRequestsBefore(iconRequestMark,
+                                        IconGenerator::FilmstripIcons);
 }
 
 //-----------------------------------------------------------------------------
@@ -87,6 +87,7 @@
 #include <QLibraryInfo>
 #include <QHash>
 #include <QPainterPath>
+#include <QDebug>
 
 #ifdef _WIN32
 #ifndef x64
@@ -634,6 +635,8 @@ int main(int argc, char *argv[]) {
   QApplication::setStyle("windows");
 
   IconGenerator::setFilmstripIconSize(Preferences::instance()->getIconSize());
+  IconGenerator::enableThumbnailStore(
+      Preferences::instance()->isThumbnailStoreEnabled());
 
   splash.showMessage(offsetStr + "Loading shaders...",
                      Qt::AlignRight | Qt::AlignBottom, Qt::black);
@@ -849,6 +852,15 @@ int main(int argc, char *argv[]) {
   w.getCurrentRoom()->dockLayout()->setEnabled(false);
   int ret = a.exec();
 
+  IconGenerator::Statistics iconStats =
+      IconGenerator::instance()->getStatistics();
+  qDebug() << "Icons - cache hits:" << iconStats.m_memoryHits
+           << "store hits:" << iconStats.m_storeHits
+           << "renders:" << iconStats.m_renders
+           << "canceled:" << iconStats.m_canceled
+           << "hit rate:" << iconStats.getHitRate()
+           << "render time (ms):" << iconStats.m_renderTime;
+
   TUndoManager::manager()->reset();
   PreviewFxManager::instance()->reset();
 
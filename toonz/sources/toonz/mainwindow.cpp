@@ -2117,6 +2117,13 @@ void MainWindow::defineActions() {
   createMenuRenderAction(MI_SavePreviewedFrames,
                          QT_TR_NOOP("&Save Previewed Frames"), "",
                          "save_previewed_frames", tr("Save the images created during preview to a specified location."));
+  createToggle(MI_ProfileRenders, QT_TR_NOOP("&Profile Renders"), "", false,
+               MenuRenderCommandType, "",
+               tr("Record the time spent on each fx by previews and renders."));
+  createMenuRenderAction(MI_ExportRenderProfile,
+                         QT_TR_NOOP("&Export Render Profile..."), "", "",
+                         tr("Save the recorded render profile as a trace file, "
+                         "together with a summary sorted by fx cost."));
   createMenuRenderAction(MI_SaveAndRender, QT_TR_NOOP("&Save and Render"), "", "render",
                          tr("Saves the current scene and renders according to the settings and "
                          "location set in Output Settings."));
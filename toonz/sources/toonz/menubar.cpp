@@ -567,6 +567,9 @@ void TopBar::loadMenubar() {
   // addMenuItem(renderMenu, MI_SavePreview);
   addMenuItem(renderMenu, MI_SavePreviewedFrames);
   renderMenu->addSeparator();
+  addMenuItem(renderMenu, MI_ProfileRenders);
+  addMenuItem(renderMenu, MI_ExportRenderProfile);
+  renderMenu->addSeparator();
   addMenuItem(renderMenu, MI_OutputSettings);
   addMenuItem(renderMenu, MI_Render);
   addMenuItem(renderMenu, MI_SaveAndRender);
@@ -61,6 +61,8 @@
 #define MI_ClonePreview "MI_ClonePreview"
 #define MI_FreezePreview "MI_FrezzePreview"
 #define MI_SavePreviewedFrames "MI_SavePreviewedFrames"
+#define MI_ProfileRenders "MI_ProfileRenders"
+#define MI_ExportRenderProfile "MI_ExportRenderProfile"
 //#define MI_SavePreview         "MI_SavePreview"
 #define MI_Print "MI_Print"
 #define MI_Preferences "MI_Preferences"
@@ -20,6 +20,7 @@
 #include "toonzqt/dvdialog.h"
 #include "toonzqt/filefield.h"
 #include "toonzqt/lutcalibrator.h"
+#include "toonzqt/icongenerator.h"
 
 // TnzLib includes
 #include "toonz/txsheethandle.h"
@@ -343,6 +344,14 @@ void PreferencesPopup::onWatchFileSystemClicked() {
 
 //-----------------------------------------------------------------------------
 
+void PreferencesPopup::onThumbnailStoreChanged() {
+  IconGenerator::enableThumbnailStore(m_pref->isThumbnailStoreEnabled());
+  // The logged hit rate then reflects the new setting only
+  IconGenerator::instance()->resetStatistics();
+}
+
+//-----------------------------------------------------------------------------
+
 void PreferencesPopup::onPathAliasPriorityChanged() {
   TApp::instance()->getCurrentScene()->notifyPreferenceChanged(
       "PathAliasPriority");
@@ -983,6 +992,7 @@ QString PreferencesPopup::getUIString(PreferencesItemId id) {
       {sceneNumberingEnabled, tr("Show Info in Rendered Frames")},
       {watchFileSystemEnabled,
        tr("Watch File System and Update File Browser Automatically")},
+      {thumbnailStoreEnabled, tr("Keep File Browser Icons on Disk")},
       //{ projectRoot,               tr("") },
       {customProjectRoot, tr("Custom Project Path(s):")},
       {pathAliasPriority, tr("Path Alias Priority:")},
@@ -1127,6 +1137,13 @@ QString PreferencesPopup::getUIString(PreferencesItemId id) {
       {previewAlwaysOpenNewFlip, tr("Display in a New Flipbook Window")},
       {fitToFlipbook, tr("Fit to Flipbook")},
       {generatedMovieViewEnabled, tr("Open Flipbook after Rendering")},
+      {speculativePreviewFrameCount,
+       tr("Frames to Pre-render around the Current Frame in Preview:")},
+      {speculativePreviewCpuShare, tr("CPU Share for Pre-rendering (%):")},
+      {regionOfInterestPreview,
+       tr("Render the Visible Area First in Preview Mode")},
+      {progressivePreview,
+       tr("Refine Previews Progressively from Lower Resolutions")},
 
       // Onion Skin
       {onionSkinEnabled, tr("Onion Skin ON")},
@@ -1355,6 +1372,7 @@ QWidget* PreferencesPopup::createGeneralPage() {
   insertUI(taskchunksize, lay);
   insertUI(sceneNumberingEnabled, lay);
   insertUI(watchFileSystemEnabled, lay);
+  insertUI(thumbnailStoreEnabled, lay);
 
   // QGridLayout* projectRootLay =
   //    insertGroupBox(tr("Additional Project Locations"), lay);
@@ -1398,6 +1416,8 @@ QWidget* PreferencesPopup::createGeneralPage() {
                            &PreferencesPopup::onAutoSaveOptionsChanged);
   m_onEditedFuncMap.insert(watchFileSystemEnabled,
                            &PreferencesPopup::onWatchFileSystemClicked);
+  m_onEditedFuncMap.insert(thumbnailStoreEnabled,
+                           &PreferencesPopup::onThumbnailStoreChanged);
 
   bool ret = true;
   ret      = ret && connect(m_pref, SIGNAL(stopAutoSave()), this,
@@ -1808,6 +1828,10 @@ QWidget* PreferencesPopup::createPreviewPage() {
   insertUI(previewAlwaysOpenNewFlip, lay);
   insertUI(fitToFlipbook, lay);
   insertUI(generatedMovieViewEnabled, lay);
+  insertUI(speculativePreviewFrameCount, lay);
+  insertUI(speculativePreviewCpuShare, lay);
+  insertUI(regionOfInterestPreview, lay);
+  insertUI(progressivePreview, lay);
 
   lay->setRowStretch(lay->rowCount(), 1);
   widget->setLayout(lay);
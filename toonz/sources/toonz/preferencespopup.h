@@ -130,6 +130,7 @@ private:
   void onAutoSaveChanged();
   void onAutoSaveOptionsChanged();
   void onWatchFileSystemClicked();
+  void onThumbnailStoreChanged();
   void onPathAliasPriorityChanged();
   // Interface
   void onStyleSheetTypeChanged();
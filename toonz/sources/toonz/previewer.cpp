@@ -26,6 +26,7 @@
 #include "toutputproperties.h"
 
 // Toonz stage structures
+#include "toonz/preferences.h"
 #include "toonz/tobjecthandle.h"
 #include "toonz/tscenehandle.h"
 #include "toonz/tframehandle.h"
@@ -85,6 +86,25 @@ stored informations no more match the current frame description.
 The clear() methods make the Previewer erase all stored informations about one
 or all frames,
 so that the following getRaster() will forcibly recalculate the requested frame.
+\n \n
+While the current frame stays still, the Previewer also pre-renders the frames
+around it (see Preferences::getSpeculativePreviewFrameCount()), favoring the
+direction the user is moving in. Speculative renders run on a separate,
+low-priority renderer using a limited share of the CPU, and are aborted as soon
+as they fall out of the speculation window or are invalidated by scene edits.
+\n \n
+In region of interest mode (see Preferences::isRegionOfInterestPreviewEnabled())
+only the area visible in the listeners is rendered on demand, in tiles aligned
+to a fixed grid. Tiles already rendered are reused when the view is panned, and
+once the visible area is complete the remaining tiles of the current frame are
+rendered in background, nearest to the visible area first.
+\n \n
+In progressive mode (see Preferences::isProgressivePreviewEnabled()) frames are
+first rendered at 1/8, 1/4 and 1/2 of the preview resolution, each pass being
+shown in place of the previous one until the full resolution is available.
+Coarse passes are kept in cache, so that the refinement of a revisited frame
+resumes from the finest one; scene edits cancel the refinement of outdated
+frames.
 */
 
 //------------------------------------------------
@@ -114,6 +134,21 @@ void buildNodeTreeDescription(std::string &desc, const TFxP &root);
 inline bool contains(const QRegion &region, const TRect &rect) {
   return QRegion(toQRect(rect)).subtracted(region).isEmpty();
 }
+
+//-------------------------------------------------------------------------
+
+// Side of the render tiles in region of interest mode, in preview pixels
+const int roiTileSize = 256;
+
+// Enlarges the passed rect to the tiles grid, within the specified bounds.
+// Coordinates are assumed non-negative.
+inline TRect toTiles(const TRect &rect, const TRect &bounds) {
+  TRect result((rect.x0 / roiTileSize) * roiTileSize,
+               (rect.y0 / roiTileSize) * roiTileSize,
+               (rect.x1 / roiTileSize + 1) * roiTileSize - 1,
+               (rect.y1 / roiTileSize + 1) * roiTileSize - 1);
+  return result * bounds;
+}
 }  // namespace
 
 //======================================================================================
@@ -130,11 +165,29 @@ public:
   struct FrameInfo {
   public:
     std::string m_alias;       // The alias of m_fx
+    int m_aliasPass;           // Shrink multiplier of the tree m_alias was
+                               // taken from
     unsigned long m_renderId;  // The render process Id - passed by TRenderer
     QRegion m_renderedRegion;  // The plane region already rendered for m_fx
     TRect m_rectUnderRender;   // Plane region currently under render
-
-    FrameInfo() : m_renderId((unsigned long)-1) {}
+    bool m_speculative;        // Whether the render was speculative
+
+    unsigned long m_tileRenderId;  // The render process Id of m_tileUnderRender
+    TRect m_tileUnderRender;  // Background tile currently under render, in
+                              // region of interest mode
+
+    int m_pass;              // Shrink multiplier of the progressive pass under
+                             // render - 0 if the render is not progressive
+    int m_coarseShrink;      // Shrink multiplier of the cached coarse pass
+    QRegion m_coarseRegion;  // The plane region rendered by the coarse pass
+
+    FrameInfo()
+        : m_aliasPass(1)
+        , m_renderId((unsigned long)-1)
+        , m_speculative(false)
+        , m_tileRenderId((unsigned long)-1)
+        , m_pass(0)
+        , m_coarseShrink(0) {}
   };
 
 public:
@@ -155,10 +208,21 @@ public:
   TPointD m_cameraPos;
   bool m_subcamera;
 
-  TRect m_previewRect;
+  TRect m_previewRect;  // The rect to be rendered first - the visible one in
+                        // region of interest mode
+  TRect m_frameRect;    // The rect a frame must cover to be complete
 
   TRenderer m_renderer;
 
+  // Speculative render stuff
+  TRenderer m_speculativeRenderer;
+  QTimer m_speculationTimer;
+  int m_lastFrame, m_direction;
+
+  // Region of interest stuff. Background tiles are rendered by the speculative
+  // renderer, and do not count as frame renders.
+  std::set<unsigned long> m_tileRenderIds;
+
   // Save command stuff
   TLevelWriterP m_lw;
   int m_currentFrameToSave;
@@ -172,7 +236,13 @@ public:
   void notifyFailed(int frame);
   void notifyUpdate();
 
-  TFxPair buildSceneFx(int frame);
+  TFxPair buildSceneFx(int frame, int pass = 1);
+  std::string getAlias(const TFxPair &fxPair, int frame) const;
+
+  std::string getCoarseCacheId(int frame) const {
+    return m_cachePrefix + "Coarse" + std::to_string(frame);
+  }
+  void releaseCachedImages(int frame);
 
   // Updater methods. These refresh the manager's status, but do not launch new
   // renders
@@ -187,14 +257,38 @@ public:
   // specified order.
   void updateFrameRange();
   void updateProgressBarStatus();
+  UCHAR getProgressBarStatus(const FrameInfo &info) const;
 
   void updateCamera();
   void updatePreviewRect();  // This is automatically invoked by refreshFrame()
 
+  // Converts a stage rect to the covered rect of the preview raster.
+  TRect toPreviewRect(TRectD rect) const;
+
+  // Converts a rect of the preview raster to the stage area to be rendered.
+  // Rects of coarse passes are relative to the pass raster.
+  TRectD toRenderArea(const TRect &rect, int pass = 1) const;
+  TRect toPassRect(const TRect &rect, int pass) const;
+
   // Use this method to re-render the passed frame. Infos specified with the
   // update* methods
   // are assumed correct.
-  void refreshFrame(int frame);
+  void refreshFrame(int frame, bool speculative = false);
+
+  TRenderer &getRenderer(const FrameInfo &info) {
+    return info.m_speculative ? m_speculativeRenderer : m_renderer;
+  }
+
+  // Pre-renders the frames around the current one
+  void speculate();
+  void abortSpeculativeRender(FrameInfo &info);
+
+  // Renders the frame's tiles outside the region of interest, one at a time
+  void renderNextTile(int frame);
+  void abortTileRender(FrameInfo &info);
+
+  // Cancels the progressive refinement of an outdated frame
+  void abortProgressiveRender(FrameInfo &info);
 
   // TRenderPort methods
   void onRenderRasterStarted(const RenderData &renderData) override;
@@ -207,6 +301,8 @@ public:
   void doOnRenderRasterCompleted(const RenderData &renderData);
   void doOnRenderRasterFailed(const RenderData &renderData);
 
+  void storeCoarsePass(FrameInfo &info, int frame, const TRasterP &ras);
+
   void remove(int frame);
   void remove();
 
@@ -237,6 +333,9 @@ Previewer::Imp::Imp(Previewer *owner)
     : m_owner(owner)
     , m_cameraRes(0, 0)
     , m_renderer(TSystem::getProcessorCount())
+    , m_speculativeRenderer(1)
+    , m_lastFrame(0)
+    , m_direction(1)
     , m_computingFrameCount(0)
     , m_currentFrameToSave(0)
     , m_subcamera(false)
@@ -249,6 +348,14 @@ Previewer::Imp::Imp(Previewer *owner)
   m_renderer.enablePrecomputing(false);
   m_renderer.addPort(this);
 
+  // Speculative tasks start only when no on-demand task is waiting
+  m_speculativeRenderer.enablePrecomputing(false);
+  m_speculativeRenderer.setTasksPriority(0);
+  m_speculativeRenderer.addPort(this);
+
+  m_speculationTimer.setInterval(notificationDelay);
+  m_speculationTimer.setSingleShot(true);
+
   updateRenderSettings();
   updateCamera();
   updateFrameRange();
@@ -258,6 +365,7 @@ Previewer::Imp::Imp(Previewer *owner)
 
 Previewer::Imp::~Imp() {
   m_renderer.removePort(this);
+  m_speculativeRenderer.removePort(this);
 
   // for(std::map<int, FrameInfo*>::iterator it=m_frames.begin();
   // it!=m_frames.end(); ++it)
@@ -267,37 +375,52 @@ Previewer::Imp::~Imp() {
 
 //-----------------------------------------------------------------------------
 
-TFxPair Previewer::Imp::buildSceneFx(int frame) {
+TFxPair Previewer::Imp::buildSceneFx(int frame, int pass) {
   TFxPair fxPair;
 
+  int shrink = m_renderSettings.m_applyShrinkToViewer
+                   ? m_renderSettings.m_shrinkX * pass
+                   : pass;
+
   TApp *app         = TApp::instance();
   ToonzScene *scene = app->getCurrentScene()->getScene();
   TXsheet *xsh      = scene->getXsheet();
   if (m_renderSettings.m_stereoscopic) {
     scene->shiftCameraX(-m_renderSettings.m_stereoscopicShift / 2.0);
-    fxPair.m_frameA = ::buildSceneFx(
-        scene, xsh, frame, TOutputProperties::AllLevels,
-        m_renderSettings.m_applyShrinkToViewer ? m_renderSettings.m_shrinkX : 1,
-        false);
+    fxPair.m_frameA = ::buildSceneFx(scene, xsh, frame,
+                                     TOutputProperties::AllLevels, shrink,
+                                     false);
 
     scene->shiftCameraX(m_renderSettings.m_stereoscopicShift);
-    fxPair.m_frameB = ::buildSceneFx(
-        scene, xsh, frame, TOutputProperties::AllLevels,
-        m_renderSettings.m_applyShrinkToViewer ? m_renderSettings.m_shrinkX : 1,
-        false);
+    fxPair.m_frameB = ::buildSceneFx(scene, xsh, frame,
+                                     TOutputProperties::AllLevels, shrink,
+                                     false);
 
     scene->shiftCameraX(-m_renderSettings.m_stereoscopicShift / 2.0);
   } else
-    fxPair.m_frameA = ::buildSceneFx(
-        scene, xsh, frame, TOutputProperties::AllLevels,
-        m_renderSettings.m_applyShrinkToViewer ? m_renderSettings.m_shrinkX : 1,
-        false);
+    fxPair.m_frameA = ::buildSceneFx(scene, xsh, frame,
+                                     TOutputProperties::AllLevels, shrink,
+                                     false);
+
+  fxPair.m_frameA = optimizeSceneFx(fxPair.m_frameA, frame);
+  fxPair.m_frameB = optimizeSceneFx(fxPair.m_frameB, frame);
 
   return fxPair;
 }
 
 //-----------------------------------------------------------------------------
 
+std::string Previewer::Imp::getAlias(const TFxPair &fxPair, int frame) const {
+  std::string alias =
+      fxPair.m_frameA ? fxPair.m_frameA->getAlias(frame, m_renderSettings) : "";
+  if (fxPair.m_frameB)
+    alias += fxPair.m_frameB->getAlias(frame, m_renderSettings);
+
+  return alias;
+}
+
+//-----------------------------------------------------------------------------
+
 void Previewer::Imp::updateCamera() {
   // Retrieve current camera
   TCamera *currCamera =
@@ -333,8 +456,7 @@ void Previewer::Imp::updateCamera() {
     // All previously rendered frames must be erased
     std::map<int, FrameInfo>::iterator it;
     for (it = m_frames.begin(); it != m_frames.end(); ++it)
-      TImageCache::instance()->remove(m_cachePrefix +
-                                      std::to_string(it->first));
+      releaseCachedImages(it->first);
 
     m_frames.clear();
   }
@@ -358,8 +480,7 @@ void Previewer::Imp::updateRenderSettings() {
 
     std::map<int, FrameInfo>::iterator it;
     for (it = m_frames.begin(); it != m_frames.end(); ++it)
-      TImageCache::instance()->remove(m_cachePrefix +
-                                      std::to_string(it->first));
+      releaseCachedImages(it->first);
 
     m_frames.clear();
   }
@@ -376,7 +497,7 @@ void Previewer::Imp::updateFrameRange() {
       jt = m_frames.lower_bound(newFrameCount);
   for (it = jt; it != m_frames.end(); ++it)
     // Release all associated cached images
-    TImageCache::instance()->remove(m_cachePrefix + std::to_string(it->first));
+    releaseCachedImages(it->first);
 
   m_frames.erase(jt, m_frames.end());
 
@@ -394,37 +515,52 @@ void Previewer::Imp::updateProgressBarStatus() {
   std::map<int, FrameInfo>::iterator it;
   for (i = 0; i < pbSize; ++i) {
     it = m_frames.find(i);
-    m_pbStatus[i] =
-        (it == m_frames.end())
-            ? FlipSlider::PBFrameNotStarted
-            : ::contains(it->second.m_renderedRegion, m_previewRect)
-                  ? FlipSlider::PBFrameFinished
-                  : it->second.m_rectUnderRender.contains(m_previewRect)
-                        ? FlipSlider::PBFrameStarted
-                        : FlipSlider::PBFrameNotStarted;
+    m_pbStatus[i] = (it == m_frames.end()) ? FlipSlider::PBFrameNotStarted
+                                           : getProgressBarStatus(it->second);
   }
 }
 
 //-----------------------------------------------------------------------------
 
+//! Frames are finished only once rendered as a whole - in region of interest
+//! mode, frames whose visible area is rendered are just started.
+UCHAR Previewer::Imp::getProgressBarStatus(const FrameInfo &info) const {
+  return ::contains(info.m_renderedRegion, m_frameRect)
+             ? FlipSlider::PBFrameFinished
+             : ::contains(info.m_renderedRegion +
+                              toQRect(info.m_rectUnderRender),
+                          m_previewRect)
+                   ? FlipSlider::PBFrameStarted
+                   : FlipSlider::PBFrameNotStarted;
+}
+
+//-----------------------------------------------------------------------------
+
 void Previewer::Imp::updatePreviewRect() {
-  TRectD previewRectD;
+  // Retrieve the view rects from each listener. Their union will form the
+  // rect to be rendered.
+  TRectD viewRectD;
+  std::set<Previewer::Listener *>::iterator it;
+  for (it = m_listeners.begin(); it != m_listeners.end(); ++it) {
+    // Retrieve the listener's viewRect and add it to the preview rect
+    viewRectD += (*it)->getPreviewRect();
+  }
 
   /*--
    * SubCameraPreviewではない場合、Viewerの表示エリアに関係なく全画面で計算を行う
    * --*/
-  if (!m_subcamera)
-    previewRectD = m_renderArea;
-  else {
-    // Retrieve the view rects from each listener. Their union will form the
-    // rect to be rendered.
-    std::set<Previewer::Listener *>::iterator it;
-    for (it = m_listeners.begin(); it != m_listeners.end(); ++it) {
-      // Retrieve the listener's viewRect and add it to the preview rect
-      previewRectD += (*it)->getPreviewRect();
-    }
-  }
+  m_frameRect = toPreviewRect(m_subcamera ? viewRectD : m_renderArea);
+  m_previewRect =
+      Preferences::instance()->isRegionOfInterestPreviewEnabled()
+          ? toPreviewRect(viewRectD)
+          : m_frameRect;
+
+  setRenderArea(toRenderArea(m_previewRect));
+}
+
+//-----------------------------------------------------------------------------
 
+TRect Previewer::Imp::toPreviewRect(TRectD previewRectD) const {
   previewRectD *= m_renderArea;
 
   int shrinkX = m_renderSettings.m_shrinkX;
@@ -447,12 +583,40 @@ void Previewer::Imp::updatePreviewRect() {
   previewRectD.x1 = tceil(previewRectD.x1);
   previewRectD.y1 = tceil(previewRectD.y1);
 
-  m_previewRect = TRect(previewRectD.x0, previewRectD.y0, previewRectD.x1 - 1,
-                        previewRectD.y1 - 1);
+  return TRect(previewRectD.x0, previewRectD.y0, previewRectD.x1 - 1,
+               previewRectD.y1 - 1);
+}
+
+//-----------------------------------------------------------------------------
+
+TRectD Previewer::Imp::toRenderArea(const TRect &rect, int pass) const {
+  int shrinkX = m_renderSettings.m_shrinkX * pass;
+  int shrinkY = m_renderSettings.m_shrinkY * pass;
+
+  TPointD shrinkedRelPos((m_renderArea.x0 - m_cameraPos.x) / shrinkX,
+                         (m_renderArea.y0 - m_cameraPos.y) / shrinkY);
+
+  return TRectD(rect.x0, rect.y0, rect.x1 + 1, rect.y1 + 1) + m_cameraPos +
+         shrinkedRelPos;
+}
 
-  previewRectD += m_cameraPos + shrinkedRelPos;
+//-----------------------------------------------------------------------------
 
-  setRenderArea(previewRectD);
+//! Returns the pixels of a coarse pass raster covering the passed rect.
+TRect Previewer::Imp::toPassRect(const TRect &rect, int pass) const {
+  if (pass <= 1) return rect;
+
+  TRect passRect(rect.x0 / pass, rect.y0 / pass, rect.x1 / pass,
+                 rect.y1 / pass);
+  return passRect *
+         TRect(TDimension(m_cameraRes.lx / pass, m_cameraRes.ly / pass));
+}
+
+//-----------------------------------------------------------------------------
+
+void Previewer::Imp::releaseCachedImages(int frame) {
+  TImageCache::instance()->remove(m_cachePrefix + std::to_string(frame));
+  TImageCache::instance()->remove(getCoarseCacheId(frame));
 }
 
 //-----------------------------------------------------------------------------
@@ -460,18 +624,16 @@ void Previewer::Imp::updatePreviewRect() {
 void Previewer::Imp::updateAliases() {
   std::map<int, FrameInfo>::iterator it;
   for (it = m_frames.begin(); it != m_frames.end(); ++it) {
-    TFxPair fxPair = buildSceneFx(it->first);
+    TFxPair fxPair = buildSceneFx(it->first, it->second.m_aliasPass);
 
-    std::string newAlias =
-        fxPair.m_frameA ? fxPair.m_frameA->getAlias(it->first, m_renderSettings)
-                        : "";
-    newAlias = newAlias + (fxPair.m_frameB ? fxPair.m_frameB->getAlias(
-                                                 it->first, m_renderSettings)
-                                           : "");
-
-    if (newAlias != it->second.m_alias) {
+    if (getAlias(fxPair, it->first) != it->second.m_alias) {
       // Clear the remaining frame infos
       it->second.m_renderedRegion = QRegion();
+
+      // Outdated speculations are useless
+      abortSpeculativeRender(it->second);
+      abortTileRender(it->second);
+      abortProgressiveRender(it->second);
     }
   }
 }
@@ -482,18 +644,16 @@ void Previewer::Imp::updateAliasKeyword(const std::string &keyword) {
   std::map<int, FrameInfo>::iterator it;
   for (it = m_frames.begin(); it != m_frames.end(); ++it) {
     if (it->second.m_alias.find(keyword) != std::string::npos) {
-      TFxPair fxPair     = buildSceneFx(it->first);
-      it->second.m_alias = fxPair.m_frameA ? fxPair.m_frameA->getAlias(
-                                                 it->first, m_renderSettings)
-                                           : "";
-      it->second.m_alias = it->second.m_alias +
-                           (fxPair.m_frameB ? fxPair.m_frameB->getAlias(
-                                                  it->first, m_renderSettings)
-                                            : "");
+      TFxPair fxPair     = buildSceneFx(it->first, it->second.m_aliasPass);
+      it->second.m_alias = getAlias(fxPair, it->first);
 
       // Clear the remaining frame infos
       it->second.m_renderedRegion = QRegion();
 
+      abortSpeculativeRender(it->second);
+      abortTileRender(it->second);
+      abortProgressiveRender(it->second);
+
       // No need to release the cached image... eventually, clear it
       TRasterImageP ri = TImageCache::instance()->get(
           m_cachePrefix + std::to_string(it->first), true);
@@ -504,8 +664,9 @@ void Previewer::Imp::updateAliasKeyword(const std::string &keyword) {
 
 //-----------------------------------------------------------------------------
 
-//! Starts rendering the passed frame.
-void Previewer::Imp::refreshFrame(int frame) {
+//! Starts rendering the passed frame. Speculative renders never replace
+//! on-demand ones.
+void Previewer::Imp::refreshFrame(int frame, bool speculative) {
   if (suspendedRendering) return;
 
   // Build the region to render
@@ -513,6 +674,10 @@ void Previewer::Imp::refreshFrame(int frame) {
 
   if (m_previewRect.getLx() <= 0 || m_previewRect.getLy() <= 0) return;
 
+  bool roi   = Preferences::instance()->isRegionOfInterestPreviewEnabled();
+  TRect rect = roi ? toTiles(m_previewRect, TRect(m_cameraRes))
+                   : m_previewRect;
+
   // Retrieve the FrameInfo for passed frame
   std::map<int, FrameInfo>::iterator it = m_frames.find(frame);
   if (it != m_frames.end()) {
@@ -520,12 +685,28 @@ void Previewer::Imp::refreshFrame(int frame) {
     // region, quit
     if (::contains(it->second.m_renderedRegion, m_previewRect)) return;
 
+    // In region of interest mode, render just the missing tiles
+    if (roi)
+      rect = toTiles(toTRect(QRegion(toQRect(m_previewRect))
+                                 .subtracted(it->second.m_renderedRegion)
+                                 .boundingRect()),
+                     TRect(m_cameraRes));
+
+    bool underRender = !it->second.m_rectUnderRender.isEmpty();
+    if (speculative && underRender && !it->second.m_speculative) return;
+
     // Then, check the m_previewRect against the frame's m_rectUnderRendering.
-    // Ensure that we're not re-launching the very same render.
-    if (it->second.m_rectUnderRender == m_previewRect) return;
+    // Ensure that we're not re-launching the very same render - unless an
+    // on-demand request finds a speculative render still waiting to start.
+    if (it->second.m_rectUnderRender == rect) {
+      bool waiting = it->second.m_speculative && !speculative &&
+                     frame < (int)m_pbStatus.size() &&
+                     m_pbStatus[frame] != FlipSlider::PBFrameStarted;
+      if (!waiting) return;
+    }
 
     // Stop any frame's previously running render process
-    m_renderer.abortRendering(it->second.m_renderId);
+    getRenderer(it->second).abortRendering(it->second.m_renderId);
   } else {
     it = m_frames.insert(std::make_pair(frame, FrameInfo())).first;
 
@@ -535,18 +716,34 @@ void Previewer::Imp::refreshFrame(int frame) {
     if (frame >= (int)m_pbStatus.size()) m_pbStatus.resize(frame + 1);
   }
 
-  // Build the TFxPair to be passed to TRenderer
-  TFxPair fxPair = buildSceneFx(frame);
+  // In progressive mode, frames with nothing to show start from coarse passes -
+  // or from the one following the finest cached pass
+  int pass = 0;
+  if (!speculative && it->second.m_renderedRegion.isEmpty() &&
+      Preferences::instance()->isProgressivePreviewEnabled()) {
+    bool coarseReady = !it->second.m_coarseRegion.isEmpty() &&
+                       ::contains(it->second.m_coarseRegion, m_previewRect);
+    pass = coarseReady ? std::max(it->second.m_coarseShrink / 2, 1) : 8;
+
+    while (pass > 1 && toPassRect(rect, pass).isEmpty()) pass /= 2;
+  }
+
+  // Build the TFxPair to be passed to TRenderer - coarse passes render a
+  // tree built at their shrink, and the frame's alias is taken from it
+  int treePass   = std::max(pass, 1);
+  TFxPair fxPair = buildSceneFx(frame, treePass);
 
   // Update the RenderInfos associated with frame
-  it->second.m_rectUnderRender = m_previewRect;
-  it->second.m_alias = fxPair.m_frameA->getAlias(frame, m_renderSettings);
-  if (fxPair.m_frameB)
-    it->second.m_alias =
-        it->second.m_alias + fxPair.m_frameB->getAlias(frame, m_renderSettings);
+  it->second.m_rectUnderRender = rect;
+  it->second.m_speculative     = speculative;
+  it->second.m_pass            = pass;
+  it->second.m_aliasPass       = treePass;
+  it->second.m_alias           = getAlias(fxPair, frame);
+
+  TRenderer &renderer = getRenderer(it->second);
 
   // Retrieve the renderId of the rendering instance
-  it->second.m_renderId = m_renderer.nextRenderId();
+  it->second.m_renderId = renderer.nextRenderId();
   std::string contextName("P");
   contextName += m_subcamera ? "SC" : "FU";
   contextName += std::to_string(frame);
@@ -554,7 +751,158 @@ void Previewer::Imp::refreshFrame(int frame) {
                                                    contextName);
 
   // Start the render
-  m_renderer.startRendering(frame, m_renderSettings, fxPair);
+  if (pass > 1) {
+    TRenderSettings renderSettings(m_renderSettings);
+    renderSettings.m_shrinkX *= pass;
+    renderSettings.m_shrinkY *= pass;
+
+    renderer.startRendering(frame, renderSettings, fxPair,
+                            toRenderArea(toPassRect(rect, pass), pass));
+  } else
+    renderer.startRendering(frame, m_renderSettings, fxPair,
+                            toRenderArea(rect));
+}
+
+//-----------------------------------------------------------------------------
+
+void Previewer::Imp::abortSpeculativeRender(FrameInfo &info) {
+  if (!info.m_speculative || info.m_rectUnderRender.isEmpty()) return;
+
+  m_speculativeRenderer.abortRendering(info.m_renderId);
+
+  // Forget the render, so that its failure notification is ignored
+  info.m_renderId        = (unsigned long)-1;
+  info.m_rectUnderRender = TRect();
+}
+
+//-----------------------------------------------------------------------------
+
+//! Renders in background the next missing tile of the frame, once its region
+//! of interest is complete. Tiles nearer to the region of interest come first.
+void Previewer::Imp::renderNextTile(int frame) {
+  if (suspendedRendering || m_listeners.empty() ||
+      !Preferences::instance()->isRegionOfInterestPreviewEnabled())
+    return;
+
+  // Only the current frame is completed
+  if (frame != TApp::instance()->getCurrentFrame()->getFrame()) return;
+
+  std::map<int, FrameInfo>::iterator it = m_frames.find(frame);
+  if (it == m_frames.end()) return;
+
+  FrameInfo &info = it->second;
+  if (!info.m_rectUnderRender.isEmpty() || !info.m_tileUnderRender.isEmpty() ||
+      !::contains(info.m_renderedRegion, m_previewRect))
+    return;
+
+  // Search the nearest missing tile
+  TRect cameraRect(m_cameraRes), nextTile;
+  TPointD center(0.5 * (m_previewRect.x0 + m_previewRect.x1),
+                 0.5 * (m_previewRect.y0 + m_previewRect.y1));
+  double minDist2 = -1.0;
+
+  int x, y;
+  for (y = 0; y < m_cameraRes.ly; y += roiTileSize)
+    for (x = 0; x < m_cameraRes.lx; x += roiTileSize) {
+      TRect tile(x, y, x + roiTileSize - 1, y + roiTileSize - 1);
+      tile *= cameraRect;
+
+      if (::contains(info.m_renderedRegion, tile)) continue;
+
+      TPointD tileCenter(0.5 * (tile.x0 + tile.x1), 0.5 * (tile.y0 + tile.y1));
+      double dist2 = norm2(tileCenter - center);
+      if (minDist2 < 0.0 || dist2 < minDist2) {
+        minDist2 = dist2;
+        nextTile = tile;
+      }
+    }
+
+  if (nextTile.isEmpty()) return;  // The frame is complete
+
+  TFxPair fxPair = buildSceneFx(frame);
+
+  info.m_tileUnderRender = nextTile;
+  info.m_tileRenderId    = m_speculativeRenderer.nextRenderId();
+  m_tileRenderIds.insert(info.m_tileRenderId);
+
+  std::string contextName("P");
+  contextName += m_subcamera ? "SC" : "FU";
+  contextName += std::to_string(frame);
+  TPassiveCacheManager::instance()->setContextName(info.m_tileRenderId,
+                                                   contextName);
+
+  m_speculativeRenderer.startRendering(frame, m_renderSettings, fxPair,
+                                       toRenderArea(nextTile));
+}
+
+//-----------------------------------------------------------------------------
+
+void Previewer::Imp::abortTileRender(FrameInfo &info) {
+  if (info.m_tileUnderRender.isEmpty()) return;
+
+  m_speculativeRenderer.abortRendering(info.m_tileRenderId);
+  info.m_tileUnderRender = TRect();
+}
+
+//-----------------------------------------------------------------------------
+
+void Previewer::Imp::abortProgressiveRender(FrameInfo &info) {
+  // Cached coarse passes are outdated too
+  info.m_coarseShrink = 0;
+  info.m_coarseRegion = QRegion();
+
+  if (info.m_pass <= 0 || info.m_rectUnderRender.isEmpty()) return;
+
+  getRenderer(info).abortRendering(info.m_renderId);
+
+  // Forget the render, so that its failure notification is ignored. The next
+  // request restarts from the coarsest pass.
+  info.m_renderId        = (unsigned long)-1;
+  info.m_rectUnderRender = TRect();
+  info.m_pass            = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+void Previewer::Imp::speculate() {
+  int frameCount = Preferences::instance()->getSpeculativePreviewFrameCount();
+  if (frameCount <= 0 || suspendedRendering || m_listeners.empty()) return;
+
+  // Speculate only when idle - that is, with no on-demand render running
+  std::map<int, FrameInfo>::iterator it;
+  for (it = m_frames.begin(); it != m_frames.end(); ++it)
+    if (!it->second.m_speculative && !it->second.m_rectUnderRender.isEmpty()) {
+      m_speculationTimer.start();
+      return;
+    }
+
+  int cpuShare = Preferences::instance()->getSpeculativePreviewCpuShare();
+  m_speculativeRenderer.setThreadsCount(
+      std::max(1, TSystem::getProcessorCount() * cpuShare / 100));
+
+  // The window extends mostly in the moving direction
+  int currentFrame = TApp::instance()->getCurrentFrame()->getFrame();
+
+  std::vector<int> frames;
+  int i, lastFrame = (int)m_pbStatus.size();
+  for (i = 1; i <= frameCount; ++i) {
+    int frame = currentFrame + i * m_direction;
+    if (0 <= frame && frame < lastFrame) frames.push_back(frame);
+  }
+  for (i = 1; i <= frameCount / 2; ++i) {
+    int frame = currentFrame - i * m_direction;
+    if (0 <= frame && frame < lastFrame) frames.push_back(frame);
+  }
+
+  // Abort the speculations which fell out of the window
+  for (it = m_frames.begin(); it != m_frames.end(); ++it)
+    if (std::find(frames.begin(), frames.end(), it->first) == frames.end())
+      abortSpeculativeRender(it->second);
+
+  std::vector<int>::iterator ft;
+  for (ft = frames.begin(); ft != frames.end(); ++ft) refreshFrame(*ft, true);
+
+  updateProgressBarStatus();
 }
 
 //-----------------------------------------------------------------------------
@@ -563,23 +911,25 @@ void Previewer::Imp::remove(int frame) {
   // Search the frame among rendered ones
   std::map<int, FrameInfo>::iterator it = m_frames.find(frame);
   if (it != m_frames.end()) {
-    m_renderer.abortRendering(it->second.m_renderId);
+    getRenderer(it->second).abortRendering(it->second.m_renderId);
+    abortTileRender(it->second);
     m_frames.erase(frame);
   }
 
   // Remove the associated image from cache
-  TImageCache::instance()->remove(m_cachePrefix + std::to_string(frame));
+  releaseCachedImages(frame);
 }
 
 //-----------------------------------------------------------------------------
 
 void Previewer::Imp::remove() {
   m_renderer.stopRendering(false);
+  m_speculativeRenderer.stopRendering(false);
 
   // Remove all cached images
   std::map<int, FrameInfo>::iterator it;
   for (it = m_frames.begin(); it != m_frames.end(); ++it)
-    TImageCache::instance()->remove(m_cachePrefix + std::to_string(it->first));
+    releaseCachedImages(it->first);
 
   m_frames.clear();
 }
@@ -614,6 +964,9 @@ inline void Previewer::Imp::notifyUpdate() {
   std::set<Previewer::Listener *>::iterator it;
   for (it = m_listeners.begin(); it != m_listeners.end(); ++it)
     (*it)->onPreviewUpdate();
+
+  // Speculate again on the updated scene
+  m_speculationTimer.start();
 }
 
 //-----------------------------------------------------------------------------
@@ -629,6 +982,9 @@ void Previewer::Imp::onRenderRasterStarted(const RenderData &renderData) {
 void Previewer::Imp::doOnRenderRasterStarted(const RenderData &renderData) {
   int frame = renderData.m_frames[0];
 
+  // Background tiles do not affect the frame status
+  if (m_tileRenderIds.count(renderData.m_renderId)) return;
+
   m_computingFrameCount++;
 
   // Update the progress bar status
@@ -675,14 +1031,26 @@ void Previewer::Imp::doOnRenderRasterCompleted(const RenderData &renderData) {
 
   TRasterP ras(renderData.m_rasA);
 
-  m_computingFrameCount--;
+  bool isTile = m_tileRenderIds.erase(renderId) > 0;
+  if (!isTile) m_computingFrameCount--;
 
   // Find the render infos in the Previewer
   std::map<int, FrameInfo>::iterator it = m_frames.find(frame);
   if (it == m_frames.end()) return;
 
   // Ensure that the render process id is the same
-  if (renderId != it->second.m_renderId) return;
+  if (renderId !=
+      (isTile ? it->second.m_tileRenderId : it->second.m_renderId))
+    return;
+
+  TRect &renderedRect =
+      isTile ? it->second.m_tileUnderRender : it->second.m_rectUnderRender;
+
+  // Coarse passes are stored apart, and followed by the next finer pass
+  if (!isTile && it->second.m_pass > 1) {
+    storeCoarsePass(it->second, frame, ras);
+    return;
+  }
 
   // Store the rendered image in the cache - this is done in the MAIN thread due
   // to the necessity of accessing it->second.m_rectUnderRender for raster
@@ -702,9 +1070,8 @@ void Previewer::Imp::doOnRenderRasterCompleted(const RenderData &renderData) {
   }
 
   // Finally, copy the rendered raster over the cached one
-  TRect rectUnderRender(
-      it->second
-          .m_rectUnderRender);  // Extract may MODIFY IT! E.g. with shrinks..!
+  TRect rectUnderRender(renderedRect);  // Extract may MODIFY IT! E.g. with
+                                       // shrinks..!
   cachedRas = cachedRas->extract(rectUnderRender);
   if (cachedRas) {
     cachedRas->copy(ras);
@@ -712,15 +1079,65 @@ void Previewer::Imp::doOnRenderRasterCompleted(const RenderData &renderData) {
   }
 
   // Update the FrameInfo
-  it->second.m_renderedRegion += toQRect(it->second.m_rectUnderRender);
-  it->second.m_rectUnderRender = TRect();
+  it->second.m_renderedRegion += toQRect(renderedRect);
+  renderedRect = TRect();
 
   // Update the progress bar status
   if (frame < m_pbStatus.size())
-    m_pbStatus[frame] = FlipSlider::PBFrameFinished;
+    m_pbStatus[frame] = getProgressBarStatus(it->second);
 
   // Notify listeners
   notifyCompleted(frame);
+
+  // Go on with the rest of the frame, in region of interest mode
+  renderNextTile(frame);
+}
+
+//-----------------------------------------------------------------------------
+
+void Previewer::Imp::storeCoarsePass(FrameInfo &info, int frame,
+                                     const TRasterP &ras) {
+  int pass = info.m_pass;
+
+  // Each pass replaces the previous one
+  std::string str = getCoarseCacheId(frame);
+
+  TRasterImageP ri(TImageCache::instance()->get(str, true));
+  TRasterP cachedRas(ri ? ri->getRaster() : TRasterP());
+
+  TDimension passRes(m_cameraRes.lx / pass, m_cameraRes.ly / pass);
+  if (!cachedRas || info.m_coarseShrink != pass ||
+      cachedRas->getSize() != passRes) {
+    TImageCache::instance()->remove(str);
+
+    cachedRas = ras->create(passRes.lx, passRes.ly);
+    cachedRas->clear();
+    ri = TRasterImageP(cachedRas);
+
+    info.m_coarseRegion = QRegion();
+  }
+
+  TRect passRect(toPassRect(info.m_rectUnderRender, pass));
+  cachedRas = cachedRas->extract(passRect);
+  if (cachedRas) {
+    cachedRas->copy(ras);
+    TImageCache::instance()->add(str, ri);
+  }
+
+  info.m_coarseShrink = pass;
+  info.m_coarseRegion += toQRect(info.m_rectUnderRender);
+  info.m_rectUnderRender = TRect();
+  info.m_pass            = 0;
+
+  if (frame < m_pbStatus.size())
+    m_pbStatus[frame] = FlipSlider::PBFrameNotStarted;
+
+  // Notify listeners - they will show the pass in place of the previous one
+  notifyCompleted(frame);
+
+  // Refine the current frame
+  if (frame == TApp::instance()->getCurrentFrame()->getFrame())
+    refreshFrame(frame);
 }
 
 //-----------------------------------------------------------------------------
@@ -736,10 +1153,20 @@ void Previewer::Imp::onRenderFailure(const RenderData &renderData,
 
 //! Adds the renderized image to TImageCache; listeneres are advised too.
 void Previewer::Imp::doOnRenderRasterFailed(const RenderData &renderData) {
-  m_computingFrameCount--;
-
   int frame = (int)renderData.m_frames[0];
 
+  if (m_tileRenderIds.erase(renderData.m_renderId)) {
+    // A failed background tile is just forgotten
+    std::map<int, FrameInfo>::iterator it = m_frames.find(frame);
+    if (it != m_frames.end() &&
+        renderData.m_renderId == it->second.m_tileRenderId)
+      it->second.m_tileUnderRender = TRect();
+
+    return;
+  }
+
+  m_computingFrameCount--;
+
   std::map<int, FrameInfo>::iterator it = m_frames.find(frame);
   if (it == m_frames.end()) return;
 
@@ -1023,6 +1450,11 @@ Previewer::Previewer(bool subcamera) : m_imp(new Imp(this)) {
   ret = ret && connect(&objectChangedTimer, SIGNAL(timeout()), this,
                        SLOT(onObjectChanged()));
 
+  ret = ret && connect(app->getCurrentFrame(), SIGNAL(frameSwitched()), this,
+                       SLOT(onFrameSwitched()));
+  ret = ret && connect(&m_imp->m_speculationTimer, SIGNAL(timeout()), this,
+                       SLOT(speculate()));
+
   qRegisterMetaType<TRenderPort::RenderData>("TRenderPort::RenderData");
 
   ret = ret && connect(this, SIGNAL(startedFrame(TRenderPort::RenderData)),
@@ -1084,6 +1516,8 @@ void Previewer::removeListener(Listener *listener) {
 
   if (m_imp->m_listeners.empty()) {
     m_imp->m_renderer.stopRendering(false);
+    m_imp->m_speculativeRenderer.stopRendering(false);
+    m_imp->m_speculationTimer.stop();
 
     // Release all used context names
     std::string prefix("P");
@@ -1162,6 +1596,15 @@ TRasterP Previewer::getRaster(int frame, bool renderIfNeeded) const {
       }
     }
 
+    // Show the finest coarse pass while the frame is being refined
+    const Imp::FrameInfo &info = it->second;
+    if (info.m_renderedRegion.isEmpty() && !info.m_coarseRegion.isEmpty() &&
+        ::contains(info.m_coarseRegion, m_imp->m_previewRect)) {
+      TRasterImageP rimg = (TRasterImageP)TImageCache::instance()->get(
+          m_imp->getCoarseCacheId(frame), false);
+      if (rimg) return rimg->getRaster();
+    }
+
     // Retrieve the cached image, if any
     std::string str = m_imp->m_cachePrefix + std::to_string(frame);
     TRasterImageP rimg =
@@ -1380,6 +1823,29 @@ void Previewer::onFailedFrame(TRenderPort::RenderData renderData) {
 
 //-----------------------------------------------------------------------------
 
+void Previewer::onFrameSwitched() {
+  if (m_imp->m_listeners.empty()) return;
+
+  int frame = TApp::instance()->getCurrentFrame()->getFrame();
+  if (frame != m_imp->m_lastFrame)
+    m_imp->m_direction = (frame > m_imp->m_lastFrame) ? 1 : -1;
+  m_imp->m_lastFrame = frame;
+
+  // Wait until the current frame stays still
+  m_imp->m_speculationTimer.start();
+}
+
+//-----------------------------------------------------------------------------
+
+void Previewer::speculate() {
+  m_imp->speculate();
+
+  // Complete the current frame beyond the region of interest, if needed
+  m_imp->renderNextTile(TApp::instance()->getCurrentFrame()->getFrame());
+}
+
+//-----------------------------------------------------------------------------
+
 //! The suspendRendering method allows suspension of the previewer's rendering
 //! activity for safety purposes, typically related to the fact that no
 //! rendering
@@ -1394,8 +1860,12 @@ void Previewer::onFailedFrame(TRenderPort::RenderData renderData) {
 //! is allowed to bypass such limitation.
 void Previewer::suspendRendering(bool suspend) {
   suspendedRendering = suspend;
-  if (suspend && previewerInstance)
+  if (suspend && previewerInstance) {
     previewerInstance->m_imp->m_renderer.stopRendering(true);
-  if (suspend && previewerInstanceSC)
+    previewerInstance->m_imp->m_speculativeRenderer.stopRendering(true);
+  }
+  if (suspend && previewerInstanceSC) {
     previewerInstanceSC->m_imp->m_renderer.stopRendering(true);
+    previewerInstanceSC->m_imp->m_speculativeRenderer.stopRendering(true);
+  }
 }
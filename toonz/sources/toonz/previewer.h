@@ -118,6 +118,9 @@ protected slots:
   void onStartedFrame(TRenderPort::RenderData renderData);
   void onRenderedFrame(TRenderPort::RenderData renderData);
   void onFailedFrame(TRenderPort::RenderData renderData);
+
+  void onFrameSwitched();
+  void speculate();
 };
 
 #endif
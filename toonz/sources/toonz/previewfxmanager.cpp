@@ -283,12 +283,15 @@ inline TFxP PreviewFxInstance::buildSceneFx(int frame) {
   TApp *app         = TApp::instance();
   ToonzScene *scene = app->getCurrentScene()->getScene();
 
+  TFxP fx;
   if (isFullPreview())
-    return ::buildSceneFx(scene, m_xsheet.getPointer(), frame,
-                          m_renderSettings.m_shrinkX, true);
+    fx = ::buildSceneFx(scene, m_xsheet.getPointer(), frame,
+                        m_renderSettings.m_shrinkX, true);
   else
-    return ::buildPartialSceneFx(scene, m_xsheet.getPointer(), frame, m_fx,
-                                 m_renderSettings.m_shrinkX, true);
+    fx = ::buildPartialSceneFx(scene, m_xsheet.getPointer(), frame, m_fx,
+                               m_renderSettings.m_shrinkX, true);
+
+  return optimizeSceneFx(fx, frame);
 }
 
 //------------------------------------------------------------------
@@ -53,7 +53,8 @@ static void printCurrentFrame() {
   }
   raster->fill(scene->getProperties()->getBgColor());
   scene->renderFrame(raster, frame,
-                     TApp::instance()->getCurrentXsheet()->getXsheet());
+                     TApp::instance()->getCurrentXsheet()->getXsheet(), true,
+                     0);
   QImage img = rasterToQImage(raster);
   QPainter painter(&printer);
   QRect rect = painter.viewport();
@@ -8,6 +8,8 @@
 #include "flipbook.h"
 #include "filebrowsermodel.h"
 #include "previewfxmanager.h"
+#include "filebrowserpopup.h"
+#include "menubarcommandids.h"
 
 // TnzQt includes
 #include "toonzqt/menubarcommand.h"
@@ -39,6 +41,7 @@
 #include "tenv.h"
 #include "trenderer.h"
 #include "trasterfx.h"
+#include "trenderprofiler.h"
 #include "iocommand.h"
 
 // TnzCore includes
@@ -46,6 +49,7 @@
 #include "tiio.h"
 #include "trop.h"
 #include "tconvert.h"
+#include "tfilepath_io.h"
 #include "tfiletype.h"
 #include "timagecache.h"
 #include "tthreadmessage.h"
@@ -863,3 +867,56 @@ void RenderCommand::doRender(bool isPreview) {
 }
 
 //===================================================================
+
+class ProfileRendersCommand final : public MenuItemHandler {
+public:
+  ProfileRendersCommand() : MenuItemHandler(MI_ProfileRenders) {}
+
+  void execute() override {
+    QAction *action = CommandManager::instance()->getAction(MI_ProfileRenders);
+    bool on         = action && action->isChecked();
+
+    // Each recording session starts from scratch
+    TRenderProfiler *profiler = TRenderProfiler::instance();
+    if (on) profiler->clear();
+    profiler->enable(on);
+  }
+} profileRendersCommand;
+
+//===================================================================
+
+class ExportRenderProfileCommand final : public MenuItemHandler {
+public:
+  ExportRenderProfileCommand() : MenuItemHandler(MI_ExportRenderProfile) {}
+
+  void execute() override {
+    TRenderProfiler *profiler = TRenderProfiler::instance();
+    if (profiler->isEmpty()) {
+      DVGui::warning(
+          QObject::tr("No render profile has been recorded. Activate Profile "
+                      "Renders, then preview or render the scene."));
+      return;
+    }
+
+    static GenericSaveFilePopup *popup = 0;
+    if (!popup) {
+      popup = new GenericSaveFilePopup(QObject::tr("Export Render Profile"));
+      popup->setFilterTypes(QStringList("json"));
+    }
+
+    TFilePath fp = popup->getPath();
+    if (fp.isEmpty()) return;
+
+    if (!profiler->exportTrace(fp)) {
+      DVGui::warning(QObject::tr("It is not possible to save the file %1.")
+                         .arg(toQString(fp)));
+      return;
+    }
+
+    // Store the per-fx summary next to the trace
+    Tofstream os(fp.withType("txt"));
+    if (os.isOpen()) os << profiler->getSummary();
+  }
+} exportRenderProfileCommand;
+
+//===================================================================
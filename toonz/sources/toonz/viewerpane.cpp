@@ -16,6 +16,7 @@
 #include "toonz/toonzscene.h"
 #include "toonz/sceneproperties.h"
 #include "toonz/txsheet.h"
+#include "toonz/soundmixer.h"
 #include "toonz/stage.h"
 #include "toonz/stage2.h"
 #include "toonz/txshlevel.h"
@@ -62,6 +63,7 @@
 #include <QToolBar>
 #include <QMainWindow>
 #include <QSettings>
+#include <QDebug>
 
 enum CV_Parts {
   CVPARTS_None        = 0,
@@ -594,11 +596,23 @@ void SceneViewerPanel::onXshLevelSwitched(TXshLevel *) {
 //-----------------------------------------------------------------------------
 
 void SceneViewerPanel::onPlayingStatusChanged(bool playing) {
+  SoundMixer *mixer =
+      TApp::instance()->getCurrentXsheet()->getXsheet()->getSoundMixer();
   if (playing) {
     m_playing = true;
+    if (mixer) mixer->resetStatistics();
   } else {
     m_playing = false;
     m_first   = true;
+    // report how the sound kept up with the playback
+    if (mixer) {
+      SoundMixer::Statistics stats = mixer->getStatistics();
+      if (stats.m_mixedSampleCount > 0)
+        qDebug() << "Playback sound:" << stats.m_mixedSampleCount
+                 << "samples mixed," << stats.m_underrunCount
+                 << "underruns," << stats.m_silentSampleCount
+                 << "silent samples";
+    }
   }
   if (Preferences::instance()->getOnionSkinDuringPlayback()) return;
   OnionSkinMask osm =
@@ -810,47 +824,23 @@ void SceneViewerPanel::playAudioFrame(int frame) {
                 ->getProperties()
                 ->getOutputProperties()
                 ->getFrameRate();
-    m_samplesPerFrame = m_sound->getSampleRate() / std::abs(m_fps);
   }
-  if (!m_sound) return;
   m_viewerFps = m_flipConsole->getCurrentFps();
-  double s0 = frame * m_samplesPerFrame, s1 = s0 + m_samplesPerFrame;
 
+  TXsheet *xsh = TApp::instance()->getCurrentXsheet()->getXsheet();
   // make the sound stop if the viewerfps is higher so the next sound can play
   // on time.
-  if (m_fps < m_viewerFps)
-    TApp::instance()->getCurrentXsheet()->getXsheet()->stopScrub();
-  TApp::instance()->getCurrentXsheet()->getXsheet()->play(m_sound, s0, s1,
-                                                          false);
+  if (m_fps < m_viewerFps) xsh->stopScrub();
+  xsh->scrub(frame, !m_sceneViewer->isPreviewEnabled());
 }
 
 //-----------------------------------------------------------------------------
 
 bool SceneViewerPanel::hasSoundtrack() {
-  if (m_sound != NULL) {
-    m_sound         = NULL;
-    m_hasSoundtrack = false;
-    m_first         = true;
-  }
-  TXsheetHandle *xsheetHandle    = TApp::instance()->getCurrentXsheet();
-  TXsheet::SoundProperties *prop = new TXsheet::SoundProperties();
-  if (!m_sceneViewer->isPreviewEnabled()) prop->m_isPreview = true;
-  try {
-    m_sound = xsheetHandle->getXsheet()->makeSound(prop);
-  } catch (TSoundDeviceException &e) {
-    if (e.getType() == TSoundDeviceException::NoDevice) {
-      std::cout << ::to_string(e.getMessage()) << std::endl;
-    } else {
-      throw TSoundDeviceException(e.getType(), e.getMessage());
-    }
-  }
-  if (m_sound == NULL) {
-    m_hasSoundtrack = false;
-    return false;
-  } else {
-    m_hasSoundtrack = true;
-    return true;
-  }
+  TXsheet *xsh    = TApp::instance()->getCurrentXsheet()->getXsheet();
+  m_first         = true;
+  m_hasSoundtrack = xsh->hasSound(!m_sceneViewer->isPreviewEnabled());
+  return m_hasSoundtrack;
 }
 
 void SceneViewerPanel::onButtonPressed(FlipConsole::EGadget button) {
@@ -47,9 +47,7 @@ class SceneViewerPanel final : public QFrame,
   bool m_playing       = false;
   double m_fps;
   int m_viewerFps;
-  double m_samplesPerFrame;
-  bool m_first         = true;
-  TSoundTrack *m_sound = NULL;
+  bool m_first = true;
 
 public:
 #if QT_VERSION >= 0x050500
@@ -10,6 +10,10 @@
 #include "timageinfo.h"
 #include "trop.h"
 #include "tsop.h"
+#include "tfilepath_io.h"
+#include "tconvert.h"
+#include "tfunctorinvoker.h"
+#include "tpalette.h"
 
 // TnzLib includes
 #include "toonz/toonzscene.h"
@@ -21,6 +25,10 @@
 #include "toonz/levelupdater.h"
 #include "toutputproperties.h"
 #include "toonz/boardsettings.h"
+#include "toonz/scenefx.h"
+#include "toonz/levelset.h"
+#include "toonz/txshsimplelevel.h"
+#include "toonz/txshpalettelevel.h"
 
 // tcg includes
 #include "tcg/tcg_macros.h"
@@ -119,6 +127,12 @@ public:
   ---*/
   std::map<double, bool> m_toBeAppliedGamma;
 
+  TFilePath m_frameKeysFolder;
+  std::string m_sourcesKey;  //!< Stamps of the files the scene renders from
+  std::map<double, std::string> m_frameKeys;  //!< Frame keys of the frames
+                                              //!< to be recorded when saved
+  int m_duplicateFramesCount;
+
   TThread::Mutex m_mutex;
 
   int m_renderSessionId;
@@ -160,6 +174,22 @@ public:
   //! the associated time-adjusted level frame.
   std::pair<bool, int> saveFrame(double frame,
                                  const std::pair<TRasterP, TRasterP> &rasters);
+  int getOutputFrame(double frame) const;
+
+  //! Returns whether frames with the same content key can be copied among
+  //! different renders.
+  bool canReuseFrames() const;
+  //! Returns the modification times and sizes of the scene and level files,
+  //! or an empty string if some level has unsaved changes.
+  std::string getSourcesKey() const;
+  //! Returns the key recording the frame among renders - that is, its
+  //! content key together with the sources key.
+  std::string getFrameKey(const TRenderer::RenderData &renderData) const;
+  TFilePath getFrameKeyPath(const std::string &key) const;
+  void recordFrameKey(double frame, int fr);
+  //! Saves the specified frame copying the image recorded for its content key;
+  //! returns false if no image is available.
+  bool reuseFrame(double frame, const std::string &key);
   std::string getRenderCacheId();
 
   // returns board duration in frame
@@ -180,6 +210,7 @@ MovieRenderer::Imp::Imp(ToonzScene *scene, const TFilePath &moviePath,
     , m_nextFrameIdxToSave(0)
     , m_savingThreadsCount(0)
     , m_whiteSample(0)
+    , m_duplicateFramesCount(0)
     , m_firstCompletedRaster(
           true)         //< I know, sounds weird - it's just set to false
     , m_failure(false)  //  AFTER the first completed raster gets processed
@@ -379,10 +410,7 @@ std::pair<bool, int> MovieRenderer::Imp::saveFrame(
   bool success = false;
 
   // Build the frame number to write to
-  double stretchFac = double(m_renderSettings.m_timeStretchTo) /
-                      m_renderSettings.m_timeStretchFrom;
-
-  int fr = (stretchFac != 1) ? tround(frame * stretchFac) : int(frame);
+  int fr = getOutputFrame(frame);
 
   int boardDuration = 0;
   if (m_movieType) {
@@ -464,6 +492,152 @@ std::pair<bool, int> MovieRenderer::Imp::saveFrame(
 
 //---------------------------------------------------------------------
 
+int MovieRenderer::Imp::getOutputFrame(double frame) const {
+  double stretchFac = double(m_renderSettings.m_timeStretchTo) /
+                      m_renderSettings.m_timeStretchFrom;
+
+  return (stretchFac != 1) ? tround(frame * stretchFac) : int(frame);
+}
+
+//---------------------------------------------------------------------
+
+bool MovieRenderer::Imp::canReuseFrames() const {
+  // Saved images must be exactly the rendered ones. Movie files cannot be
+  // copied frame by frame, and scene numbering stamps each image differently.
+  return !m_frameKeysFolder.isEmpty() && m_levelUpdaterA.get() &&
+         !m_movieType && !m_renderSettings.m_stereoscopic &&
+         !Preferences::instance()->isSceneNumberingEnabled();
+}
+
+//---------------------------------------------------------------------
+
+std::string MovieRenderer::Imp::getSourcesKey() const {
+  struct locals {
+    static void addStamp(std::string &key, const TFilePath &fp) {
+      TFileStatus fs(fp);
+      key += ::to_string(fp.getWideString()) + ";";
+      if (fs.doesExist()) {
+        qint64 msecs = fs.getLastModificationTime().toMSecsSinceEpoch();
+        key += std::to_string(msecs) + ";" + std::to_string(fs.getSize());
+      }
+      key += "\n";
+    }
+  };
+
+  std::string key;
+  locals::addStamp(key, m_scene->getScenePath());
+
+  TLevelSet *levelSet = m_scene->getLevelSet();
+  for (int l = 0, lCount = levelSet->getLevelCount(); l != lCount; ++l) {
+    TXshLevel *xl = levelSet->getLevel(l);
+
+    if (TXshSimpleLevel *sl = xl->getSimpleLevel()) {
+      if (sl->getDirtyFlag() ||
+          (sl->getPalette() && sl->getPalette()->getDirtyFlag()))
+        return std::string();
+
+      TFilePath path = m_scene->decodeFilePath(sl->getPath());
+      if (path.isLevelName()) {
+        // Each frame of a sequence is a separate file
+        std::vector<TFrameId> fids;
+        sl->getFids(fids);
+
+        for (int f = 0; f != int(fids.size()); ++f)
+          locals::addStamp(key, path.withFrame(fids[f]));
+      } else
+        locals::addStamp(key, path);
+
+      // Toonz raster palettes are saved beside the level
+      if (sl->getType() == TZP_XSHLEVEL)
+        locals::addStamp(key, path.withNoFrame().withType("tpl"));
+    } else if (TXshPaletteLevel *pl = xl->getPaletteLevel()) {
+      if (pl->getPalette() && pl->getPalette()->getDirtyFlag())
+        return std::string();
+
+      locals::addStamp(key, m_scene->decodeFilePath(pl->getPath()));
+    }
+  }
+
+  return TRasterFxKey::hash(key).toString();
+}
+
+//---------------------------------------------------------------------
+
+std::string MovieRenderer::Imp::getFrameKey(
+    const TRenderer::RenderData &renderData) const {
+  return TRasterFxKey::hash(renderData.getContentKey() + "|" + m_sourcesKey)
+      .toString();
+}
+
+//---------------------------------------------------------------------
+
+TFilePath MovieRenderer::Imp::getFrameKeyPath(const std::string &key) const {
+  return m_frameKeysFolder + (key + ".framekey");
+}
+
+//---------------------------------------------------------------------
+
+void MovieRenderer::Imp::recordFrameKey(double frame, int fr) {
+  std::map<double, std::string>::const_iterator kt = m_frameKeys.find(frame);
+  if (kt == m_frameKeys.end()) return;
+
+  // The key file just stores the path of the saved image. Writing it after
+  // the image ensures that recorded images are complete.
+  TFilePath framePath = m_fp.withFrame(TFrameId(fr + 1));
+
+  try {
+    Tofstream os(getFrameKeyPath(kt->second));
+    if (os.isOpen()) os << ::to_string(framePath.getWideString()) << "\n";
+  } catch (...) {
+    // Not recording a key just means the frame will be rendered again
+  }
+}
+
+//---------------------------------------------------------------------
+
+bool MovieRenderer::Imp::reuseFrame(double frame, const std::string &key) {
+  TFilePath keyPath = getFrameKeyPath(key);
+  if (!TFileStatus(keyPath).doesExist()) return false;
+
+  try {
+    std::string line;
+    {
+      Tifstream is(keyPath);
+      if (!is.isOpen() || !std::getline(is, line) || line.empty())
+        return false;
+    }
+
+    TFilePath sourcePath(line);
+    if (!TFileStatus(sourcePath).doesExist()) return false;
+
+    TImageP img;
+    if (!TImageReader::load(sourcePath, img) || !img) return false;
+
+    int fr = getOutputFrame(frame);
+    m_levelUpdaterA->update(TFrameId(fr + 1), img);
+
+    // The copied frame is now a valid source for further renders, too
+    recordFrameKey(frame, fr);
+
+    bool okToContinue = true;
+
+    std::set<MovieRenderer::Listener *>::iterator lt;
+    for (lt = m_listeners.begin(); lt != m_listeners.end(); ++lt)
+      okToContinue &= (*lt)->onFrameCompleted(fr);
+
+    if (!okToContinue) m_renderer.stopRendering();
+
+    ++m_duplicateFramesCount;
+    return true;
+  } catch (...) {
+    // Fall back to rendering the frame
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------------
+
 void MovieRenderer::Imp::doRenderRasterCompleted(const RenderData &renderData) {
   assert(!(m_cacheResults &&
            m_levelUpdaterB.get()));  // Cannot cache results on stereoscopy
@@ -507,6 +681,9 @@ void MovieRenderer::Imp::doRenderRasterCompleted(const RenderData &renderData) {
 
   m_toBeAppliedGamma[renderData.m_frames[0]] = true;
 
+  // All the frames of the cluster share the same rendered rasters
+  m_duplicateFramesCount += int(renderData.m_frames.size()) - 1;
+
   // Prepare the cluster's frames to be saved (possibly in the future)
   std::vector<double>::const_iterator jt;
   for (jt = renderData.m_frames.begin(), ++jt; jt != renderData.m_frames.end();
@@ -561,6 +738,7 @@ void MovieRenderer::Imp::doRenderRasterCompleted(const RenderData &renderData) {
                                 : (locker.unlock(), &locker)};
 
       savedFrame = saveFrame(frame, rasters);
+      if (savedFrame.first) recordFrameKey(frame, savedFrame.second);
     }
 
     // Report status and deal with responses
@@ -637,6 +815,8 @@ void MovieRenderer::Imp::doPreviewRasterCompleted(
       img->setRaster(aux);
     }
 
+    m_duplicateFramesCount += int(renderData.m_frames.size()) - 1;
+
     QString frameName = name + QString::number(renderData.m_frames[0] + 1);
 
     TImageCache::instance()->add(frameName.toStdString(), img);
@@ -831,6 +1011,19 @@ void MovieRenderer::addFrame(double frame, const TFxPair &fxPair) {
 
 //---------------------------------------------------------
 
+void MovieRenderer::setFrameKeysFolder(const TFilePath &folder) {
+  m_imp->m_frameKeysFolder = folder;
+}
+
+//---------------------------------------------------------
+
+int MovieRenderer::getDuplicateFramesCount() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_duplicateFramesCount;
+}
+
+//---------------------------------------------------------
+
 void MovieRenderer::enablePrecomputing(bool on) {
   m_imp->m_renderer.enablePrecomputing(on);
 }
@@ -855,12 +1048,64 @@ void MovieRenderer::start() {
   m_imp->addRef();
 
   // Prepare the TRenderer::RenderDatas to render
+  const TRenderSettings &rs = m_imp->m_renderSettings;
+
+  bool reuseFrames = m_imp->canReuseFrames();
+  if (reuseFrames) {
+    m_imp->m_sourcesKey = m_imp->getSourcesKey();
+    reuseFrames         = !m_imp->m_sourcesKey.empty();
+  }
+
+  if (reuseFrames && !TFileStatus(m_imp->m_frameKeysFolder).doesExist()) {
+    try {
+      TSystem::mkDir(m_imp->m_frameKeysFolder);
+    } catch (...) {
+      // Keys will just not be recorded
+    }
+  }
+
   RenderDataVector *datasToBeRendered = new RenderDataVector;
   size_t i, size = m_imp->m_framesToBeRendered.size();
-  for (i = 0; i < size; ++i)
-    datasToBeRendered->push_back(TRenderer::RenderData(
-        m_imp->m_framesToBeRendered[i].first, m_imp->m_renderSettings,
-        m_imp->m_framesToBeRendered[i].second));
+  for (i = 0; i < size; ++i) {
+    double frame   = m_imp->m_framesToBeRendered[i].first;
+    TFxPair fxPair = m_imp->m_framesToBeRendered[i].second;
+
+    // With field rendering, the second tree is rendered half a frame later
+    double frameB =
+        (rs.m_fieldPrevalence != TRenderSettings::NoField) ? frame + 0.5 : frame;
+    fxPair.m_frameA = optimizeSceneFx(fxPair.m_frameA, frame);
+    fxPair.m_frameB = optimizeSceneFx(fxPair.m_frameB, frameB);
+
+    TRenderer::RenderData renderData(frame, rs, fxPair);
+
+    if (reuseFrames) {
+      // Frames already saved by another render are copied rather than
+      // rendered. The content key is kept by renderData, so TRenderer will
+      // not build it again.
+      std::string key           = m_imp->getFrameKey(renderData);
+      m_imp->m_frameKeys[frame] = key;
+
+      if (m_imp->reuseFrame(frame, key)) continue;
+    }
+
+    datasToBeRendered->push_back(renderData);
+  }
+
+  if (datasToBeRendered->empty()) {
+    // Every frame was copied - TRenderer would not notify the render end, so
+    // do it here. The notification is queued like TRenderer's, since
+    // listeners typically expect it from the event loop.
+    delete datasToBeRendered;
+
+    struct FinishedFunctor final : public TFunctorInvoker::BaseFunctor {
+      Imp *m_imp;
+      FinishedFunctor(Imp *imp) : m_imp(imp) {}
+      void operator()() override { m_imp->onRenderFinished(); }
+    };
+
+    TFunctorInvoker::instance()->invokeQueued(new FinishedFunctor(m_imp));
+    return;
+  }
 
   m_imp->m_renderer.startRendering(datasToBeRendered);
 }
@@ -139,7 +139,7 @@ std::string PlasticDeformerFx::getAlias(double frame,
     TRasterFxP ifx = m_port.getFx();
     assert(ifx);
 
-    alias += ifx->getAlias(frame, info);
+    alias += getInputAlias(ifx.getPointer(), frame, info);
   }
 
   TStageObject *meshColumnObj =
@@ -383,6 +383,8 @@ void Preferences::definePreferenceItems() {
          false);
   define(watchFileSystemEnabled, "watchFileSystemEnabled", QMetaType::Bool,
          true);
+  define(thumbnailStoreEnabled, "thumbnailStoreEnabled", QMetaType::Bool,
+         true);
   define(projectRoot, "projectRoot", QMetaType::Int, 0x08);
   define(customProjectRoot, "customProjectRoot", QMetaType::QString, "");
   define(pathAliasPriority, "pathAliasPriority", QMetaType::Int,
@@ -578,6 +580,13 @@ void Preferences::definePreferenceItems() {
   define(fitToFlipbook, "fitToFlipbook", QMetaType::Bool, true);
   define(generatedMovieViewEnabled, "generatedMovieViewEnabled",
          QMetaType::Bool, true);
+  define(speculativePreviewFrameCount, "speculativePreviewFrameCount",
+         QMetaType::Int, 0, 0, 100);
+  define(speculativePreviewCpuShare, "speculativePreviewCpuShare",
+         QMetaType::Int, 50, 10, 100);
+  define(regionOfInterestPreview, "regionOfInterestPreview", QMetaType::Bool,
+         false);
+  define(progressivePreview, "progressivePreview", QMetaType::Bool, false);
 
   // Onion Skin
   define(onionSkinEnabled, "onionSkinEnabled", QMetaType::Bool, true);
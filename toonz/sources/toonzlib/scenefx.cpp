@@ -36,6 +36,12 @@
 
 #include "toonz/scenefx.h"
 
+// STD includes
+#include <map>
+#include <set>
+#include <limits>
+#include <algorithm>
+
 /*
   TODO: Some parts of the following render-tree building procedure should be
   revised. In particular,
@@ -228,6 +234,103 @@ private:
 
 FX_IDENTIFIER_IS_HIDDEN(AffineFx, "affineFx")
 
+//***************************************************************************************************
+//    FusedColorFx  definition
+//***************************************************************************************************
+
+//! FusedColorFx applies a chain of pointwise fxs to its input in a single pass.
+/*!
+  FusedColorFx replaces chains of pointwise fxs (see TRasterFx::isPointwise())
+  in optimized render-trees. Rather than having each fx of the chain traverse
+  the whole tile in turn, the tile is split in bands that pass through all the
+  fxs while they are still in cache - and the per-fx computation overhead
+  (aliases, bboxes, cache lookups) is paid once.
+\n\n
+  The fused fxs keep their original input connections, which are used to
+  build the alias: a FusedColorFx shares its alias - and so its cached tiles
+  - with the topmost fx of the chain.
+*/
+
+class FusedColorFx final : public TRasterFx {
+  FX_DECLARATION(FusedColorFx)
+
+public:
+  enum { BandPixels = 1 << 16, LutBandPixels = 1 << 20 };
+
+private:
+  std::vector<TRasterFxP> m_fxs;  //!< The fused fxs, from the bottom one
+  TRasterFxPort m_input;          //!< The input port
+
+public:
+  FusedColorFx() {
+    addInputPort("source", m_input);
+    setName(L"FusedColorFx");
+  }
+  ~FusedColorFx() {}
+
+  TFx *clone(bool recursive = true) const override {
+    FusedColorFx *fx = dynamic_cast<FusedColorFx *>(TFx::clone(recursive));
+    assert(fx);
+    fx->m_fxs = m_fxs;
+    return fx;
+  }
+
+  void setFxs(const std::vector<TRasterFxP> &fxs) { m_fxs = fxs; }
+
+  bool canHandle(const TRenderSettings &info, double frame) override {
+    return true;
+  }
+
+  bool doGetBBox(double frame, TRectD &bBox,
+                 const TRenderSettings &info) override {
+    if (!m_input.isConnected()) {
+      bBox = TRectD();
+      return false;
+    }
+    return m_input->doGetBBox(frame, bBox, info);
+  }
+
+  std::string getAlias(double frame,
+                       const TRenderSettings &info) const override {
+    assert(!m_fxs.empty());
+    return m_fxs.back()->getAlias(frame, info);
+  }
+
+  void doCompute(TTile &tile, double frame,
+                 const TRenderSettings &ri) override {
+    if (!m_input.isConnected()) return;
+
+    m_input->compute(tile, frame, ri);
+
+    TRasterP ras = tile.getRaster();
+    int lx = ras->getLx(), ly = ras->getLy();
+    if (lx <= 0 || ly <= 0) return;
+
+    // 64-bit fxs typically build 65536-entry LUTs on each call: use larger
+    // bands to amortize them
+    int bandPixels = (ras->getPixelSize() > 4) ? LutBandPixels : BandPixels;
+    int bandHeight = std::max(1, bandPixels / ras->getWrap());
+
+    ras->lock();
+    for (int y = 0; y < ly; y += bandHeight) {
+      TRect bandRect(0, y, lx - 1, std::min(y + bandHeight, ly) - 1);
+      TRasterP band = ras->extract(bandRect);
+
+      for (const TRasterFxP &fx : m_fxs) fx->computePixels(band, frame, ri);
+    }
+    ras->unlock();
+  }
+
+  std::string getPluginId() const override { return std::string(); }
+
+private:
+  // not implemented
+  FusedColorFx(const FusedColorFx &);
+  FusedColorFx &operator=(const FusedColorFx &);
+};
+
+FX_IDENTIFIER_IS_HIDDEN(FusedColorFx, "fusedColorFx")
+
 //***************************************************************************************************
 //    PlacedFx  definition
 //***************************************************************************************************
@@ -1130,6 +1233,258 @@ PlacedFx FxBuilder::makePFfromGenericFx(TFx *fx) {
   return pf;
 }
 
+//***************************************************************************************************
+//    SceneFxOptimizer  definition
+//***************************************************************************************************
+
+namespace {
+
+const double unknownFrame = (std::numeric_limits<double>::max)();
+bool sceneFxOptimizationEnabled = true;
+
+}  // namespace
+
+//-------------------------------------------------------------------
+
+//! SceneFxOptimizer simplifies built render-trees before they are rendered.
+/*!
+  The optimization takes two passes over the tree:
+  \li simplify() merges consecutive NaAffineFxs, drops the identity ones and
+      bypasses the fxs that return their input unchanged (see
+      TRasterFx::isIdentity());
+  \li fuse() replaces chains of pointwise fxs with FusedColorFxs.
+\n\n
+  The fxs of the input tree are never modified, since they may belong to the
+  scene: whenever the inputs of an fx change, the fx is cloned - as FxBuilder
+  does.
+\n\n
+  Identities are tested at the frame the tree is rendered at, which is known
+  only below fxs that pass it on unchanged - or, as TimeShuffleFx, in a known
+  way. Elsewhere, only fxs with no animated parameters may be bypassed.
+*/
+
+class SceneFxOptimizer {
+  std::map<std::pair<TFx *, double>, TFxP> m_simplifiedFxs;
+  std::map<TFx *, TFxP> m_fusedFxs;
+
+  std::map<TFx *, int> m_outputCounts;
+  std::set<TFx *> m_countedFxs;
+
+public:
+  TFxP optimize(const TFxP &fx, double frame) {
+    TFxP simplifiedFx = simplify(fx.getPointer(), frame);
+    countOutputs(simplifiedFx.getPointer());
+    return fuse(simplifiedFx.getPointer());
+  }
+
+private:
+  TFxP simplify(TFx *fx, double frame);
+  void countOutputs(TFx *fx);
+  TFxP fuse(TFx *fx);
+
+  double getInputFrame(TFx *fx, double frame) const;
+  bool isActive(TFx *fx, double frame) const;
+  bool isBypassable(TFx *fx, double frame) const;
+  bool isFusible(TFx *fx) const;
+
+  TFxP replaceInputs(TFx *fx, const std::vector<TFxP> &inputs) const;
+};
+
+//-------------------------------------------------------------------
+
+TFxP SceneFxOptimizer::simplify(TFx *fx, double frame) {
+  if (!fx) return TFxP();
+
+  std::pair<TFx *, double> key(fx, frame);
+
+  std::map<std::pair<TFx *, double>, TFxP>::iterator ft =
+      m_simplifiedFxs.find(key);
+  if (ft != m_simplifiedFxs.end()) return ft->second;
+
+  // Column fxs are the leaves of render-trees
+  TFxP result(fx);
+  if (!dynamic_cast<TColumnFx *>(fx)) {
+    double inputFrame = getInputFrame(fx, frame);
+
+    int p, pCount = fx->getInputPortCount();
+    std::vector<TFxP> inputs(pCount);
+    for (p = 0; p != pCount; ++p)
+      inputs[p] = simplify(fx->getInputPort(p)->getFx(), inputFrame);
+
+    result = replaceInputs(fx, inputs);
+
+    NaAffineFx *affFx = dynamic_cast<NaAffineFx *>(result.getPointer());
+    if (affFx) {
+      // Merge with an input affine - or drop the identity
+      NaAffineFx *inputAffFx = dynamic_cast<NaAffineFx *>(inputs[0].getPointer());
+      if (inputAffFx)
+        result = TFxUtil::makeAffine(inputAffFx->getInputPort(0)->getFx(),
+                                     affFx->getPlacement(frame) *
+                                         inputAffFx->getPlacement(frame));
+      else if (affFx->getPlacement(frame) == TAffine())
+        result = inputs[0];
+    } else if (isBypassable(result.getPointer(), frame))
+      result = inputs[0];
+  }
+
+  m_simplifiedFxs[key] = result;
+  return result;
+}
+
+//-------------------------------------------------------------------
+
+void SceneFxOptimizer::countOutputs(TFx *fx) {
+  if (!fx || !m_countedFxs.insert(fx).second) return;
+
+  int p, pCount = fx->getInputPortCount();
+  for (p = 0; p != pCount; ++p) {
+    TFx *inputFx = fx->getInputPort(p)->getFx();
+    if (inputFx) {
+      ++m_outputCounts[inputFx];
+      countOutputs(inputFx);
+    }
+  }
+}
+
+//-------------------------------------------------------------------
+
+TFxP SceneFxOptimizer::fuse(TFx *fx) {
+  if (!fx) return TFxP();
+
+  std::map<TFx *, TFxP>::iterator ft = m_fusedFxs.find(fx);
+  if (ft != m_fusedFxs.end()) return ft->second;
+
+  TFxP result(fx);
+  if (!dynamic_cast<TColumnFx *>(fx)) {
+    // Collect the chain of pointwise fxs starting at fx. Fxs with other
+    // outputs end the chain, as they would be computed twice.
+    std::vector<TRasterFxP> chain;
+
+    TFx *inputFx = fx;
+    if (isFusible(fx)) {
+      do {
+        chain.push_back(inputFx);
+        inputFx = inputFx->getInputPort(0)->getFx();
+      } while (isFusible(inputFx) && m_outputCounts[inputFx] == 1);
+    }
+
+    if (chain.size() > 1) {
+      std::reverse(chain.begin(), chain.end());
+
+      FusedColorFx *fusedFx = new FusedColorFx;
+      result                = fusedFx;
+
+      fusedFx->setFxs(chain);
+      if (!fusedFx->connect("source", fuse(inputFx).getPointer()))
+        assert(!"Could not connect ports!");
+    } else {
+      int p, pCount = fx->getInputPortCount();
+      std::vector<TFxP> inputs(pCount);
+      for (p = 0; p != pCount; ++p)
+        inputs[p] = fuse(fx->getInputPort(p)->getFx());
+
+      result = replaceInputs(fx, inputs);
+    }
+  }
+
+  m_fusedFxs[fx] = result;
+  return result;
+}
+
+//-------------------------------------------------------------------
+
+double SceneFxOptimizer::getInputFrame(TFx *fx, double frame) const {
+  if (frame == unknownFrame) return frame;
+
+  if (TimeShuffleFx *tsFx = dynamic_cast<TimeShuffleFx *>(fx))
+    return tsFx->getTimeRegion().contains(frame) ? tsFx->getLevelFrame(frame)
+                                                 : unknownFrame;
+
+  TRasterFx *rasFx = dynamic_cast<TRasterFx *>(fx);
+  if (dynamic_cast<TGeometryFx *>(fx) || dynamic_cast<FusedColorFx *>(fx) ||
+      (rasFx && rasFx->isPointwise()))
+    return frame;
+
+  return unknownFrame;
+}
+
+//-------------------------------------------------------------------
+
+bool SceneFxOptimizer::isActive(TFx *fx, double frame) const {
+  if (!fx->checkActiveTimeRegion()) return true;
+
+  TFxTimeRegion timeRegion = fx->getActiveTimeRegion();
+  return timeRegion.isUnlimited() ||
+         (frame != unknownFrame && timeRegion.contains(frame));
+}
+
+//-------------------------------------------------------------------
+
+bool SceneFxOptimizer::isBypassable(TFx *fx, double frame) const {
+  TRasterFx *rasFx = dynamic_cast<TRasterFx *>(fx);
+  if (!rasFx || rasFx->getInputPortCount() != 1 ||
+      !rasFx->getInputPort(0)->isConnected() ||
+      rasFx->getAttributes()->passiveCacheDataIdx() >= 0 ||
+      !isActive(rasFx, frame))
+    return false;
+
+  if (frame != unknownFrame) return rasFx->isIdentity(frame);
+
+  // The fx could be computed at any frame
+  TParamContainer *params = rasFx->getParams();
+
+  int p, pCount = params->getParamCount();
+  for (p = 0; p != pCount; ++p)
+    if (params->getParam(p)->hasKeyframes()) return false;
+
+  return rasFx->isIdentity(0);
+}
+
+//-------------------------------------------------------------------
+
+bool SceneFxOptimizer::isFusible(TFx *fx) const {
+  TRasterFx *rasFx = dynamic_cast<TRasterFx *>(fx);
+  return rasFx && rasFx->isPointwise() && rasFx->getInputPortCount() == 1 &&
+         rasFx->getInputPort(0)->isConnected() &&
+         rasFx->getAttributes()->isEnabled() &&
+         rasFx->getAttributes()->passiveCacheDataIdx() < 0 &&
+         isActive(rasFx, unknownFrame);
+}
+
+//-------------------------------------------------------------------
+
+TFxP SceneFxOptimizer::replaceInputs(TFx *fx,
+                                     const std::vector<TFxP> &inputs) const {
+  int p, pCount = fx->getInputPortCount();
+  for (p = 0; p != pCount; ++p)
+    if (inputs[p].getPointer() != fx->getInputPort(p)->getFx()) break;
+
+  if (p == pCount) return fx;
+
+  TFx *clonedFx = fx->clone(false);
+  for (p = 0; p != pCount; ++p)
+    clonedFx->getInputPort(p)->setFx(inputs[p].getPointer());
+
+  return clonedFx;
+}
+
+//-------------------------------------------------------------------
+
+TFxP optimizeSceneFx(const TFxP &fx, double frame) {
+  if (!fx || !sceneFxOptimizationEnabled) return fx;
+  return SceneFxOptimizer().optimize(fx, frame);
+}
+
+//-------------------------------------------------------------------
+
+void enableSceneFxOptimization(bool enable) {
+  sceneFxOptimizationEnabled = enable;
+}
+
+//-------------------------------------------------------------------
+
+bool isSceneFxOptimizationEnabled() { return sceneFxOptimizationEnabled; }
+
 //***************************************************************************************************
 //    Exported  Render-Tree building  functions
 //***************************************************************************************************
@@ -0,0 +1,579 @@
+
+
+#include "toonz/soundmixer.h"
+
+// TnzLib includes
+#include "toonz/txshsoundcolumn.h"
+#include "toonz/txshsoundlevel.h"
+
+// TnzCore includes
+#include "tsound_t.h"
+#include "tsop.h"
+#include "tutil.h"
+
+// Qt includes
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QThread>
+#include <QIODevice>
+#include <QPointer>
+#include <QAudioFormat>
+#include <QAudioDeviceInfo>
+#include <QAudioOutput>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+//***************************************************************************************
+//    Local namespace
+//***************************************************************************************
+
+namespace {
+
+//! A sound level, as placed in the mix.
+struct Clip {
+  TSoundTrackP m_track;
+  TINT32 m_s0, m_s1;  //!< Mix samples [m_s0, m_s1) where the level is heard.
+  double m_origin;    //!< Mix sample of the track's first sample.
+  double m_volume;
+};
+
+typedef std::vector<Clip> Clips;
+
+// Track samples added around each resampled block, so that the resampling
+// filter sees the neighbours of the block's samples
+const int PadSampleCount = 32;
+
+//-----------------------------------------------------------------------------
+
+TSoundTrackFormat toSoundTrackFormat(const QAudioFormat &format) {
+  return TSoundTrackFormat(format.sampleRate(), format.sampleSize(),
+                           format.channelCount(),
+                           format.sampleType() == QAudioFormat::SignedInt);
+}
+
+QAudioFormat toAudioFormat(const TSoundTrackFormat &format) {
+  QAudioFormat qFormat;
+  qFormat.setSampleRate(format.m_sampleRate);
+  qFormat.setSampleType(format.m_signedSample ? QAudioFormat::SignedInt
+                                              : QAudioFormat::UnSignedInt);
+  qFormat.setSampleSize(format.m_bitPerSample);
+  qFormat.setCodec("audio/pcm");
+  qFormat.setChannelCount(format.m_channelCount);
+  qFormat.setByteOrder(QAudioFormat::LittleEndian);
+  return qFormat;
+}
+
+}  // namespace
+
+//***************************************************************************************
+//    SoundMixer::Imp declaration
+//***************************************************************************************
+
+class SoundMixer::Imp {
+public:
+  class Thread;
+  class Stream;
+
+  mutable QMutex m_mutex;
+  QWaitCondition m_condition;  //!< Wakes the mixing thread.
+
+  std::shared_ptr<const Clips> m_clips;
+  TSoundTrackFormat m_format, m_deviceFormat;
+  TUINT32 m_levelSampleRate;  //!< The rate m_format was chosen for.
+  double m_samplePerFrame;
+  bool m_hasDevice;
+
+  // Play state
+  TINT32 m_start, m_end, m_position;
+  bool m_active, m_loop, m_quit;
+  bool m_streaming;  //!< The device has read mixed samples of the current
+                     //!< range, which is not played out yet.
+  int m_generation;  //!< Incremented whenever queued samples are discarded.
+
+  // Queue of mixed samples in the device format
+  QByteArray m_queue;
+  int m_queueBegin, m_queueSize;
+
+  Statistics m_statistics;
+
+  Thread *m_thread;
+  Stream *m_stream;
+  QPointer<QAudioOutput> m_output;
+
+public:
+  Imp();
+  ~Imp();
+
+  void mix(const Clips &clips, TINT32 s0, const TSoundTrackP &dst) const;
+
+  //! Returns true if the current range has samples left to mix.
+  bool isPending() const {
+    return m_active && (m_loop || m_position < m_end);
+  }
+  int getQueueCapacity() const { return m_queue.size(); }
+  int getDeviceSampleSize() const {
+    return m_deviceFormat.m_channelCount *
+           std::max(m_deviceFormat.m_bitPerSample / 8, 1);
+  }
+
+  void flush() {
+    m_queueBegin = m_queueSize = 0;
+    m_streaming                = false;
+    ++m_generation;
+  }
+
+  void run();
+  qint64 read(char *data, qint64 maxSize);
+
+  void updateFormat(TUINT32 sampleRate);
+  void startOutput();
+};
+
+//***************************************************************************************
+//    Thread and Stream
+//***************************************************************************************
+
+class SoundMixer::Imp::Thread final : public QThread {
+  SoundMixer::Imp *m_imp;
+
+public:
+  Thread(SoundMixer::Imp *imp) : m_imp(imp) {}
+
+  void run() override { m_imp->run(); }
+};
+
+//-----------------------------------------------------------------------------
+
+//! The device used by the audio output to pull mixed samples.
+class SoundMixer::Imp::Stream final : public QIODevice {
+  SoundMixer::Imp *m_imp;
+
+public:
+  Stream(SoundMixer::Imp *imp) : m_imp(imp) {}
+
+  bool isSequential() const override { return true; }
+
+protected:
+  qint64 readData(char *data, qint64 maxSize) override {
+    return m_imp->read(data, maxSize);
+  }
+  qint64 writeData(const char *, qint64) override { return -1; }
+};
+
+//***************************************************************************************
+//    SoundMixer::Imp implementation
+//***************************************************************************************
+
+SoundMixer::Imp::Imp()
+    : m_clips(new Clips)
+    , m_format(44100, 16, 2, true)
+    , m_deviceFormat(m_format)
+    , m_levelSampleRate(0)
+    , m_samplePerFrame(0)
+    , m_hasDevice(false)
+    , m_start(0)
+    , m_end(0)
+    , m_position(0)
+    , m_active(false)
+    , m_loop(false)
+    , m_quit(false)
+    , m_streaming(false)
+    , m_generation(0)
+    , m_queueBegin(0)
+    , m_queueSize(0)
+    , m_thread(0)
+    , m_stream(0) {
+  memset(&m_statistics, 0, sizeof(Statistics));
+}
+
+//-----------------------------------------------------------------------------
+
+SoundMixer::Imp::~Imp() {
+  if (m_thread) {
+    {
+      QMutexLocker locker(&m_mutex);
+      m_quit = true;
+      m_condition.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+  }
+
+  if (m_output) {
+    m_output->stop();
+    delete m_output;
+  }
+  delete m_stream;
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::Imp::mix(const Clips &clips, TINT32 s0,
+                          const TSoundTrackP &dst) const {
+  TSoundTrackStereo16 *out =
+      dynamic_cast<TSoundTrackStereo16 *>(dst.getPointer());
+  assert(out);
+
+  TINT32 count = dst->getSampleCount();
+  std::vector<double> values(2 * count, 0.0);
+
+  TSoundTrackFormat format = dst->getFormat();
+
+  for (const Clip &clip : clips) {
+    TINT32 q0 = std::max(s0, clip.m_s0), q1 = std::min(s0 + count, clip.m_s1);
+    if (q0 >= q1) continue;
+
+    // Convert just the part of the track heard in the block
+    double ratio = clip.m_track->getSampleRate() / (double)format.m_sampleRate;
+    TINT32 t0    = tfloor((q0 - clip.m_origin) * ratio) - PadSampleCount;
+    TINT32 t1    = tceil((q1 - clip.m_origin) * ratio) + PadSampleCount;
+    if (t1 < 0 || t0 >= clip.m_track->getSampleCount()) continue;
+
+    TSoundTrackP chunk = clip.m_track->extract(t0, t1);
+    if (!chunk) continue;
+    t0 = std::max<TINT32>(t0, 0);  // extract() crops the range
+
+    TSoundTrackP converted = (chunk->getFormat() == format)
+                                 ? chunk
+                                 : TSop::convert(chunk, format);
+    const TSoundTrackStereo16 *in =
+        dynamic_cast<const TSoundTrackStereo16 *>(converted.getPointer());
+    if (!in) continue;
+
+    const TStereo16Sample *samples = in->samples();
+    TINT32 sampleCount             = in->getSampleCount();
+
+    TINT32 j = tround((q0 - clip.m_origin) - t0 / ratio);
+    for (TINT32 q = q0; q < q1; ++q, ++j) {
+      if (j < 0) continue;
+      if (j >= sampleCount) break;
+
+      double *value = &values[2 * (q - s0)];
+      value[0] += samples[j].getValue(TSound::LEFT) * clip.m_volume;
+      value[1] += samples[j].getValue(TSound::RIGHT) * clip.m_volume;
+    }
+  }
+
+  TStereo16Sample *sample = out->samples();
+  for (TINT32 i = 0; i < count; ++i, ++sample) {
+    sample->setValue(TSound::LEFT,
+                     (short)tcrop(tround(values[2 * i]), -32768, 32767));
+    sample->setValue(TSound::RIGHT,
+                     (short)tcrop(tround(values[2 * i + 1]), -32768, 32767));
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::Imp::run() {
+  QMutexLocker locker(&m_mutex);
+
+  while (!m_quit) {
+    int sampleSize = getDeviceSampleSize();
+    int freeSize   = getQueueCapacity() - m_queueSize;
+
+    if (!isPending() || freeSize < BlockSize * sampleSize) {
+      m_condition.wait(&m_mutex);
+      continue;
+    }
+
+    TINT32 s0    = m_position;
+    TINT32 count = std::min<TINT32>(BlockSize, m_end - m_position);
+
+    std::shared_ptr<const Clips> clips = m_clips;
+    TSoundTrackFormat format           = m_format;
+    TSoundTrackFormat deviceFormat     = m_deviceFormat;
+    int generation                     = m_generation;
+
+    // Mix without holding the lock: the device keeps reading meanwhile
+    locker.unlock();
+
+    TSoundTrackP block = TSoundTrack::create(format, count);
+    mix(*clips, s0, block);
+    if (deviceFormat != format) block = TSop::convert(block, deviceFormat);
+
+    locker.relock();
+
+    // The range or the format changed: the block is useless
+    if (generation != m_generation) continue;
+
+    int size = std::min<int>(block->getSampleCount() * sampleSize,
+                             getQueueCapacity() - m_queueSize);
+    const char *data = (const char *)block->getRawData();
+    for (int i = 0; i < size;) {
+      int pos    = (m_queueBegin + m_queueSize) % getQueueCapacity();
+      int length = std::min(size - i, getQueueCapacity() - pos);
+      memcpy(m_queue.data() + pos, data + i, length);
+      m_queueSize += length, i += length;
+    }
+
+    m_statistics.m_mixedSampleCount += count;
+
+    m_position += count;
+    if (m_loop && m_position >= m_end) m_position = m_start;
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+qint64 SoundMixer::Imp::read(char *data, qint64 maxSize) {
+  QMutexLocker locker(&m_mutex);
+
+  int sampleSize = getDeviceSampleSize();
+
+  qint64 size = std::min<qint64>(maxSize, m_queueSize);
+  size -= size % sampleSize;
+
+  for (qint64 i = 0; i < size;) {
+    int length = std::min<int>(size - i, getQueueCapacity() - m_queueBegin);
+    memcpy(data + i, m_queue.constData() + m_queueBegin, length);
+    m_queueBegin = (m_queueBegin + length) % getQueueCapacity();
+    m_queueSize -= length, i += length;
+  }
+
+  qint64 queuedSize = size;
+  if (size > 0) m_condition.wakeAll();
+
+  if (size < maxSize && isPending()) {
+    // Keep the device going with silence. Only a queue that drains during
+    // playback is an underrun: a restart, a seek or a range extended after
+    // it was played out begin with an empty queue.
+    qint64 silentSize = maxSize - size;
+    silentSize -= silentSize % sampleSize;
+
+    char silence = m_deviceFormat.m_signedSample ? 0 : (char)0x80;
+    memset(data + size, silence, silentSize);
+
+    if (m_streaming) {
+      ++m_statistics.m_underrunCount;
+      m_statistics.m_silentSampleCount += silentSize / sampleSize;
+    }
+    size += silentSize;
+  }
+
+  if (isPending()) {
+    if (queuedSize > 0) m_streaming = true;
+  } else if (m_queueSize == 0)
+    m_streaming = false;
+
+  return size;
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::Imp::updateFormat(TUINT32 sampleRate) {
+  // Adapt the format to the device, as TXshSoundColumn does
+  QAudioDeviceInfo info(QAudioDeviceInfo::defaultOutputDevice());
+  bool hasDevice = !info.deviceName().isEmpty();
+  if (hasDevice && !info.supportedSampleRates().contains(sampleRate))
+    sampleRate = 44100;
+
+  TSoundTrackFormat format(sampleRate, 16, 2, true);
+  TSoundTrackFormat deviceFormat = format;
+  if (hasDevice) {
+    QAudioFormat qFormat = toAudioFormat(format);
+    if (!info.isFormatSupported(qFormat))
+      deviceFormat = toSoundTrackFormat(info.nearestFormat(qFormat));
+  }
+
+  QMutexLocker locker(&m_mutex);
+
+  m_format       = format;
+  m_deviceFormat = deviceFormat;
+  m_hasDevice    = hasDevice;
+
+  // Samples are counted at the new rate, and queued ones are unplayable
+  m_queue.resize(MaxQueuedBlocks * BlockSize * getDeviceSampleSize());
+  flush();
+  m_active = false;
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::Imp::startOutput() {
+  QAudioFormat qFormat = toAudioFormat(m_deviceFormat);
+
+  if (m_output && m_output->format() != qFormat) {
+    m_output->stop();
+    delete m_output;
+  }
+
+  if (!m_output) {
+    m_output = new QAudioOutput(qFormat);
+    // The device buffer adds to the mixer's latency: keep it short
+    m_output->setBufferSize(qFormat.bytesForDuration(50000));
+  }
+
+  if (!m_stream) {
+    m_stream = new Stream(this);
+    m_stream->open(QIODevice::ReadOnly);
+  }
+
+  if (!m_thread) {
+    m_thread = new Thread(this);
+    m_thread->start(QThread::HighPriority);
+  }
+
+  if (m_output->state() == QAudio::StoppedState) m_output->start(m_stream);
+}
+
+//***************************************************************************************
+//    SoundMixer implementation
+//***************************************************************************************
+
+SoundMixer::SoundMixer() : m_imp(new Imp) {}
+
+//-----------------------------------------------------------------------------
+
+SoundMixer::~SoundMixer() {}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::setColumns(const std::vector<TXshSoundColumn *> &columns,
+                            double fps) {
+  // The mix uses the highest sample rate among the levels
+  TUINT32 sampleRate = 0;
+  for (TXshSoundColumn *column : columns) {
+    for (int i = 0; ColumnLevel *l = column->getColumnLevel(i); ++i) {
+      TXshSoundLevel *soundLevel = l->getSoundLevel();
+      if (!soundLevel || !soundLevel->getSoundTrack()) continue;
+      sampleRate =
+          std::max(sampleRate, soundLevel->getSoundTrack()->getSampleRate());
+    }
+  }
+  if (sampleRate == 0) sampleRate = 44100;
+
+  // Querying the device is slow: only do it when the levels' rate changes
+  if (sampleRate != m_imp->m_levelSampleRate) {
+    m_imp->m_levelSampleRate = sampleRate;
+    m_imp->updateFormat(sampleRate);
+  }
+  sampleRate = m_imp->m_format.m_sampleRate;
+
+  double samplePerFrame = sampleRate / fps;
+
+  // Take the snapshot
+  std::shared_ptr<Clips> clips(new Clips);
+  for (TXshSoundColumn *column : columns) {
+    double volume = column->getVolume();
+    if (volume == 0) continue;
+
+    for (int i = 0; ColumnLevel *l = column->getColumnLevel(i); ++i) {
+      TXshSoundLevel *soundLevel = l->getSoundLevel();
+      if (!soundLevel) continue;
+
+      TSoundTrackP st = soundLevel->getSoundTrack();
+      if (!st || st->getSampleCount() <= 0) continue;
+
+      int startFrame = l->getStartFrame() + l->getStartOffset();
+      int endFrame   = startFrame + soundLevel->getFrameCount() -
+                     l->getStartOffset() - l->getEndOffset();
+      if (endFrame <= startFrame) continue;
+
+      Clip clip = {st, (TINT32)(startFrame * samplePerFrame),
+                   (TINT32)(endFrame * samplePerFrame),
+                   l->getStartFrame() * samplePerFrame, volume};
+      clips->push_back(clip);
+    }
+  }
+
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->m_clips          = clips;
+  m_imp->m_samplePerFrame = samplePerFrame;
+}
+
+//-----------------------------------------------------------------------------
+
+bool SoundMixer::isEmpty() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_clips->empty();
+}
+
+//-----------------------------------------------------------------------------
+
+TSoundTrackFormat SoundMixer::getFormat() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_format;
+}
+
+//-----------------------------------------------------------------------------
+
+double SoundMixer::getSamplePerFrame() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_samplePerFrame;
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::mix(TINT32 s0, const TSoundTrackP &dst) const {
+  std::shared_ptr<const Clips> clips;
+  {
+    QMutexLocker locker(&m_imp->m_mutex);
+    clips = m_imp->m_clips;
+  }
+  m_imp->mix(*clips, s0, dst);
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::play(TINT32 s0, TINT32 s1, bool loop) {
+  if (s0 > s1) std::swap(s0, s1);
+
+  {
+    QMutexLocker locker(&m_imp->m_mutex);
+    if (!m_imp->m_hasDevice || m_imp->m_queue.isEmpty() || s0 == s1) return;
+
+    // Consecutive ranges may be a sample apart due to frame rounding
+    if (m_imp->m_active && !m_imp->m_loop && !loop &&
+        std::abs(s0 - m_imp->m_end) <= 1) {
+      m_imp->m_end = s1;
+    } else {
+      m_imp->flush();
+      m_imp->m_start = m_imp->m_position = s0;
+      m_imp->m_end                       = s1;
+      m_imp->m_loop                      = loop;
+      m_imp->m_active                    = true;
+    }
+    m_imp->m_condition.wakeAll();
+  }
+
+  // Outside the lock: starting the output may read from the stream
+  m_imp->startOutput();
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::stop() {
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->flush();
+  m_imp->m_active = false;
+}
+
+//-----------------------------------------------------------------------------
+
+bool SoundMixer::isPlaying() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->isPending() || m_imp->m_queueSize > 0;
+}
+
+//-----------------------------------------------------------------------------
+
+SoundMixer::Statistics SoundMixer::getStatistics() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  Statistics statistics = m_imp->m_statistics;
+  statistics.m_queuedSampleCount =
+      m_imp->m_queueSize / m_imp->getDeviceSampleSize();
+  return statistics;
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundMixer::resetStatistics() {
+  QMutexLocker locker(&m_imp->m_mutex);
+  memset(&m_imp->m_statistics, 0, sizeof(Statistics));
+}
@@ -0,0 +1,290 @@
+
+
+#include "toonz/soundpeaks.h"
+
+// TnzLib includes
+#include "toonz/toonzfolders.h"
+
+// TnzCore includes
+#include "tcommon.h"
+#include "tconvert.h"
+
+// Qt includes
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+// STD includes
+#include <cstring>
+
+//***************************************************************************************
+//    Local namespace
+//***************************************************************************************
+
+namespace {
+
+const quint32 peaksMagic    = 0x5350454b;  // 'SPEK'
+const qint32 peaksVersion   = 2;
+const int maxPeaksFileCount = 2000;
+
+//-----------------------------------------------------------------------------
+
+QString initPeaksFolder() {
+  TFilePath cacheRoot = ToonzFolder::getCacheRootFolder();
+  if (cacheRoot.isEmpty()) return QString();
+
+  QString folder = (cacheRoot + "sounds").getQString();
+  return QDir(folder).mkpath(".") ? folder : QString();
+}
+
+const QString &peaksFolder() {
+  static const QString folder = initPeaksFolder();
+  return folder;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Returns the peaks file of the sound file \b path, or an empty string.
+QString getPeaksFilePath(const TFilePath &path) {
+  if (peaksFolder().isEmpty()) return QString();
+
+  QFileInfo fi(path.getQString());
+  if (!fi.isFile()) return QString();
+
+  std::string key =
+      ::to_string(path) + "|" + std::to_string(fi.size()) + "|" +
+      std::to_string(fi.lastModified().toMSecsSinceEpoch());
+  QByteArray hash = QCryptographicHash::hash(
+      QByteArray(key.c_str(), (int)key.size()), QCryptographicHash::Md5);
+
+  return peaksFolder() + "/" + QString::fromLatin1(hash.toHex()) + ".peaks";
+}
+
+//-----------------------------------------------------------------------------
+
+void prunePeaks() {
+  static QMutex mutex;
+  static bool pruned = false;
+
+  QMutexLocker locker(&mutex);
+  if (pruned) return;
+  pruned = true;
+
+  QFileInfoList files =
+      QDir(peaksFolder())
+          .entryInfoList(QStringList("*.peaks"), QDir::Files,
+                         QDir::Time | QDir::Reversed);
+  if (files.size() <= maxPeaksFileCount) return;
+
+  // Remove the oldest files, leaving some room before the next pruning
+  int removedCount = files.size() - maxPeaksFileCount * 3 / 4;
+  for (int i = 0; i < removedCount; ++i) QFile::remove(files[i].filePath());
+}
+
+//-----------------------------------------------------------------------------
+
+inline void addBlock(SoundPeaks::Block &total, const SoundPeaks::Block &block) {
+  if (total.m_min > block.m_min) total.m_min = block.m_min;
+  if (total.m_max < block.m_max) total.m_max = block.m_max;
+}
+
+}  // namespace
+
+//***************************************************************************************
+//    SoundPeaks implementation
+//***************************************************************************************
+
+SoundPeaks::SoundPeaks() : m_sampleCount(0), m_leftMin(0), m_leftMax(-1) {}
+
+//-----------------------------------------------------------------------------
+
+void SoundPeaks::clear() {
+  m_levels.clear();
+  m_sampleCount = 0;
+  m_leftMin = 0, m_leftMax = -1;
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundPeaks::build(const TSoundTrackP &st) {
+  clear();
+  if (!st || st->getSampleCount() <= 0) return;
+
+  m_sampleCount = st->getSampleCount();
+  st->getMinMaxPressure(TSound::LEFT, m_leftMin, m_leftMax);
+
+  // Only whole blocks are stored: queries read partial ones from the track
+  TINT32 blockCount = m_sampleCount >> BlockLevel;
+
+  m_levels.resize(1);
+  std::vector<Block> &blocks = m_levels[0];
+  blocks.resize(blockCount);
+
+  for (TINT32 b = 0; b < blockCount; ++b) {
+    TINT32 s0 = b << BlockLevel, s1 = s0 + BlockSize - 1;
+
+    Block &block = blocks[b];
+    st->getMinMaxPressure(s0, s1, TSound::MONO, block.m_min, block.m_max);
+  }
+
+  buildLevels();
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundPeaks::build(const TSoundTrackP &st, const TFilePath &path) {
+  QString filePath = getPeaksFilePath(path);
+  if (!filePath.isEmpty() && load(filePath, st)) return;
+
+  build(st);
+  if (!filePath.isEmpty() && !isEmpty()) save(filePath, st);
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundPeaks::buildLevels() {
+  m_levels.resize(1);
+
+  // Level k+1 pairs up the blocks of level k - an odd last one is never
+  // needed by queries
+  while (m_levels.back().size() > 1) {
+    const std::vector<Block> &lower = m_levels.back();
+    std::vector<Block> upper(lower.size() / 2);
+
+    for (size_t b = 0; b < upper.size(); ++b) {
+      upper[b] = lower[2 * b];
+      addBlock(upper[b], lower[2 * b + 1]);
+    }
+
+    m_levels.push_back(std::vector<Block>());
+    m_levels.back().swap(upper);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundPeaks::getMinMaxPressure(const TSoundTrackP &st, TINT32 s0,
+                                   TINT32 s1, double &min,
+                                   double &max) const {
+  TINT32 ss0 = tcrop<TINT32>(s0, 0, m_sampleCount - 1);
+  TINT32 ss1 = tcrop<TINT32>(s1, 0, m_sampleCount - 1);
+
+  // Short and degenerate ranges are left to the track
+  if (s0 == s1 || ss1 - ss0 < 2 * BlockSize) {
+    st->getMinMaxPressure(s0, s1, TSound::MONO, min, max);
+    return;
+  }
+
+  // Whole blocks span [b0, b1)
+  TINT32 b0 = (ss0 + BlockSize - 1) >> BlockLevel;
+  TINT32 b1 = (ss1 + 1) >> BlockLevel;
+
+  Block total = {0.0, 0.0};
+  bool first  = true;
+
+  if (ss0 < (b0 << BlockLevel)) {
+    st->getMinMaxPressure(ss0, (b0 << BlockLevel) - 1, TSound::MONO,
+                          total.m_min, total.m_max);
+    first = false;
+  }
+  if ((b1 << BlockLevel) <= ss1) {
+    Block tail = {0.0, 0.0};
+    st->getMinMaxPressure(b1 << BlockLevel, ss1, TSound::MONO, tail.m_min,
+                          tail.m_max);
+    if (first)
+      total = tail, first = false;
+    else
+      addBlock(total, tail);
+  }
+
+  for (int k = 0; b0 < b1; ++k, b0 >>= 1, b1 >>= 1) {
+    const std::vector<Block> &level = m_levels[k];
+    if (b0 & 1) {
+      if (first)
+        total = level[b0], first = false;
+      else
+        addBlock(total, level[b0]);
+      ++b0;
+    }
+    if (b1 & 1) {
+      --b1;
+      if (first)
+        total = level[b1], first = false;
+      else
+        addBlock(total, level[b1]);
+    }
+  }
+
+  min = total.m_min, max = total.m_max;
+}
+
+//-----------------------------------------------------------------------------
+
+bool SoundPeaks::load(const QString &filePath, const TSoundTrackP &st) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+
+  QDataStream in(&file);
+  quint32 magic;
+  qint32 version, sampleCount, sampleRate, channelCount, bitPerSample;
+  double leftMin, leftMax;
+  QByteArray data;
+  in >> magic >> version >> sampleCount >> sampleRate >> channelCount >>
+      bitPerSample >> leftMin >> leftMax >> data;
+
+  if (in.status() != QDataStream::Ok || magic != peaksMagic ||
+      version != peaksVersion || sampleCount != st->getSampleCount() ||
+      sampleRate != (qint32)st->getSampleRate() ||
+      channelCount != st->getChannelCount() ||
+      bitPerSample != st->getBitPerSample())
+    return false;
+
+  data = qUncompress(data);
+
+  TINT32 blockCount = sampleCount >> BlockLevel;
+  if (data.size() != blockCount * (int)sizeof(Block)) return false;
+
+  clear();
+  m_sampleCount = sampleCount;
+  m_leftMin = leftMin, m_leftMax = leftMax;
+
+  m_levels.resize(1);
+  m_levels[0].resize(blockCount);
+  if (blockCount > 0)
+    memcpy(&m_levels[0][0], data.constData(), data.size());
+
+  buildLevels();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void SoundPeaks::save(const QString &filePath, const TSoundTrackP &st) const {
+  prunePeaks();
+
+  const std::vector<Block> &blocks = m_levels[0];
+  QByteArray data((const char *)blocks.data(),
+                  (int)(blocks.size() * sizeof(Block)));
+
+  // QSaveFile writes to a temporary file first: readers never see partially
+  // written peaks.
+  QSaveFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly)) return;
+
+  QDataStream out(&file);
+  out << peaksMagic << peaksVersion << qint32(m_sampleCount)
+      << qint32(st->getSampleRate()) << qint32(st->getChannelCount())
+      << qint32(st->getBitPerSample()) << m_leftMin << m_leftMax
+      << qCompress(data, 1);
+
+  if (out.status() == QDataStream::Ok)
+    file.commit();
+  else
+    file.cancelWriting();
+}
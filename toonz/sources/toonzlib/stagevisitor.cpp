@@ -16,6 +16,7 @@
 #include "tcolorstyles.h"
 #include "timage_io.h"
 #include "tregion.h"
+#include "tthread.h"
 #include "toonz/toonzscene.h"
 
 // TnzBase includes
@@ -371,7 +372,8 @@ RasterPainter::RasterPainter(const TDimension &dim, const TAffine &viewAff,
     , m_maskLevel(0)
     , m_singleColumnEnabled(false)
     , m_checkFlags(checkFlags)
-    , m_doRasterDarkenBlendedView(false) {}
+    , m_doRasterDarkenBlendedView(false)
+    , m_threadCount(1) {}
 
 //-----------------------------------------------------------------------------
 
@@ -456,8 +458,52 @@ recall
 
 namespace {
 QThreadStorage<std::vector<char> *> threadBuffers;
+
+//! Rows of the flush buffer composited by a single task.
+const int CompositeBandHeight = 64;
+
+//! A RasterPainter node, resolved for compositing.
+struct CompositeLayer {
+  TRasterP m_raster;
+  TPaletteP m_palette;  //!< Palette snapshot for colormap rasters
+  TAffine m_aff;        //!< Node to buffer affine
+  TPixel32 m_colorScale;
+  int m_inksOnly;
+  bool m_doPremultiply, m_whiteTransp, m_isFirstColumn;
+  bool m_useSettings;  //!< Whether the cmapped checks in m_settings apply
+  TRop::CmappedQuickputSettings m_settings;
+
+  CompositeLayer()
+      : m_inksOnly(0)
+      , m_doPremultiply(false)
+      , m_whiteTransp(false)
+      , m_isFirstColumn(false)
+      , m_useSettings(false) {}
+};
+
+//! Puts the layer on the rows of the buffer in [y0, y1).
+void compositeLayer(const TRaster32P &ras, const CompositeLayer &layer,
+                    int y0, int y1, bool doRasterDarkenBlendedView) {
+  if (TRaster32P src32 = layer.m_raster)
+    TRop::quickPut(ras, src32, layer.m_aff, layer.m_colorScale,
+                   layer.m_doPremultiply, layer.m_whiteTransp,
+                   layer.m_isFirstColumn, doRasterDarkenBlendedView, y0, y1);
+  else if (TRasterGR8P srcGr8 = layer.m_raster)
+    TRop::quickPut(ras, srcGr8, layer.m_aff, layer.m_colorScale, false, false,
+                   false, false, y0, y1);
+  else if (TRasterCM32P srcCm = layer.m_raster) {
+    if (layer.m_useSettings)
+      TRop::quickPut(ras, srcCm, layer.m_palette, layer.m_aff,
+                     layer.m_settings, y0, y1);
+    else
+      TRop::quickPut(ras, srcCm, layer.m_palette, layer.m_aff,
+                     layer.m_colorScale, layer.m_inksOnly, y0, y1);
+  } else
+    assert(!"Cannot use quickput with this raster combination!");
 }
 
+}  // namespace
+
 void RasterPainter::flushRasterImages() {
   if (m_nodes.empty()) return;
 
@@ -525,12 +571,16 @@ void RasterPainter::flushRasterImages() {
   Preferences::instance()->getOnionData(frontOnionColor, backOnionColor,
                                         onionInksOnly);
 
-  // Stack every node on top of the raster buffer
+  // Resolve what every node puts on the buffer. Check modes and palette
+  // frames alter shared data, so this is done here once per node - the
+  // compositing below only reads the layers.
+  std::vector<CompositeLayer> layers(nodesCount);
   for (i = 0; i < nodesCount; ++i) {
     if (m_nodes[i].m_isCurrentColumn) current = i;
 
-    TAffine aff         = TTranslation(-rect.x0, -rect.y0) * m_nodes[i].m_aff;
-    TDimension imageDim = m_nodes[i].m_raster->getSize();
+    CompositeLayer &layer = layers[i];
+
+    TAffine aff = TTranslation(-rect.x0, -rect.y0) * m_nodes[i].m_aff;
     TPointD offset(0.5, 0.5);
     aff *= TTranslation(offset);  // very quick and very dirty fix: in
                                   // camerastand the images seems shifted of an
@@ -556,13 +606,15 @@ void RasterPainter::flushRasterImages() {
       inksOnly = tc & ToonzCheck::eInksOnly;
     }
 
-    if (TRaster32P src32 = m_nodes[i].m_raster)
-      TRop::quickPut(viewedRaster, src32, aff, colorscale,
-                     m_nodes[i].m_doPremultiply, m_nodes[i].m_whiteTransp,
-                     m_nodes[i].m_isFirstColumn, m_doRasterDarkenBlendedView);
-    else if (TRasterGR8P srcGr8 = m_nodes[i].m_raster)
-      TRop::quickPut(viewedRaster, srcGr8, aff, colorscale);
-    else if (TRasterCM32P srcCm = m_nodes[i].m_raster) {
+    layer.m_raster        = m_nodes[i].m_raster;
+    layer.m_aff           = aff;
+    layer.m_colorScale    = colorscale;
+    layer.m_inksOnly      = inksOnly;
+    layer.m_doPremultiply = m_nodes[i].m_doPremultiply;
+    layer.m_whiteTransp   = m_nodes[i].m_whiteTransp;
+    layer.m_isFirstColumn = m_nodes[i].m_isFirstColumn;
+
+    if (TRasterCM32P srcCm = m_nodes[i].m_raster) {
       assert(m_nodes[i].m_palette);
       int oldframe = m_nodes[i].m_palette->getFrame();
       m_nodes[i].m_palette->setFrame(m_nodes[i].m_frame);
@@ -581,48 +633,63 @@ void RasterPainter::flushRasterImages() {
         if (tc & ToonzCheck::eGap)
           AreaFiller(srcCm).rectFill(m_nodes[i].m_savebox, 1, true, true,
                                      false);
-      } else
+      } else if (m_nodes[i].m_palette->isAnimated())
+        // Snapshot the colors at the node's frame, since another node may
+        // show the same palette at a different one
+        plt = m_nodes[i].m_palette->clone();
+      else
         plt = m_nodes[i].m_palette;
 
-      if (tc == 0 || tc == ToonzCheck::eBlackBg ||
-          !m_nodes[i].m_isCurrentColumn)
-        TRop::quickPut(viewedRaster, srcCm, plt, aff, colorscale, inksOnly);
-      else {
-        TRop::CmappedQuickputSettings settings;
-
-        settings.m_globalColorScale = colorscale;
-        settings.m_inksOnly         = inksOnly;
-        settings.m_transparencyCheck =
-            tc & (ToonzCheck::eTransparency | ToonzCheck::eGap);
-        settings.m_blackBgCheck = tc & ToonzCheck::eBlackBg;
-        /*-- InkCheck, Ink#1Check, PaintCheckはカレントカラムにのみ有効 --*/
-        settings.m_inkIndex =
-            m_nodes[i].m_isCurrentColumn
-                ? (tc & ToonzCheck::eInk ? index
-                                         : (tc & ToonzCheck::eInk1 ? 1 : -1))
-                : -1;
-        settings.m_paintIndex = m_nodes[i].m_isCurrentColumn
-                                    ? (tc & ToonzCheck::ePaint ? index : -1)
-                                    : -1;
-
-        Preferences::instance()->getTranspCheckData(
-            settings.m_transpCheckBg, settings.m_transpCheckInk,
-            settings.m_transpCheckPaint);
-
-        settings.m_isOnionSkin = m_nodes[i].m_onionMode != Node::eOnionSkinNone;
-        settings.m_gapCheckIndex = styleIndex;
-
-        TRop::quickPut(viewedRaster, srcCm, plt, aff, settings);
-      }
+      m_nodes[i].m_palette->setFrame(oldframe);
 
-      srcCm = TRasterCM32P();
-      plt   = TPaletteP();
+      layer.m_raster  = srcCm;
+      layer.m_palette = plt;
 
-      m_nodes[i].m_palette->setFrame(oldframe);
-    } else
-      assert(!"Cannot use quickput with this raster combination!");
+      if (tc == 0 || tc == ToonzCheck::eBlackBg ||
+          !m_nodes[i].m_isCurrentColumn)
+        continue;
+
+      TRop::CmappedQuickputSettings &settings = layer.m_settings;
+
+      layer.m_useSettings         = true;
+      settings.m_globalColorScale = colorscale;
+      settings.m_inksOnly         = inksOnly;
+      settings.m_transparencyCheck =
+          tc & (ToonzCheck::eTransparency | ToonzCheck::eGap);
+      settings.m_blackBgCheck = tc & ToonzCheck::eBlackBg;
+      /*-- InkCheck, Ink#1Check, PaintCheckはカレントカラムにのみ有効 --*/
+      settings.m_inkIndex =
+          m_nodes[i].m_isCurrentColumn
+              ? (tc & ToonzCheck::eInk ? index
+                                       : (tc & ToonzCheck::eInk1 ? 1 : -1))
+              : -1;
+      settings.m_paintIndex = m_nodes[i].m_isCurrentColumn
+                                  ? (tc & ToonzCheck::ePaint ? index : -1)
+                                  : -1;
+
+      Preferences::instance()->getTranspCheckData(settings.m_transpCheckBg,
+                                                  settings.m_transpCheckInk,
+                                                  settings.m_transpCheckPaint);
+
+      settings.m_isOnionSkin = m_nodes[i].m_onionMode != Node::eOnionSkinNone;
+      settings.m_gapCheckIndex = styleIndex;
+    }
   }
 
+  // Stack every layer on top of the raster buffer. A buffer pixel depends only
+  // on the layer pixels put over it, so horizontal bands of the buffer are
+  // composited concurrently, each band stacking all layers in z-order. The
+  // bands are put as rows of the whole buffer, making the result identical to
+  // a serial composite.
+  TThread::parallelFor(
+      0, viewedRaster->getLy(),
+      [&viewedRaster, &layers, this](int y0, int y1) {
+        for (const CompositeLayer &layer : layers)
+          compositeLayer(viewedRaster, layer, y0, y1,
+                         m_doRasterDarkenBlendedView);
+      },
+      CompositeBandHeight, m_threadCount);
+
   if (m_vs.m_colorMask != 0) {
     TRop::setChannel(ras, ras, m_vs.m_colorMask, false);
     TRop::quickPut(ras2, ras, TAffine());
@@ -1794,7 +1794,7 @@ void TZeraryColumnFx::setZeraryFx(TFx *fx) {
 
 std::string TZeraryColumnFx::getAlias(double frame,
                                       const TRenderSettings &info) const {
-  return "TZeraryColumnFx[" + m_fx->getAlias(frame, info) + "]";
+  return "TZeraryColumnFx[" + getInputAlias(m_fx, frame, info) + "]";
 }
 
 //-------------------------------------------------------------------
@@ -1873,9 +1873,9 @@ std::string TXsheetFx::getAlias(double frame,
   TFxSet *terminalFxs = m_fxDag->getTerminalFxs();
   int i, fxsCount = terminalFxs->getFxCount();
   for (i = 0; i < fxsCount; ++i) {
-    alias +=
-        static_cast<TRasterFx *>(terminalFxs->getFx(i))->getAlias(frame, info) +
-        ",";
+    alias += getInputAlias(static_cast<TRasterFx *>(terminalFxs->getFx(i)),
+                           frame, info) +
+             ",";
   }
 
   return alias + "]";
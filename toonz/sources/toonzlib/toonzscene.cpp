@@ -709,7 +709,7 @@ int ToonzScene::getFrameCount() const {
 //-----------------------------------------------------------------------------
 
 void ToonzScene::renderFrame(const TRaster32P &ras, int row, const TXsheet *xsh,
-                             bool checkFlags) const {
+                             bool checkFlags, int threadCount) const {
   if (xsh == 0) xsh = getXsheet();
 
   TCamera *camera        = xsh->getStageObjectTree()->getCurrentCamera();
@@ -742,6 +742,7 @@ void ToonzScene::renderFrame(const TRaster32P &ras, int row, const TXsheet *xsh,
 
     Stage::RasterPainter painter(ras->getSize(), viewAff, clipRect, vs,
                                  checkFlags);
+    painter.setThreadCount(threadCount);
     Stage::visit(painter, const_cast<ToonzScene *>(this),
                  const_cast<TXsheet *>(xsh), row);
 
@@ -764,7 +765,8 @@ void ToonzScene::renderFrame(const TRaster32P &ras, int row, const TXsheet *xsh,
 
 void ToonzScene::renderFrame(const TRaster32P &ras, int row, const TXsheet *xsh,
                              const TRectD &placedRect,
-                             const TAffine &worldToPlacedAff) const {
+                             const TAffine &worldToPlacedAff,
+                             int threadCount) const {
   // Build reference change affines
   const TAffine &placedToOglRefAff =
       TScale(ras->getLx() / placedRect.getLx(),
@@ -824,6 +826,7 @@ void ToonzScene::renderFrame(const TRaster32P &ras, int row, const TXsheet *xsh,
 
     Stage::RasterPainter painter(ras->getSize(), worldToOglRefAff, clipRect, vs,
                                  false);
+    painter.setThreadCount(threadCount);
     Stage::visit(painter, const_cast<ToonzScene *>(this),
                  const_cast<TXsheet *>(xsh), row);
 
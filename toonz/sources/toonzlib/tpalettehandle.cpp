@@ -179,7 +179,10 @@ void TPaletteHandle::setStyleParamIndex(int index) {
 
 //-----------------------------------------------------------------------------
 
-void TPaletteHandle::notifyPaletteChanged() { emit broadcastPaletteChanged(); }
+void TPaletteHandle::notifyPaletteChanged() {
+  if (getPalette()) getPalette()->invalidateColorLut();
+  emit broadcastPaletteChanged();
+}
 
 //-----------------------------------------------------------------------------
 
@@ -197,6 +200,9 @@ void TPaletteHandle::notifyColorStyleSwitched() {
 
 void TPaletteHandle::notifyColorStyleChanged(bool onDragging,
                                              bool setDirtyFlag) {
+  // Styles are edited in place before the notification
+  if (getPalette()) getPalette()->invalidateColorLut();
+
   if (setDirtyFlag && getPalette() && !getPalette()->getDirtyFlag())
     getPalette()->setDirtyFlag(true);
 
@@ -0,0 +1,153 @@
+
+
+#include "toonz/txshcellruns.h"
+
+#include <algorithm>
+
+//=============================================================================
+// TXshCellRuns
+
+int TXshCellRuns::findRun(int index) const {
+  assert(0 <= index && index < size());
+  std::vector<Run>::const_iterator it =
+      std::upper_bound(m_runs.begin(), m_runs.end(), index,
+                       [](int i, const Run &run) { return i < run.m_end; });
+  assert(it != m_runs.end());
+  return it - m_runs.begin();
+}
+
+//-----------------------------------------------------------------------------
+
+void TXshCellRuns::get(int index, int count, TXshCell cells[]) const {
+  if (count <= 0) return;
+  assert(0 <= index && index + count <= size());
+
+  int r = findRun(index);
+  while (count > 0) {
+    const Run &run = m_runs[r++];
+    int n          = std::min(run.m_end - index, count);
+    std::fill_n(cells, n, run.m_cell);
+    cells += n, index += n, count -= n;
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+int TXshCellRuns::split(int index) {
+  assert(0 <= index && index <= size());
+  if (index == size()) return (int)m_runs.size();
+
+  int r = findRun(index);
+  if (getRunStart(r) == index) return r;
+
+  // the run contains index: cut off its head
+  Run head(m_runs[r].m_cell, index);
+  m_runs.insert(m_runs.begin() + r, head);
+  return r + 1;
+}
+
+//-----------------------------------------------------------------------------
+
+void TXshCellRuns::merge(int r0, int r1) {
+  r0 = std::max(r0, 1);
+  r1 = std::min(r1, (int)m_runs.size() - 1);
+  for (int r = r1; r >= r0; --r) {
+    if (m_runs[r].m_cell != m_runs[r - 1].m_cell) continue;
+    m_runs[r - 1].m_end = m_runs[r].m_end;
+    m_runs.erase(m_runs.begin() + r);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void TXshCellRuns::set(int index, int count, const TXshCell cells[]) {
+  if (count <= 0) return;
+  assert(0 <= index && index + count <= size());
+
+  if (count == 1) {
+    // single cells overwriting a whole run, or the cell it already holds,
+    // leave the run layout alone
+    int r         = findRun(index);
+    TXshCell cell = normalized(cells[0]);
+    if (m_runs[r].m_cell == cell) return;
+    if (getRunStart(r) == index && m_runs[r].m_end == index + 1) {
+      m_runs[r].m_cell = cell;
+      merge(r, r + 1);
+      return;
+    }
+  }
+
+  // compress the new cells first: cells[] may point into this container
+  std::vector<Run> runs;
+  for (int i = 0; i < count; ++i) {
+    const TXshCell &cell = normalized(cells[i]);
+    if (!runs.empty() && runs.back().m_cell == cell)
+      ++runs.back().m_end;
+    else
+      runs.push_back(Run(cell, index + i + 1));
+  }
+
+  int r0 = split(index);
+  int r1 = split(index + count);
+  m_runs.erase(m_runs.begin() + r0, m_runs.begin() + r1);
+  m_runs.insert(m_runs.begin() + r0, runs.begin(), runs.end());
+  merge(r0, r0 + (int)runs.size());
+}
+
+//-----------------------------------------------------------------------------
+
+void TXshCellRuns::insert(int index, int count, const TXshCell &cell) {
+  if (count <= 0) return;
+  assert(0 <= index && index <= size());
+
+  Run run(normalized(cell), index + count);  // copy first, cell may be
+                                            // stored here
+
+  int r = split(index), runCount = (int)m_runs.size();
+  for (int i = r; i < runCount; ++i) m_runs[i].m_end += count;
+  m_runs.insert(m_runs.begin() + r, run);
+  merge(r, r + 1);
+}
+
+//-----------------------------------------------------------------------------
+
+void TXshCellRuns::erase(int index, int count) {
+  if (count <= 0) return;
+  assert(0 <= index && index + count <= size());
+
+  int r0 = split(index);
+  int r1 = split(index + count);
+  m_runs.erase(m_runs.begin() + r0, m_runs.begin() + r1);
+
+  int runCount = (int)m_runs.size();
+  for (int i = r0; i < runCount; ++i) m_runs[i].m_end -= count;
+  merge(r0, r0);
+}
+
+//-----------------------------------------------------------------------------
+
+void TXshCellRuns::resize(int newSize) {
+  int oldSize = size();
+  if (newSize < oldSize)
+    erase(newSize, oldSize - newSize);
+  else
+    insert(oldSize, newSize - oldSize);
+}
+
+//-----------------------------------------------------------------------------
+
+int TXshCellRuns::trimFront() {
+  int removed = 0;
+  while (!m_runs.empty() && m_runs.front().m_cell.isEmpty()) {
+    int count = m_runs.front().m_end;
+    erase(0, count);
+    removed += count;
+  }
+  return removed;
+}
+
+//-----------------------------------------------------------------------------
+
+void TXshCellRuns::trimBack() {
+  while (!m_runs.empty() && m_runs.back().m_cell.isEmpty()) m_runs.pop_back();
+}
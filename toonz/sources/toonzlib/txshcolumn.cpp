@@ -20,6 +20,8 @@
 
 #include <QMap>
 
+#include <algorithm>
+
 namespace {
 QMap<int, QPair<QString, TPixel32>> filterColors;
 };
@@ -36,20 +38,21 @@ TXshCellColumn::~TXshCellColumn() { m_cells.clear(); }
 //-----------------------------------------------------------------------------
 
 int TXshCellColumn::getRange(int &r0, int &r1) const {
+  // equal cells are merged in runs, and empty cells are all stored as
+  // TXshCell(): there is at most one leading and one trailing empty run to
+  // skip
   int cellCount = m_cells.size();
-  r0            = m_first;
-  r1            = r0 + cellCount - 1;
-  int i;
-  for (i = 0; i < cellCount && m_cells[i].isEmpty(); i++) {
-  }
+  int runCount  = m_cells.getRunCount();
+  int i         = 0;
+  if (cellCount > 0 && m_cells.front().isEmpty()) i = m_cells.getRun(0).m_end;
   if (i >= cellCount) {
     r0 = 0;
     r1 = -1;
     return 0;
   }
   r0 = m_first + i;
-  for (i = cellCount - 1; i >= 0 && m_cells[i].isEmpty(); i--) {
-  }
+  i  = cellCount - 1;
+  if (m_cells.back().isEmpty()) i = m_cells.getRunStart(runCount - 1) - 1;
 
   r1 = m_first + i;
   return r1 - r0 + 1;
@@ -59,8 +62,8 @@ int TXshCellColumn::getRange(int &r0, int &r1) const {
 
 int TXshCellColumn::getRowCount() const {
   int i = m_cells.size();
-  for (; i > 0 && m_cells[i - 1].isEmpty(); i--) {
-  }
+  if (i > 0 && m_cells.back().isEmpty())
+    i = m_cells.getRunStart(m_cells.getRunCount() - 1);
   if (i == 0)
     return 0;
   else
@@ -83,7 +86,7 @@ int TXshCellColumn::getFirstRow() const { return m_first; }
 
 const TXshCell &TXshCellColumn::getCell(int row) const {
   static TXshCell emptyCell;
-  if (row < 0 || row < m_first || row >= m_first + (int)m_cells.size())
+  if (row < 0 || row < m_first || row >= m_first + m_cells.size())
     return emptyCell;
   return m_cells[row - m_first];
 }
@@ -102,7 +105,7 @@ void TXshCellColumn::checkColumn() const {
   int r0, r1;
   int range = getRange(r0, r1);
   assert(range >= 0);
-  assert(range == (int)m_cells.size());
+  assert(range == m_cells.size());
   assert(getRowCount() >= 0);
 
   TXshCell firstCell = getCell(m_first);
@@ -123,11 +126,10 @@ void TXshCellColumn::checkColumn() const {
 
 void TXshCellColumn::getCells(int row, int rowCount, TXshCell cells[]) {
   const TXshCell emptyCell;
-  int first = m_first;
-  int i;
+  int first     = m_first;
   int cellCount = m_cells.size();
   if (row < 0 || row + rowCount - 1 < first || row >= first + cellCount) {
-    for (i = 0; i < rowCount; i++) cells[i] = emptyCell;
+    std::fill_n(cells, rowCount, emptyCell);
     return;
   }
 
@@ -144,13 +146,9 @@ void TXshCellColumn::getCells(int row, int rowCount, TXshCell cells[]) {
   }
   if (n + src > cellCount) n = cellCount - src;
 
-  TXshCell *dstCell                       = cells;
-  TXshCell *endDstCell                    = dstCell + dst;
-  while (dstCell < endDstCell) *dstCell++ = emptyCell;
-  endDstCell += n;
-  while (dstCell < endDstCell) *dstCell++ = m_cells[src++];
-  endDstCell                              = cells + rowCount;
-  while (dstCell < endDstCell) *dstCell++ = emptyCell;
+  std::fill_n(cells, dst, emptyCell);
+  m_cells.get(src, n, cells + dst);
+  std::fill(cells + dst + n, cells + rowCount, emptyCell);
 }
 
 //-----------------------------------------------------------------------------
@@ -180,10 +178,9 @@ bool TXshCellColumn::setCell(int row, const TXshCell &cell) {
     if (cell.isEmpty()) return false;  // non faccio nulla
     int delta = m_first - row;
     assert(delta > 0);
-    m_cells.insert(m_cells.begin(), delta - 1, TXshCell());  // celle vuote
-    m_cells.insert(m_cells.begin(),
-                   cell);  // devo settare la prima comp. del vettore
-    m_first = row;         // row 'e la nuova firstrow
+    m_cells.insert(0, delta - 1, TXshCell());  // celle vuote
+    m_cells.insert(0, 1, cell);  // devo settare la prima comp. del vettore
+    m_first = row;               // row 'e la nuova firstrow
 // updateIcon();
 #ifndef NDEBUG
     checkColumn();
@@ -192,9 +189,8 @@ bool TXshCellColumn::setCell(int row, const TXshCell &cell) {
   } else if (row > lastRow)  // dopo
   {
     if (cell.isEmpty()) return false;  // non faccio nulla
-    int count = row - lastRow - 1;
     // se necessario, inserisco celle vuote
-    for (int i = 0; i < count; ++i) m_cells.push_back(TXshCell());
+    m_cells.resize(row - m_first);
     m_cells.push_back(cell);
 #ifndef NDEBUG
     checkColumn();
@@ -203,19 +199,16 @@ bool TXshCellColumn::setCell(int row, const TXshCell &cell) {
   }
   //"[r0,r1]"
   int index = row - m_first;
-  assert(0 <= index && index < (int)m_cells.size());
-  m_cells[index] = cell;
+  assert(0 <= index && index < m_cells.size());
+  m_cells.set(index, cell);
   // if(index == 0) updateIcon();
   if (cell.isEmpty()) {
     if (row == lastRow) {
       // verifico la presenza di celle bianche alla fine
-      while (!m_cells.empty() && m_cells.back().isEmpty()) m_cells.pop_back();
+      m_cells.trimBack();
     } else if (row == m_first) {
       // verifico la presenza di celle bianche all'inizio
-      while (!m_cells.empty() && m_cells.front().isEmpty()) {
-        m_cells.erase(m_cells.begin());
-        m_first++;
-      }
+      m_first += m_cells.trimFront();
     }
     if (m_cells.empty()) m_first = 0;
   }
@@ -231,43 +224,26 @@ bool TXshCellColumn::setCells(int row, int rowCount, const TXshCell cells[]) {
   for (i = 0; i < rowCount; i++)
     if (!canSetCell(cells[i])) return false;
 
-  int oldCellCount = m_cells.size();
-
   // le celle da settare sono [ra, rb]
   int ra = row;
   int rb = row + rowCount - 1;
   assert(ra <= rb);
-  // le celle non vuote sono [c_ra, c_rb]
-  int c_rb = m_first + oldCellCount - 1;
 
-  if (row > c_rb)  // sono oltre l'ultima riga
-  {
-    if (oldCellCount == 0) m_first = row;  // row 'e la nuova firstrow
-    int newCellCount               = row - m_first + rowCount;
-    m_cells.resize(newCellCount);
-  } else if (row < m_first) {
-    int delta = m_first - row;
-    m_cells.insert(m_cells.begin(), delta, TXshCell());
+  if (m_cells.empty())
+    m_first = row;  // row 'e la nuova firstrow
+  else if (row < m_first) {
+    m_cells.insert(0, m_first - row);
     m_first = row;  // row e' la nuova firstrow
   }
-  if (rb > c_rb) {
-    for (int i = 0; i < rb - c_rb; ++i) m_cells.push_back(TXshCell());
-  }
+  if (rb - m_first + 1 > m_cells.size()) m_cells.resize(rb - m_first + 1);
 
   int index = row - m_first;
-  assert(0 <= index && index < (int)m_cells.size());
-  for (int i = 0; i < rowCount; i++) m_cells[index + i] = cells[i];
-
-  // verifico la presenza di celle bianche alla fine
-  while (!m_cells.empty() && m_cells.back().isEmpty()) {
-    m_cells.pop_back();
-  }
+  assert(0 <= index && index < m_cells.size());
+  m_cells.set(index, rowCount, cells);
 
-  // verifico la presenza di celle bianche all'inizio
-  while (!m_cells.empty() && m_cells.front().isEmpty()) {
-    m_cells.erase(m_cells.begin());
-    m_first++;
-  }
+  // verifico la presenza di celle bianche alla fine e all'inizio
+  m_cells.trimBack();
+  m_first += m_cells.trimFront();
   if (m_cells.empty()) {
     m_first = 0;
   }
@@ -281,16 +257,13 @@ void TXshCellColumn::insertEmptyCells(int row, int rowCount) {
   if (m_cells.empty()) return;  // se la colonna e' vuota non devo inserire
                                 // celle
 
-  if (row >= m_first + (int)m_cells.size()) return;  // dopo:non inserisco nulla
-  if (row <= m_first)                                // prima
+  if (row >= m_first + m_cells.size()) return;  // dopo:non inserisco nulla
+  if (row <= m_first)                           // prima
   {
     m_first += rowCount;
   } else  // in mezzo
   {
-    int delta                          = row - m_first;
-    std::vector<TXshCell>::iterator it = m_cells.begin();
-    std::advance(it, delta);
-    m_cells.insert(it, rowCount, TXshCell());
+    m_cells.insert(row - m_first, rowCount, TXshCell());
   }
 }
 
@@ -328,25 +301,18 @@ void TXshCellColumn::clearCells(int row, int rowCount) {
     m_cells.clear();
     m_first = 0;
   } else {
-    assert(ra - c_ra < (int)m_cells.size());
-    assert(ra - c_ra + n <= (int)m_cells.size());
-    // std::fill_n(&m_cells[ra-c_ra],n, TXshCell());
-    int i;
-    for (i = 0; i < n; i++) m_cells[ra - c_ra + i] = TXshCell();
+    assert(ra - c_ra + n <= m_cells.size());
+    m_cells.erase(ra - c_ra, n);
+    m_cells.insert(ra - c_ra, n, TXshCell());
 
     // verifico la presenza di celle bianche alla fine
-    while (!m_cells.empty() && m_cells.back().isEmpty()) {
-      m_cells.pop_back();
-    }
+    m_cells.trimBack();
 
     if (m_cells.empty()) {
       m_first = 0;
     } else {
       // verifico la presenza di celle bianche all'inizio
-      while (!m_cells.empty() && m_cells.front().isEmpty()) {
-        m_cells.erase(m_cells.begin());
-        m_first++;
-      }
+      m_first += m_cells.trimFront();
     }
   }
   // updateIcon();
@@ -381,28 +347,15 @@ void TXshCellColumn::removeCells(int row, int rowCount) {
   if (row == m_first) {
     // cancello all'inizio
     assert(rowCount <= cellCount);
-    std::vector<TXshCell>::iterator it  = m_cells.begin();
-    std::vector<TXshCell>::iterator it2 = m_cells.begin();
-    std::advance(it2, rowCount);
-    m_cells.erase(it, it2);
+    m_cells.erase(0, rowCount);
     // verifico la presenza di celle bianche all'inizio
-    while (!m_cells.empty() && m_cells.front().isEmpty()) {
-      m_cells.erase(m_cells.begin());
-      m_first++;
-    }
+    m_first += m_cells.trimFront();
   } else {
     // cancello dopo l'inizio
-    int d                               = row - m_first;
-    std::vector<TXshCell>::iterator it  = m_cells.begin();
-    std::vector<TXshCell>::iterator it2 = m_cells.begin();
-    std::advance(it, d);
-    std::advance(it2, d + rowCount);
-    m_cells.erase(it, it2);
+    m_cells.erase(row - m_first, rowCount);
     if (row + rowCount == m_first + cellCount) {
       // verifico la presenza di celle bianche alla fine
-      while (!m_cells.empty() && m_cells.back().isEmpty()) {
-        m_cells.pop_back();
-      }
+      m_cells.trimBack();
     }
   }
 
@@ -22,6 +22,7 @@
 #include "toonz/txshpalettecolumn.h"
 #include "toonz/txshzeraryfxcolumn.h"
 #include "toonz/txshsoundcolumn.h"
+#include "toonz/soundmixer.h"
 #include "toonz/sceneproperties.h"
 #include "toonz/toonzscene.h"
 #include "toonz/columnfan.h"
@@ -98,6 +99,7 @@ struct TXsheet::TXsheetImp {
   int m_viewColumn;
 
   TSoundTrackP m_mixedSound;
+  std::unique_ptr<SoundMixer> m_soundMixer;  //!< Streams scrubbed frames.
   ColumnFan m_columnFans[Orientations::COUNT];
   XshHandleManager *m_handleManager;
   ToonzScene *m_scene;
@@ -1497,30 +1499,19 @@ void TXsheet::scrub(int frame, bool isPreview) {
     double fps =
         getScene()->getProperties()->getOutputProperties()->getFrameRate();
 
-    TXsheet::SoundProperties *prop = new TXsheet::SoundProperties();
-    prop->m_isPreview              = isPreview;
+    std::vector<TXshSoundColumn *> sounds;
+    searchAudioColumn(this, sounds, isPreview);
+    if (sounds.empty()) return;
 
-    TSoundTrack *st = makeSound(prop);  // Absorbs prop's ownership
-    if (!st) return;
+    // Frames are mixed on demand: only the scrubbed ones are ever computed
+    if (!m_imp->m_soundMixer) m_imp->m_soundMixer.reset(new SoundMixer);
+    SoundMixer *mixer = m_imp->m_soundMixer.get();
+    mixer->setColumns(sounds, fps);
 
-    double samplePerFrame = st->getSampleRate() / fps;
+    double samplePerFrame = mixer->getSamplePerFrame();
 
     double s0 = frame * samplePerFrame, s1 = s0 + samplePerFrame;
-    // if (m_player && m_player->isPlaying()) {
-    //    try {
-    //        m_player->stop();
-    //    }
-    //    catch (const std::runtime_error& e) {
-    //        int i = 0;
-    //    }
-    //    catch (const std::exception& e) {
-    //        int i = 0;
-    //    }
-    //    catch (...) {
-    //        int i = 0;
-    //    }
-    //}
-    play(st, s0, s1, false);
+    mixer->play(s0, s1);
   } catch (TSoundDeviceException &e) {
     if (e.getType() == TSoundDeviceException::NoDevice) {
       std::cout << ::to_string(e.getMessage()) << std::endl;
@@ -1533,11 +1524,26 @@ void TXsheet::scrub(int frame, bool isPreview) {
 //-----------------------------------------------------------------------------
 
 void TXsheet::stopScrub() {
+  if (m_imp->m_soundMixer) m_imp->m_soundMixer->stop();
   if (m_player) m_player->stop();
 }
 
 //-----------------------------------------------------------------------------
 
+bool TXsheet::hasSound(bool isPreview) {
+  std::vector<TXshSoundColumn *> sounds;
+  searchAudioColumn(this, sounds, isPreview);
+  return !sounds.empty();
+}
+
+//-----------------------------------------------------------------------------
+
+SoundMixer *TXsheet::getSoundMixer() const {
+  return m_imp->m_soundMixer.get();
+}
+
+//-----------------------------------------------------------------------------
+
 void TXsheet::play(TSoundTrackP soundtrack, int s0, int s1, bool loop) {
   if (!TSoundOutputDevice::installed()) return;
 
@@ -222,7 +222,7 @@ bool TXshLevelColumn::setNumbers(int row, int rowCount,
   for (int i = 0; i < rowCount; i++) {
     // checking target cells
     int currentTgtIndex = row + i - m_first;
-    if (currentTgtIndex < m_cells.size()) {
+    if (0 <= currentTgtIndex && currentTgtIndex < m_cells.size()) {
       TXshCell tgtCell = m_cells[currentTgtIndex];
       if (!tgtCell.isEmpty() && tgtCell.m_frameId == TFrameId::NO_FRAME)
         return false;
@@ -266,42 +266,34 @@ bool TXshLevelColumn::setNumbers(int row, int rowCount,
   }
 
   // Resize the cell container
-  int ra   = row;
-  int rb   = row + rowCount - 1;
-  int c_rb = m_first + m_cells.size() - 1;
-  if (row > c_rb) {
-    int newCellCount = row - m_first + rowCount;
-    m_cells.resize(newCellCount);
-  } else if (row < m_first) {
+  int rb = row + rowCount - 1;
+  if (row < m_first) {
     int delta = m_first - row;
-    m_cells.insert(m_cells.begin(), delta, TXshCell());
+    m_cells.insert(0, delta, TXshCell());
     m_first = row;
   }
-  if (rb > c_rb) {
-    for (int i = 0; i < rb - c_rb; ++i) m_cells.push_back(TXshCell());
-  }
+  if (rb - m_first + 1 > m_cells.size()) m_cells.resize(rb - m_first + 1);
+
+  // Paste numbers. The new cells are set in a single call, since each
+  // container edit costs up to the column's run count.
+  std::vector<TXshCell> newCells(rowCount);
+  m_cells.get(row - m_first, rowCount, &newCells[0]);
 
-  // Paste numbers.
   for (int i = 0; i < rowCount; i++) {
-    int dstIndex     = row - m_first + i;
-    TXshCell dstCell = m_cells[dstIndex];
+    TXshCell dstCell = newCells[i];
     TXshCell srcCell = cells[i];
     if (srcCell.isEmpty()) {
-      m_cells[dstIndex] = TXshCell();
+      newCells[i] = TXshCell();
     } else {
       if (!dstCell.isEmpty()) currentLevel = dstCell.m_level;
-      m_cells[dstIndex] = TXshCell(currentLevel, srcCell.m_frameId);
+      newCells[i] = TXshCell(currentLevel, srcCell.m_frameId);
     }
   }
+  m_cells.set(row - m_first, rowCount, &newCells[0]);
 
   // Update the cell container.
-  while (!m_cells.empty() && m_cells.back().isEmpty()) {
-    m_cells.pop_back();
-  }
-  while (!m_cells.empty() && m_cells.front().isEmpty()) {
-    m_cells.erase(m_cells.begin());
-    m_first++;
-  }
+  m_cells.trimBack();
+  m_first += m_cells.trimFront();
   if (m_cells.empty()) {
     m_first = 0;
   }
@@ -36,7 +36,12 @@ TXshSoundLevel::~TXshSoundLevel() {}
 
 TXshSoundLevel *TXshSoundLevel::clone() const {
   TXshSoundLevel *sound = new TXshSoundLevel();
-  sound->setSoundTrack(m_soundTrack->clone());
+  // The clone has the same samples: its peaks and values are copied, not
+  // recomputed
+  sound->m_soundTrack      = m_soundTrack->clone();
+  sound->m_peaks           = m_peaks;
+  for (int o = 0; o < Orientations::COUNT; ++o)
+    sound->m_values[o] = m_values[o];
   sound->m_duration        = m_duration;
   sound->m_path            = m_path;
   sound->m_samplePerFrame  = m_samplePerFrame;
@@ -83,7 +88,11 @@ void TXshSoundLevel::loadSoundTrack(const TFilePath &fileName) {
     if (ret) {
       m_duration = st->getDuration();
       setName(fileName.getWideName());
-      setSoundTrack(st);
+
+      // The file's peaks are usually already stored
+      m_soundTrack = st;
+      m_peaks.build(st, path);
+      computeValues();
     }
   } catch (TException &) {
     return;
@@ -170,8 +179,7 @@ void TXshSoundLevel::computeValuesFor(const Orientation *o) {
   double maxPressure = 0.0;
   double minPressure = 0.0;
 
-  m_soundTrack->getMinMaxPressure(TINT32(0), (TINT32)sampleCount, TSound::LEFT,
-                                  minPressure, maxPressure);
+  m_peaks.getLeftMinMaxPressure(minPressure, maxPressure);
 
   double absMaxPressure = std::max(fabs(minPressure), fabs(maxPressure));
 
@@ -189,19 +197,19 @@ void TXshSoundLevel::computeValuesFor(const Orientation *o) {
     for (j = 0; j < frameHeight - 1; ++j) {
       double min = 0.0;
       double max = 0.0;
-      m_soundTrack->getMinMaxPressure(
-          (TINT32)(i * m_samplePerFrame + j * samplePerPixel),
-          (TINT32)(i * m_samplePerFrame + (j + 1) * samplePerPixel - 1),
-          TSound::MONO, min, max);
+      m_peaks.getMinMaxPressure(
+          m_soundTrack, (TINT32)(i * m_samplePerFrame + j * samplePerPixel),
+          (TINT32)(i * m_samplePerFrame + (j + 1) * samplePerPixel - 1), min,
+          max);
       values.insert(std::pair<int, std::pair<double, double>>(
           p + j, std::pair<double, double>(min * weightA, max * weightA)));
     }
 
     double min = 0.0;
     double max = 0.0;
-    m_soundTrack->getMinMaxPressure(
-        (TINT32)(i * m_samplePerFrame + j * samplePerPixel),
-        (TINT32)((i + 1) * m_samplePerFrame - 1), TSound::MONO, min, max);
+    m_peaks.getMinMaxPressure(
+        m_soundTrack, (TINT32)(i * m_samplePerFrame + j * samplePerPixel),
+        (TINT32)((i + 1) * m_samplePerFrame - 1), min, max);
     values.insert(std::pair<int, std::pair<double, double>>(
         p + j, std::pair<double, double>(min * weightA, max * weightA)));
 
@@ -212,6 +220,14 @@ void TXshSoundLevel::computeValuesFor(const Orientation *o) {
 
 //-----------------------------------------------------------------------------
 
+void TXshSoundLevel::setSoundTrack(TSoundTrackP st) {
+  m_soundTrack = st;
+  m_peaks.build(st);
+  computeValues();
+}
+
+//-----------------------------------------------------------------------------
+
 void TXshSoundLevel::computeValues() {
   for (auto o : Orientations::all()) computeValuesFor(o);
 }
@@ -38,12 +38,25 @@
 #include "toonz/preferences.h"
 #include "toonz/sceneresources.h"
 #include "toonz/stage2.h"
+#include "toonz/toonzfolders.h"
 
 // TnzQt includes
 #include "toonzqt/gutil.h"
 
 #include "toonzqt/icongenerator.h"
 
+// Qt includes
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+
+// STD includes
+#include <atomic>
+
 //=============================================================================
 
 //===================================
@@ -60,6 +73,9 @@ TDimension FilmstripIconSize(0, 0);
 std::set<std::string> iconsMap;
 typedef std::set<std::string>::iterator IconIterator;
 
+// Icons whose memory hit was already counted - repaints do not count again
+std::set<std::string> hitIcons;
+
 //-----------------------------------------------------------------------------
 
 // Returns true if the image request was already submitted.
@@ -128,6 +144,7 @@ bool getIcon(const std::string &iconName, QPixmap &pix,
 //-----------------------------------------------------------------------------
 
 void setIcon(const std::string &iconName, const TRaster32P &icon) {
+  hitIcons.erase(iconName);
   if (iconsMap.find(iconName) != iconsMap.end())
     TImageCache::instance()->add(iconName, TRasterImageP(icon), true);
 }
@@ -137,6 +154,7 @@ void setIcon(const std::string &iconName, const TRaster32P &icon) {
  * them
  */
 void setIcon_TnzImg(const std::string &iconName, const TRasterCM32P &icon) {
+  hitIcons.erase(iconName);
   if (iconsMap.find(iconName) != iconsMap.end())
     TImageCache::instance()->add(
         iconName, TToonzImageP(icon, TRect(icon->getSize())), true);
@@ -151,6 +169,7 @@ void removeIcon(const std::string &iconName) {
     TImageCache::instance()->remove(iconName);
   }
   iconsMap.erase(iconName);
+  hitIcons.erase(iconName);
 }
 
 //-----------------------------------------------------------------------------
@@ -194,6 +213,189 @@ void makeChessBackground(const TRaster32P &ras) {
   ras->unlock();
 }
 
+//-----------------------------------------------------------------------------
+
+// Icon generation counters - updated by the icon rendering thread too.
+std::atomic<int> memoryHitsCount(0), storeHitsCount(0), rendersCount(0),
+    canceledCount(0);
+std::atomic<long long> renderTimeNs(0);
+
+}  // namespace
+
+//=============================================================================
+
+//==========================================
+//
+//    ThumbnailStore class
+//
+//------------------------------------------
+
+namespace {
+
+/*!
+  Disk storage for the icons of saved files, under the cache folder. Each icon
+  is a separate file named after the hash of its key, which includes the
+  source file's modification time: a modified file simply gets new entries,
+  and stale ones are pruned by age when the store grows too large.
+
+  Keys are computed, and icons loaded and saved, by the icon rendering
+  thread: the main thread never touches the disk for stored icons.
+*/
+class ThumbnailStore {
+  enum PixelType { RGBM32 = 1, CM32 = 2 };
+
+  static const quint32 Magic    = 0x54484d42;  // 'THMB'
+  static const int MaxFileCount = 20000;
+
+  QString m_folder;
+  std::atomic<bool> m_enabled;  //!< Toggled by the main thread.
+  bool m_pruned;
+
+public:
+  static ThumbnailStore *instance() {
+    static ThumbnailStore theInstance;
+    return &theInstance;
+  }
+
+  bool isEnabled() const { return m_enabled; }
+  void setEnabled(bool enabled) { m_enabled = enabled && !m_folder.isEmpty(); }
+
+  //! Returns the key of the icon of \b path, or an empty string if the icon
+  //! should not be stored.
+  std::string getKey(const std::string &kind, const TFilePath &path,
+                     const TFrameId &fid, const TDimension &iconSize) const;
+
+  TRasterP load(const std::string &key) const;
+  void save(const std::string &key, const TRasterP &icon);
+
+private:
+  ThumbnailStore();
+
+  QString getFilePath(const std::string &key) const;
+  void prune();
+};
+
+//-----------------------------------------------------------------------------
+
+ThumbnailStore::ThumbnailStore() : m_enabled(false), m_pruned(false) {
+  TFilePath cacheRoot = ToonzFolder::getCacheRootFolder();
+  if (cacheRoot.isEmpty()) return;
+
+  QString folder = (cacheRoot + "icons").getQString();
+  if (!QDir(folder).mkpath(".")) return;
+
+  m_folder  = folder;
+  m_enabled = true;
+}
+
+//-----------------------------------------------------------------------------
+
+std::string ThumbnailStore::getKey(const std::string &kind,
+                                   const TFilePath &path, const TFrameId &fid,
+                                   const TDimension &iconSize) const {
+  if (!m_enabled) return std::string();
+
+  TFileStatus fs(path);
+  if (!fs.doesExist() || fs.isDirectory()) return std::string();
+
+  return kind + "|" + ::to_string(path) + "|" + fid.expand() + "|" +
+         std::to_string(fs.getLastModificationTime().toMSecsSinceEpoch()) +
+         "|" + std::to_string(iconSize.lx) + "x" +
+         std::to_string(iconSize.ly);
+}
+
+//-----------------------------------------------------------------------------
+
+QString ThumbnailStore::getFilePath(const std::string &key) const {
+  QByteArray hash = QCryptographicHash::hash(
+      QByteArray(key.c_str(), (int)key.size()), QCryptographicHash::Md5);
+  return m_folder + "/" + QString::fromLatin1(hash.toHex()) + ".icon";
+}
+
+//-----------------------------------------------------------------------------
+
+TRasterP ThumbnailStore::load(const std::string &key) const {
+  QFile file(getFilePath(key));
+  if (!file.open(QIODevice::ReadOnly)) return TRasterP();
+
+  QDataStream in(&file);
+  quint32 magic, type;
+  qint32 lx, ly;
+  QByteArray data;
+  in >> magic >> type >> lx >> ly >> data;
+  if (in.status() != QDataStream::Ok || magic != Magic || lx <= 0 || ly <= 0)
+    return TRasterP();
+
+  TRasterP icon;
+  if (type == RGBM32)
+    icon = TRaster32P(lx, ly);
+  else if (type == CM32)
+    icon = TRasterCM32P(lx, ly);
+  else
+    return TRasterP();
+
+  data = qUncompress(data);
+  if (data.size() != lx * ly * icon->getPixelSize()) return TRasterP();
+
+  // Newly allocated rasters are contiguous
+  icon->lock();
+  memcpy(icon->getRawData(), data.constData(), data.size());
+  icon->unlock();
+
+  return icon;
+}
+
+//-----------------------------------------------------------------------------
+
+void ThumbnailStore::save(const std::string &key, const TRasterP &icon) {
+  quint32 type;
+  if ((TRaster32P)icon)
+    type = RGBM32;
+  else if ((TRasterCM32P)icon)
+    type = CM32;
+  else
+    return;
+
+  if (!m_pruned) {
+    prune();
+    m_pruned = true;
+  }
+
+  int lx = icon->getLx(), ly = icon->getLy();
+  int rowSize = lx * icon->getPixelSize();
+
+  QByteArray data(rowSize * ly, Qt::Uninitialized);
+  icon->lock();
+  for (int y = 0; y < ly; ++y)
+    memcpy(data.data() + y * rowSize, icon->getRawData(0, y), rowSize);
+  icon->unlock();
+
+  // QSaveFile writes to a temporary file first: readers never see a partially
+  // written icon.
+  QSaveFile file(getFilePath(key));
+  if (!file.open(QIODevice::WriteOnly)) return;
+
+  QDataStream out(&file);
+  out << Magic << type << qint32(lx) << qint32(ly) << qCompress(data, 1);
+  if (out.status() == QDataStream::Ok)
+    file.commit();
+  else
+    file.cancelWriting();
+}
+
+//-----------------------------------------------------------------------------
+
+void ThumbnailStore::prune() {
+  QDir dir(m_folder);
+  QFileInfoList files = dir.entryInfoList(QStringList("*.icon"), QDir::Files,
+                                          QDir::Time | QDir::Reversed);
+  if (files.size() <= MaxFileCount) return;
+
+  // Remove the oldest icons, leaving some room before the next pruning
+  int removedCount = files.size() - MaxFileCount * 3 / 4;
+  for (int i = 0; i < removedCount; ++i) QFile::remove(files[i].filePath());
+}
+
 }  // namespace
 
 //=============================================================================
@@ -446,6 +648,12 @@ class IconRenderer : public TThread::Runnable {
   TDimension m_iconSize;
   std::string m_id;
 
+  // Thumbnail store source, empty if not stored
+  std::string m_storeKind;
+  TFilePath m_storePath;
+  TFrameId m_storeFid;
+  bool m_storeRefresh;
+
   bool m_started;
   bool m_terminated;
 
@@ -453,14 +661,31 @@ public:
   IconRenderer(const std::string &id, const TDimension &iconSize);
   virtual ~IconRenderer();
 
-  void run() override = 0;
+  //! Loads the icon from the thumbnail store, or renders and stores it.
+  void run() override;
+  virtual void render() = 0;
 
   void setIcon(const TRaster32P &icon) { m_icon = icon; }
   TRaster32P getIcon() const { return m_icon; }
 
+  //! Returns the icon to be saved in the thumbnail store, if any.
+  virtual TRasterP getStoredIcon() const { return m_icon; }
+  virtual void setStoredIcon(const TRasterP &icon) { setIcon(icon); }
+
   TDimension getIconSize() { return m_iconSize; }
   const std::string &getId() const { return m_id; }
 
+  //! Stores the icon of \b path in the thumbnail store; \b refresh replaces
+  //! the stored icon instead of loading it.
+  void setStoredFile(const std::string &kind, const TFilePath &path,
+                     const TFrameId &fid, bool refresh = false) {
+    if (path.isEmpty()) return;
+    m_storeKind    = kind;
+    m_storePath    = path;
+    m_storeFid     = fid;
+    m_storeRefresh = refresh;
+  }
+
   bool &hasStarted() { return m_started; }
   bool &wasTerminated() { return m_terminated; }
 };
@@ -471,6 +696,7 @@ IconRenderer::IconRenderer(const std::string &id, const TDimension &iconSize)
     : m_icon()
     , m_iconSize(iconSize)
     , m_id(id)
+    , m_storeRefresh(false)
     , m_started(false)
     , m_terminated(false) {
   connect(this, SIGNAL(started(TThread::RunnableP)), IconGenerator::instance(),
@@ -488,6 +714,37 @@ IconRenderer::IconRenderer(const std::string &id, const TDimension &iconSize)
 
 IconRenderer::~IconRenderer() {}
 
+//-----------------------------------------------------------------------------
+
+void IconRenderer::run() {
+  // The key reads the file's modification time: done here, not in the caller
+  std::string storeKey;
+  if (!m_storeKind.empty())
+    storeKey = ThumbnailStore::instance()->getKey(m_storeKind, m_storePath,
+                                                  m_storeFid, m_iconSize);
+
+  if (!storeKey.empty() && !m_storeRefresh) {
+    if (TRasterP icon = ThumbnailStore::instance()->load(storeKey)) {
+      setStoredIcon(icon);
+      ++storeHitsCount;
+      return;
+    }
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  render();
+
+  renderTimeNs += timer.nsecsElapsed();
+  ++rendersCount;
+
+  if (!storeKey.empty()) {
+    if (TRasterP icon = getStoredIcon())
+      ThumbnailStore::instance()->save(storeKey, icon);
+  }
+}
+
 //=============================================================================
 
 //===================================
@@ -528,7 +785,7 @@ public:
       , m_settings(settings) {}
 
   TRaster32P generateRaster(const TDimension &iconSize) const;
-  void run() override;
+  void render() override;
 };
 
 //-----------------------------------------------------------------------------
@@ -557,7 +814,7 @@ TRaster32P VectorImageIconRenderer::generateRaster(
 
 //-----------------------------------------------------------------------------
 
-void VectorImageIconRenderer::run() {
+void VectorImageIconRenderer::render() {
   try {
     TRaster32P ras(generateRaster(getIconSize()));
 
@@ -581,7 +838,7 @@ public:
       : IconRenderer(id, iconSize), m_spline(spline) {}
 
   TRaster32P generateRaster(const TDimension &iconSize) const;
-  void run() override;
+  void render() override;
 };
 
 //-----------------------------------------------------------------------------
@@ -625,7 +882,7 @@ TRaster32P SplineIconRenderer::generateRaster(
 
 //-----------------------------------------------------------------------------
 
-void SplineIconRenderer::run() {
+void SplineIconRenderer::render() {
   TRaster32P raster = generateRaster(getIconSize());
   if (raster) setIcon(raster);
 }
@@ -645,12 +902,12 @@ public:
                           TXshSimpleLevelP sl, const TFrameId &fid)
       : IconRenderer(id, iconSize), m_sl(sl), m_fid(fid) {}
 
-  void run() override;
+  void render() override;
 };
 
 //-----------------------------------------------------------------------------
 
-void RasterImageIconRenderer::run() {
+void RasterImageIconRenderer::render() {
   if (!m_sl->isFid(m_fid)) return;
 
   TImageP image = m_sl->getFrameIcon(m_fid);
@@ -687,15 +944,25 @@ public:
       , m_settings(settings)
       , m_tnzImgIcon(0) {}
 
-  void run() override;
+  void render() override;
 
   void setIcon_TnzImg(const TRasterCM32P &timgp) { m_tnzImgIcon = timgp; }
   TRasterCM32P getIcon_TnzImg() const { return m_tnzImgIcon; }
+
+  TRasterP getStoredIcon() const override {
+    return m_tnzImgIcon ? TRasterP(m_tnzImgIcon) : TRasterP(getIcon());
+  }
+  void setStoredIcon(const TRasterP &icon) override {
+    if (TRasterCM32P iconCM32 = icon)
+      setIcon_TnzImg(iconCM32);
+    else
+      setIcon(icon);
+  }
 };
 
 //-----------------------------------------------------------------------------
 
-void ToonzImageIconRenderer::run() {
+void ToonzImageIconRenderer::render() {
   if (!m_sl->isFid(m_fid)) return;
 
   TImageP image = m_sl->getFrameIcon(m_fid);
@@ -801,7 +1068,7 @@ public:
       , m_settings(settings) {}
 
   TRaster32P generateRaster(const TDimension &iconSize) const;
-  void run() override;
+  void render() override;
 };
 
 //-----------------------------------------------------------------------------
@@ -832,7 +1099,7 @@ TRaster32P MeshImageIconRenderer::generateRaster(
 
 //-----------------------------------------------------------------------------
 
-void MeshImageIconRenderer::run() {
+void MeshImageIconRenderer::render() {
   try {
     TRaster32P ras(generateRaster(getIconSize()));
 
@@ -870,7 +1137,7 @@ public:
   }
 
   TRaster32P generateRaster(const TDimension &iconSize) const;
-  void run() override;
+  void render() override;
 };
 
 //-----------------------------------------------------------------------------
@@ -891,8 +1158,9 @@ TRaster32P XsheetIconRenderer::generateRaster(
   bool rasterizePli               = TXshSimpleLevel::m_rasterizePli;
   TXshSimpleLevel::m_rasterizePli = false;
 
-  // All checks are disabled
-  scene->renderFrame(ras, m_row, m_xsheet, false);
+  // All checks are disabled. Icons are rendered one at a time, so the
+  // columns are composited on all cores.
+  scene->renderFrame(ras, m_row, m_xsheet, false, 0);
 
   TXshSimpleLevel::m_rasterizePli = rasterizePli;
   TImageCache::instance()->setEnabled(true);
@@ -902,7 +1170,7 @@ TRaster32P XsheetIconRenderer::generateRaster(
 
 //-----------------------------------------------------------------------------
 
-void XsheetIconRenderer::run() {
+void XsheetIconRenderer::render() {
   TRaster32P ras = generateRaster(getIconSize());
   if (ras) setIcon(ras);
 }
@@ -916,15 +1184,25 @@ void XsheetIconRenderer::run() {
 class FileIconRenderer final : public IconRenderer {
   TFilePath m_path;
   TFrameId m_fid;
+  bool m_decoded;  //!< Whether the icon was decoded from the file.
 
 public:
   FileIconRenderer(const TDimension &iconSize, const TFilePath &path,
                    const TFrameId &fid)
-      : IconRenderer(getId(path, fid), iconSize), m_path(path), m_fid(fid) {}
+      : IconRenderer(getId(path, fid), iconSize)
+      , m_path(path)
+      , m_fid(fid)
+      , m_decoded(false) {}
 
   static std::string getId(const TFilePath &path, const TFrameId &fid);
+  static TFilePath getStorePath(const TFilePath &path, const TFrameId &fid);
 
-  void run() override;
+  void render() override;
+
+  // Type icons and broken file icons are not worth storing
+  TRasterP getStoredIcon() const override {
+    return m_decoded ? TRasterP(getIcon()) : TRasterP();
+  }
 };
 
 //-----------------------------------------------------------------------------
@@ -970,6 +1248,25 @@ std::string FileIconRenderer::getId(const TFilePath &path,
 
 //-----------------------------------------------------------------------------
 
+TFilePath FileIconRenderer::getStorePath(const TFilePath &path,
+                                        const TFrameId &fid) {
+  // Only the types whose icon is decoded from the file itself - see render().
+  // Scene icons are small pngs already, and are not worth it.
+  std::string type(path.getType());
+  bool decoded = type == "pli" || type == "mesh" || type == "tlv" ||
+                 (type != "svg" && type != "psd" &&
+                  TFileType::isViewable(TFileType::getInfo(path)));
+  if (!decoded) return TFilePath();
+
+  if (!path.isLevelName()) return path;
+
+  // The first frame of a sequence is not known without listing its folder
+  if (fid == TFrameId::NO_FRAME) return TFilePath();
+  return path.withFrame(fid);
+}
+
+//-----------------------------------------------------------------------------
+
 TRaster32P IconGenerator::generateVectorFileIcon(const TFilePath &path,
                                                  const TDimension &iconSize,
                                                  const TFrameId &fid) {
@@ -1148,7 +1445,7 @@ TRaster32P IconGenerator::generateSceneFileIcon(const TFilePath &path,
 
 //-----------------------------------------------------------------------------
 
-void FileIconRenderer::run() {
+void FileIconRenderer::render() {
   TDimension iconSize(getIconSize());
   try {
     TRaster32P iconRaster;
@@ -1258,6 +1555,7 @@ void FileIconRenderer::run() {
       return;
     }
     setIcon(iconRaster);
+    m_decoded = true;
   } catch (const TImageVersionException &) {
     QPixmap unknown(
         svgToPixmap(getIconThemePath("mimetypes/60/unknown_icon.svg"),
@@ -1286,7 +1584,7 @@ public:
 
   static std::string getId() { return "currentScene"; }
 
-  void run() override;
+  void render() override;
   TRaster32P generateIcon(const TDimension &iconSize) const;
 };
 
@@ -1299,14 +1597,33 @@ TRaster32P SceneIconRenderer::generateIcon(const TDimension &iconSize) const {
   bgColor.m        = 255;
   ras->fill(bgColor);
 
-  m_toonzScene->renderFrame(ras, 0, 0, false);
+  // composited on all cores, as in XsheetIconRenderer
+  m_toonzScene->renderFrame(ras, 0, 0, false, 0);
 
   return ras;
 }
 
 //-----------------------------------------------------------------------------
 
-void SceneIconRenderer::run() { setIcon(generateIcon(getIconSize())); }
+void SceneIconRenderer::render() { setIcon(generateIcon(getIconSize())); }
+
+//=============================================================================
+
+namespace {
+
+// Returns the file storing a level frame, whose icon goes to the thumbnail
+// store. Only frames read unchanged from a saved file are stored.
+TFilePath getLevelStorePath(TXshSimpleLevel *sl, const TFrameId &fid) {
+  ToonzScene *scene = sl->getScene();
+  if (!scene || sl->getDirtyFlag() ||
+      sl->getFrameStatus(fid) != TXshSimpleLevel::Normal)
+    return TFilePath();
+
+  TFilePath path = scene->decodeFilePath(sl->getPath());
+  return path.isLevelName() ? path.withFrame(fid) : path;
+}
+
+}  // namespace
 
 //=============================================================================
 
@@ -1316,7 +1633,8 @@ void SceneIconRenderer::run() { setIcon(generateIcon(getIconSize())); }
 //
 //-----------------------------------
 
-IconGenerator::IconGenerator() : m_iconSize(FilmstripIconSize) {
+IconGenerator::IconGenerator()
+    : m_iconSize(FilmstripIconSize), m_requestCount(0) {
   m_executor.setMaxActiveTasks(1);  // Only one thread to render icons...
   m_executor.setDedicatedThreads(true);
 }
@@ -1357,9 +1675,109 @@ TOfflineGL *IconGenerator::getOfflineGLContext() {
 //-----------------------------------------------------------------------------
 
 void IconGenerator::addTask(const std::string &id,
-                            TThread::RunnableP iconRenderer) {
+                            TThread::RunnableP iconRenderer,
+                            RequestGroup group) {
   iconsMap.insert(id);
-  m_executor.addTask(iconRenderer);
+
+  // A new request for a queued icon replaces the old one
+  std::map<std::string, Request>::iterator it = m_requests.find(id);
+  if (it != m_requests.end()) m_queue.erase(it->second.m_mark);
+
+  Request request         = {iconRenderer, group, ++m_requestCount};
+  m_requests[id]          = request;
+  m_queue[request.m_mark] = id;
+
+  submitNext();
+}
+
+//-----------------------------------------------------------------------------
+
+//! Called when an icon already in the icons map is requested again: if it is
+//! still queued, moves it to the front of the queue.
+void IconGenerator::renewRequest(const std::string &id) {
+  std::map<std::string, Request>::iterator it = m_requests.find(id);
+  if (it == m_requests.end()) {
+    if (hitIcons.insert(id).second) ++memoryHitsCount;
+    return;
+  }
+
+  Request &request = it->second;
+  bool queued      = m_queue.erase(request.m_mark) > 0;
+
+  request.m_mark = ++m_requestCount;
+  if (queued) m_queue[request.m_mark] = id;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Submits the most recent queued request to the executor, unless a submitted
+//! one is still waiting to start. Keeping a single icon task in the executor
+//! lets the icons be ordered among themselves without raising their
+//! scheduling priority over other tasks'.
+void IconGenerator::submitNext() {
+  if (m_waitingTask || m_queue.empty()) return;
+
+  std::map<int, std::string>::iterator qt = --m_queue.end();
+  m_waitingTask = m_requests[qt->second].m_renderer;
+  m_queue.erase(qt);
+
+  m_executor.addTask(m_waitingTask);
+}
+
+//-----------------------------------------------------------------------------
+
+void IconGenerator::releaseRequest(TThread::RunnableP iconRenderer) {
+  IconRenderer *ir = static_cast<IconRenderer *>(iconRenderer.getPointer());
+
+  std::map<std::string, Request>::iterator it = m_requests.find(ir->getId());
+  if (it != m_requests.end() &&
+      it->second.m_renderer.getPointer() == iconRenderer.getPointer())
+    m_requests.erase(it);
+}
+
+//-----------------------------------------------------------------------------
+
+void IconGenerator::cancelRequestsBefore(int mark, RequestGroup group) {
+  std::map<std::string, Request>::iterator it = m_requests.begin();
+  while (it != m_requests.end()) {
+    Request &request = it->second;
+
+    // Submitted requests are left to the executor
+    if (request.m_group != group || request.m_mark > mark ||
+        !m_queue.erase(request.m_mark)) {
+      ++it;
+      continue;
+    }
+
+    removeIcon(it->first);
+    ++canceledCount;
+    it = m_requests.erase(it);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+IconGenerator::Statistics IconGenerator::getStatistics() const {
+  Statistics stats;
+  stats.m_memoryHits = memoryHitsCount;
+  stats.m_storeHits  = storeHitsCount;
+  stats.m_renders    = rendersCount;
+  stats.m_canceled   = canceledCount;
+  stats.m_renderTime = renderTimeNs * 1.0e-6;
+  return stats;
+}
+
+//-----------------------------------------------------------------------------
+
+void IconGenerator::resetStatistics() {
+  memoryHitsCount = storeHitsCount = rendersCount = canceledCount = 0;
+  renderTimeNs    = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+void IconGenerator::enableThumbnailStore(bool enabled) {
+  ThumbnailStore::instance()->setEnabled(enabled);
 }
 
 //-----------------------------------------------------------------------------
@@ -1373,7 +1791,10 @@ QPixmap IconGenerator::getIcon(TXshLevel *xl, const TFrameId &fid,
 
     std::string id = XsheetIconRenderer::getId(cl, fid.getNumber() - 1);
     QPixmap pix;
-    if (::getIcon(id, pix)) return pix;
+    if (::getIcon(id, pix)) {
+      renewRequest(id);
+      return pix;
+    }
 
     if (onDemand) return pix;
 
@@ -1382,7 +1803,8 @@ QPixmap IconGenerator::getIcon(TXshLevel *xl, const TFrameId &fid,
     // The icon must be calculated - add an IconRenderer task.
     // storeIcon(id, QPixmap());   //It was automatically added by the former
     // access
-    addTask(id, new XsheetIconRenderer(id, iconSize, cl->getXsheet()));
+    addTask(id, new XsheetIconRenderer(id, iconSize, cl->getXsheet()),
+            CellIcons);
   }
 
   if (TXshSimpleLevel *sl = xl->getSimpleLevel()) {
@@ -1401,7 +1823,10 @@ QPixmap IconGenerator::getIcon(TXshLevel *xl, const TFrameId &fid,
     if (!filmStrip) id += "_small";
 
     QPixmap pix;
-    if (::getIcon(id, pix, xl->getSimpleLevel())) return pix;
+    if (::getIcon(id, pix, xl->getSimpleLevel())) {
+      renewRequest(id);
+      return pix;
+    }
 
     if (onDemand) return pix;
 
@@ -1411,29 +1836,39 @@ QPixmap IconGenerator::getIcon(TXshLevel *xl, const TFrameId &fid,
     if (!filmStrip) m_settings = IconGenerator::Settings();
 
     TDimension iconSize = filmStrip ? m_iconSize : TDimension(80, 60);
+    RequestGroup group  = filmStrip ? FilmstripIcons : CellIcons;
 
     // storeIcon(id, QPixmap());
 
-    int type = sl->getType();
+    // Vector and mesh icons depend on the icon settings and are not stored
+    IconRenderer *ir = 0;
+    int type         = sl->getType();
     switch (type) {
     case OVL_XSHLEVEL:
     case TZI_XSHLEVEL:
-      addTask(id, new RasterImageIconRenderer(id, iconSize, sl, fid));
+      ir = new RasterImageIconRenderer(id, iconSize, sl, fid);
+      ir->setStoredFile("level", getLevelStorePath(sl, fid), fid);
+      addTask(id, ir, group);
       break;
     case PLI_XSHLEVEL:
       addTask(id,
-              new VectorImageIconRenderer(id, iconSize, sl, fid, m_settings));
+              new VectorImageIconRenderer(id, iconSize, sl, fid, m_settings),
+              group);
       break;
     case TZP_XSHLEVEL:
       // Yep, we could have rasters, due to a cleanupping process
       if (status == TXshSimpleLevel::Scanned)
-        addTask(id, new RasterImageIconRenderer(id, iconSize, sl, fid));
-      else
-        addTask(id,
-                new ToonzImageIconRenderer(id, iconSize, sl, fid, m_settings));
+        addTask(id, new RasterImageIconRenderer(id, iconSize, sl, fid), group);
+      else {
+        ir = new ToonzImageIconRenderer(id, iconSize, sl, fid, m_settings);
+        ir->setStoredFile("level", getLevelStorePath(sl, fid), fid);
+        addTask(id, ir, group);
+      }
       break;
     case MESH_XSHLEVEL:
-      addTask(id, new MeshImageIconRenderer(id, iconSize, sl, fid, m_settings));
+      addTask(id,
+              new MeshImageIconRenderer(id, iconSize, sl, fid, m_settings),
+              group);
       break;
     default:
       assert(false);
@@ -1455,7 +1890,10 @@ QPixmap IconGenerator::getSizedIcon(TXshLevel *xl, const TFrameId &fid,
   if (TXshChildLevel *cl = xl->getChildLevel()) {
     std::string id = XsheetIconRenderer::getId(cl, fid.getNumber() - 1);
     QPixmap pix;
-    if (::getIcon(id, pix)) return pix;
+    if (::getIcon(id, pix)) {
+      renewRequest(id);
+      return pix;
+    }
 
     // if (onDemand) return pix;
 
@@ -1486,7 +1924,10 @@ QPixmap IconGenerator::getSizedIcon(TXshLevel *xl, const TFrameId &fid,
     id += newId;
 
     QPixmap pix;
-    if (::getIcon(id, pix, xl->getSimpleLevel())) return pix;
+    if (::getIcon(id, pix, xl->getSimpleLevel())) {
+      renewRequest(id);
+      return pix;
+    }
 
     // if (onDemand) return pix;
 
@@ -1548,23 +1989,28 @@ void IconGenerator::invalidate(TXshLevel *xl, const TFrameId &fid,
     switch (type) {
     case OVL_XSHLEVEL:
     case TZI_XSHLEVEL:
-      addTask(id, new RasterImageIconRenderer(id, getIconSize(), sl, fid));
+      addTask(id, new RasterImageIconRenderer(id, getIconSize(), sl, fid),
+              FilmstripIcons);
       break;
     case PLI_XSHLEVEL:
       removeIcon(id);
       addTask(id, new VectorImageIconRenderer(id, getIconSize(), sl, fid,
-                                              m_settings));
+                                              m_settings),
+              FilmstripIcons);
       break;
     case TZP_XSHLEVEL:
       if (sl->getFrameStatus(fid) == TXshSimpleLevel::Scanned)
-        addTask(id, new RasterImageIconRenderer(id, getIconSize(), sl, fid));
+        addTask(id, new RasterImageIconRenderer(id, getIconSize(), sl, fid),
+                FilmstripIcons);
       else
         addTask(id, new ToonzImageIconRenderer(id, getIconSize(), sl, fid,
-                                               m_settings));
+                                               m_settings),
+                FilmstripIcons);
       break;
     case MESH_XSHLEVEL:
       addTask(id, new MeshImageIconRenderer(id, getIconSize(), sl, fid,
-                                            m_settings));
+                                            m_settings),
+              FilmstripIcons);
       break;
     default:
       assert(false);
@@ -1586,23 +2032,28 @@ void IconGenerator::invalidate(TXshLevel *xl, const TFrameId &fid,
     switch (type) {
     case OVL_XSHLEVEL:
     case TZI_XSHLEVEL:
-      addTask(id, new RasterImageIconRenderer(id, TDimension(80, 60), sl, fid));
+      addTask(id, new RasterImageIconRenderer(id, TDimension(80, 60), sl, fid),
+              CellIcons);
       break;
     case PLI_XSHLEVEL:
       addTask(id, new VectorImageIconRenderer(id, TDimension(80, 60), sl, fid,
-                                              m_settings));
+                                              m_settings),
+              CellIcons);
       break;
     case TZP_XSHLEVEL:
       if (sl->getFrameStatus(fid) == TXshSimpleLevel::Scanned)
         addTask(id,
-                new RasterImageIconRenderer(id, TDimension(80, 60), sl, fid));
+                new RasterImageIconRenderer(id, TDimension(80, 60), sl, fid),
+                CellIcons);
       else
         addTask(id, new ToonzImageIconRenderer(id, TDimension(80, 60), sl, fid,
-                                               m_settings));
+                                               m_settings),
+                CellIcons);
       break;
     case MESH_XSHLEVEL:
       addTask(id, new MeshImageIconRenderer(id, TDimension(80, 60), sl, fid,
-                                            m_settings));
+                                            m_settings),
+              CellIcons);
       break;
     default:
       assert(false);
@@ -1644,7 +2095,10 @@ QPixmap IconGenerator::getIcon(TStageObjectSpline *spline) {
   std::string iconName = spline->getIconId();
 
   QPixmap pix;
-  if (::getIcon(iconName, pix)) return pix;
+  if (::getIcon(iconName, pix)) {
+    renewRequest(iconName);
+    return pix;
+  }
 
   // storeIcon(id, QPixmap());
   addTask(iconName, new SplineIconRenderer(iconName, getIconSize(), spline));
@@ -1679,9 +2133,14 @@ QPixmap IconGenerator::getIcon(const TFilePath &path, const TFrameId &fid) {
   TDimension fileIconSize(80, 60);
   // Here the fileIconSize is input in order to check if the icon is obtained
   // with high-dpi (i.e. devPixRatio > 1.0).
-  if (::getIcon(id, pix, 0, fileIconSize)) return pix;
+  if (::getIcon(id, pix, 0, fileIconSize)) {
+    renewRequest(id);
+    return pix;
+  }
 
-  addTask(id, new FileIconRenderer(fileIconSize, path, fid));
+  FileIconRenderer *ir = new FileIconRenderer(fileIconSize, path, fid);
+  ir->setStoredFile("file", FileIconRenderer::getStorePath(path, fid), fid);
+  addTask(id, ir, FileIcons);
 
   return QPixmap();
 }
@@ -1691,7 +2150,14 @@ QPixmap IconGenerator::getIcon(const TFilePath &path, const TFrameId &fid) {
 void IconGenerator::invalidate(const TFilePath &path, const TFrameId &fid) {
   std::string id = FileIconRenderer::getId(path, fid);
   removeIcon(id);
-  addTask(id, new FileIconRenderer(TDimension(80, 60), path, fid));
+
+  // The file may have changed within the modification time's resolution: the
+  // stored icon is rendered again and replaced
+  TDimension fileIconSize(80, 60);
+  FileIconRenderer *ir = new FileIconRenderer(fileIconSize, path, fid);
+  ir->setStoredFile("file", FileIconRenderer::getStorePath(path, fid), fid,
+                    true);
+  addTask(id, ir, FileIcons);
 }
 
 //-----------------------------------------------------------------------------
@@ -1706,7 +2172,10 @@ QPixmap IconGenerator::getSceneIcon(ToonzScene *scene) {
   std::string id(SceneIconRenderer::getId());
 
   QPixmap pix;
-  if (::getIcon(id, pix)) return pix;
+  if (::getIcon(id, pix)) {
+    renewRequest(id);
+    return pix;
+  }
 
   // storeIcon(id, QPixmap());
   addTask(id, new SceneIconRenderer(getIconSize(), scene));
@@ -1735,7 +2204,18 @@ void IconGenerator::remap(const std::string &newIconId,
 
 //-----------------------------------------------------------------------------
 
-void IconGenerator::clearRequests() { m_executor.cancelAll(); }
+void IconGenerator::clearRequests() {
+  // Queued requests were never submitted to the executor
+  std::map<int, std::string>::iterator it;
+  for (it = m_queue.begin(); it != m_queue.end(); ++it) {
+    removeIcon(it->second);
+    m_requests.erase(it->second);
+    ++canceledCount;
+  }
+  m_queue.clear();
+
+  m_executor.cancelAll();
+}
 
 //-----------------------------------------------------------------------------
 
@@ -1753,6 +2233,8 @@ void IconGenerator::clearSceneIcons() {
   // note the ';' - which follows ':' in the ascii table
   iconsMap.erase(iconsMap.begin(), iconsMap.lower_bound("$:"));
   iconsMap.erase(iconsMap.lower_bound("$;"), iconsMap.end());
+  hitIcons.erase(hitIcons.begin(), hitIcons.lower_bound("$:"));
+  hitIcons.erase(hitIcons.lower_bound("$;"), hitIcons.end());
 }
 
 //-----------------------------------------------------------------------------
@@ -1761,6 +2243,11 @@ void IconGenerator::onStarted(TThread::RunnableP iconRenderer) {
   IconRenderer *ir = static_cast<IconRenderer *>(iconRenderer.getPointer());
 
   ir->hasStarted() = true;
+
+  if (iconRenderer.getPointer() == m_waitingTask.getPointer()) {
+    m_waitingTask = TThread::RunnableP();
+    submitNext();
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -1770,6 +2257,13 @@ void IconGenerator::onCanceled(TThread::RunnableP iconRenderer) {
 
   if (!ir->hasStarted()) {
     removeIcon(ir->getId());
+    releaseRequest(iconRenderer);
+    ++canceledCount;
+  }
+
+  if (iconRenderer.getPointer() == m_waitingTask.getPointer()) {
+    m_waitingTask = TThread::RunnableP();
+    submitNext();
   }
 }
 
@@ -1777,6 +2271,7 @@ void IconGenerator::onCanceled(TThread::RunnableP iconRenderer) {
 
 void IconGenerator::onFinished(TThread::RunnableP iconRenderer) {
   IconRenderer *ir = static_cast<IconRenderer *>(iconRenderer.getPointer());
+  releaseRequest(iconRenderer);
 
   // if the icon was generated in TToonzImage format, cache it instead
   ToonzImageIconRenderer *tir = dynamic_cast<ToonzImageIconRenderer *>(ir);
@@ -1803,6 +2298,7 @@ void IconGenerator::onFinished(TThread::RunnableP iconRenderer) {
 
 void IconGenerator::onException(TThread::RunnableP iconRenderer) {
   IconRenderer *ir = static_cast<IconRenderer *>(iconRenderer.getPointer());
+  releaseRequest(iconRenderer);
 
   if (ir->wasTerminated()) m_iconsTerminationLoop.quit();
 }
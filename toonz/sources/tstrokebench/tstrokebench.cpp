@@ -0,0 +1,608 @@
+
+
+// TnzTools includes
+#include "tools/tool.h"
+#include "tools/toolhandle.h"
+#include "tools/toolcommandids.h"
+
+// TnzQt includes
+#include "toonzqt/tselectionhandle.h"
+
+// TnzLib includes
+#include "toonz/toonzfolders.h"
+#include "toonz/toonzscene.h"
+#include "toonz/txsheet.h"
+#include "toonz/txshcell.h"
+#include "toonz/txshsimplelevel.h"
+#include "toonz/levelproperties.h"
+#include "toonz/tstageobjectid.h"
+#include "toonz/tscenehandle.h"
+#include "toonz/txsheethandle.h"
+#include "toonz/tframehandle.h"
+#include "toonz/tcolumnhandle.h"
+#include "toonz/txshlevelhandle.h"
+#include "toonz/tobjecthandle.h"
+#include "toonz/tonionskinmaskhandle.h"
+#include "toonz/tfxhandle.h"
+#include "toonz/tpalettehandle.h"
+#include "toonz/palettecontroller.h"
+#include "toonz/fullcolorpalette.h"
+#include "toonz/mypaintbrushstyle.h"
+#include "toonz/preferences.h"
+#include "toonz/stage.h"
+
+// TnzBase includes
+#include "tcli.h"
+#include "tenv.h"
+
+// TnzCore includes
+#include "tsystem.h"
+#include "tthread.h"
+#include "tundo.h"
+#include "tpalette.h"
+#include "ttoonzimage.h"
+#include "trasterimage.h"
+#include "tvectorimage.h"
+#include "timagecache.h"
+#include "tiio_std.h"
+#include "tnzimage.h"
+
+// Qt includes
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+// STD includes
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cmath>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace TCli;
+typedef QualifierT<TFilePath> FilePathQualifier;
+
+//==================================================================================
+
+/*
+  tstrokebench replays strokes into a drawing tool, on a synthetic level
+  created in memory, and reports how long the tool takes to process them.
+
+  Strokes are read from a text file with one event per line:
+
+    <time in ms> <x> <y> <pressure>
+
+  where x and y are in the tool's coordinates (pixels from the level's center
+  on raster levels). An empty line ends a stroke: its first event is the
+  button press, its last one the release. Without a strokes file, zigzag
+  strokes sampled like a 120 Hz tablet are synthesized.
+
+  On raster levels the brush draws with the level's plain style, or with a
+  MyPaint brush if one is given - e.g. "-mypaint classic/charcoal.myb", a
+  path relative to the library's MyPaint brushes.
+
+  Events are replayed as fast as possible: the reported times measure the
+  tool alone, without the viewer's repaint.
+*/
+
+namespace {
+
+const char *rootVarName     = "TOONZROOT";
+const char *systemVarPrefix = "TOONZ";
+
+//========================================================================
+
+struct StrokeEvent {
+  double m_time;  //!< Milliseconds since the start of the stroke.
+  TPointD m_pos;
+  double m_pressure;
+};
+
+typedef std::vector<StrokeEvent> Stroke;
+
+//------------------------------------------------------------------------
+
+bool loadStrokes(const TFilePath &fp, std::vector<Stroke> &strokes) {
+  QFile file(fp.getQString());
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+
+  QTextStream in(&file);
+  Stroke stroke;
+  while (!in.atEnd()) {
+    QString line = in.readLine().trimmed();
+    if (line.startsWith('#')) continue;
+    if (line.isEmpty()) {
+      if (!stroke.empty()) strokes.push_back(stroke), stroke.clear();
+      continue;
+    }
+
+    QStringList values = line.split(' ', QString::SkipEmptyParts);
+    if (values.size() < 3) return false;
+
+    StrokeEvent e;
+    e.m_time     = values[0].toDouble();
+    e.m_pos      = TPointD(values[1].toDouble(), values[2].toDouble());
+    e.m_pressure = values.size() > 3 ? values[3].toDouble() : 1.0;
+    stroke.push_back(e);
+  }
+  if (!stroke.empty()) strokes.push_back(stroke);
+
+  return true;
+}
+
+//------------------------------------------------------------------------
+
+//! Builds \b count zigzag strokes spanning most of a \b size level.
+void makeStrokes(const TDimension &size, int count, int eventCount,
+                 std::vector<Stroke> &strokes) {
+  const double eventTime = 1000.0 / 120.0;
+
+  double lx = size.lx * 0.8, ly = size.ly * 0.8;
+  for (int s = 0; s < count; ++s) {
+    Stroke stroke(eventCount);
+    double y0 = -0.5 * ly + ly * (s + 0.5) / count;
+    for (int i = 0; i < eventCount; ++i) {
+      double t = (double)i / std::max(eventCount - 1, 1);
+
+      StrokeEvent &e = stroke[i];
+      e.m_time       = i * eventTime;
+      e.m_pos        = TPointD(-0.5 * lx + lx * t,
+                        y0 + 0.5 * ly / count * sin(t * 8.0 * M_PI));
+      e.m_pressure   = 0.2 + 0.8 * sin(t * M_PI);
+    }
+    strokes.push_back(stroke);
+  }
+}
+
+//------------------------------------------------------------------------
+
+//! Returns the peak memory used by the process, in KB.
+TINT64 getPeakMemorySize() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS c;
+  c.cb = sizeof(PROCESS_MEMORY_COUNTERS);
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &c, sizeof(c))) return 0;
+  return c.PeakWorkingSetSize >> 10;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef MACOSX
+  return usage.ru_maxrss >> 10;  // bytes
+#else
+  return usage.ru_maxrss;  // KB
+#endif
+#endif
+}
+
+//========================================================================
+
+class BenchViewer final : public TTool::Viewer {
+  TDimension m_size;
+
+public:
+  BenchViewer(const TDimension &size) : m_size(size) {}
+
+  double getPixelSize() const override { return 1.0; }
+
+  void invalidateAll() override {}
+  void GLInvalidateAll() override {}
+  void GLInvalidateRect(const TRectD &rect) override {}
+  void invalidateToolStatus() override {}
+
+  int posToColumnIndex(const TPointD &p, double distance,
+                       bool includeInvisible) const override {
+    return 0;
+  }
+  void posToColumnIndexes(const TPointD &p, std::vector<int> &indexes,
+                          double distance,
+                          bool includeInvisible) const override {
+    indexes.push_back(0);
+  }
+  int posToRow(const TPointD &p, double distance, bool includeInvisible,
+               bool currentColumnOnly) const override {
+    return 0;
+  }
+
+  TPointD worldToPos(const TPointD &worldPos) const override {
+    return worldPos + TPointD(0.5 * m_size.lx, 0.5 * m_size.ly);
+  }
+  TPointD winToWorld(const TPointD &winPos) const override {
+    return TPointD(winPos.x - 0.5 * m_size.lx, 0.5 * m_size.ly - winPos.y);
+  }
+  int pick(const TPointD &point) override { return 0; }
+
+  void pan(const TPointD &delta) override {}
+  void zoom(const TPointD &center, double scaleFactor) override {}
+  void rotate(const TPointD &center, double angle) override {}
+  void rotate3D(double dPhi, double dTheta) override {}
+  bool is3DView() const override { return false; }
+  bool getIsFlippedX() const override { return false; }
+  bool getIsFlippedY() const override { return false; }
+  double projectToZ(const TPointD &delta) override { return 0.0; }
+
+  TPointD getDpiScale() const override { return TPointD(1.0, 1.0); }
+  int getVGuideCount() override { return 0; }
+  int getHGuideCount() override { return 0; }
+  double getHGuide(int index) override { return 0.0; }
+  double getVGuide(int index) override { return 0.0; }
+
+  void resetInputMethod() override {}
+  void setFocus() override {}
+
+  TRectD getGeometry() const override {
+    return TRectD(-0.5 * m_size.lx, -0.5 * m_size.ly, 0.5 * m_size.lx,
+                  0.5 * m_size.ly);
+  }
+};
+
+//========================================================================
+
+class BenchApplication final : public TTool::Application {
+  TSceneHandle m_currentScene;
+  TXsheetHandle m_currentXsheet;
+  TFrameHandle m_currentFrame;
+  TColumnHandle m_currentColumn;
+  TXshLevelHandle m_currentLevel;
+  ToolHandle m_currentTool;
+  TObjectHandle m_currentObject;
+  TOnionSkinMaskHandle m_currentOnionSkinMask;
+  TFxHandle m_currentFx;
+  PaletteController m_paletteController;
+
+public:
+  TFrameHandle *getCurrentFrame() const override {
+    return const_cast<TFrameHandle *>(&m_currentFrame);
+  }
+  TXshLevelHandle *getCurrentLevel() const override {
+    return const_cast<TXshLevelHandle *>(&m_currentLevel);
+  }
+  TXsheetHandle *getCurrentXsheet() const override {
+    return const_cast<TXsheetHandle *>(&m_currentXsheet);
+  }
+  TObjectHandle *getCurrentObject() const override {
+    return const_cast<TObjectHandle *>(&m_currentObject);
+  }
+  TColumnHandle *getCurrentColumn() const override {
+    return const_cast<TColumnHandle *>(&m_currentColumn);
+  }
+  TSceneHandle *getCurrentScene() const override {
+    return const_cast<TSceneHandle *>(&m_currentScene);
+  }
+  ToolHandle *getCurrentTool() const override {
+    return const_cast<ToolHandle *>(&m_currentTool);
+  }
+  TSelectionHandle *getCurrentSelection() const override {
+    return TSelectionHandle::getCurrent();
+  }
+  TOnionSkinMaskHandle *getCurrentOnionSkin() const override {
+    return const_cast<TOnionSkinMaskHandle *>(&m_currentOnionSkinMask);
+  }
+  TPaletteHandle *getCurrentPalette() const override {
+    return m_paletteController.getCurrentPalette();
+  }
+  TFxHandle *getCurrentFx() const override {
+    return const_cast<TFxHandle *>(&m_currentFx);
+  }
+  PaletteController *getPaletteController() const override {
+    return const_cast<PaletteController *>(&m_paletteController);
+  }
+
+  TColorStyle *getCurrentLevelStyle() const override {
+    return m_paletteController.getCurrentLevelPalette()->getStyle();
+  }
+  int getCurrentLevelStyleIndex() const override {
+    return m_paletteController.getCurrentLevelPalette()->getStyleIndex();
+  }
+  void setCurrentLevelStyleIndex(int index, bool forceUpdate) override {
+    m_paletteController.getCurrentLevelPalette()->setStyleIndex(index,
+                                                                 forceUpdate);
+  }
+  void refreshStatusBar() override {}
+
+  //! Makes a one-frame level of \b levelType the current one.
+  TXshSimpleLevel *setupLevel(ToonzScene *scene, int levelType,
+                              const TDimension &size);
+};
+
+//------------------------------------------------------------------------
+
+TXshSimpleLevel *BenchApplication::setupLevel(ToonzScene *scene,
+                                              int levelType,
+                                              const TDimension &size) {
+  const double dpi = Stage::standardDpi;
+
+  TXshLevel *level = scene->createNewLevel(levelType, L"bench");
+  TXshSimpleLevel *sl = level ? level->getSimpleLevel() : 0;
+  if (!sl) return 0;
+
+  TFrameId fid(1);
+  if (levelType == TZP_XSHLEVEL || levelType == OVL_XSHLEVEL) {
+    sl->getProperties()->setDpiPolicy(LevelProperties::DP_ImageDpi);
+    sl->getProperties()->setDpi(dpi);
+    sl->getProperties()->setImageDpi(TPointD(dpi, dpi));
+    sl->getProperties()->setImageRes(size);
+  }
+
+  TPalette *palette = 0;
+  if (levelType == PLI_XSHLEVEL) {
+    sl->setFrame(fid, new TVectorImage());
+    palette = sl->getPalette();
+  } else if (levelType == TZP_XSHLEVEL) {
+    TRasterCM32P raster(size);
+    raster->fill(TPixelCM32());
+    TToonzImageP ti(raster, TRect());
+    ti->setDpi(dpi, dpi);
+    ti->setSavebox(raster->getBounds());
+    sl->setFrame(fid, ti);
+    palette = sl->getPalette();
+  } else {
+    TRaster32P raster(size);
+    raster->clear();
+    TRasterImageP ri(raster);
+    ri->setDpi(dpi, dpi);
+    sl->setFrame(fid, ri);
+    palette = FullColorPalette::instance()->getPalette(scene);
+  }
+  scene->getXsheet()->setCell(0, 0, TXshCell(sl, fid));
+
+  m_currentScene.setScene(scene);
+  m_currentXsheet.setXsheet(scene->getXsheet());
+  m_currentFrame.setFrame(0);
+  m_currentColumn.setColumnIndex(0);
+  m_currentObject.setObjectId(TStageObjectId::ColumnId(0));
+  m_currentLevel.setLevel(sl);
+  m_paletteController.getCurrentLevelPalette()->setPalette(palette, 1);
+  m_paletteController.setCurrentPalette(
+      m_paletteController.getCurrentLevelPalette());
+
+  return sl;
+}
+
+//========================================================================
+
+//! Statistics of a set of durations, in milliseconds.
+class Timings {
+  std::vector<double> m_values;
+
+public:
+  void add(double ms) { m_values.push_back(ms); }
+
+  void print(ostream &out, const string &name) {
+    out << left << setw(10) << name << right << setw(8) << m_values.size();
+    if (m_values.empty()) {
+      out << endl;
+      return;
+    }
+
+    std::sort(m_values.begin(), m_values.end());
+    double sum = 0.0;
+    for (double value : m_values) sum += value;
+
+    auto percentile = [this](double p) {
+      return m_values[std::min((size_t)(p * m_values.size()),
+                               m_values.size() - 1)];
+    };
+    out << fixed << setprecision(3) << setw(10) << sum / m_values.size()
+        << setw(10) << percentile(0.5) << setw(10) << percentile(0.95)
+        << setw(10) << percentile(0.99) << setw(10) << m_values.back()
+        << endl;
+  }
+};
+
+//------------------------------------------------------------------------
+
+inline double elapsedMs(const QElapsedTimer &timer) {
+  return timer.nsecsElapsed() * 1e-6;
+}
+
+//------------------------------------------------------------------------
+
+void fatalError(const string &msg) {
+  cerr << msg << endl;
+  exit(1);
+}
+
+}  // namespace
+
+//==================================================================================
+
+int main(int argc, char *argv[]) {
+  StringQualifier toolName("-tool name",
+                           "Tool to benchmark: brush (default) or fill");
+  StringQualifier levelTypeName(
+      "-level type", "Level type: tlv (default), pli or raster");
+  IntQualifier lxQual("-lx n", "Level width, in pixels (default 1920)");
+  IntQualifier lyQual("-ly n", "Level height, in pixels (default 1080)");
+  FilePathQualifier strokesName("-strokes file", "Strokes to replay");
+  FilePathQualifier mypaintName("-mypaint brush",
+                                "MyPaint brush to draw with (tlv, raster)");
+  IntQualifier countQual("-count n",
+                         "Number of synthesized strokes (default 20)");
+  IntQualifier eventQual("-events n",
+                         "Events per synthesized stroke (default 240)");
+  IntQualifier repeatQual("-repeat n", "Replays of the strokes (default 1)");
+  FilePathQualifier csvName("-csv file", "Writes the time of each event");
+
+  Usage usage(argv[0]);
+  usage.add(toolName + levelTypeName + lxQual + lyQual + strokesName +
+            mypaintName + countQual + eventQual + repeatQual + csvName);
+  if (!usage.parse(argc, argv)) exit(1);
+
+  QApplication app(argc, argv);
+  setlocale(LC_NUMERIC, "C");
+
+  TThread::init();
+
+  TEnv::setRootVarName(rootVarName);
+  TEnv::setSystemVarPrefix(systemVarPrefix);
+  TEnv::setApplicationFileName(argv[0]);
+
+  TSystem::hasMainLoop(false);
+  Tiio::defineStd();
+  initImageIo();
+  Preferences::instance();
+
+  TFilePath cacheRoot = ToonzFolder::getCacheRootFolder();
+  if (cacheRoot.isEmpty()) cacheRoot = TEnv::getStuffDir() + "cache";
+  TImageCache::instance()->setRootDir(cacheRoot);
+  TImageStyle::setLibraryDir(ToonzFolder::getLibraryFolder());
+
+  // Parse the options
+  string levelTypeStr = levelTypeName.isSelected() ? levelTypeName.getValue()
+                                                   : string("tlv");
+  int levelType;
+  TImage::Type imageType;
+  if (levelTypeStr == "tlv")
+    levelType = TZP_XSHLEVEL, imageType = TImage::TOONZ_RASTER;
+  else if (levelTypeStr == "pli")
+    levelType = PLI_XSHLEVEL, imageType = TImage::VECTOR;
+  else if (levelTypeStr == "raster")
+    levelType = OVL_XSHLEVEL, imageType = TImage::RASTER;
+  else
+    fatalError("Unknown level type: " + levelTypeStr);
+
+  string toolStr =
+      toolName.isSelected() ? toolName.getValue() : string("brush");
+  QString toolId;
+  if (toolStr == "brush")
+    toolId = T_Brush;
+  else if (toolStr == "fill")
+    toolId = T_Fill;
+  else
+    fatalError("Unknown tool: " + toolStr);
+
+  TDimension size(lxQual.isSelected() ? lxQual.getValue() : 1920,
+                  lyQual.isSelected() ? lyQual.getValue() : 1080);
+  if (size.lx <= 0 || size.ly <= 0) fatalError("Invalid level size");
+
+  std::vector<Stroke> strokes;
+  if (strokesName.isSelected()) {
+    if (!loadStrokes(strokesName.getValue(), strokes))
+      fatalError("Can't read " + ::to_string(strokesName.getValue()));
+  } else
+    makeStrokes(size, countQual.isSelected() ? countQual.getValue() : 20,
+                eventQual.isSelected() ? eventQual.getValue() : 240,
+                strokes);
+  if (strokes.empty()) fatalError("No strokes to replay");
+
+  int repeatCount = repeatQual.isSelected() ? repeatQual.getValue() : 1;
+
+  // Build the synthetic scene
+  BenchApplication application;
+  TTool::setApplication(&application);
+
+  ToonzScene *scene = new ToonzScene();
+  if (!application.setupLevel(scene, levelType, size))
+    fatalError("Can't create the level");
+
+  if (mypaintName.isSelected()) {
+    if (levelType == PLI_XSHLEVEL)
+      fatalError("MyPaint brushes need a tlv or raster level");
+
+    TMyPaintBrushStyle *style =
+        new TMyPaintBrushStyle(mypaintName.getValue());
+    style->setMainColor(TPixel32::Black);
+
+    TPaletteHandle *paletteHandle =
+        application.getPaletteController()->getCurrentLevelPalette();
+    paletteHandle->getPalette()->setStyle(paletteHandle->getStyleIndex(),
+                                          style);
+  }
+
+  // the tool handle picks the tool for the level type, and activates it
+  ToolHandle *toolHandle = application.getCurrentTool();
+  toolHandle->setTool(toolId);
+  toolHandle->onImageChanged(imageType);
+  TTool *tool = toolHandle->getTool();
+  if (!tool) fatalError("No " + toolStr + " tool for " + levelTypeStr);
+
+  BenchViewer viewer(size);
+  tool->setViewer(&viewer);
+  QString disabledReason = tool->updateEnabled();
+  if (!tool->isEnabled())
+    fatalError("The tool is disabled: " + disabledReason.toStdString());
+
+  // Replay
+  ofstream csv;
+  if (csvName.isSelected()) {
+    csv.open(::to_string(csvName.getValue()).c_str());
+    csv << "stroke,event,time_ms,process_ms" << endl;
+  }
+
+  Timings downTimings, dragTimings, upTimings;
+  TINT64 startMemory = getPeakMemorySize();
+  QElapsedTimer totalTimer;
+  totalTimer.start();
+
+  int strokeIndex = 0;
+  for (int r = 0; r < repeatCount; ++r)
+    for (const Stroke &stroke : strokes) {
+      for (int i = 0; i < (int)stroke.size(); ++i) {
+        const StrokeEvent &se = stroke[i];
+
+        TMouseEvent e;
+        e.m_pos      = viewer.worldToPos(se.m_pos);
+        e.m_pressure = se.m_pressure;
+        e.m_isTablet = true;
+        e.m_buttons  = Qt::LeftButton;
+        e.m_button   = Qt::LeftButton;
+        e.m_mousePos = QPointF(e.m_pos.x, size.ly - e.m_pos.y);
+
+        QElapsedTimer timer;
+        timer.start();
+        if (i == 0) {
+          tool->preLeftButtonDown();
+          tool->leftButtonDown(se.m_pos, e);
+        } else
+          tool->leftButtonDrag(se.m_pos, e);
+        double ms = elapsedMs(timer);
+        (i == 0 ? downTimings : dragTimings).add(ms);
+        if (csv.is_open())
+          csv << strokeIndex << "," << i << "," << se.m_time << "," << ms
+              << endl;
+
+        // the release commits the stroke: undo, level and cache updates
+        if (i == (int)stroke.size() - 1) {
+          e.m_buttons = Qt::NoButton;
+          timer.restart();
+          tool->leftButtonUp(se.m_pos, e);
+          upTimings.add(elapsedMs(timer));
+        }
+      }
+      ++strokeIndex;
+    }
+
+  double totalMs = elapsedMs(totalTimer);
+  tool->onDeactivate();
+
+  // Report
+  cout << "tool " << toolStr;
+  if (mypaintName.isSelected())
+    cout << " (MyPaint " << ::to_string(mypaintName.getValue()) << ")";
+  cout << " on a " << size.lx << "x" << size.ly << " " << levelTypeStr
+       << " level, " << strokeIndex << " strokes" << endl
+       << endl;
+  cout << left << setw(10) << "(ms)" << right << setw(8) << "count"
+       << setw(10) << "mean" << setw(10) << "median" << setw(10) << "95%"
+       << setw(10) << "99%" << setw(10) << "max" << endl;
+  downTimings.print(cout, "press");
+  dragTimings.print(cout, "drag");
+  upTimings.print(cout, "commit");
+  cout << endl
+       << "total " << fixed << setprecision(1) << totalMs << " ms, "
+       << TUndoManager::manager()->getHistoryCount() << " undos" << endl;
+  cout << "peak memory " << (getPeakMemorySize() >> 10) << " MB (" << fixed
+       << setprecision(1) << (getPeakMemorySize() - startMemory) / 1024.0
+       << " MB during the replay)" << endl;
+
+  return 0;
+}